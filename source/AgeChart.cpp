@@ -0,0 +1,104 @@
+//
+//  AgeChart.cpp
+//
+//  Copyright © 2020 Ravbug. All rights reserved.
+//
+
+#include "AgeChart.hpp"
+#include "FolderDisplay.hpp"
+#include <wx/dcbuffer.h>
+
+namespace{
+	//newest to oldest
+	const wxColour bucketColours[AgeBuckets::count] = {
+		wxColour(90, 180, 90), wxColour(220, 200, 70), wxColour(235, 140, 50), wxColour(80, 130, 220)
+	};
+	const int rowHeight = 18;
+	const int labelWidth = 70;
+}
+
+AgeChart::AgeChart(wxWindow* parent) : wxPanel(parent, wxID_ANY, wxDefaultPosition, wxSize(-1, rowHeight * 3 + 8)){
+	SetBackgroundStyle(wxBG_STYLE_PAINT);
+	Bind(wxEVT_PAINT, &AgeChart::OnPaint, this);
+}
+
+/**
+ @return a short name for a bucket, such as "30-90d"
+ */
+wxString AgeChart::bucketName(size_t bucket){
+	if (bucket == 0){
+		return wxString::Format("<%dd", AgeBuckets::limits[0]);
+	}
+	if (bucket == AgeBuckets::count - 1){
+		return wxString::Format(">%dd", AgeBuckets::limits[bucket - 1]);
+	}
+	return wxString::Format("%d-%dd", AgeBuckets::limits[bucket - 1], AgeBuckets::limits[bucket]);
+}
+
+/**
+ Show an item's ages
+ @param modifiedAge bytes by time since modification
+ @param accessedAge bytes by time since access
+ */
+void AgeChart::SetBuckets(const AgeBuckets& modifiedAge, const AgeBuckets& accessedAge){
+	modified = modifiedAge;
+	accessed = accessedAge;
+	hasData = true;
+	wxString tip;
+	for (size_t i = 0; i < AgeBuckets::count; i++){
+		tip += wxString::Format("%s: %s modified, %s accessed\n", bucketName(i), FolderDisplay::sizeToString(modified.bytes[i]), FolderDisplay::sizeToString(accessed.bytes[i]));
+	}
+	SetToolTip(tip.Trim());
+	Refresh();
+}
+
+/**
+ Show nothing
+ */
+void AgeChart::Clear(){
+	hasData = false;
+	UnsetToolTip();
+	Refresh();
+}
+
+void AgeChart::OnPaint(wxPaintEvent&){
+	wxAutoBufferedPaintDC dc(this);
+	dc.SetBackground(wxBrush(GetBackgroundColour()));
+	dc.Clear();
+	const wxSize size = GetClientSize();
+	dc.SetFont(GetFont());
+	dc.SetTextForeground(wxSystemSettings::GetColour(wxSYS_COLOUR_WINDOWTEXT));
+	dc.SetPen(*wxTRANSPARENT_PEN);
+	
+	//one stacked bar per kind of age
+	const int barWidth = size.x - labelWidth - 10;
+	const std::pair<const char*, const AgeBuckets*> bars[] = {{"Modified", &modified}, {"Accessed", &accessed}};
+	int y = 2;
+	for (const auto& bar : bars){
+		dc.DrawText(bar.first, 5, y);
+		const fileSize total = bar.second->from(0);
+		if (hasData && total > 0 && barWidth > 0){
+			int x = labelWidth;
+			fileSize before = 0;
+			for (size_t i = 0; i < AgeBuckets::count; i++){
+				//position each edge from the running total so the segments fill the bar exactly
+				before += bar.second->bytes[i];
+				const int end = labelWidth + (int)((double)before / total * barWidth);
+				dc.SetBrush(wxBrush(bucketColours[i]));
+				dc.DrawRectangle(x, y + 2, end - x, rowHeight - 4);
+				x = end;
+			}
+		}
+		y += rowHeight;
+	}
+	
+	//legend
+	int x = 5;
+	for (size_t i = 0; i < AgeBuckets::count; i++){
+		dc.SetBrush(wxBrush(bucketColours[i]));
+		dc.DrawRectangle(x, y + 4, 10, 10);
+		const wxString name = bucketName(i);
+		dc.DrawText(name, x + 13, y);
+		x += 13 + dc.GetTextExtent(name).x + 10;
+	}
+}
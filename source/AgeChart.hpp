@@ -0,0 +1,28 @@
+//
+//  AgeChart.hpp
+//
+//  Copyright © 2020 Ravbug. All rights reserved.
+//
+
+#pragma once
+#include "globals.h"
+#include "DirectoryData.hpp"
+
+/**
+ Draws how an item's bytes are spread across the AgeBuckets, with one bar for
+ time since modification and one for time since access
+ */
+class AgeChart : public wxPanel{
+public:
+	AgeChart(wxWindow* parent);
+	void SetBuckets(const AgeBuckets& modified, const AgeBuckets& accessed);
+	void Clear();
+	
+private:
+	AgeBuckets modified;
+	AgeBuckets accessed;
+	bool hasData = false;
+	
+	void OnPaint(wxPaintEvent&);
+	static wxString bucketName(size_t bucket);
+};
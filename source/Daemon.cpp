@@ -0,0 +1,812 @@
+//
+//  Daemon.cpp
+//
+//  Copyright © 2020 Ravbug. All rights reserved.
+//
+
+#include "Daemon.hpp"
+#include "Epoch.hpp"
+#include <algorithm>
+#include <unordered_map>
+#include <iostream>
+#include <sstream>
+#include <cstring>
+#include <cerrno>
+#include <csignal>
+#include <chrono>
+#if !defined _WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <poll.h>
+#endif
+
+using namespace std;
+
+namespace{
+	//macOS has no MSG_NOSIGNAL, the daemon ignores SIGPIPE instead
+#if defined MSG_NOSIGNAL
+	constexpr int sendFlags = MSG_NOSIGNAL;
+#else
+	constexpr int sendFlags = 0;
+#endif
+	//rows in one page when a request does not ask for fewer
+	constexpr size_t maxPage = 100000;
+
+	bool isSeparator(char c){
+		return c == '/' || c == filesystem::path::preferred_separator;
+	}
+
+	/**
+	 @return the order of the largest items first
+	 */
+	bool largerFirst(const DirectoryData* a, const DirectoryData* b){
+		return a->size > b->size;
+	}
+
+	/**
+	 Read the offset and count of a paged request
+	 @param in the rest of the request
+	 @return false if they are missing
+	 */
+	bool readPage(istringstream& in, size_t& offset, size_t& count){
+		if (!(in >> offset >> count)){
+			return false;
+		}
+		count = min(count, maxPage);
+		//the rest of the line is a path or query, which may start with spaces of its own
+		if (in.peek() == ' '){
+			in.get();
+		}
+		return true;
+	}
+
+	string rest(istringstream& in){
+		string text;
+		getline(in, text);
+		return text;
+	}
+}
+
+/**
+ Write this row as one line: size, allocated, items, kind, modified and path separated by tabs.
+ Backslashes, tabs and newlines in the path are escaped.
+ @param out the string to append to
+ */
+void DaemonRow::format(string& out) const{
+	out += to_string(size);
+	out += '\t';
+	out += to_string(allocated);
+	out += '\t';
+	out += to_string(items);
+	out += '\t';
+	out += kind;
+	out += '\t';
+	out += to_string((int64_t)modified);
+	out += '\t';
+	for (char c : path){
+		switch (c){
+			case '\\': out += "\\\\"; break;
+			case '\t': out += "\\t"; break;
+			case '\n': out += "\\n"; break;
+			default: out += c;
+		}
+	}
+	out += '\n';
+}
+
+/**
+ Read a row written by format
+ @param line the line, without its newline
+ @return false if the line is not a row
+ */
+bool DaemonRow::parse(const string& line){
+	size_t fields[5];
+	size_t start = 0;
+	for (size_t& f : fields){
+		f = line.find('\t', start);
+		if (f == string::npos){
+			return false;
+		}
+		start = f + 1;
+	}
+	size = strtoll(line.c_str(), nullptr, 10);
+	allocated = strtoll(line.c_str() + fields[0] + 1, nullptr, 10);
+	items = strtoull(line.c_str() + fields[1] + 1, nullptr, 10);
+	kind = line[fields[2] + 1];
+	modified = (time_t)strtoll(line.c_str() + fields[3] + 1, nullptr, 10);
+	path.clear();
+	for (size_t i = fields[4] + 1; i < line.size(); i++){
+		if (line[i] == '\\' && i + 1 < line.size()){
+			const char c = line[++i];
+			path += c == 't' ? '\t' : c == 'n' ? '\n' : c;
+		}
+		else{
+			path += line[i];
+		}
+	}
+	return true;
+}
+
+/**
+ Start scanning folders in the background
+ @param folders the folders to keep scanned
+ @param refreshSeconds how long to wait between checks for changes
+ @param logger called with errors and progress, from any thread
+ */
+ScanDaemon::ScanDaemon(const vector<string>& folders, int refreshSeconds, const logCallback& logger) : refreshSeconds(refreshSeconds), Log(logger){
+	for (const string& folder : folders){
+		roots.push_back(make_unique<Root>());
+		roots.back()->path = folder;
+		//clients can browse each tree while it is being sized
+		roots.back()->tree = new DirectoryData(folder, true);
+	}
+	refresher = thread(&ScanDaemon::refreshLoop, this);
+}
+
+ScanDaemon::~ScanDaemon(){
+	stopping = true;
+	refreshWake.notify_all();
+	refresher.join();
+	//disconnect clients, then wait for their threads to leave the trees
+	{
+		unique_lock<mutex> lock(clientsLock);
+#if !defined _WIN32
+		for (int fd : clients){
+			shutdown(fd, SHUT_RDWR);
+		}
+#endif
+		clientsDone.wait(lock, [this]{
+			return clients.empty();
+		});
+	}
+	for (auto& root : roots){
+		delete root->tree.load();
+	}
+}
+
+/**
+ Size every tree, then check them for changes until the daemon stops
+ */
+void ScanDaemon::refreshLoop(){
+	Scanner scanner(stopping, Log);
+	//clients query the trees, which must list every file
+	scanner.summarizeAbove = Scanner::neverSummarize;
+	for (auto& root : roots){
+		auto start = chrono::steady_clock::now();
+		scanner.SizeItem(root->tree, nullptr);
+		version++;
+		Log("Scanned " + root->path + " in " + to_string(chrono::duration_cast<chrono::seconds>(chrono::steady_clock::now() - start).count()) + " s");
+	}
+
+	while (!stopping){
+		{
+			unique_lock<mutex> lock(refreshLock);
+			refreshWake.wait_for(lock, chrono::seconds(refreshSeconds), [this]{
+				return refreshRequested || stopping;
+			});
+			refreshRequested = false;
+		}
+		for (auto& root : roots){
+			if (stopping){
+				break;
+			}
+			if (refreshFolder(*root, root->tree, scanner)){
+				version++;
+			}
+		}
+		//this is the only thread that retires items
+		epoch::collect();
+	}
+}
+
+/**
+ Bring a folder up to date. Subfolders are checked first, then the folder is rescanned if its
+ modification time changed, which happens when items are added, removed or renamed in it. The rescan
+ keeps the subfolders that still exist, so only new subfolders are sized.
+ @param root the tree the folder belongs to
+ @param folder the folder to check
+ @param scanner the scanner to size changed folders with
+ @return true if anything beneath the folder changed
+ @note files that change size without their folder changing are found when their folder next changes
+ */
+bool ScanDaemon::refreshFolder(Root& root, DirectoryData* folder, Scanner& scanner){
+	if (folder->isSymlink || !folder->isComplete() || stopping){
+		return false;
+	}
+	bool changed = false;
+	epoch::Guard guard;
+	//the folder's list is replaced as changed subfolders are swapped in, so walk a copy
+	const vector<DirectoryData*> subFolders = folder->children()->subFolders;
+	for (DirectoryData* sub : subFolders){
+		changed |= refreshFolder(root, sub, scanner);
+	}
+
+	//a folder on a network mount is stat'ed on the watchdog's thread, so a hung mount cannot stall every root.
+	//Once it has timed out, its folders are left as they are until the mount recovers and the daemon restarts.
+	struct stat info;
+	const VolumeInfo* mount = scanner.watchdog != nullptr ? scanner.watchdog->mountFor(folder->Path) : nullptr;
+	if (mount == nullptr){
+		info = get_stat(folder->Path);
+	}
+	else{
+		if (scanner.watchdog->hung(*mount)){
+			return changed;
+		}
+		const string path = folder->Path;
+		uint64_t calls = 0;
+		shared_ptr<struct stat> read = scanner.watchdog->run<struct stat>(*mount, [path](struct stat& out, atomic<uint64_t>& made){
+			out = get_stat(path);
+			made++;
+		}, stopping, calls);
+		if (read == nullptr){
+			return changed;
+		}
+		info = *read;
+	}
+	if (info.st_mode == 0 || info.st_mtime == folder->meta.modified){
+		//a deleted folder is dropped when its parent is rescanned
+		return changed;
+	}
+
+	unordered_map<string, DirectoryData*> kept;
+	for (DirectoryData* sub : folder->children()->subFolders){
+		kept.emplace(sub->Path, sub);
+	}
+	DirectoryData* fresh = new DirectoryData(folder->Path, true);
+	fresh->parent = folder->parent;
+	scanner.reuse = [&kept](const string& path) -> DirectoryData*{
+		auto it = kept.find(path);
+		if (it == kept.end()){
+			return nullptr;
+		}
+		DirectoryData* sub = it->second;
+		kept.erase(it);
+		return sub;
+	};
+	scanner.SizeItem(fresh, nullptr);
+	scanner.reuse = nullptr;
+
+	//swap in the fresh folder, then leave the old one only the items the fresh one did not take
+	if (folder->parent != nullptr){
+		folder->parent->replaceChild(folder, fresh);
+	}
+	else{
+		root.tree = fresh;
+	}
+	//the subfolders the rescan reused move to the fresh folder only now that it is in the tree
+	for (DirectoryData* sub : fresh->children()->subFolders){
+		sub->parent = fresh;
+	}
+	ChildList* leftovers = new ChildList;
+	leftovers->files = folder->children()->files;
+	for (auto& k : kept){
+		leftovers->subFolders.push_back(k.second);
+	}
+	folder->publish(leftovers);
+	epoch::retire(folder);
+	return true;
+}
+
+/**
+ Accept clients until stop is set. Each client is served on its own thread.
+ @param socketPath the path of the socket to create
+ @param stop set to true to return
+ @throws runtime_error if the socket cannot be created
+ */
+void ScanDaemon::serve(const string& socketPath, const atomic<bool>& stop){
+#if defined _WIN32
+	throw runtime_error("The daemon is not supported on Windows");
+#else
+	sockaddr_un address{};
+	address.sun_family = AF_UNIX;
+	if (socketPath.size() >= sizeof(address.sun_path)){
+		throw runtime_error("Socket path is too long: " + socketPath);
+	}
+	strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+
+	const int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listener < 0){
+		throw runtime_error(string("Cannot create socket: ") + strerror(errno));
+	}
+	//replace a socket left behind by a daemon that exited, but not one that is still running
+	if (connect(listener, (sockaddr*)&address, sizeof(address)) == 0){
+		close(listener);
+		throw runtime_error("A daemon is already listening on " + socketPath);
+	}
+	unlink(socketPath.c_str());
+	//only the owner may connect, the trees show every file name
+	const mode_t oldMask = umask(0077);
+	const bool bound = ::bind(listener, (sockaddr*)&address, sizeof(address)) == 0;
+	umask(oldMask);
+	if (!bound || listen(listener, 64) != 0){
+		const string error = strerror(errno);
+		close(listener);
+		throw runtime_error("Cannot listen on " + socketPath + ": " + error);
+	}
+	Log("Listening on " + socketPath);
+
+	while (!stop){
+		pollfd waiting{listener, POLLIN, 0};
+		if (poll(&waiting, 1, 500) <= 0){
+			continue;
+		}
+		const int fd = accept(listener, nullptr, nullptr);
+		if (fd < 0){
+			continue;
+		}
+		{
+			lock_guard<mutex> lock(clientsLock);
+			clients.insert(fd);
+		}
+		thread(&ScanDaemon::serveClient, this, fd).detach();
+	}
+	close(listener);
+	unlink(socketPath.c_str());
+#endif
+}
+
+/**
+ Answer requests from one client until it disconnects
+ @param fd the client's socket, closed on return
+ */
+void ScanDaemon::serveClient(int fd){
+#if !defined _WIN32
+	string pending;
+	string out;
+	char buffer[4096];
+	for(;;){
+		const ssize_t received = recv(fd, buffer, sizeof(buffer), 0);
+		if (received <= 0){
+			break;
+		}
+		pending.append(buffer, received);
+		size_t newline;
+		bool open = true;
+		while (open && (newline = pending.find('\n')) != string::npos){
+			string request = pending.substr(0, newline);
+			pending.erase(0, newline + 1);
+			if (!request.empty() && request.back() == '\r'){
+				request.pop_back();
+			}
+			out.clear();
+			respond(request, out);
+			for (size_t sent = 0; sent < out.size();){
+				const ssize_t n = send(fd, out.data() + sent, out.size() - sent, sendFlags);
+				if (n <= 0){
+					open = false;
+					break;
+				}
+				sent += n;
+			}
+		}
+		if (!open){
+			break;
+		}
+	}
+	close(fd);
+#endif
+	lock_guard<mutex> lock(clientsLock);
+	clients.erase(fd);
+	clientsDone.notify_all();
+}
+
+/**
+ Find an item by path in any of the trees
+ @param path the full path of the item
+ @return the item, or nullptr if no tree contains it
+ @note hold an epoch::Guard while using the returned item
+ */
+DirectoryData* ScanDaemon::find(const string& path){
+	for (auto& root : roots){
+		DirectoryData* item = root->tree.load();
+		const string& base = item->Path;
+		if (path.compare(0, base.size(), base) != 0){
+			continue;
+		}
+		if (path.size() == base.size()){
+			return item;
+		}
+		size_t start = base.size();
+		if (!isSeparator(base.back())){
+			if (!isSeparator(path[start])){
+				continue;
+			}
+			start++;
+		}
+		//descend one component at a time, comparing whole paths so names need no parsing
+		while (item != nullptr && start < path.size()){
+			size_t end = start;
+			while (end < path.size() && !isSeparator(path[end])){
+				end++;
+			}
+			const string_view prefix(path.data(), end);
+			const ChildList* list = item->children();
+			DirectoryData* next = nullptr;
+			for (DirectoryData* sub : list->subFolders){
+				if (sub->Path == prefix){
+					next = sub;
+					break;
+				}
+			}
+			if (next == nullptr && end == path.size()){
+				for (DirectoryData* file : list->files){
+					if (file->Path == prefix){
+						next = file;
+						break;
+					}
+				}
+			}
+			item = next;
+			start = end + 1;
+		}
+		return item;
+	}
+	return nullptr;
+}
+
+/**
+ @return the flat copy of a tree, rebuilt if the tree changed since it was made
+ */
+shared_ptr<NodeColumns> ScanDaemon::columnsFor(Root& root){
+	lock_guard<mutex> lock(root.columnsLock);
+	const uint64_t current = version;
+	if (root.columns == nullptr || root.columnsVersion != current){
+		root.columns = NodeColumns::build(root.tree, stopping);
+		root.columnsVersion = current;
+	}
+	return root.columns;
+}
+
+/**
+ Append the row for an item
+ */
+void ScanDaemon::appendRow(string& out, DirectoryData* item){
+	DaemonRow row;
+	row.size = item->size;
+	row.allocated = item->allocated;
+	row.items = item->num_items;
+	row.kind = item->isSymlink ? 'l' : !item->isFolder ? 'f' : item->isComplete() ? 'd' : 'p';
+	row.modified = item->meta.modified;
+	row.path = item->Path;
+	row.format(out);
+}
+
+/**
+ Answer one request
+ @param request the request line, see the class description
+ @param out receives the response
+ */
+void ScanDaemon::respond(const string& request, string& out){
+	istringstream in(request);
+	string command;
+	in >> command;
+	size_t offset = 0, count = 0;
+	epoch::Guard guard;
+
+	if (command == "roots"){
+		out += "ok " + to_string(roots.size()) + " " + to_string(roots.size()) + "\n";
+		for (auto& root : roots){
+			appendRow(out, root->tree);
+		}
+	}
+	else if (command == "children" && readPage(in, offset, count)){
+		DirectoryData* folder = find(rest(in));
+		if (folder == nullptr || !folder->isFolder){
+			out += "error no such folder\n";
+			return;
+		}
+		const ChildList* list = folder->children();
+		const size_t first = min(offset, list->size());
+		const size_t last = min(offset + count, list->size());
+		out += "ok " + to_string(last - first) + " " + to_string(list->size()) + "\n";
+		if (folder->isComplete()){
+			//sorted once when the folder was scanned
+			const vector<uint32_t>& bySize = list->order(ChildOrder::Size);
+			for (size_t i = first; i < last; i++){
+				appendRow(out, list->at(bySize[i]));
+			}
+			return;
+		}
+		vector<DirectoryData*> items;
+		items.reserve(list->size());
+		items.insert(items.end(), list->subFolders.begin(), list->subFolders.end());
+		items.insert(items.end(), list->files.begin(), list->files.end());
+		//only the requested page needs to be in order
+		partial_sort(items.begin(), items.begin() + last, items.end(), largerFirst);
+		for (size_t i = first; i < last; i++){
+			appendRow(out, items[i]);
+		}
+	}
+	else if (command == "total"){
+		in >> ws;
+		DirectoryData* item = find(rest(in));
+		if (item == nullptr){
+			out += "error no such item\n";
+			return;
+		}
+		out += "ok 1 1\n";
+		appendRow(out, item);
+	}
+	else if ((command == "top" || command == "search") && readPage(in, offset, count)){
+		unique_ptr<Query> query;
+		try{
+			query = make_unique<Query>(command == "search" ? rest(in) : "");
+		}
+		catch(const invalid_argument& e){
+			out += string("error ") + e.what() + "\n";
+			return;
+		}
+		//run on every tree, then merge the largest matches
+		struct Match{
+			shared_ptr<NodeColumns> columns;
+			uint32_t row;
+		};
+		vector<Match> matches;
+		uint64_t total = 0;
+		for (auto& root : roots){
+			auto columns = columnsFor(*root);
+			QueryResult result = query->run(*columns, offset + count, stopping);
+			total += result.count;
+			for (uint32_t row : result.rows){
+				matches.push_back(Match{columns, row});
+			}
+		}
+		const size_t first = min(offset, matches.size());
+		const size_t last = min(offset + count, matches.size());
+		partial_sort(matches.begin(), matches.begin() + last, matches.end(), [](const Match& a, const Match& b){
+			return a.columns->size[a.row] > b.columns->size[b.row];
+		});
+		out += "ok " + to_string(last - first) + " " + to_string(total) + "\n";
+		for (size_t i = first; i < last; i++){
+			const NodeColumns& c = *matches[i].columns;
+			const uint32_t row = matches[i].row;
+			DaemonRow r;
+			r.size = c.size[row];
+			r.allocated = c.allocated[row];
+			r.kind = c.isFolder[row] ? 'd' : 'f';
+			r.modified = (time_t)c.modified[row];
+			r.path = c.path(row);
+			r.format(out);
+		}
+	}
+	else if (command == "refresh"){
+		{
+			lock_guard<mutex> lock(refreshLock);
+			refreshRequested = true;
+		}
+		refreshWake.notify_all();
+		out += "ok 0 0\n";
+	}
+	else{
+		out += "error cannot understand \"" + request + "\"\n";
+	}
+}
+
+/**
+ Connect to a daemon
+ @param socketPath the daemon's socket
+ @throws runtime_error if no daemon is listening
+ */
+DaemonClient::DaemonClient(const string& socketPath){
+#if defined _WIN32
+	throw runtime_error("The daemon is not supported on Windows");
+#else
+	sockaddr_un address{};
+	address.sun_family = AF_UNIX;
+	strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+	fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0 || connect(fd, (sockaddr*)&address, sizeof(address)) != 0){
+		const string error = strerror(errno);
+		if (fd >= 0){
+			close(fd);
+		}
+		throw runtime_error("Cannot connect to " + socketPath + ": " + error);
+	}
+	//a stuck daemon fails the request instead of hanging the caller
+	timeval timeout{10, 0};
+	setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+#endif
+}
+
+DaemonClient::~DaemonClient(){
+#if !defined _WIN32
+	if (fd >= 0){
+		close(fd);
+	}
+#endif
+}
+
+/**
+ Make a request running on another thread fail now instead of at its timeout. The connection cannot be used afterwards.
+ */
+void DaemonClient::cancel(){
+#if !defined _WIN32
+	shutdown(fd, SHUT_RDWR);
+#endif
+}
+
+/**
+ Read one line of a response
+ @param line receives the line without its newline
+ @return false if the daemon disconnected
+ */
+bool DaemonClient::readLine(string& line){
+#if !defined _WIN32
+	size_t newline;
+	while ((newline = pending.find('\n')) == string::npos){
+		char buffer[65536];
+		const ssize_t received = recv(fd, buffer, sizeof(buffer), 0);
+		if (received <= 0){
+			return false;
+		}
+		pending.append(buffer, received);
+	}
+	line.assign(pending, 0, newline);
+	pending.erase(0, newline + 1);
+	return true;
+#else
+	return false;
+#endif
+}
+
+/**
+ Send a request and read the response
+ @param line the request, see ScanDaemon
+ @param row called with each row of the response
+ @return the total number of results, of which the rows are one page
+ @throws runtime_error with the daemon's message if the request failed
+ */
+uint64_t DaemonClient::request(const string& line, const function<void(const DaemonRow&)>& row){
+#if !defined _WIN32
+	const string message = line + "\n";
+	for (size_t sent = 0; sent < message.size();){
+		const ssize_t n = send(fd, message.data() + sent, message.size() - sent, sendFlags);
+		if (n <= 0){
+			throw runtime_error("The daemon disconnected");
+		}
+		sent += n;
+	}
+#endif
+	string status;
+	if (!readLine(status)){
+		throw runtime_error("The daemon disconnected");
+	}
+	if (status.compare(0, 3, "ok ") != 0){
+		throw runtime_error(status.compare(0, 6, "error ") == 0 ? status.substr(6) : status);
+	}
+	char* end;
+	const uint64_t rows = strtoull(status.c_str() + 3, &end, 10);
+	const uint64_t total = strtoull(end, nullptr, 10);
+	DaemonRow r;
+	string text;
+	for (uint64_t i = 0; i < rows; i++){
+		if (!readLine(text)){
+			throw runtime_error("The daemon disconnected");
+		}
+		if (r.parse(text)){
+			row(r);
+		}
+	}
+	return total;
+}
+
+/**
+ @return the socket used when none is given, private to the current user
+ */
+string defaultDaemonSocket(){
+#if defined _WIN32
+	return "";
+#else
+	const char* runtime = getenv("XDG_RUNTIME_DIR");
+	if (runtime != nullptr && *runtime != '\0'){
+		return string(runtime) + "/fatfilefinder.sock";
+	}
+	return "/tmp/fatfilefinder-" + to_string(getuid()) + ".sock";
+#endif
+}
+
+namespace{
+	atomic<bool> daemonStop{false};
+
+	/**
+	 Remove a --socket option from the arguments
+	 @param args the arguments after the command
+	 @return the socket to use
+	 */
+	string takeSocket(vector<string>& args){
+		string socketPath = defaultDaemonSocket();
+		for (size_t i = 0; i + 1 < args.size(); i++){
+			if (args[i] == "--socket"){
+				socketPath = args[i + 1];
+				args.erase(args.begin() + i, args.begin() + i + 2);
+				break;
+			}
+		}
+		return socketPath;
+	}
+}
+
+bool isDaemonCommand(int argc, char** argv){
+	return argc >= 2 && strcmp(argv[1], "--daemon") == 0;
+}
+
+/**
+ Keep folders scanned and answer requests until interrupted:
+   FatFileFinder --daemon [--socket PATH] [--refresh SECONDS] /srv /home
+ @return the process exit code
+ */
+int daemonCommand(int argc, char** argv){
+	vector<string> args(argv + 2, argv + argc);
+	const string socketPath = takeSocket(args);
+	int refresh = 300;
+	for (size_t i = 0; i + 1 < args.size(); i++){
+		if (args[i] == "--refresh"){
+			refresh = max(1, atoi(args[i + 1].c_str()));
+			args.erase(args.begin() + i, args.begin() + i + 2);
+			break;
+		}
+	}
+	if (args.empty()){
+		cerr << "usage: " << argv[0] << " --daemon [--socket PATH] [--refresh SECONDS] <folder>..." << endl;
+		return 2;
+	}
+
+	signal(SIGINT, [](int){ daemonStop = true; });
+	signal(SIGTERM, [](int){ daemonStop = true; });
+#if !defined _WIN32
+	signal(SIGPIPE, SIG_IGN);
+#endif
+	mutex logLock;
+	ScanDaemon daemon(args, refresh, [&logLock](const string& msg){
+		lock_guard<mutex> lock(logLock);
+		cerr << msg << endl;
+	});
+	try{
+		daemon.serve(socketPath, daemonStop);
+	}
+	catch(const runtime_error& e){
+		cerr << e.what() << endl;
+		return 1;
+	}
+	return 0;
+}
+
+bool isAskCommand(int argc, char** argv){
+	return argc >= 2 && strcmp(argv[1], "--ask") == 0;
+}
+
+/**
+ Send one request to a running daemon and print the response rows:
+   FatFileFinder --ask [--socket PATH] children 0 50 /srv
+ A final line starting with # gives the total number of results.
+ @return the process exit code
+ */
+int askCommand(int argc, char** argv){
+	vector<string> args(argv + 2, argv + argc);
+	const string socketPath = takeSocket(args);
+	if (args.empty()){
+		cerr << "usage: " << argv[0] << " --ask [--socket PATH] <request>" << endl;
+		return 2;
+	}
+	string request;
+	for (const string& a : args){
+		request += (request.empty() ? "" : " ") + a;
+	}
+	try{
+		DaemonClient client(socketPath);
+		string line;
+		const uint64_t total = client.request(request, [&line](const DaemonRow& row){
+			line.clear();
+			row.format(line);
+			cout << line;
+		});
+		cout << "# " << total << " results" << endl;
+	}
+	catch(const runtime_error& e){
+		cerr << e.what() << endl;
+		return 1;
+	}
+	return 0;
+}
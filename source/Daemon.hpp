@@ -0,0 +1,122 @@
+//
+//  Daemon.hpp
+//
+//  Copyright © 2020 Ravbug. All rights reserved.
+//
+
+#pragma once
+#include "DirectoryData.hpp"
+#include "QueryEngine.hpp"
+#include "Scanner.hpp"
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <unordered_set>
+#include <atomic>
+#include <functional>
+
+using namespace std;
+
+/**
+ One item in a daemon response
+ */
+struct DaemonRow{
+	fileSize size = 0;
+	fileSize allocated = 0;
+	uint64_t items = 0;
+	//d folder, p folder still being sized, l symbolic link, f file
+	char kind = 'f';
+	time_t modified = 0;
+	string path;
+
+	void format(string& out) const;
+	bool parse(const string& line);
+};
+
+/**
+ Keeps scanned trees in memory and answers questions about them over a Unix domain socket, so the same
+ folders are not rescanned by every session. Trees are kept fresh by rescanning only the folders whose
+ modification time changed, reusing the subfolders that did not.
+
+ Requests are single lines. Offsets and counts page through the results:
+   roots                              the scanned folders
+   children <offset> <count> <path>   the contents of a folder, largest first
+   total <path>                       a single item
+   top <offset> <count>               the largest files in every tree
+   search <offset> <count> <terms>    items matching query terms (see Query), largest first
+   refresh                            check for changes now instead of waiting
+ Each response is a status line, "ok <rows> <total>" or "error <message>", followed by the rows, formatted
+ by DaemonRow::format. Rows are written straight from the tree, which clients share without copying it.
+ */
+class ScanDaemon{
+public:
+	ScanDaemon(const vector<string>& folders, int refreshSeconds, const logCallback& logger);
+	~ScanDaemon();
+
+	void serve(const string& socketPath, const atomic<bool>& stop);
+	void respond(const string& request, string& out);
+
+private:
+	/**
+	 A scanned folder. Its tree is replaced when the folder itself changes.
+	 */
+	struct Root{
+		string path;
+		atomic<DirectoryData*> tree{nullptr};
+		//flat copy of the tree for top and search, rebuilt on demand after the tree changes
+		mutex columnsLock;
+		shared_ptr<NodeColumns> columns;
+		uint64_t columnsVersion = 0;
+	};
+	vector<unique_ptr<Root>> roots;
+	//incremented whenever any tree changes
+	atomic<uint64_t> version{1};
+	const int refreshSeconds;
+	logCallback Log;
+
+	atomic<bool> stopping{false};
+	thread refresher;
+	mutex refreshLock;
+	condition_variable refreshWake;
+	bool refreshRequested = false;
+
+	mutex clientsLock;
+	condition_variable clientsDone;
+	unordered_set<int> clients;
+
+	void refreshLoop();
+	bool refreshFolder(Root&, DirectoryData*, Scanner&);
+	void serveClient(int fd);
+	DirectoryData* find(const string& path);
+	shared_ptr<NodeColumns> columnsFor(Root&);
+	static void appendRow(string& out, DirectoryData*);
+};
+
+/**
+ A connection to a ScanDaemon
+ */
+class DaemonClient{
+public:
+	DaemonClient(const string& socketPath);
+	~DaemonClient();
+	DaemonClient(const DaemonClient&) = delete;
+	DaemonClient& operator=(const DaemonClient&) = delete;
+
+	uint64_t request(const string& line, const function<void(const DaemonRow&)>& row);
+	void cancel();
+
+private:
+	int fd = -1;
+	string pending;
+
+	bool readLine(string&);
+};
+
+string defaultDaemonSocket();
+bool isDaemonCommand(int argc, char** argv);
+int daemonCommand(int argc, char** argv);
+bool isAskCommand(int argc, char** argv);
+int askCommand(int argc, char** argv);
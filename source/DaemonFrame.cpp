@@ -0,0 +1,172 @@
+//
+//  DaemonFrame.cpp
+//
+//  Copyright © 2020 Ravbug. All rights reserved.
+//
+
+#include "DaemonFrame.hpp"
+#include "FolderDisplay.hpp"
+#include <filesystem>
+
+/**
+ Construct a daemon browser and connect to the default socket
+ @param parent the main window
+ */
+DaemonFrame::DaemonFrame(wxWindow* parent) : ReportFrame(parent, "Daemon"){
+	socketPath = new wxTextCtrl(list->GetParent(), wxID_ANY, defaultDaemonSocket(), wxDefaultPosition, wxSize(240, -1), wxTE_PROCESS_ENTER);
+	socketPath->SetToolTip("The socket of a daemon started with --daemon");
+	controlSizer->Add(socketPath, 0, wxALL, 5);
+	wxButton* upBtn = new wxButton(list->GetParent(), wxID_UP, "Up");
+	controlSizer->Add(upBtn, 0, wxALL, 5);
+	moreBtn = new wxButton(list->GetParent(), wxID_ANY, "More");
+	controlSizer->Add(moreBtn, 0, wxALL, 5);
+	status = new wxStaticText(list->GetParent(), wxID_ANY, "");
+	controlSizer->Add(status, 1, wxALL|wxALIGN_CENTER_VERTICAL, 5);
+	socketPath->Bind(wxEVT_TEXT_ENTER, [this](wxCommandEvent&){
+		Connect();
+	});
+	upBtn->Bind(wxEVT_BUTTON, &DaemonFrame::OnUp, this);
+	moreBtn->Bind(wxEVT_BUTTON, [this](wxCommandEvent&){
+		LoadPage();
+	});
+	
+	list->AppendTextColumn("Name", wxDATAVIEW_CELL_INERT, 240, wxALIGN_LEFT, wxDATAVIEW_COL_RESIZABLE);
+	list->AppendTextColumn("Size", wxDATAVIEW_CELL_INERT, 90, wxALIGN_RIGHT);
+	list->AppendTextColumn("On Disk", wxDATAVIEW_CELL_INERT, 90, wxALIGN_RIGHT);
+	list->AppendTextColumn("Items", wxDATAVIEW_CELL_INERT, 70, wxALIGN_RIGHT);
+	list->AppendTextColumn("Modified", wxDATAVIEW_CELL_INERT, -1, wxALIGN_LEFT, wxDATAVIEW_COL_RESIZABLE);
+	
+	Connect();
+}
+
+DaemonFrame::~DaemonFrame(){
+	Stop();
+}
+
+/**
+ Connect to the socket in the text field and show the daemon's roots
+ */
+void DaemonFrame::Connect(){
+	Stop();
+	client = nullptr;
+	folder.clear();
+	history.clear();
+	Populate();
+}
+
+/**
+ Wait for the running request, if any. A request that has not been answered is cut off, which closes the connection.
+ */
+void DaemonFrame::Stop(){
+	if (!worker.joinable()){
+		return;
+	}
+	if (!answered && client != nullptr){
+		client->cancel();
+		client = nullptr;
+	}
+	worker.join();
+}
+
+/**
+ Reload the folder being shown
+ */
+void DaemonFrame::Populate(){
+	Clear();
+	folderRows.clear();
+	shown = 0;
+	LoadPage();
+}
+
+/**
+ Ask for the next page of the folder being shown, connecting first if there is no connection
+ */
+void DaemonFrame::LoadPage(){
+	Stop();
+	const std::string request = folder.empty() ? "roots" : "children " + std::to_string(shown) + " " + std::to_string(pageRows) + " " + folder;
+	const unsigned int id = ++asked;
+	moreBtn->Disable();
+	status->SetLabel("Asking the daemon");
+	answered = false;
+	worker = std::thread([this, id, request, connected = client, socket = socketPath->GetValue().ToStdString()]() mutable {
+		std::vector<DaemonRow> rows;
+		uint64_t total = 0;
+		std::string error;
+		try{
+			if (connected == nullptr){
+				connected = std::make_shared<DaemonClient>(socket);
+			}
+			total = connected->request(request, [&rows](const DaemonRow& row){
+				rows.push_back(row);
+			});
+		}
+		catch(const std::runtime_error& e){
+			//the connection is unusable once a response is cut off
+			connected = nullptr;
+			error = e.what();
+		}
+		answered = true;
+		CallAfter([this, id, rows = std::move(rows), total, error, connected]{
+			ShowPage(id, rows, total, error, connected);
+		});
+	});
+}
+
+/**
+ Append a page the worker received
+ @param request the number of the request, pages of replaced requests are dropped
+ @param rows the rows of the page
+ @param total the number of items in the folder
+ @param error the reason the request failed, or an empty string
+ @param connected the connection to use for the next request, or nullptr to connect again
+ */
+void DaemonFrame::ShowPage(unsigned int request, const std::vector<DaemonRow>& rows, uint64_t total, const std::string& error, const std::shared_ptr<DaemonClient>& connected){
+	if (request != asked){
+		return;
+	}
+	client = connected;
+	if (!error.empty()){
+		moreBtn->Disable();
+		status->SetLabel(error);
+		return;
+	}
+	list->Freeze();
+	for (const DaemonRow& row : rows){
+		wxVector<wxVariant> items;
+		items.push_back(folder.empty() ? row.path : std::filesystem::path(row.path).filename().string());
+		items.push_back(FolderDisplay::sizeToString(row.size) + (row.kind == 'p' ? " (sizing)" : ""));
+		items.push_back(FolderDisplay::sizeToString(row.allocated));
+		items.push_back(row.kind == 'd' || row.kind == 'p' ? std::to_string(row.items) : "");
+		items.push_back(timeToString(row.modified));
+		AppendRow(items, row.path);
+		if (row.kind == 'd' || row.kind == 'p'){
+			folderRows.insert(row.path);
+		}
+		shown++;
+	}
+	list->Thaw();
+	moreBtn->Enable(shown < total);
+	status->SetLabel(wxString::Format("%s: %zu of %llu items", folder.empty() ? "Roots" : folder.c_str(), shown, (unsigned long long)total));
+}
+
+/**
+ Browse into a folder
+ @param path the activated row
+ */
+void DaemonFrame::Activate(const std::string& path){
+	if (folderRows.count(path) == 0){
+		return;
+	}
+	history.push_back(folder);
+	folder = path;
+	Populate();
+}
+
+void DaemonFrame::OnUp(wxCommandEvent&){
+	if (history.empty()){
+		return;
+	}
+	folder = history.back();
+	history.pop_back();
+	Populate();
+}
@@ -0,0 +1,51 @@
+//
+//  DaemonFrame.hpp
+//
+//  Copyright © 2020 Ravbug. All rights reserved.
+//
+
+#pragma once
+#include "ReportFrame.hpp"
+#include "Daemon.hpp"
+#include <memory>
+#include <unordered_set>
+#include <thread>
+#include <atomic>
+
+/**
+ Browses the trees kept by a running daemon, a page of the largest items at a time, without scanning.
+ Requests are made on a worker thread, so a slow daemon does not freeze the window.
+ */
+class DaemonFrame : public ReportFrame{
+public:
+	static constexpr size_t pageRows = 1000;
+	
+	DaemonFrame(wxWindow* parent);
+	~DaemonFrame();
+	void Populate() override;
+	
+protected:
+	void Activate(const std::string& path) override;
+	
+private:
+	wxTextCtrl* socketPath;
+	wxButton* moreBtn;
+	wxStaticText* status;
+	//the open connection, or nullptr to connect with the next request. Only the worker uses it while a request runs.
+	std::shared_ptr<DaemonClient> client;
+	std::thread worker;
+	std::atomic<bool> answered{true};
+	//counts requests, so the answer to one that was replaced is dropped
+	unsigned int asked = 0;
+	//the folder being shown, or empty for the daemon's roots
+	std::string folder;
+	std::vector<std::string> history;
+	std::unordered_set<std::string> folderRows;
+	size_t shown = 0;
+	
+	void Connect();
+	void Stop();
+	void LoadPage();
+	void ShowPage(unsigned int request, const std::vector<DaemonRow>& rows, uint64_t total, const std::string& error, const std::shared_ptr<DaemonClient>& connected);
+	void OnUp(wxCommandEvent&);
+};
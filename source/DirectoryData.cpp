@@ -7,50 +7,140 @@
 //
 
 #include "DirectoryData.hpp"
+#include "Epoch.hpp"
 #include <filesystem>
+#include <algorithm>
 using namespace filesystem;
 
+const ChildList DirectoryData::emptyList;
+SizeMode DirectoryData::sizeMode = SizeMode::Apparent;
+
 /**
- Clear variables, including deallocating all sub-objects stored in vectors
+ Clear variables, including deallocating all sub-objects stored in the published list
+ @note Only call when no other thread can reach this object (e.g. from the destructor)
  */
 void DirectoryData::resetStats(){
+	const ChildList* list = published.exchange(nullptr);
+	if (list != nullptr){
 		//deallocate each of the files
-		for (DirectoryData* file : files) {
+		for (DirectoryData* file : list->files) {
 			delete file;
-			file = nullptr;
 		}
 		//deallocate each of the subfolders
-		for (DirectoryData* folder : subFolders) {
+		for (DirectoryData* folder : list->subFolders) {
 			delete folder;
-			folder = nullptr;
 		}
-		subFolders.clear();
-		files.clear();
-		size = 0;
-		num_items = 0;
-   }
+		delete list;
+	}
+	size = 0;
+	allocated = 0;
+	num_items = 0;
+	finished = false;
+}
+
+/**
+ Atomically replace the contents of this folder. Readers see either the old list or the new one.
+ @param list the new contents, ownership is transferred to this object
+ @note the previous list is retired and reclaimed once no reader can observe it
+ */
+void DirectoryData::publish(ChildList* list){
+	const ChildList* old = published.exchange(list, memory_order_acq_rel);
+	if (old != nullptr){
+		epoch::retire(old);
+	}
+}
+
+/**
+ Mark this folder as fully sized. After this call its published list and sizes no longer change.
+ */
+void DirectoryData::markComplete(){
+	finished.store(true, memory_order_release);
+}
+
+/**
+ Swap a child folder for a replacement, publishing a new list and updating the sizes of all ancestors
+ @param old the child to replace. It is not deallocated; the caller must retire it.
+ @param fresh the replacement
+ */
+void DirectoryData::replaceChild(DirectoryData* old, DirectoryData* fresh){
+	epoch::Guard guard;
+	ChildList* list = new ChildList(*children());
+	replace(list->subFolders.begin(), list->subFolders.end(), old, fresh);
+	fresh->parent = this;
+	publish(list);
+	
+	//propagate the difference to every ancestor
+	const fileSize sizeDelta = fresh->size - old->size;
+	const long itemDelta = (long)fresh->num_items - (long)old->num_items;
+	const fileSize allocatedDelta = fresh->allocated - old->allocated;
+	for (DirectoryData* p = this; p != nullptr; p = p->parent){
+		p->size += sizeDelta;
+		p->allocated += allocatedDelta;
+		p->num_items += itemDelta;
+		p->stats->newestModified = max(p->stats->newestModified, fresh->stats->newestModified);
+		p->stats->modifiedAge.subtract(old->stats->modifiedAge);
+		p->stats->modifiedAge.add(fresh->stats->modifiedAge);
+		p->stats->accessedAge.subtract(old->stats->accessedAge);
+		p->stats->accessedAge.add(fresh->stats->accessedAge);
+	}
+	//the ancestors' orders may no longer hold, give each a fresh list to sort again when next used
+	for (DirectoryData* p = parent; p != nullptr; p = p->parent){
+		p->publish(new ChildList(*p->children()));
+	}
+}
+
+/**
+ Re-read this item's metadata from disk
+ @return false if the item no longer exists
+ @note only call on the UI thread, for items that are complete and that no job or background copy is reading
+ */
+bool DirectoryData::refreshMeta(){
+	struct stat info;
+#if defined _WIN32
+	const int result = stat(Path.c_str(), &info);
+#else
+	const int result = lstat(Path.c_str(), &info);
+#endif
+	if (result != 0){
+		return false;
+	}
+	meta = FileMeta(info);
+#if defined _WIN32
+	meta.attributes = file_attributes(Path);
+#endif
+	return true;
+}
 
 /**
  Back-propagate changes made to child objects anywhere in the hierarchy into the parent object
- Does not make filesystem calls, instead uses only the data in the FolderData struct.
+ Does not make filesystem calls, instead uses only the data in the published lists.
  Modifies the properties of the struct.
  */
 void DirectoryData::recalculateStats(){
-	if (subFolders.size() > 0){
-		size = 1;
-		num_items = files.size();
+	epoch::Guard guard;
+	const ChildList* list = children();
+	if (list->subFolders.size() > 0){
+		fileSize total = 1;
+		fileSize onDisk = meta.allocated(0);
+		unsigned long items = 0;
 		//calculate file size
-		for (DirectoryData* file : files){
-			size += file->size;
+		for (DirectoryData* file : list->files){
+			total += file->size;
+			onDisk += file->allocated;
+			items += file->isSummary ? file->num_items.load() : 1;
 		}
 		
-		for(DirectoryData* sub : subFolders){
+		for(DirectoryData* sub : list->subFolders){
 			//error handle
 			if (sub == nullptr) {continue;}
 			sub->recalculateStats();
-			num_items += sub->num_items + 1;
-			size += sub->size;
+			items += sub->num_items + 1;
+			total += sub->size;
+			onDisk += sub->allocated;
 		}
+		size = total;
+		allocated = onDisk;
+		num_items = items;
 	}
 }
 
@@ -80,5 +170,104 @@ Return a string representing the item's % size of the superitem
 @returns size rounded to 1 decimal place e.g (5.2%)
 */
 long double DirectoryData::percentOfParent() const{
-	return (long double)size / (long double)parent->size * 100;
+	const fileSize whole = parent->measured();
+	if (whole == 0){
+		return 0;
+	}
+	return (long double)measured() / (long double)whole * 100;
+}
+
+/**
+ @param now the time ages are measured from
+ @return the bytes of this item not modified recently. Folders count nothing until they are complete.
+ */
+fileSize DirectoryData::coldBytes(time_t now) const{
+	if (!isFolder){
+		return AgeBuckets::bucketFor(meta.modified, now) >= AgeBuckets::cold ? size.load() : 0;
+	}
+	return isComplete() ? stats->modifiedAge.from(AgeBuckets::cold) : 0;
+}
+
+ChildList::~ChildList(){
+	for (auto& order : orders){
+		delete order.load(memory_order_relaxed);
+	}
+}
+
+/**
+ @param item the item to measure
+ @param by the order, other than Name
+ @param now the time ages are measured from
+ @return the key the item is sorted by, larger first
+ */
+static int64_t orderKey(const DirectoryData* item, ChildOrder by, time_t now){
+	switch (by){
+		case ChildOrder::Allocated:
+			return item->allocated;
+		case ChildOrder::Items:
+			return item->isFolder || item->isSummary ? (int64_t)item->num_items.load() : 1;
+		case ChildOrder::Modified:
+			return item->isFolder ? item->stats->newestModified : item->meta.modified;
+		case ChildOrder::Recent:
+			if (item->isFolder){
+				return item->stats->modifiedAge.bytes[0];
+			}
+			return AgeBuckets::bucketFor(item->meta.modified, now) == 0 ? item->size.load() : 0;
+		case ChildOrder::Slack:
+			return item->slack();
+		case ChildOrder::Cold:
+			return item->coldBytes(now);
+		default:
+			return item->size;
+	}
+}
+
+/**
+ Get the items of this list in an order. Each order is sorted once per list, on first use, and shared by
+ every reader afterwards. The scanner sorts by size as soon as the folder is complete, so that order is free.
+ Ties are broken by name, then by position, so the order is the same however often it is rebuilt.
+ @param by the order to get
+ @return indices for at(), first to last
+ @pre the folder owning this list is complete, otherwise the cached order would miss later changes in size
+ */
+const vector<uint32_t>& ChildList::order(ChildOrder by) const{
+	atomic<const vector<uint32_t>*>& slot = orders[(size_t)by];
+	const vector<uint32_t>* cached = slot.load(memory_order_acquire);
+	if (cached != nullptr){
+		return *cached;
+	}
+	
+	auto sorted = new vector<uint32_t>(size());
+	for (uint32_t i = 0; i < sorted->size(); i++){
+		(*sorted)[i] = i;
+	}
+	//items of a list share a parent, so comparing paths compares names
+	auto byName = [&](uint32_t a, uint32_t b){
+		const int diff = at(a)->Path.compare(at(b)->Path);
+		return diff != 0 ? diff < 0 : a < b;
+	};
+	if (by == ChildOrder::Name){
+		sort(sorted->begin(), sorted->end(), byName);
+	}
+	else{
+		//read each key once, the sizes are atomics
+		const time_t now = time(nullptr);
+		vector<int64_t> keys(sorted->size());
+		for (uint32_t i = 0; i < keys.size(); i++){
+			keys[i] = orderKey(at(i), by, now);
+		}
+		sort(sorted->begin(), sorted->end(), [&](uint32_t a, uint32_t b){
+			if (keys[a] != keys[b]){
+				return keys[a] > keys[b];
+			}
+			return byName(a, b);
+		});
+	}
+	
+	//another reader may have sorted at the same time, keep whichever was first
+	if (!slot.compare_exchange_strong(cached, sorted, memory_order_acq_rel, memory_order_acquire)){
+		delete sorted;
+		return *cached;
+	}
+	return *sorted;
 }
@@ -7,41 +7,286 @@
 
 #pragma once
 #include "globals.h"
+#include "FileTypes.hpp"
+#include <atomic>
+#include <array>
+#include <memory>
+#include <vector>
 using namespace std;
 
+class DirectoryData;
+
+/**
+ Bytes and file count for one extension
+ */
+struct TypeShare{
+	uint32_t extension = 0;
+	uint32_t count = 0;
+	fileSize bytes = 0;
+};
+
+/**
+ The parts of a stat record shown in the sidebar, captured once by the scanner
+ */
+struct FileMeta{
+	time_t modified = 0;
+	time_t changed = 0;
+	time_t accessed = 0;
+	//512-byte blocks allocated on disk, always 0 on Windows
+	int64_t blocks = 0;
+	uint32_t mode = 0;
+	uint32_t uid = 0;
+	uint32_t gid = 0;
+#if defined _WIN32
+	//FILE_ATTRIBUTE_ bits, which the stat record does not carry. Read by the scan, so the sidebar does not ask the disk.
+	uint32_t attributes = 0;
+#endif
+	
+	FileMeta(){}
+	FileMeta(const struct stat& info) : modified(info.st_mtime), changed(info.st_ctime), accessed(info.st_atime), mode(info.st_mode), uid(info.st_uid), gid(info.st_gid){
+#if !defined _WIN32
+		blocks = info.st_blocks;
+#endif
+	}
+	
+	/**
+	 @param apparent the item's st_size
+	 @return the bytes the item occupies on disk. Windows does not report blocks, so this is the apparent size there.
+	 */
+	fileSize allocated(fileSize apparent) const{
+#if defined _WIN32
+		return apparent;
+#else
+		//only Windows falls back to the apparent size
+		(void)apparent;
+		//st_blocks is always in 512-byte units, regardless of the filesystem's block size
+		return blocks * 512;
+#endif
+	}
+	
+	/**
+	 @return true if this record was filled from a stat call
+	 */
+	bool valid() const{
+		return mode != 0;
+	}
+};
+
+/**
+ Bytes grouped by how long ago they were last modified or accessed, for finding data that can move to
+ cheaper storage. The buckets are fixed, so every folder costs the same no matter what it contains.
+ */
+struct AgeBuckets{
+	static constexpr size_t count = 4;
+	//upper bounds of the first buckets in days, the last bucket holds everything older
+	static constexpr int limits[count - 1] = {30, 90, 365};
+	//the first bucket counted as cold
+	static constexpr size_t cold = 2;
+	array<fileSize, count> bytes{};
+	
+	/**
+	 @param when the time the item was modified or accessed
+	 @param now the time ages are measured from
+	 @return the bucket for the item. Items from the future count as new.
+	 */
+	static size_t bucketFor(time_t when, time_t now){
+		const time_t age = now - when;
+		for (size_t i = 0; i < count - 1; i++){
+			if (age < (time_t)limits[i] * 86400){
+				return i;
+			}
+		}
+		return count - 1;
+	}
+	void add(fileSize size, time_t when, time_t now){
+		bytes[bucketFor(when, now)] += size;
+	}
+	void add(const AgeBuckets& other){
+		for (size_t i = 0; i < count; i++){
+			bytes[i] += other.bytes[i];
+		}
+	}
+	void subtract(const AgeBuckets& other){
+		for (size_t i = 0; i < count; i++){
+			bytes[i] -= other.bytes[i];
+		}
+	}
+	/**
+	 @param bucket the first bucket to include
+	 @return the bytes in the bucket and all older buckets
+	 */
+	fileSize from(size_t bucket) const{
+		fileSize total = 0;
+		for (size_t i = bucket; i < count; i++){
+			total += bytes[i];
+		}
+		return total;
+	}
+};
+
+/**
+ Statistics kept only for folders. Written by the scanner before the folder is marked complete.
+ */
+struct FolderStats{
+	//the extensions using the most space in this subtree, largest first. Empty entries have a count of 0.
+	//Subtree totals are merged from each child's top entries, so they are approximate beyond the first few.
+	static constexpr size_t topTypeCount = 6;
+	array<TypeShare, topTypeCount> topTypes{};
+	//newest modification time of everything beneath the folder, including itself
+	time_t newestModified = 0;
+	//file bytes beneath the folder by time since last modification and last access
+	AgeBuckets modifiedAge;
+	AgeBuckets accessedAge;
+};
+
+/**
+ Which size drives sorting, percentages and totals in the UI
+ */
+enum class SizeMode{
+	Apparent,	//the sum of file lengths
+	Allocated	//the space actually used on disk
+};
+
+/**
+ Orders the contents of a folder can be listed in
+ */
+enum class ChildOrder{
+	Size,		//largest first
+	Allocated,	//most space on disk first
+	Name,		//A to Z
+	Items,		//most items first
+	Modified,	//most recently modified first
+	Recent,		//most bytes modified in the last 30 days first
+	Slack,		//most slack first
+	Cold,		//most bytes not modified in the last 90 days first
+	Count
+};
+
+/**
+ The immutable contents of a folder. A folder's list is published once by the scanner
+ and is never modified afterwards; changes are made by publishing a replacement list.
+ */
+struct ChildList{
+	vector<DirectoryData*> subFolders;
+	vector<DirectoryData*> files;
+	
+	ChildList(){}
+	//orders are not copied, they belong to the contents of one list
+	ChildList(const ChildList& other) : subFolders(other.subFolders), files(other.files){}
+	ChildList& operator=(const ChildList&) = delete;
+	~ChildList();
+	
+	/**
+	 @return the number of items in the list, subfolders first
+	 */
+	size_t size() const{
+		return subFolders.size() + files.size();
+	}
+	/**
+	 @param i the index of an item, counting subfolders first
+	 @return the item
+	 */
+	DirectoryData* at(size_t i) const{
+		return i < subFolders.size() ? subFolders[i] : files[i - subFolders.size()];
+	}
+	
+	const vector<uint32_t>& order(ChildOrder) const;
+	
+private:
+	//permutations of the items by each order, built once on first use and freed with the list
+	mutable array<atomic<const vector<uint32_t>*>, (size_t)ChildOrder::Count> orders{};
+};
+
 class DirectoryData{
 public:
 	string Path;
 	//see typedefs for platform-specific types
-	fileSize size;
-	unsigned long num_items;
+	//sizes are updated by the scanner while the UI reads them
+	atomic<fileSize> size{0};
+	//bytes allocated on disk, aggregated the same way as size
+	atomic<fileSize> allocated{0};
+	atomic<unsigned long> num_items{0};
 	bool isFolder;
-	bool isSymlink;
-	
+	bool isSymlink = false;
+	//stands for the small files of a huge folder, which are counted in num_items but not kept as items
+	bool isSummary = false;
+	//the folder is on a network mount that stopped responding, so it was not read
+	atomic<bool> timedOut{false};
+	//interned id of the file's extension, see ExtensionTable
+	uint32_t extension = 0;
+	FileCategory category = FileCategory::NoExtension;
+	//written by the scanner before the item is published, afterwards only by the UI thread
+	FileMeta meta;
+	//only allocated for folders
+	unique_ptr<FolderStats> stats;
+
 	//for back navigation
 	DirectoryData* parent = nullptr;
-	
-	//for holding items
-	vector<DirectoryData*> subFolders;
-	vector<DirectoryData*> files;
-	
+
 	DirectoryData(const string& inPath, bool folder){
 		Path = inPath;
 		isFolder = folder;
-		size = 0;
-		num_items = 0;
-		isSymlink = false;
+		if (folder){
+			stats = make_unique<FolderStats>();
+		}
 	}
-	DirectoryData(const string& inPath, fileSize inSize) : DirectoryData(inPath, false){
-		size = inSize;
+	DirectoryData(const string& inPath, const struct stat& info) : DirectoryData(inPath, false){
+		size = info.st_size;
+		meta = FileMeta(info);
+		allocated = meta.allocated(size);
+		//files are complete as soon as they are created
+		finished.store(true, memory_order_relaxed);
 	}
 	//destructor
 	~DirectoryData(){
 		resetStats();
 	}
-	
+
+	/**
+	 @return the published contents of this folder. Never nullptr.
+	 @note hold an epoch::Guard while using the returned list
+	 */
+	const ChildList* children() const{
+		const ChildList* list = published.load(memory_order_acquire);
+		return list != nullptr ? list : &emptyList;
+	}
+
+	/**
+	 @return true if this item and everything beneath it has been sized
+	 */
+	bool isComplete() const{
+		return finished.load(memory_order_acquire);
+	}
+
+	void publish(ChildList*);
+	void markComplete();
+	void replaceChild(DirectoryData*, DirectoryData*);
 	void resetStats();
 	void recalculateStats();
+	bool refreshMeta();
 	vector<DirectoryData*> getSuperFolders();
 	long double percentOfParent() const;
+	fileSize coldBytes(time_t now) const;
+	
+	/**
+	 @return the size selected by sizeMode
+	 */
+	fileSize measured() const{
+		return sizeMode == SizeMode::Allocated ? allocated.load() : size.load();
+	}
+	
+	/**
+	 @return allocated minus apparent size. Negative for sparse and compressed files.
+	 */
+	fileSize slack() const{
+		return allocated - size;
+	}
+	
+	//set from the UI thread only
+	static SizeMode sizeMode;
+
+private:
+	atomic<const ChildList*> published{nullptr};
+	atomic<bool> finished{false};
+	static const ChildList emptyList;
 };
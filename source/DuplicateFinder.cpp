@@ -0,0 +1,331 @@
+//
+//  DuplicateFinder.cpp
+//
+//  Copyright © 2020 Ravbug. All rights reserved.
+//
+
+#include "DuplicateFinder.hpp"
+#include "FastHash.hpp"
+#include "JobManager.hpp"
+#include "Epoch.hpp"
+#include <unordered_map>
+#include <algorithm>
+#include <memory>
+#include <mutex>
+
+#if defined __APPLE__ || defined __linux__
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+namespace{
+	/**
+	 A file opened for hashing. Reads bypass the page cache where the platform allows it.
+	 */
+	class InputFile{
+	public:
+		InputFile(const string& path){
+#if defined __APPLE__ || defined __linux__
+			fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+			if (fd >= 0){
+				struct stat info;
+				if (fstat(fd, &info) == 0){
+					identity = ((uint64_t)info.st_dev << 40) ^ (uint64_t)info.st_ino;
+				}
+	#if defined __linux__
+				posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+	#elif defined __APPLE__
+				fcntl(fd, F_NOCACHE, 1);
+	#endif
+			}
+#else
+			file = fopen(path.c_str(), "rb");
+#endif
+		}
+		~InputFile(){
+#if defined __APPLE__ || defined __linux__
+			if (fd >= 0){
+				close(fd);
+			}
+#else
+			if (file != nullptr){
+				fclose(file);
+			}
+#endif
+		}
+		bool ok() const{
+#if defined __APPLE__ || defined __linux__
+			return fd >= 0;
+#else
+			return file != nullptr;
+#endif
+		}
+		/**
+		 Read a range of the file, then drop it from the page cache
+		 @return the number of bytes read
+		 */
+		size_t readAt(uint8_t* buffer, size_t length, fileSize offset){
+#if defined __APPLE__ || defined __linux__
+			ssize_t n = pread(fd, buffer, length, offset);
+			if (n <= 0){
+				return 0;
+			}
+	#if defined __linux__
+			posix_fadvise(fd, offset, n, POSIX_FADV_DONTNEED);
+	#endif
+			return n;
+#else
+			if (_fseeki64(file, offset, SEEK_SET) != 0){
+				return 0;
+			}
+			return fread(buffer, 1, length, file);
+#endif
+		}
+		//device and inode, so hard links to the same data are not reported as copies
+		uint64_t identity = 0;
+	private:
+#if defined __APPLE__ || defined __linux__
+		int fd = -1;
+#else
+		FILE* file = nullptr;
+#endif
+	};
+}
+
+/**
+ Find all sets of identical files among the collected files
+ @param progress called periodically from worker threads
+ @return groups of identical files, largest wasted space first
+ */
+vector<DuplicateGroup> DuplicateFinder::find(const progressCallback& progress){
+	vector<Candidate*> pending;
+	for (Candidate& c : candidates){
+		pending.push_back(&c);
+	}
+	
+	//the files are read on the shared workers, alongside any scan, one task per file or group
+	shared_ptr<Job> job = JobManager::shared().submit(JobManager::scanPriority);
+	atomic<size_t> done{0};
+	auto runStage = [&](const string& stage, size_t count, const function<void(size_t)>& fn){
+		done = 0;
+		for (size_t i = 0; i < count; i++){
+			job->post(nullptr, [&, i, count]{
+				if (abort){
+					return;
+				}
+				fn(i);
+				size_t finished = ++done;
+				if (progress != nullptr && (finished % 256 == 0 || finished == count)){
+					progress(stage, finished, count);
+				}
+			});
+		}
+		job->join();
+	};
+	
+	//hash the first and last blocks of every file that shares its size with another
+	runStage("Comparing the start and end of files", pending.size(), [&](size_t i){
+		hashEdges(*pending[i]);
+	});
+	
+	//keep the files that still match another file. Small files were hashed completely, but a hash can
+	//collide, so their bytes are compared before they are reported as identical.
+	vector<vector<Candidate*>> small;
+	vector<Candidate*> survivors;
+	vector<DuplicateGroup> result;
+	mutex resultLock;
+	auto addGroup = [&](const vector<Candidate*>& group){
+		DuplicateGroup g;
+		g.size = group.front()->size;
+		for (Candidate* c : group){
+			g.paths.push_back(c->path);
+		}
+		lock_guard<mutex> guard(resultLock);
+		result.push_back(move(g));
+	};
+	for (auto& group : groupBy(pending, [](const Candidate* c){ return c->hash; })){
+		if (group.front()->size <= (fileSize)(2 * edgeBytes)){
+			small.push_back(move(group));
+		}
+		else{
+			survivors.insert(survivors.end(), group.begin(), group.end());
+		}
+	}
+	runStage("Comparing small files", small.size(), [&](size_t i){
+		for (const auto& same : compareContents(small[i])){
+			addGroup(same);
+		}
+	});
+	
+	//hash the survivors in full
+	runStage("Comparing entire files", survivors.size(), [&](size_t i){
+		hashContents(*survivors[i]);
+	});
+	for (auto& group : groupBy(survivors, [](const Candidate* c){ return c->hash; })){
+		addGroup(group);
+	}
+	if (abort){
+		return {};
+	}
+	
+	sort(result.begin(), result.end(), [](const DuplicateGroup& a, const DuplicateGroup& b){
+		return a.wasted() > b.wasted();
+	});
+	return result;
+}
+
+/**
+ Gather the files whose size is shared with at least one other file
+ @param root the tree to gather from. Only complete folders are searched.
+ */
+void DuplicateFinder::collect(DirectoryData* root){
+	epoch::Guard guard;
+	unordered_map<fileSize, uint32_t> sizeCounts;
+	vector<DirectoryData*> files;
+	
+	//walk the completed parts of the tree without recursion
+	vector<DirectoryData*> stack{root};
+	while (!stack.empty() && !abort){
+		DirectoryData* folder = stack.back();
+		stack.pop_back();
+		const ChildList* list = folder->children();
+		for (DirectoryData* sub : list->subFolders){
+			if (sub->isComplete() && !sub->isSymlink){
+				stack.push_back(sub);
+			}
+		}
+		for (DirectoryData* file : list->files){
+			//empty files are all identical but waste nothing, and summary rows are not files
+			if (file->size > 0 && !file->isSummary){
+				sizeCounts[file->size]++;
+				files.push_back(file);
+			}
+		}
+	}
+	
+	candidates.clear();
+	for (DirectoryData* file : files){
+		if (sizeCounts[file->size] > 1){
+			candidates.push_back(Candidate{file->Path, file->size});
+		}
+	}
+}
+
+/**
+ Hash the first and last edgeBytes of a file, or all of it if it is small
+ @param c the file to hash
+ */
+void DuplicateFinder::hashEdges(Candidate& c){
+	InputFile file(c.path);
+	if (!file.ok()){
+		return;
+	}
+	c.readable = true;
+	c.identity = file.identity;
+	thread_local unique_ptr<uint8_t[]> buffer(new uint8_t[2 * edgeBytes]);
+	
+	FastHash hash(c.size);
+	if (c.size <= (fileSize)(2 * edgeBytes)){
+		hash.update(buffer.get(), file.readAt(buffer.get(), c.size, 0));
+	}
+	else{
+		hash.update(buffer.get(), file.readAt(buffer.get(), edgeBytes, 0));
+		hash.update(buffer.get(), file.readAt(buffer.get(), edgeBytes, c.size - edgeBytes));
+	}
+	c.hash = hash.digest();
+}
+
+/**
+ Hash the entire contents of a file in large blocks
+ @param c the file to hash
+ */
+void DuplicateFinder::hashContents(Candidate& c){
+	InputFile file(c.path);
+	if (!file.ok()){
+		c.readable = false;
+		return;
+	}
+	thread_local unique_ptr<uint8_t[]> buffer(new uint8_t[blockBytes]);
+	
+	FastHash hash(c.size);
+	fileSize offset = 0;
+	while (offset < c.size && !abort){
+		size_t n = file.readAt(buffer.get(), blockBytes, offset);
+		if (n == 0){
+			break;
+		}
+		hash.update(buffer.get(), n);
+		offset += n;
+	}
+	c.hash = hash.digest();
+}
+
+/**
+ Split files whose hashes matched into sets with the same bytes
+ @param group readable files of one size, small enough to read whole
+ @return the sets of two or more identical files
+ */
+vector<vector<DuplicateFinder::Candidate*>> DuplicateFinder::compareContents(const vector<Candidate*>& group){
+	vector<string> contents;
+	vector<vector<Candidate*>> sets;
+	for (Candidate* c : group){
+		string bytes(c->size, '\0');
+		InputFile file(c->path);
+		if (!file.ok() || file.readAt((uint8_t*)&bytes[0], bytes.size(), 0) != bytes.size()){
+			continue;
+		}
+		auto same = std::find(contents.begin(), contents.end(), bytes);
+		if (same != contents.end()){
+			sets[same - contents.begin()].push_back(c);
+		}
+		else{
+			contents.push_back(move(bytes));
+			sets.push_back({c});
+		}
+	}
+	sets.erase(remove_if(sets.begin(), sets.end(), [](const vector<Candidate*>& s){
+		return s.size() < 2;
+	}), sets.end());
+	return sets;
+}
+
+/**
+ Split files into groups of two or more that have the same size and key
+ @param items the files to group. Unreadable files are dropped, as are extra hard links to the same data.
+ @param key function returning the key to group on
+ @return the groups
+ */
+template<typename KeyFn>
+vector<vector<DuplicateFinder::Candidate*>> DuplicateFinder::groupBy(vector<Candidate*>& items, KeyFn key){
+	sort(items.begin(), items.end(), [&](const Candidate* a, const Candidate* b){
+		if (a->size != b->size){
+			return a->size < b->size;
+		}
+		if (key(a) != key(b)){
+			return key(a) < key(b);
+		}
+		return a->identity < b->identity;
+	});
+	vector<vector<Candidate*>> groups;
+	size_t start = 0;
+	while (start < items.size()){
+		size_t end = start + 1;
+		while (end < items.size() && items[end]->size == items[start]->size && key(items[end]) == key(items[start])){
+			end++;
+		}
+		vector<Candidate*> group;
+		for (size_t i = start; i < end; i++){
+			const bool sameData = !group.empty() && items[i]->identity != 0 && items[i]->identity == group.back()->identity;
+			if (items[i]->readable && !sameData){
+				group.push_back(items[i]);
+			}
+		}
+		if (group.size() > 1){
+			groups.push_back(move(group));
+		}
+		start = end;
+	}
+	return groups;
+}
@@ -0,0 +1,65 @@
+//
+//  DuplicateFinder.hpp
+//
+//  Copyright © 2020 Ravbug. All rights reserved.
+//
+
+#pragma once
+#include "DirectoryData.hpp"
+#include <functional>
+#include <atomic>
+
+/**
+ A set of files with identical contents
+ */
+struct DuplicateGroup{
+	fileSize size = 0;
+	vector<string> paths;
+	
+	/**
+	 @return the space that would be reclaimed by keeping only one copy
+	 */
+	fileSize wasted() const{
+		return size * (fileSize)(paths.size() - 1);
+	}
+};
+
+/**
+ Finds files with identical contents in a sized tree.
+ The tree is only read by collect(); find() works from copies of the paths, so it does not
+ need to hold an epoch::Guard while it reads files.
+ Files are bucketed by size, then by a hash of their first and last blocks. Small files that
+ still match are compared byte by byte, larger ones are hashed in full. Reading runs on the
+ shared workers and asks the OS not to keep the file contents cached.
+ */
+class DuplicateFinder{
+public:
+	//called with the current stage, and the number of files finished and total in that stage
+	typedef function<void(const string& stage, size_t done, size_t total)> progressCallback;
+	
+	static constexpr size_t edgeBytes = 64 * 1024;
+	static constexpr size_t blockBytes = 1024 * 1024;
+	
+	DuplicateFinder(const atomic<bool>& abortFlag) : abort(abortFlag){}
+	
+	void collect(DirectoryData* root);
+	vector<DuplicateGroup> find(const progressCallback& progress);
+	
+private:
+	const atomic<bool>& abort;
+	
+	struct Candidate{
+		string path;
+		fileSize size;
+		uint64_t hash = 0;
+		uint64_t identity = 0;
+		bool readable = false;
+	};
+	vector<Candidate> candidates;
+	
+	void hashEdges(Candidate&);
+	void hashContents(Candidate&);
+	static vector<vector<Candidate*>> compareContents(const vector<Candidate*>&);
+	template<typename KeyFn>
+	static vector<vector<Candidate*>> groupBy(vector<Candidate*>&, KeyFn);
+};
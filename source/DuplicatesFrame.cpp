@@ -0,0 +1,109 @@
+//
+//  DuplicatesFrame.cpp
+//
+//  Copyright © 2020 Ravbug. All rights reserved.
+//
+
+#include "DuplicatesFrame.hpp"
+#include "FolderDisplay.hpp"
+#include "Epoch.hpp"
+#include <filesystem>
+#include <future>
+
+/**
+ Construct a duplicate file list and start searching
+ @param parent the main window
+ @param rootProvider returns the current root of the scanned tree. Called on the main thread each time the search starts.
+ */
+DuplicatesFrame::DuplicatesFrame(wxWindow* parent, const std::function<DirectoryData*()>& rootProvider) : ReportFrame(parent, "Duplicate Files"), rootProvider(rootProvider){
+	status = new wxStaticText(list->GetParent(), wxID_ANY, "");
+	controlSizer->Add(status, 1, wxALL|wxALIGN_CENTER_VERTICAL, 5);
+	
+	list->AppendTextColumn("Group", wxDATAVIEW_CELL_INERT, 50, wxALIGN_RIGHT);
+	list->AppendTextColumn("File Name", wxDATAVIEW_CELL_INERT, 200, wxALIGN_LEFT, wxDATAVIEW_COL_RESIZABLE);
+	list->AppendTextColumn("File Size", wxDATAVIEW_CELL_INERT, 90, wxALIGN_RIGHT);
+	list->AppendTextColumn("Wasted", wxDATAVIEW_CELL_INERT, 90, wxALIGN_RIGHT);
+	list->AppendTextColumn("Folder", wxDATAVIEW_CELL_INERT, -1, wxALIGN_LEFT, wxDATAVIEW_COL_RESIZABLE);
+	
+	Populate();
+}
+
+DuplicatesFrame::~DuplicatesFrame(){
+	Stop();
+}
+
+/**
+ Cancel the running search, if any, and wait for it to exit
+ */
+void DuplicatesFrame::Stop(){
+	abort = true;
+	if (worker.joinable()){
+		worker.join();
+	}
+	abort = false;
+}
+
+/**
+ Start a new search of the current tree, replacing any search in progress
+ */
+void DuplicatesFrame::Populate(){
+	Stop();
+	Clear();
+	DirectoryData* root = rootProvider();
+	if (root == nullptr){
+		status->SetLabel("Open a folder to search for duplicates");
+		return;
+	}
+	status->SetLabel("Gathering files");
+	
+	//the tree may be replaced as soon as this function returns, so wait until the worker has pinned it
+	std::promise<void> pinned;
+	std::future<void> ready = pinned.get_future();
+	worker = std::thread([this, root, pinned = std::move(pinned)]() mutable {
+		DuplicateFinder finder(abort);
+		{
+			epoch::Guard guard;
+			pinned.set_value();
+			finder.collect(root);
+		}
+		auto groups = finder.find([this](const string& stage, size_t done, size_t total){
+			CallAfter([this, stage, done, total]{
+				status->SetLabel(wxString::Format("%s (%zu of %zu)", stage, done, total));
+			});
+		});
+		if (!abort){
+			CallAfter([this, groups]{
+				ShowResults(groups);
+			});
+		}
+	});
+	ready.wait();
+}
+
+/**
+ Display the groups found by the search
+ @param groups the groups to show, largest wasted space first
+ */
+void DuplicatesFrame::ShowResults(const std::vector<DuplicateGroup>& groups){
+	Clear();
+	fileSize totalWasted = 0;
+	list->Freeze();
+	int number = 1;
+	for (const DuplicateGroup& g : groups){
+		totalWasted += g.wasted();
+		for (size_t i = 0; i < g.paths.size(); i++){
+			std::filesystem::path p(g.paths[i]);
+			wxVector<wxVariant> items;
+			items.push_back(std::to_string(number));
+			items.push_back(p.filename().string());
+			items.push_back(FolderDisplay::sizeToString(g.size));
+			//only list the wasted space once per group
+			items.push_back(i == 0 ? FolderDisplay::sizeToString(g.wasted()) : "");
+			items.push_back(p.parent_path().string());
+			AppendRow(items, g.paths[i]);
+		}
+		number++;
+	}
+	list->Thaw();
+	status->SetLabel(wxString::Format("%zu groups of identical files, %s wasted", groups.size(), FolderDisplay::sizeToString(totalWasted)));
+}
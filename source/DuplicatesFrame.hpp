@@ -0,0 +1,31 @@
+//
+//  DuplicatesFrame.hpp
+//
+//  Copyright © 2020 Ravbug. All rights reserved.
+//
+
+#pragma once
+#include "ReportFrame.hpp"
+#include "DuplicateFinder.hpp"
+#include <functional>
+#include <thread>
+#include <atomic>
+
+/**
+ Searches the scanned tree for identical files on a background thread and lists them in groups
+ */
+class DuplicatesFrame : public ReportFrame{
+public:
+	DuplicatesFrame(wxWindow* parent, const std::function<DirectoryData*()>& rootProvider);
+	~DuplicatesFrame();
+	void Populate() override;
+	
+private:
+	std::function<DirectoryData*()> rootProvider;
+	wxStaticText* status;
+	std::thread worker;
+	std::atomic<bool> abort{false};
+	
+	void Stop();
+	void ShowResults(const std::vector<DuplicateGroup>&);
+};
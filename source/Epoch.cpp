@@ -0,0 +1,160 @@
+//
+//  Epoch.cpp
+//
+//  Copyright © 2020 Ravbug. All rights reserved.
+//
+
+#include "Epoch.hpp"
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <cstdint>
+using namespace std;
+
+namespace{
+	constexpr size_t slotsPerBlock = 128;
+	constexpr size_t collectThreshold = 64;
+
+	/**
+	 One reader announcement. pinned is 0 when the owning thread is not inside a Guard.
+	 */
+	struct alignas(64) Slot{
+		atomic<uint64_t> pinned{0};
+		atomic<bool> used{false};
+	};
+
+	struct Retired{
+		uint64_t epoch;
+		function<void()> reclaim;
+	};
+
+	/**
+	 Reader slots, chained as more threads need them. Blocks are never freed, so readers can walk the chain without a lock.
+	 */
+	struct SlotBlock{
+		Slot slots[slotsPerBlock];
+		atomic<SlotBlock*> next{nullptr};
+	};
+
+	atomic<uint64_t> globalEpoch{1};
+	SlotBlock firstBlock;
+	mutex retireLock;
+	vector<Retired> retired;
+
+	/**
+	 Claim a free reader slot for the calling thread. If every slot is taken, another block is added,
+	 since threads abandoned on a hung mount may hold theirs until the program exits.
+	 */
+	Slot* acquireSlot(){
+		for (SlotBlock* block = &firstBlock;;){
+			for (Slot& s : block->slots){
+				bool expected = false;
+				if (!s.used.load(memory_order_relaxed) && s.used.compare_exchange_strong(expected, true)){
+					return &s;
+				}
+			}
+			SlotBlock* next = block->next.load(memory_order_acquire);
+			if (next == nullptr){
+				SlotBlock* added = new SlotBlock;
+				if (block->next.compare_exchange_strong(next, added)){
+					next = added;
+				}
+				else{
+					//another thread added one first
+					delete added;
+				}
+			}
+			block = next;
+		}
+	}
+
+	/**
+	 Call a function with every reader slot
+	 @param fn called with each slot
+	 */
+	template<typename Fn>
+	void forEachSlot(Fn&& fn){
+		for (SlotBlock* block = &firstBlock; block != nullptr; block = block->next.load(memory_order_acquire)){
+			for (Slot& s : block->slots){
+				fn(s);
+			}
+		}
+	}
+
+	/**
+	 Per-thread reader state, releases the slot when the thread exits
+	 */
+	struct ThreadRecord{
+		Slot* slot = nullptr;
+		unsigned int depth = 0;
+		~ThreadRecord(){
+			if (slot != nullptr){
+				slot->pinned.store(0);
+				slot->used.store(false);
+			}
+		}
+	};
+	thread_local ThreadRecord self;
+}
+
+epoch::Guard::Guard(){
+	if (self.depth++ == 0){
+		if (self.slot == nullptr){
+			self.slot = acquireSlot();
+		}
+		self.slot->pinned.store(globalEpoch.load());
+	}
+}
+
+epoch::Guard::~Guard(){
+	if (--self.depth == 0){
+		self.slot->pinned.store(0, memory_order_release);
+	}
+}
+
+void epoch::retire(const function<void()>& reclaim){
+	//readers that pin after this point can no longer reach the object
+	const uint64_t tag = globalEpoch.fetch_add(1);
+	size_t pending;
+	{
+		lock_guard<mutex> lock(retireLock);
+		retired.push_back(Retired{tag, reclaim});
+		pending = retired.size();
+	}
+	if (pending > collectThreshold && self.depth == 0){
+		collect();
+	}
+}
+
+bool epoch::pinnedElsewhere(){
+	bool pinned = false;
+	forEachSlot([&pinned](const Slot& s){
+		pinned |= &s != self.slot && s.pinned.load() != 0;
+	});
+	return pinned;
+}
+
+void epoch::collect(){
+	//find the oldest epoch still pinned by a reader
+	uint64_t oldest = UINT64_MAX;
+	forEachSlot([&oldest](const Slot& s){
+		uint64_t e = s.pinned.load();
+		if (e != 0 && e < oldest){
+			oldest = e;
+		}
+	});
+
+	vector<Retired> ready;
+	{
+		lock_guard<mutex> lock(retireLock);
+		vector<Retired> remaining;
+		for (Retired& r : retired){
+			(r.epoch < oldest ? ready : remaining).push_back(std::move(r));
+		}
+		retired.swap(remaining);
+	}
+	//run reclaimers outside the lock, they may retire more objects
+	for (Retired& r : ready){
+		r.reclaim();
+	}
+}
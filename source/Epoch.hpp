@@ -0,0 +1,55 @@
+//
+//  Epoch.hpp
+//
+//  Copyright © 2020 Ravbug. All rights reserved.
+//
+
+#pragma once
+#include <functional>
+
+/**
+ Epoch-based reclamation for data shared between the scan workers and the UI.
+ Readers pin the current epoch with a Guard while they hold pointers into shared
+ structures. Writers unlink an object, then retire it; the object is reclaimed once
+ every reader that could have observed it has left its critical section.
+ */
+namespace epoch{
+	/**
+	 RAII read-side critical section. Guards may be nested on the same thread.
+	 */
+	class Guard{
+	public:
+		Guard();
+		~Guard();
+		Guard(const Guard&) = delete;
+		Guard& operator=(const Guard&) = delete;
+	};
+
+	/**
+	 Schedule a reclaim function to run once no reader can still observe the object
+	 @param reclaim function that frees the object, called exactly once
+	 @pre the object must already be unreachable for new readers
+	 */
+	void retire(const std::function<void()>& reclaim);
+
+	/**
+	 Convenience overload to delete an object when it is safe to do so
+	 @param ptr the object to delete
+	 */
+	template<typename T>
+	inline void retire(const T* ptr){
+		retire([ptr]{
+			delete ptr;
+		});
+	}
+
+	/**
+	 @return true if a thread other than the caller is inside a Guard
+	 */
+	bool pinnedElsewhere();
+
+	/**
+	 Run all reclaim functions that are safe to run. Call periodically from any thread not inside a Guard.
+	 */
+	void collect();
+}
@@ -0,0 +1,97 @@
+//
+//  ErrorCollector.cpp
+//
+//  Copyright © 2020 Ravbug. All rights reserved.
+//
+
+#include "ErrorCollector.hpp"
+#include <algorithm>
+#include <system_error>
+
+/**
+ @return the error and the step it happened in, such as "Permission denied while listing"
+ */
+string ErrorGroup::describe() const{
+	static const char* steps[] = {"listing", "reading status", "adding entry"};
+	return system_category().message(code) + " while " + steps[(size_t)step];
+}
+
+/**
+ Record an error
+ @param l the groups of the calling worker
+ @param folder the folder being read
+ @param step what was being done
+ @param code the error code
+ @param item the name of the entry that failed, or an empty string if the folder itself failed
+ */
+void ErrorCollector::add(Local& l, const string& folder, ScanStep step, int code, const string& item){
+	changes.fetch_add(1, memory_order_relaxed);
+	lock_guard<mutex> guard(l.lock);
+	auto found = l.folders.find(folder);
+	if (found != l.folders.end()){
+		for (ErrorGroup& group : found->second){
+			if (group.step == step && group.code == code){
+				group.count++;
+				return;
+			}
+		}
+	}
+	if (l.groups == maxGroups){
+		l.overflow++;
+		return;
+	}
+	l.groups++;
+	//the folder is only copied for the first error of each kind
+	l.folders[folder].push_back(ErrorGroup{folder, step, code, 1, item});
+}
+
+/**
+ Merge the groups of every worker. Safe to call while scans are running.
+ @param overflow receives the number of errors that were counted without a group
+ @return the groups, most frequent first
+ */
+vector<ErrorGroup> ErrorCollector::groups(uint64_t& overflow) const{
+	unordered_map<string, vector<ErrorGroup>> merged;
+	overflow = 0;
+	locals.forEach([&](const Local& l){
+		lock_guard<mutex> guard(l.lock);
+		overflow += l.overflow;
+		for (const auto& folder : l.folders){
+			vector<ErrorGroup>& into = merged[folder.first];
+			for (const ErrorGroup& group : folder.second){
+				auto same = find_if(into.begin(), into.end(), [&](const ErrorGroup& g){
+					return g.step == group.step && g.code == group.code;
+				});
+				if (same != into.end()){
+					same->count += group.count;
+				}
+				else{
+					into.push_back(group);
+				}
+			}
+		}
+	});
+	vector<ErrorGroup> result;
+	for (auto& folder : merged){
+		for (ErrorGroup& group : folder.second){
+			result.push_back(std::move(group));
+		}
+	}
+	sort(result.begin(), result.end(), [](const ErrorGroup& a, const ErrorGroup& b){
+		return a.count != b.count ? a.count > b.count : a.folder < b.folder;
+	});
+	return result;
+}
+
+/**
+ Forget every error collected so far
+ */
+void ErrorCollector::clear(){
+	locals.forEach([](Local& l){
+		lock_guard<mutex> guard(l.lock);
+		l.folders.clear();
+		l.groups = 0;
+		l.overflow = 0;
+	});
+	changes.fetch_add(1, memory_order_relaxed);
+}
@@ -0,0 +1,86 @@
+//
+//  ErrorCollector.hpp
+//
+//  Copyright © 2020 Ravbug. All rights reserved.
+//
+
+#pragma once
+#include "PerThread.hpp"
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+
+using namespace std;
+
+/**
+ The part of reading a folder that failed
+ */
+enum class ScanStep : uint8_t{
+	List,		//listing the folder's entries
+	Status,		//reading the status of an entry
+	Entry,		//any other failure while adding an entry
+	Count
+};
+
+/**
+ Errors of one kind in one folder
+ */
+struct ErrorGroup{
+	string folder;
+	ScanStep step = ScanStep::List;
+	//the errno, or the system error code on Windows
+	int code = 0;
+	uint64_t count = 0;
+	//the name of the first entry that failed, empty if the folder itself failed
+	string example;
+
+	string describe() const;
+};
+
+/**
+ Collects the errors of scans without building a message or posting an event for each one.
+ Each worker records into its own Local, where errors are grouped by folder, step and error code,
+ so a scan that is denied access to thousands of items keeps a few counters instead of thousands of lines.
+ */
+class ErrorCollector{
+public:
+	//groups kept by each worker, further errors are only counted
+	static constexpr size_t maxGroups = 10000;
+
+	/**
+	 Per-worker groups. Only the owning worker writes; the lock is held briefly so readers can merge mid-scan.
+	 */
+	struct Local{
+		mutable mutex lock;
+		//keyed by folder, with the few kinds of errors seen in each
+		unordered_map<string, vector<ErrorGroup>> folders;
+		size_t groups = 0;
+		//errors that did not fit in the groups
+		uint64_t overflow = 0;
+	};
+
+	/**
+	 @return the groups for the calling thread, created on first use
+	 */
+	Local& local(){
+		return locals.local();
+	}
+	void add(Local&, const string& folder, ScanStep, int code, const string& item);
+	vector<ErrorGroup> groups(uint64_t& overflow) const;
+	void clear();
+
+	/**
+	 @return a number that changes whenever an error is added or the collector is cleared
+	 */
+	uint64_t version() const{
+		return changes.load(memory_order_relaxed);
+	}
+
+private:
+	atomic<uint64_t> changes{0};
+	PerThread<Local> locals;
+};
@@ -0,0 +1,150 @@
+//
+//  EstimateFrame.cpp
+//
+//  Copyright © 2020 Ravbug. All rights reserved.
+//
+
+#include "EstimateFrame.hpp"
+#include "FolderDisplay.hpp"
+#include "Epoch.hpp"
+#include <unordered_map>
+#include <algorithm>
+
+//time limits offered, in seconds
+static const int budgets[] = {5, 10, 30, 60};
+
+/**
+ Construct an estimate report and start estimating
+ @param parent the main window
+ @param rootProvider returns the scanned folder, or nullptr if none is open. Called on the main thread.
+ @param watchdog the watchdog of the scan of that folder
+ */
+EstimateFrame::EstimateFrame(wxWindow* parent, const std::function<DirectoryData*()>& rootProvider, const std::shared_ptr<MountWatchdog>& watchdog) : ReportFrame(parent, "Size Estimates"), rootProvider(rootProvider), watchdog(watchdog), refreshTimer(this){
+	wxArrayString choices;
+	for (int seconds : budgets){
+		choices.Add(wxString::Format("Sample for %d seconds", seconds));
+	}
+	budgetChoice = new wxChoice(list->GetParent(), wxID_ANY, wxDefaultPosition, wxDefaultSize, choices);
+	budgetChoice->SetSelection(1);
+	controlSizer->Add(budgetChoice, 0, wxALL, 5);
+	status = new wxStaticText(list->GetParent(), wxID_ANY, "", wxDefaultPosition, wxDefaultSize, wxST_ELLIPSIZE_MIDDLE);
+	controlSizer->Add(status, 1, wxALL|wxALIGN_CENTER_VERTICAL, 5);
+	budgetChoice->Bind(wxEVT_CHOICE, [this](wxCommandEvent&){
+		Populate();
+	});
+	
+	list->AppendTextColumn("Folder", wxDATAVIEW_CELL_INERT, 200, wxALIGN_LEFT, wxDATAVIEW_COL_RESIZABLE);
+	list->AppendProgressColumn("Percent", wxDATAVIEW_CELL_INERT, 100);
+	list->AppendTextColumn("Estimate", wxDATAVIEW_CELL_INERT, 90, wxALIGN_RIGHT);
+	list->AppendTextColumn("95% Range", wxDATAVIEW_CELL_INERT, 160, wxALIGN_RIGHT);
+	list->AppendTextColumn("Basis", wxDATAVIEW_CELL_INERT, -1, wxALIGN_LEFT, wxDATAVIEW_COL_RESIZABLE);
+	
+	Bind(wxEVT_TIMER, [this](wxTimerEvent&){
+		ShowRows();
+	});
+	
+	Populate();
+}
+
+EstimateFrame::~EstimateFrame(){
+	Stop();
+}
+
+/**
+ Cancel the running estimate, if any, and wait for its walks to return
+ */
+void EstimateFrame::Stop(){
+	refreshTimer.Stop();
+	if (job != nullptr){
+		job->cancel();
+		job->join();
+		job = nullptr;
+	}
+}
+
+/**
+ Start a new estimate of the scanned folder
+ */
+void EstimateFrame::Populate(){
+	Stop();
+	Clear();
+	DirectoryData* root = rootProvider();
+	if (root == nullptr){
+		status->SetLabel("Open a folder to estimate its contents");
+		return;
+	}
+	const int seconds = budgets[budgetChoice->GetSelection()];
+	estimator = std::make_unique<SizeEstimator>(root->Path);
+	estimator->watchdog = watchdog;
+	job = JobManager::shared().submit(JobManager::reloadPriority);
+	//leave half of the workers to the full scan, which replaces the estimates as it goes
+	estimator->run(*job, std::chrono::seconds(seconds), std::max(1u, std::thread::hardware_concurrency() / 2));
+	deadline = std::chrono::steady_clock::now() + std::chrono::seconds(seconds);
+	status->SetLabel("Reading " + root->Path);
+	refreshTimer.Start(refreshMilliseconds);
+}
+
+/**
+ Show the current estimates, largest first, bounded by what the full scan has found
+ */
+void EstimateFrame::ShowRows(){
+	if (!estimator->ready()){
+		return;
+	}
+	std::vector<std::pair<std::string, SizeEstimate>> rows = estimator->folders();
+	SizeEstimate total = estimator->total();
+	DirectoryData* root = rootProvider();
+	size_t exact = 0;
+	if (root != nullptr && root->Path == estimator->rootPath){
+		epoch::Guard guard;
+		std::unordered_map<std::string, const DirectoryData*> scanned;
+		for (const DirectoryData* sub : root->children()->subFolders){
+			scanned[sub->Path] = sub;
+		}
+		for (auto& row : rows){
+			auto found = scanned.find(row.first);
+			row.second.bound(found != scanned.end() ? found->second : nullptr);
+			exact += row.second.exact;
+		}
+		total.bound(root);
+	}
+	std::sort(rows.begin(), rows.end(), [](const std::pair<std::string, SizeEstimate>& a, const std::pair<std::string, SizeEstimate>& b){
+		return a.second.expected > b.second.expected;
+	});
+	
+	const std::string selected = SelectedPath();
+	list->Freeze();
+	Clear();
+	for (const auto& row : rows){
+		const SizeEstimate& e = row.second;
+		wxVector<wxVariant> items;
+		items.push_back(std::filesystem::path(row.first).filename().string());
+		items.push_back(wxAny((long)(total.expected > 0 ? e.expected * 100 / total.expected : 0)));
+		items.push_back(FolderDisplay::sizeToString(e.expected));
+		if (e.exact){
+			items.push_back("");
+			items.push_back("Scanned");
+		}
+		else{
+			items.push_back(FolderDisplay::sizeToString(e.low) + " - " + (e.unbounded ? std::string("?") : FolderDisplay::sizeToString(e.high)));
+			items.push_back(wxString::Format("%zu walks", e.probes));
+		}
+		AppendRow(items, row.first);
+		if (row.first == selected){
+			list->SelectRow(list->GetItemCount() - 1);
+		}
+	}
+	list->Thaw();
+	
+	const bool sampling = job != nullptr && !job->finished();
+	wxString label = wxString::Format("%s estimated at %s from %zu walks, %zu of %zu folders scanned", estimator->rootPath, FolderDisplay::sizeToString(total.expected), estimator->probes(), exact, rows.size());
+	if (sampling){
+		const auto left = std::chrono::duration_cast<std::chrono::seconds>(deadline - std::chrono::steady_clock::now()).count();
+		label += wxString::Format(", sampling for %lld more seconds", (long long)std::max<long long>(left, 0));
+	}
+	status->SetLabel(label);
+	//keep refreshing after sampling ends so estimates turn into scanned sizes, until every folder is scanned
+	if (!sampling && (total.exact || root == nullptr)){
+		refreshTimer.Stop();
+	}
+}
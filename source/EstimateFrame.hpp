@@ -0,0 +1,39 @@
+//
+//  EstimateFrame.hpp
+//
+//  Copyright © 2020 Ravbug. All rights reserved.
+//
+
+#pragma once
+#include "ReportFrame.hpp"
+#include "SizeEstimator.hpp"
+#include <memory>
+#include <functional>
+
+/**
+ Estimates the sizes of the scanned folder's subfolders within a few seconds, with confidence intervals.
+ Estimates are replaced by the scanned sizes as the full scan finishes each folder.
+ */
+class EstimateFrame : public ReportFrame{
+public:
+	EstimateFrame(wxWindow* parent, const std::function<DirectoryData*()>& rootProvider, const std::shared_ptr<MountWatchdog>& watchdog);
+	~EstimateFrame();
+	void Populate() override;
+	
+private:
+	//how often the rows are refreshed while estimating
+	static constexpr int refreshMilliseconds = 500;
+	
+	std::function<DirectoryData*()> rootProvider;
+	//shared with the scan, so a mount either finds hung is skipped by both
+	std::shared_ptr<MountWatchdog> watchdog;
+	std::unique_ptr<SizeEstimator> estimator;
+	std::shared_ptr<Job> job;
+	std::chrono::steady_clock::time_point deadline;
+	wxChoice* budgetChoice;
+	wxStaticText* status;
+	wxTimer refreshTimer;
+	
+	void Stop();
+	void ShowRows();
+};
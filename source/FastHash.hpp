@@ -0,0 +1,145 @@
+//
+//  FastHash.hpp
+//
+//  Copyright © 2020 Ravbug. All rights reserved.
+//
+
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <cstddef>
+
+/**
+ Streaming 64-bit non-cryptographic hash (the XXH64 algorithm).
+ Input is consumed as four independent 64-bit lanes, so the multiply-rotate
+ rounds of each lane overlap in the CPU pipeline and throughput is close to memory bandwidth.
+ */
+class FastHash{
+public:
+	FastHash(uint64_t seed = 0){
+		lanes[0] = seed + prime1 + prime2;
+		lanes[1] = seed + prime2;
+		lanes[2] = seed;
+		lanes[3] = seed - prime1;
+		this->seed = seed;
+	}
+	
+	/**
+	 Add bytes to the hash
+	 @param data the bytes to hash
+	 @param length the number of bytes
+	 */
+	void update(const void* data, size_t length){
+		const uint8_t* p = (const uint8_t*)data;
+		total += length;
+		//complete a partially filled stripe first
+		if (buffered > 0){
+			size_t take = length < stripe - buffered ? length : stripe - buffered;
+			memcpy(buffer + buffered, p, take);
+			buffered += take;
+			p += take;
+			length -= take;
+			if (buffered < stripe){
+				return;
+			}
+			consume(buffer);
+			buffered = 0;
+		}
+		for (; length >= stripe; p += stripe, length -= stripe){
+			consume(p);
+		}
+		memcpy(buffer, p, length);
+		buffered = length;
+	}
+	
+	/**
+	 @return the hash of all bytes added so far
+	 */
+	uint64_t digest() const{
+		uint64_t h;
+		if (total >= stripe){
+			h = rotl(lanes[0], 1) + rotl(lanes[1], 7) + rotl(lanes[2], 12) + rotl(lanes[3], 18);
+			for (uint64_t lane : lanes){
+				h ^= round(0, lane);
+				h = h * prime1 + prime4;
+			}
+		}
+		else{
+			h = seed + prime5;
+		}
+		h += total;
+		
+		const uint8_t* p = buffer;
+		size_t length = buffered;
+		for (; length >= 8; p += 8, length -= 8){
+			h ^= round(0, read64(p));
+			h = rotl(h, 27) * prime1 + prime4;
+		}
+		if (length >= 4){
+			h ^= (uint64_t)read32(p) * prime1;
+			h = rotl(h, 23) * prime2 + prime3;
+			p += 4;
+			length -= 4;
+		}
+		for (; length > 0; p++, length--){
+			h ^= (*p) * prime5;
+			h = rotl(h, 11) * prime1;
+		}
+		
+		//avalanche
+		h ^= h >> 33;
+		h *= prime2;
+		h ^= h >> 29;
+		h *= prime3;
+		h ^= h >> 32;
+		return h;
+	}
+	
+	/**
+	 Hash a buffer in one call
+	 */
+	static uint64_t hash(const void* data, size_t length, uint64_t seed = 0){
+		FastHash h(seed);
+		h.update(data, length);
+		return h.digest();
+	}
+	
+private:
+	static constexpr uint64_t prime1 = 0x9E3779B185EBCA87ULL;
+	static constexpr uint64_t prime2 = 0xC2B2AE3D27D4EB4FULL;
+	static constexpr uint64_t prime3 = 0x165667B19E3779F9ULL;
+	static constexpr uint64_t prime4 = 0x85EBCA77C2B2AE63ULL;
+	static constexpr uint64_t prime5 = 0x27D4EB2F165667C5ULL;
+	static constexpr size_t stripe = 32;
+	
+	uint64_t lanes[4];
+	uint64_t seed;
+	uint64_t total = 0;
+	uint8_t buffer[stripe];
+	size_t buffered = 0;
+	
+	static inline uint64_t rotl(uint64_t x, int r){
+		return (x << r) | (x >> (64 - r));
+	}
+	static inline uint64_t round(uint64_t acc, uint64_t input){
+		acc += input * prime2;
+		acc = rotl(acc, 31);
+		return acc * prime1;
+	}
+	static inline uint64_t read64(const uint8_t* p){
+		uint64_t v;
+		memcpy(&v, p, sizeof(v));
+		return v;
+	}
+	static inline uint32_t read32(const uint8_t* p){
+		uint32_t v;
+		memcpy(&v, p, sizeof(v));
+		return v;
+	}
+	inline void consume(const uint8_t* p){
+		lanes[0] = round(lanes[0], read64(p));
+		lanes[1] = round(lanes[1], read64(p + 8));
+		lanes[2] = round(lanes[2], read64(p + 16));
+		lanes[3] = round(lanes[3], read64(p + 24));
+	}
+};
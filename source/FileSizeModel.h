@@ -6,27 +6,30 @@
 Defines the file-size sort method
 */
 class FileSizeModel : public wxDataViewListStore {
-#ifndef _WIN32
 public:
 	/**
-	 * The comparator method for the file size displays
+	 * The comparator method for the file size displays. FolderDisplay inserts its rows in order and does not
+	 * let the control sort, but a sort requested by the control stays consistent with that order.
 	 * @param item1 the first item in the list to compare
 	 * @param item2 the second item in the list to compare
 	 * @param column unused - this comparator always sorts by client data
-	 * ascending - negative = greater or less
+	 * @param ascending true to list the smallest items first
+	 * @return negative if item1 is listed first, positive if item2 is, 0 if both show the same item
 	 */
 	int Compare(const wxDataViewItem& item1, const wxDataViewItem& item2, unsigned int column, bool ascending) const override {
 		//get the client data for use in comparison
 		DirectoryData* data1 = (DirectoryData*)GetItemData(item1);
 		DirectoryData* data2 = (DirectoryData*)GetItemData(item2);
 
-		int answer = (data1->size > data2->size) ? -1 : 1;
-
-		if (ascending) {
-			answer *= -1;
+		//largest first, equal sizes by name so the ordering is strict
+		int answer = 0;
+		if (data1->measured() != data2->measured()){
+			answer = data1->measured() > data2->measured() ? -1 : 1;
+		}
+		else{
+			answer = data1->Path.compare(data2->Path);
 		}
 
-		return answer;
+		return ascending ? -answer : answer;
 	}
-#endif
 };
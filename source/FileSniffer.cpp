@@ -0,0 +1,279 @@
+//
+//  FileSniffer.cpp
+//
+//  Copyright © 2020 Ravbug. All rights reserved.
+//
+
+#include "FileSniffer.hpp"
+#include <sys/stat.h>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+
+#if defined _WIN32
+#include <windows.h>
+#include <objbase.h>
+#include <shellapi.h>
+#endif
+
+using namespace std;
+
+namespace{
+	/**
+	 A signature at a fixed offset in the file
+	 */
+	struct Magic{
+		size_t offset;
+		const char* bytes;
+		size_t length;
+		const char* description;
+	};
+	
+	#define MAGIC(offset, literal, description) {offset, literal, sizeof(literal) - 1, description}
+	//checked in order, so longer signatures come before shorter ones that share a prefix
+	const Magic signatures[] = {
+		MAGIC(0, "\x89PNG\r\n\x1a\n", "PNG image"),
+		MAGIC(0, "\xff\xd8\xff", "JPEG image"),
+		MAGIC(0, "GIF87a", "GIF image"),
+		MAGIC(0, "GIF89a", "GIF image"),
+		MAGIC(0, "BM", "Bitmap image"),
+		MAGIC(0, "II*\0", "TIFF image"),
+		MAGIC(0, "MM\0*", "TIFF image"),
+		MAGIC(0, "8BPS", "Photoshop image"),
+		MAGIC(0, "\0\0\1\0", "Windows icon"),
+		MAGIC(8, "WEBP", "WebP image"),
+		MAGIC(8, "WAVE", "WAVE audio"),
+		MAGIC(8, "AVI ", "AVI video"),
+		MAGIC(0, "ID3", "MP3 audio"),
+		MAGIC(0, "\xff\xfb", "MP3 audio"),
+		MAGIC(0, "fLaC", "FLAC audio"),
+		MAGIC(0, "OggS", "Ogg media"),
+		MAGIC(4, "ftypqt", "QuickTime movie"),
+		MAGIC(4, "ftypM4A", "MPEG-4 audio"),
+		MAGIC(4, "ftypheic", "HEIC image"),
+		MAGIC(4, "ftyp", "MPEG-4 media"),
+		MAGIC(0, "\x1a\x45\xdf\xa3", "Matroska or WebM video"),
+		MAGIC(0, "%PDF-", "PDF document"),
+		MAGIC(0, "%!PS", "PostScript document"),
+		MAGIC(0, "{\\rtf1", "Rich Text document"),
+		MAGIC(0, "\xd0\xcf\x11\xe0\xa1\xb1\x1a\xe1", "Microsoft Office document"),
+		MAGIC(0, "SQLite format 3", "SQLite database"),
+		MAGIC(0, "PK\3\4", "Zip archive"),
+		MAGIC(0, "PK\5\6", "Zip archive (empty)"),
+		MAGIC(0, "\x1f\x8b", "gzip compressed data"),
+		MAGIC(0, "BZh", "bzip2 compressed data"),
+		MAGIC(0, "\xfd" "7zXZ\0", "XZ compressed data"),
+		MAGIC(0, "\x28\xb5\x2f\xfd", "Zstandard compressed data"),
+		MAGIC(0, "7z\xbc\xaf\x27\x1c", "7-Zip archive"),
+		MAGIC(0, "Rar!\x1a\x07", "RAR archive"),
+		MAGIC(257, "ustar", "tar archive"),
+		MAGIC(0, "xar!", "XAR archive"),
+		MAGIC(0, "\x7f" "ELF", "ELF executable"),
+		MAGIC(0, "\xcf\xfa\xed\xfe", "Mach-O 64-bit executable"),
+		MAGIC(0, "\xce\xfa\xed\xfe", "Mach-O executable"),
+		MAGIC(0, "\xca\xfe\xba\xbe", "Mach-O universal binary or Java class"),
+		MAGIC(0, "MZ", "Windows executable"),
+		MAGIC(0, "\0asm", "WebAssembly module"),
+		MAGIC(0, "dex\n", "Android Dalvik executable"),
+		MAGIC(0, "wOFF", "WOFF font"),
+		MAGIC(0, "wOF2", "WOFF2 font"),
+		MAGIC(0, "OTTO", "OpenType font"),
+		MAGIC(0, "\0\1\0\0\0", "TrueType font"),
+		MAGIC(0, "bplist00", "Binary property list"),
+		MAGIC(0, "<?xml", "XML document"),
+		MAGIC(0, "#!", "Script"),
+	};
+	#undef MAGIC
+	
+	/**
+	 @return true if the bytes are valid UTF-8 without control characters other than whitespace
+	 @param data the bytes to check
+	 @param length the number of bytes
+	 @param ascii set to false if any multibyte sequences were found
+	 */
+	bool isText(const uint8_t* data, size_t length, bool& ascii){
+		ascii = true;
+		size_t i = 0;
+		while (i < length){
+			uint8_t c = data[i];
+			if (c < 0x80){
+				if (c < 0x20 && c != '\n' && c != '\r' && c != '\t' && c != '\f' && c != 0x1b){
+					return false;
+				}
+				i++;
+				continue;
+			}
+			ascii = false;
+			size_t extra = (c & 0xe0) == 0xc0 ? 1 : (c & 0xf0) == 0xe0 ? 2 : (c & 0xf8) == 0xf0 ? 3 : 0;
+			if (extra == 0){
+				return false;
+			}
+			//a sequence cut off by the end of the header is still text
+			for (size_t j = 1; j <= extra && i + j < length; j++){
+				if ((data[i + j] & 0xc0) != 0x80){
+					return false;
+				}
+			}
+			i += extra + 1;
+		}
+		return true;
+	}
+	
+#if defined _WIN32
+	/**
+	 Ask the shell for the type name of a file
+	 @param path the path to the file
+	 @return the type name registered for the file's extension
+	 */
+	string systemDescription(const string& path){
+		SHFILEINFOW fileInfo{};
+		if (SHGetFileInfoW(filesystem::path(path).wstring().c_str(), 0, &fileInfo, sizeof(fileInfo), SHGFI_TYPENAME) == 0){
+			return "";
+		}
+		return filesystem::path(fileInfo.szTypeName).string();
+	}
+#endif
+}
+
+/**
+ Start the sniffer thread
+ @param callback receives each result
+ */
+FileSniffer::FileSniffer(const resultCallback& callback) : callback(callback){
+	worker = thread(&FileSniffer::run, this);
+}
+
+FileSniffer::~FileSniffer(){
+	{
+		lock_guard<mutex> guard(lock);
+		stopping = true;
+	}
+	wake.notify_one();
+	worker.join();
+}
+
+/**
+ Describe a file in the background, replacing any request that has not started yet
+ @param path the file to describe
+ */
+void FileSniffer::request(const string& path){
+	{
+		lock_guard<mutex> guard(lock);
+		pending = path;
+		hasPending = true;
+	}
+	wake.notify_one();
+}
+
+/**
+ Sniffer thread body
+ */
+void FileSniffer::run(){
+#if defined _WIN32
+	//the shell type lookup needs COM on this thread
+	CoInitializeEx(nullptr, COINIT_APARTMENTTHREADED);
+#endif
+	for(;;){
+		string path;
+		{
+			unique_lock<mutex> guard(lock);
+			wake.wait(guard, [this]{ return hasPending || stopping; });
+			if (stopping){
+				break;
+			}
+			path = move(pending);
+			hasPending = false;
+		}
+		callback(path, sniff(path));
+	}
+#if defined _WIN32
+	CoUninitialize();
+#endif
+}
+
+/**
+ Describe a file, using the cache when the file has not changed
+ @param path the file to describe
+ @return the description
+ */
+string FileSniffer::sniff(const string& path){
+	struct stat info;
+	if (stat(path.c_str(), &info) != 0){
+		return "Unknown";
+	}
+	if (S_ISDIR(info.st_mode)){
+		return "Folder";
+	}
+	
+	FileKey key;
+	key.device = info.st_dev;
+	key.inode = info.st_ino;
+	key.modified = info.st_mtime;
+	if (key.inode == 0){
+		key.pathHash = hash<string>()(path);
+	}
+	auto found = cache.find(key);
+	if (found != cache.end()){
+		//move to the front of the recently used list
+		recent.splice(recent.begin(), recent, found->second);
+		return found->second->second;
+	}
+	
+	string description;
+	FILE* file = fopen(path.c_str(), "rb");
+	if (file == nullptr){
+		description = "Unknown (not readable)";
+	}
+	else{
+		uint8_t header[headerBytes];
+		size_t length = fread(header, 1, sizeof(header), file);
+		fclose(file);
+		description = describe(header, length);
+#if defined _WIN32
+		//fall back to the registered type for formats without a signature
+		if (description == "Data"){
+			string system = systemDescription(path);
+			if (!system.empty()){
+				description = system;
+			}
+		}
+#endif
+	}
+	
+	recent.emplace_front(key, description);
+	cache[key] = recent.begin();
+	if (recent.size() > cacheCapacity){
+		cache.erase(recent.back().first);
+		recent.pop_back();
+	}
+	return description;
+}
+
+/**
+ Describe the format of a file from its first bytes
+ @param data the start of the file
+ @param length the number of bytes available, up to headerBytes
+ @return a short description of the format
+ */
+string FileSniffer::describe(const uint8_t* data, size_t length){
+	if (length == 0){
+		return "Empty";
+	}
+	for (const Magic& m : signatures){
+		if (m.offset + m.length <= length && memcmp(data + m.offset, m.bytes, m.length) == 0){
+			return m.description;
+		}
+	}
+	//byte order marks
+	if (length >= 3 && memcmp(data, "\xef\xbb\xbf", 3) == 0){
+		return "UTF-8 text";
+	}
+	if (length >= 2 && (memcmp(data, "\xff\xfe", 2) == 0 || memcmp(data, "\xfe\xff", 2) == 0)){
+		return "UTF-16 text";
+	}
+	bool ascii;
+	if (isText(data, length, ascii)){
+		return ascii ? "ASCII text" : "UTF-8 text";
+	}
+	return "Data";
+}
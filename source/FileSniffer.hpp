@@ -0,0 +1,78 @@
+//
+//  FileSniffer.hpp
+//
+//  Copyright © 2020 Ravbug. All rights reserved.
+//
+
+#pragma once
+#include <string>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <list>
+#include <unordered_map>
+#include <cstdint>
+
+/**
+ Identifies a version of a file on disk. A file that is modified or replaced gets a new key.
+ */
+struct FileKey{
+	uint64_t device = 0;
+	uint64_t inode = 0;
+	int64_t modified = 0;
+	//filesystems without inode numbers are keyed by path instead
+	size_t pathHash = 0;
+	
+	bool operator==(const FileKey& other) const{
+		return device == other.device && inode == other.inode && modified == other.modified && pathHash == other.pathHash;
+	}
+};
+
+struct FileKeyHash{
+	size_t operator()(const FileKey& k) const{
+		size_t h = std::hash<uint64_t>()(k.inode);
+		h ^= std::hash<uint64_t>()(k.device) + 0x9e3779b97f4a7c15 + (h << 6) + (h >> 2);
+		h ^= std::hash<int64_t>()(k.modified) + 0x9e3779b97f4a7c15 + (h << 6) + (h >> 2);
+		return h ^ k.pathHash;
+	}
+};
+
+/**
+ Describes the type of a file from the first bytes of its contents, on a background thread.
+ Only the most recent request is kept, so quickly moving through a list only reads the files
+ that are still selected. Results are cached by FileKey.
+ */
+class FileSniffer{
+public:
+	//called on the sniffer thread with the requested path and its description
+	typedef std::function<void(const std::string& path, const std::string& description)> resultCallback;
+	
+	static constexpr size_t headerBytes = 4096;
+	static constexpr size_t cacheCapacity = 1024;
+	
+	FileSniffer(const resultCallback& callback);
+	~FileSniffer();
+	
+	void request(const std::string& path);
+	static std::string describe(const uint8_t* data, size_t length);
+	
+private:
+	resultCallback callback;
+	
+	std::mutex lock;
+	std::condition_variable wake;
+	std::string pending;
+	bool hasPending = false;
+	bool stopping = false;
+	
+	//most recently used first, only touched by the sniffer thread
+	typedef std::pair<FileKey, std::string> cacheEntry;
+	std::list<cacheEntry> recent;
+	std::unordered_map<FileKey, std::list<cacheEntry>::iterator, FileKeyHash> cache;
+	
+	std::thread worker;
+	
+	void run();
+	std::string sniff(const std::string& path);
+};
@@ -0,0 +1,351 @@
+//
+//  FileTypes.cpp
+//
+//  Copyright © 2020 Ravbug. All rights reserved.
+//
+
+#include "FileTypes.hpp"
+#include <unordered_map>
+#include <shared_mutex>
+#include <mutex>
+#include <vector>
+#include <array>
+#include <algorithm>
+#include <cstdlib>
+
+using namespace std;
+
+namespace{
+	struct KnownExtension{
+		const char* extension;
+		FileCategory category;
+	};
+	
+	//lowercase, without the leading dot. Each extension may appear only once.
+	constexpr KnownExtension knownExtensions[] = {
+		{"exe", FileCategory::Program},{"dll", FileCategory::Program},{"bat", FileCategory::Program},{"cmd", FileCategory::Program},{"com", FileCategory::Program},{"msi", FileCategory::Program},{"msix", FileCategory::Program},{"appx", FileCategory::Program},
+		{"jar", FileCategory::Program},{"apk", FileCategory::Program},{"aab", FileCategory::Program},{"app", FileCategory::Program},{"ipa", FileCategory::Program},{"sys", FileCategory::Program},{"so", FileCategory::Program},{"dylib", FileCategory::Program},
+		{"bundle", FileCategory::Program},{"framework", FileCategory::Program},{"ko", FileCategory::Program},{"elf", FileCategory::Program},{"out", FileCategory::Program},{"run", FileCategory::Program},{"ps1", FileCategory::Program},{"vbs", FileCategory::Program},
+		{"scr", FileCategory::Program},{"cpl", FileCategory::Program},{"ocx", FileCategory::Program},{"drv", FileCategory::Program},{"efi", FileCategory::Program},{"wasm", FileCategory::Program},{"class", FileCategory::Program},{"dex", FileCategory::Program},
+		{"pyc", FileCategory::Program},{"pyo", FileCategory::Program},{"lib", FileCategory::Program},{"a", FileCategory::Program},{"o", FileCategory::Program},{"obj", FileCategory::Program},{"pdb", FileCategory::Program},
+		{"iso", FileCategory::DiskImage},{"bin", FileCategory::DiskImage},{"img", FileCategory::DiskImage},{"dmg", FileCategory::DiskImage},{"vhd", FileCategory::DiskImage},{"vhdx", FileCategory::DiskImage},{"vmdk", FileCategory::DiskImage},{"vdi", FileCategory::DiskImage},
+		{"qcow", FileCategory::DiskImage},{"qcow2", FileCategory::DiskImage},{"toast", FileCategory::DiskImage},{"cue", FileCategory::DiskImage},{"nrg", FileCategory::DiskImage},{"mdf", FileCategory::DiskImage},{"mds", FileCategory::DiskImage},{"sparseimage", FileCategory::DiskImage},
+		{"sparsebundle", FileCategory::DiskImage},{"ova", FileCategory::DiskImage},{"ovf", FileCategory::DiskImage},{"hdd", FileCategory::DiskImage},{"raw", FileCategory::DiskImage},{"wim", FileCategory::DiskImage},{"swm", FileCategory::DiskImage},{"esd", FileCategory::DiskImage},
+		{"ai", FileCategory::Image},{"bmp", FileCategory::Image},{"gif", FileCategory::Image},{"ico", FileCategory::Image},{"jpeg", FileCategory::Image},{"jpg", FileCategory::Image},{"jpe", FileCategory::Image},{"jfif", FileCategory::Image},
+		{"png", FileCategory::Image},{"psd", FileCategory::Image},{"svg", FileCategory::Image},{"svgz", FileCategory::Image},{"tif", FileCategory::Image},{"tiff", FileCategory::Image},{"icns", FileCategory::Image},{"exr", FileCategory::Image},
+		{"heic", FileCategory::Image},{"heif", FileCategory::Image},{"webp", FileCategory::Image},{"avif", FileCategory::Image},{"cr2", FileCategory::Image},{"cr3", FileCategory::Image},{"nef", FileCategory::Image},{"arw", FileCategory::Image},
+		{"dng", FileCategory::Image},{"orf", FileCategory::Image},{"rw2", FileCategory::Image},{"raf", FileCategory::Image},{"srw", FileCategory::Image},{"pef", FileCategory::Image},{"tga", FileCategory::Image},{"dds", FileCategory::Image},
+		{"hdr", FileCategory::Image},{"xcf", FileCategory::Image},{"kra", FileCategory::Image},{"eps", FileCategory::Image},{"indd", FileCategory::Image},{"sketch", FileCategory::Image},{"xd", FileCategory::Image},{"fig", FileCategory::Image},
+		{"jxl", FileCategory::Image},{"jp2", FileCategory::Image},{"pcx", FileCategory::Image},{"ppm", FileCategory::Image},{"pgm", FileCategory::Image},{"pbm", FileCategory::Image},
+		{"mp3", FileCategory::Audio},{"aif", FileCategory::Audio},{"aiff", FileCategory::Audio},{"aifc", FileCategory::Audio},{"ogg", FileCategory::Audio},{"oga", FileCategory::Audio},{"opus", FileCategory::Audio},{"wav", FileCategory::Audio},
+		{"wma", FileCategory::Audio},{"m4a", FileCategory::Audio},{"m4b", FileCategory::Audio},{"m4p", FileCategory::Audio},{"aac", FileCategory::Audio},{"flac", FileCategory::Audio},{"alac", FileCategory::Audio},{"ape", FileCategory::Audio},
+		{"mid", FileCategory::Audio},{"midi", FileCategory::Audio},{"amr", FileCategory::Audio},{"au", FileCategory::Audio},{"caf", FileCategory::Audio},{"dsf", FileCategory::Audio},{"dff", FileCategory::Audio},{"mka", FileCategory::Audio},
+		{"ra", FileCategory::Audio},{"wv", FileCategory::Audio},{"ac3", FileCategory::Audio},{"dts", FileCategory::Audio},
+		{"mp4", FileCategory::Video},{"avi", FileCategory::Video},{"flv", FileCategory::Video},{"f4v", FileCategory::Video},{"h264", FileCategory::Video},{"h265", FileCategory::Video},{"hevc", FileCategory::Video},{"m4v", FileCategory::Video},
+		{"mkv", FileCategory::Video},{"mov", FileCategory::Video},{"mpg", FileCategory::Video},{"mpeg", FileCategory::Video},{"mpe", FileCategory::Video},{"m2v", FileCategory::Video},{"m2ts", FileCategory::Video},{"mts", FileCategory::Video},
+		{"ts", FileCategory::Video},{"vob", FileCategory::Video},{"wmv", FileCategory::Video},{"webm", FileCategory::Video},{"3gp", FileCategory::Video},{"3g2", FileCategory::Video},{"ogv", FileCategory::Video},{"rm", FileCategory::Video},
+		{"rmvb", FileCategory::Video},{"asf", FileCategory::Video},{"divx", FileCategory::Video},{"xvid", FileCategory::Video},{"prores", FileCategory::Video},{"mxf", FileCategory::Video},
+		{"7z", FileCategory::Archive},{"arj", FileCategory::Archive},{"pkg", FileCategory::Archive},{"rar", FileCategory::Archive},{"rpm", FileCategory::Archive},{"deb", FileCategory::Archive},{"gz", FileCategory::Archive},{"tgz", FileCategory::Archive},
+		{"bz2", FileCategory::Archive},{"tbz2", FileCategory::Archive},{"xz", FileCategory::Archive},{"txz", FileCategory::Archive},{"lz", FileCategory::Archive},{"lzma", FileCategory::Archive},{"lz4", FileCategory::Archive},{"zst", FileCategory::Archive},
+		{"tzst", FileCategory::Archive},{"z", FileCategory::Archive},{"zip", FileCategory::Archive},{"zipx", FileCategory::Archive},{"tar", FileCategory::Archive},{"cab", FileCategory::Archive},{"cpio", FileCategory::Archive},{"ar", FileCategory::Archive},
+		{"xar", FileCategory::Archive},{"sit", FileCategory::Archive},{"sitx", FileCategory::Archive},{"ace", FileCategory::Archive},{"lzh", FileCategory::Archive},{"lha", FileCategory::Archive},{"war", FileCategory::Archive},{"ear", FileCategory::Archive},
+		{"whl", FileCategory::Archive},{"gem", FileCategory::Archive},{"nupkg", FileCategory::Archive},{"snap", FileCategory::Archive},{"flatpak", FileCategory::Archive},{"appimage", FileCategory::Archive},{"crx", FileCategory::Archive},{"xpi", FileCategory::Archive},
+		{"doc", FileCategory::Document},{"docx", FileCategory::Document},{"docm", FileCategory::Document},{"dot", FileCategory::Document},{"dotx", FileCategory::Document},{"odt", FileCategory::Document},{"ott", FileCategory::Document},{"pdf", FileCategory::Document},
+		{"rtf", FileCategory::Document},{"tex", FileCategory::Document},{"txt", FileCategory::Document},{"md", FileCategory::Document},{"markdown", FileCategory::Document},{"rst", FileCategory::Document},{"log", FileCategory::Document},{"xls", FileCategory::Document},
+		{"xlsx", FileCategory::Document},{"xlsm", FileCategory::Document},{"ods", FileCategory::Document},{"csv", FileCategory::Document},{"tsv", FileCategory::Document},{"ppt", FileCategory::Document},{"pptx", FileCategory::Document},{"pps", FileCategory::Document},
+		{"ppsx", FileCategory::Document},{"odp", FileCategory::Document},{"key", FileCategory::Document},{"pages", FileCategory::Document},{"numbers", FileCategory::Document},{"epub", FileCategory::Document},{"mobi", FileCategory::Document},{"azw", FileCategory::Document},
+		{"azw3", FileCategory::Document},{"djvu", FileCategory::Document},{"xps", FileCategory::Document},{"oxps", FileCategory::Document},{"ps", FileCategory::Document},{"one", FileCategory::Document},{"msg", FileCategory::Document},{"eml", FileCategory::Document},
+		{"pst", FileCategory::Document},{"ost", FileCategory::Document},{"vcf", FileCategory::Document},{"ics", FileCategory::Document},
+		{"c", FileCategory::Code},{"h", FileCategory::Code},{"cc", FileCategory::Code},{"cpp", FileCategory::Code},{"cxx", FileCategory::Code},{"hpp", FileCategory::Code},{"hxx", FileCategory::Code},{"hh", FileCategory::Code},
+		{"inl", FileCategory::Code},{"m", FileCategory::Code},{"mm", FileCategory::Code},{"swift", FileCategory::Code},{"java", FileCategory::Code},{"kt", FileCategory::Code},{"kts", FileCategory::Code},{"scala", FileCategory::Code},
+		{"groovy", FileCategory::Code},{"go", FileCategory::Code},{"rs", FileCategory::Code},{"py", FileCategory::Code},{"pyw", FileCategory::Code},{"rb", FileCategory::Code},{"pl", FileCategory::Code},{"pm", FileCategory::Code},
+		{"php", FileCategory::Code},{"js", FileCategory::Code},{"mjs", FileCategory::Code},{"cjs", FileCategory::Code},{"jsx", FileCategory::Code},{"tsx", FileCategory::Code},{"cs", FileCategory::Code},{"fs", FileCategory::Code},
+		{"vb", FileCategory::Code},{"lua", FileCategory::Code},{"r", FileCategory::Code},{"jl", FileCategory::Code},{"dart", FileCategory::Code},{"zig", FileCategory::Code},{"nim", FileCategory::Code},{"hs", FileCategory::Code},
+		{"ml", FileCategory::Code},{"ex", FileCategory::Code},{"exs", FileCategory::Code},{"erl", FileCategory::Code},{"clj", FileCategory::Code},{"sh", FileCategory::Code},{"bash", FileCategory::Code},{"zsh", FileCategory::Code},
+		{"fish", FileCategory::Code},{"sql", FileCategory::Code},{"html", FileCategory::Code},{"htm", FileCategory::Code},{"css", FileCategory::Code},{"scss", FileCategory::Code},{"sass", FileCategory::Code},{"less", FileCategory::Code},
+		{"xml", FileCategory::Code},{"json", FileCategory::Code},{"yaml", FileCategory::Code},{"yml", FileCategory::Code},{"toml", FileCategory::Code},{"ini", FileCategory::Code},{"cfg", FileCategory::Code},{"conf", FileCategory::Code},
+		{"cmake", FileCategory::Code},{"make", FileCategory::Code},{"mk", FileCategory::Code},{"gradle", FileCategory::Code},{"ipynb", FileCategory::Code},{"vue", FileCategory::Code},{"svelte", FileCategory::Code},{"asm", FileCategory::Code},
+		{"s", FileCategory::Code},
+	};
+	constexpr size_t knownCount = sizeof(knownExtensions) / sizeof(knownExtensions[0]);
+	
+	constexpr char fold(char c){
+		return c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c;
+	}
+	
+	/**
+	 Case-insensitive seeded hash of an extension
+	 @param s the extension
+	 @param seed selects one of a family of independent hash functions
+	 @return the hash value
+	 */
+	constexpr uint32_t extensionHash(string_view s, uint32_t seed){
+		uint32_t h = 2166136261u ^ (seed * 0x9e3779b9u);
+		for (char c : s){
+			h ^= (uint8_t)fold(c);
+			h *= 16777619u;
+		}
+		//finish so that nearby seeds give unrelated slots
+		h ^= h >> 15;
+		h *= 0x2c1b3c6du;
+		h ^= h >> 12;
+		return h;
+	}
+	
+	constexpr size_t bucketCount = 256;
+	constexpr size_t slotCount = 1024;
+	static_assert(knownCount < slotCount / 2, "grow slotCount to keep the table sparse");
+	
+	/**
+	 Hash-and-displace perfect hash: an extension's bucket picks a seed, and that seed
+	 places it in a slot no other known extension uses.
+	 */
+	struct PerfectHash{
+		array<uint32_t, bucketCount> seeds{};
+		array<int16_t, slotCount> slots{};
+		bool valid = false;
+	};
+	
+	/**
+	 Build the perfect hash. This runs once, at static initialization: searching for the seeds at compile
+	 time takes more steps than compilers allow by default.
+	 @return the table, with valid set to false if no seed could be found for some bucket
+	 */
+	PerfectHash buildPerfectHash(){
+		PerfectHash table{};
+		for (int16_t& slot : table.slots){
+			slot = -1;
+		}
+		
+		//group the extensions by bucket with a counting sort
+		array<size_t, bucketCount + 1> start{};
+		array<uint16_t, knownCount> bucketOf{};
+		for (size_t i = 0; i < knownCount; i++){
+			bucketOf[i] = extensionHash(knownExtensions[i].extension, 0) % bucketCount;
+			start[bucketOf[i] + 1]++;
+		}
+		for (size_t b = 0; b < bucketCount; b++){
+			start[b + 1] += start[b];
+		}
+		array<int16_t, knownCount> members{};
+		array<size_t, bucketCount> filled{};
+		for (size_t i = 0; i < knownCount; i++){
+			members[start[bucketOf[i]] + filled[bucketOf[i]]++] = (int16_t)i;
+		}
+		size_t largest = 0;
+		for (size_t b = 0; b < bucketCount; b++){
+			largest = max(largest, start[b + 1] - start[b]);
+		}
+		
+		//place the largest buckets first, while the table is emptiest
+		for (size_t size = largest; size > 0; size--){
+			for (size_t b = 0; b < bucketCount; b++){
+				if (start[b + 1] - start[b] != size){
+					continue;
+				}
+				bool placed = false;
+				for (uint32_t seed = 1; seed < 65536 && !placed; seed++){
+					array<uint32_t, 16> chosen{};
+					placed = size <= chosen.size();
+					for (size_t m = 0; m < size && placed; m++){
+						chosen[m] = extensionHash(knownExtensions[members[start[b] + m]].extension, seed) % slotCount;
+						placed = table.slots[chosen[m]] == -1;
+						for (size_t other = 0; other < m && placed; other++){
+							placed = chosen[other] != chosen[m];
+						}
+					}
+					if (placed){
+						table.seeds[b] = seed;
+						for (size_t m = 0; m < size; m++){
+							table.slots[chosen[m]] = members[start[b] + m];
+						}
+					}
+				}
+				if (!placed){
+					return table;
+				}
+			}
+		}
+		table.valid = true;
+		return table;
+	}
+	
+	const PerfectHash extensionTable = buildPerfectHash();
+	
+	/**
+	 @return true if a lowercase known extension equals the candidate, ignoring the candidate's case
+	 */
+	bool equalsFolded(const char* known, string_view candidate){
+		size_t i = 0;
+		for (; i < candidate.size(); i++){
+			if (known[i] == '\0' || known[i] != fold(candidate[i])){
+				return false;
+			}
+		}
+		return known[i] == '\0';
+	}
+	
+	/**
+	 @return the index of an extension in knownExtensions, ignoring its case, or -1 if it is not known
+	 */
+	int16_t knownIndex(string_view extension){
+		const uint32_t seed = extensionTable.seeds[extensionHash(extension, 0) % bucketCount];
+		const int16_t index = extensionTable.slots[extensionHash(extension, seed) % slotCount];
+		return index >= 0 && equalsFolded(knownExtensions[index].extension, extension) ? index : -1;
+	}
+}
+
+/**
+ Find the category an extension belongs to. Does not allocate.
+ @param extension the extension without the leading dot, in any case
+ @return the category, or FileCategory::Other if the extension is not known
+ */
+FileCategory categoryForExtension(string_view extension){
+	if (extension.empty()){
+		return FileCategory::NoExtension;
+	}
+	const int16_t index = knownIndex(extension);
+	return index >= 0 ? knownExtensions[index].category : FileCategory::Other;
+}
+
+/**
+ @return a display name for a category
+ */
+const char* categoryName(FileCategory category){
+	static const char* names[] = {"Other", "No Extension", "Programs", "Disk Images", "Images", "Audio", "Video", "Archives", "Documents", "Source Code"};
+	static_assert(sizeof(names) / sizeof(names[0]) == (size_t)FileCategory::Count, "every category needs a name");
+	return names[(size_t)category];
+}
+
+/**
+ Find the extension of a path, the same way std::filesystem::path::extension does, but without the dot
+ @param path the path or name of the file
+ @return a view into path of the extension, in its original case, or an empty view if the file has none
+ */
+string_view extensionView(string_view path){
+	const size_t nameStart = path.find_last_of("/\\") + 1;	//npos + 1 == 0
+	const size_t dot = path.rfind('.');
+	//a leading dot marks a hidden file, not an extension
+	if (dot == string_view::npos || dot <= nameStart || dot + 1 == path.size()){
+		return {};
+	}
+	return path.substr(dot + 1);
+}
+
+/**
+ Extract the extension of a path, lowercased and without the dot
+ @param path the path to the file
+ @return the extension, or an empty string if the file has none
+ */
+string extensionOf(const string& path){
+	string extension(extensionView(path));
+	for (char& c : extension){
+		c = fold(c);
+	}
+	return extension;
+}
+
+namespace{
+	/**
+	 Ids of the extensions seen so far. The known extensions are registered up front, with the id
+	 following their index in knownExtensions, so they are found through the perfect hash alone.
+	 */
+	struct InternedExtensions{
+		shared_mutex lock;
+		unordered_map<string,uint32_t> ids;
+		vector<string> names{""};
+		vector<FileCategory> categories{FileCategory::NoExtension};
+		
+		InternedExtensions(){
+			if (!extensionTable.valid){
+				//a duplicate in knownExtensions, the only way the seed search can fail
+				abort();
+			}
+			for (const KnownExtension& known : knownExtensions){
+				ids.emplace(known.extension, (uint32_t)names.size());
+				names.push_back(known.extension);
+				categories.push_back(known.category);
+			}
+		}
+	};
+	InternedExtensions interned;
+	
+	/**
+	 A recently interned unknown extension
+	 */
+	struct CachedExtension{
+		string name;
+		uint32_t id = 0;
+	};
+	constexpr size_t cachedExtensions = 64;
+}
+
+/**
+ Get the id for an extension, assigning a new one if it has not been seen before.
+ Does not allocate or lock for known extensions, nor for unknown ones seen recently by the calling thread.
+ @param extension the extension without the leading dot, in any case
+ @return the id of the extension
+ */
+uint32_t ExtensionTable::intern(string_view extension){
+	if (extension.empty()){
+		return 0;
+	}
+	const int16_t index = knownIndex(extension);
+	if (index >= 0){
+		return index + 1;
+	}
+	
+	//unknown extensions are cached per thread, one per slot, replacing what was there
+	thread_local array<CachedExtension, cachedExtensions> cache;
+	CachedExtension& cached = cache[extensionHash(extension, 0) % cachedExtensions];
+	if (cached.id != 0 && equalsFolded(cached.name.c_str(), extension)){
+		return cached.id;
+	}
+	
+	string folded(extension);
+	for (char& c : folded){
+		c = fold(c);
+	}
+	uint32_t id;
+	bool found = false;
+	{
+		shared_lock<shared_mutex> lock(interned.lock);
+		auto it = interned.ids.find(folded);
+		if (it != interned.ids.end()){
+			id = it->second;
+			found = true;
+		}
+	}
+	if (!found){
+		unique_lock<shared_mutex> lock(interned.lock);
+		auto it = interned.ids.find(folded);
+		if (it != interned.ids.end()){
+			id = it->second;
+		}
+		else{
+			id = (uint32_t)interned.names.size();
+			interned.ids.emplace(folded, id);
+			interned.names.push_back(folded);
+			interned.categories.push_back(FileCategory::Other);
+		}
+	}
+	cached.name = std::move(folded);
+	cached.id = id;
+	return id;
+}
+
+/**
+ @return the extension string for an id
+ */
+string ExtensionTable::name(uint32_t id){
+	shared_lock<shared_mutex> lock(interned.lock);
+	return id < interned.names.size() ? interned.names[id] : "";
+}
+
+/**
+ @return the category of the extension with this id
+ */
+FileCategory ExtensionTable::category(uint32_t id){
+	shared_lock<shared_mutex> lock(interned.lock);
+	return id < interned.categories.size() ? interned.categories[id] : FileCategory::Other;
+}
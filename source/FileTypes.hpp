@@ -0,0 +1,43 @@
+//
+//  FileTypes.hpp
+//
+//  Copyright © 2020 Ravbug. All rights reserved.
+//
+
+#pragma once
+#include <string>
+#include <string_view>
+#include <cstdint>
+
+/**
+ Broad groups of file types, used for icons and for type statistics
+ */
+enum class FileCategory : uint8_t{
+	Other,
+	NoExtension,
+	Program,
+	DiskImage,
+	Image,
+	Audio,
+	Video,
+	Archive,
+	Document,
+	Code,
+	Count
+};
+
+FileCategory categoryForExtension(std::string_view extension);
+const char* categoryName(FileCategory);
+std::string_view extensionView(std::string_view path);
+std::string extensionOf(const std::string& path);
+
+/**
+ Maps extension strings to small integer ids so that nodes and statistics can store them compactly.
+ Id 0 is reserved for files without an extension. Safe to use from any thread.
+ */
+class ExtensionTable{
+public:
+	static uint32_t intern(std::string_view extension);
+	static std::string name(uint32_t id);
+	static FileCategory category(uint32_t id);
+};
@@ -0,0 +1,85 @@
+//
+//  FileTypesFrame.cpp
+//
+//  Copyright © 2020 Ravbug. All rights reserved.
+//
+
+#include "FileTypesFrame.hpp"
+#include "FolderDisplay.hpp"
+#include <algorithm>
+
+using namespace std;
+
+/**
+ Construct a space breakdown by file type
+ @param parent the main window
+ @param report the scan to read the totals from. May still be running.
+ */
+FileTypesFrame::FileTypesFrame(wxWindow* parent, const shared_ptr<ScanReport>& report) : ReportFrame(parent, "File Types"), report(report){
+	wxString groups[] = {"By extension", "By category"};
+	groupChoice = new wxChoice(list->GetParent(), wxID_ANY, wxDefaultPosition, wxDefaultSize, 2, groups);
+	groupChoice->SetSelection(0);
+	controlSizer->Add(groupChoice, 0, wxALL, 5);
+	groupChoice->Bind(wxEVT_CHOICE, [this](wxCommandEvent&){
+		Populate();
+	});
+	
+	list->AppendTextColumn("Type", wxDATAVIEW_CELL_INERT, 120, wxALIGN_LEFT, wxDATAVIEW_COL_RESIZABLE);
+	list->AppendTextColumn("Category", wxDATAVIEW_CELL_INERT, 110, wxALIGN_LEFT, wxDATAVIEW_COL_RESIZABLE);
+	list->AppendTextColumn("Files", wxDATAVIEW_CELL_INERT, 80, wxALIGN_RIGHT);
+	list->AppendProgressColumn("Percent", wxDATAVIEW_CELL_INERT, 100);
+	list->AppendTextColumn("Size", wxDATAVIEW_CELL_INERT, 90, wxALIGN_RIGHT);
+	
+	Populate();
+}
+
+/**
+ Read the current totals from the scan and display them, largest first
+ */
+void FileTypesFrame::Populate(){
+	Clear();
+	if (report == nullptr){
+		return;
+	}
+	struct Row{
+		string type;
+		string category;
+		TypeTotals totals;
+	};
+	vector<Row> rows;
+	if (groupChoice->GetSelection() == 0){
+		for (const auto& pair : report->extensionTotals()){
+			string name = pair.first == 0 ? "(none)" : "." + ExtensionTable::name(pair.first);
+			rows.push_back(Row{name, categoryName(ExtensionTable::category(pair.first)), pair.second});
+		}
+	}
+	else{
+		auto totals = report->categoryTotals();
+		for (size_t i = 0; i < totals.size(); i++){
+			if (totals[i].count > 0){
+				const char* name = categoryName((FileCategory)i);
+				rows.push_back(Row{name, name, totals[i]});
+			}
+		}
+	}
+	sort(rows.begin(), rows.end(), [](const Row& a, const Row& b){
+		return a.totals.bytes > b.totals.bytes;
+	});
+	
+	fileSize total = 0;
+	for (const Row& r : rows){
+		total += r.totals.bytes;
+	}
+	
+	list->Freeze();
+	for (const Row& r : rows){
+		wxVector<wxVariant> items;
+		items.push_back(r.type);
+		items.push_back(r.category);
+		items.push_back(to_string(r.totals.count));
+		items.push_back(wxAny((long)(total > 0 ? r.totals.bytes * 100 / total : 0)));
+		items.push_back(FolderDisplay::sizeToString(r.totals.bytes));
+		AppendRow(items, "");
+	}
+	list->Thaw();
+}
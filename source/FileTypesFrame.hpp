@@ -0,0 +1,23 @@
+//
+//  FileTypesFrame.hpp
+//
+//  Copyright © 2020 Ravbug. All rights reserved.
+//
+
+#pragma once
+#include "ReportFrame.hpp"
+#include "ScanReport.hpp"
+#include <memory>
+
+/**
+ Shows how much space each extension and each file category uses across the whole scanned tree
+ */
+class FileTypesFrame : public ReportFrame{
+public:
+	FileTypesFrame(wxWindow* parent, const std::shared_ptr<ScanReport>& report);
+	void Populate() override;
+	
+private:
+	std::shared_ptr<ScanReport> report;
+	wxChoice* groupChoice;
+};
@@ -6,18 +6,66 @@
 //
 
 #include "FolderDisplay.hpp"
+#include "Epoch.hpp"
 #include <array>
+#include <algorithm>
 #include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <mutex>
 
 wxBEGIN_EVENT_TABLE(FolderDisplay, wxPanel)
 EVT_DATAVIEW_SELECTION_CHANGED(FDISP, FolderDisplay::OnSelectionChanged)
 EVT_DATAVIEW_ITEM_ACTIVATED(FDISP, FolderDisplay::OnSelectionActivated)
-EVT_COMMAND(PROGEVT, progEvt, FolderDisplay::OnUpdateUI)
+EVT_TIMER(FRAMETIMER, FolderDisplay::OnUpdateUI)
+EVT_DATAVIEW_COLUMN_HEADER_CLICK(FDISP, FolderDisplay::OnHeaderClick)
+EVT_DATAVIEW_COLUMN_HEADER_RIGHT_CLICK(FDISP, FolderDisplay::OnHeaderRightClick)
 wxEND_EVENT_TABLE()
 
 using namespace std;
 using namespace std::filesystem;
 
+//appended to the title of the column the rows are sorted by
+#if defined _WIN32
+static const wxString descendingMark = " v";
+static const wxString ascendingMark = " ^";
+#else
+static const wxString descendingMark = L" ▼";
+static const wxString ascendingMark = L" ▲";
+#endif
+
+#if defined _WIN32
+static const string atLeast = ">= ";
+#else
+static const string atLeast = "≥ ";
+#endif
+
+/**
+ @return true if a is listed before b in rows ordered by size, matching ChildOrder::Size
+ */
+static bool shownBefore(const DirectoryData* a, const DirectoryData* b){
+	const fileSize sizeA = a->measured();
+	const fileSize sizeB = b->measured();
+	return sizeA != sizeB ? sizeA > sizeB : a->Path < b->Path;
+}
+
+/**
+ Order items largest first by their sizes at the time of the call
+ @param items the items to sort. Folders being sized may grow meanwhile, so each size is read once.
+ */
+static void sortBySize(vector<DirectoryData*>& items){
+	vector<pair<fileSize, DirectoryData*>> sizes(items.size());
+	for (size_t i = 0; i < items.size(); i++){
+		sizes[i] = {items[i]->measured(), items[i]};
+	}
+	sort(sizes.begin(), sizes.end(), [](const pair<fileSize, DirectoryData*>& a, const pair<fileSize, DirectoryData*>& b){
+		return a.first != b.first ? a.first > b.first : a.second->Path < b.second->Path;
+	});
+	for (size_t i = 0; i < items.size(); i++){
+		items[i] = sizes[i].second;
+	}
+}
+
 /**
  Constructs a FolderDisplay given an event parent and a model
  @param parentWindow the parent wxWindow
@@ -25,7 +73,7 @@ using namespace std::filesystem;
  @param contents the FolderData to represent in this FolderDisplay
  @note Must call display() to display the contents (or update them)
  */
-FolderDisplay::FolderDisplay(wxWindow* parentWindow, wxWindow* eventWindow, DirectoryData* contents) : FolderDisplayBase(parentWindow){
+FolderDisplay::FolderDisplay(wxWindow* parentWindow, wxWindow* eventWindow, DirectoryData* contents) : FolderDisplayBase(parentWindow), frameTimer(this, FRAMETIMER){
 	eventManager = eventWindow;
 	data = contents;
 
@@ -34,8 +82,15 @@ FolderDisplay::FolderDisplay(wxWindow* parentWindow, wxWindow* eventWindow, Dire
 	ListCtrl->AssociateModel(model.get());
 	//add rows here
 	ListCtrl->AppendTextColumn("File Name",wxDATAVIEW_CELL_INERT,wxCOL_WIDTH_AUTOSIZE,static_cast<wxAlignment>(wxALIGN_LEFT), wxDATAVIEW_COL_RESIZABLE );
-	ListCtrl->AppendProgressColumn("Percent",wxDATAVIEW_CELL_INERT, -1, static_cast<wxAlignment>(wxALIGN_CENTER), wxDATAVIEW_COL_SORTABLE );
+	ListCtrl->AppendProgressColumn("Percent",wxDATAVIEW_CELL_INERT, -1, static_cast<wxAlignment>(wxALIGN_CENTER), 0 );
 	ListCtrl->AppendTextColumn("File Size",wxDATAVIEW_CELL_INERT, 100, static_cast<wxAlignment>(wxALIGN_RIGHT), 0 );
+	ListCtrl->AppendTextColumn("Slack",wxDATAVIEW_CELL_INERT, 100, static_cast<wxAlignment>(wxALIGN_RIGHT), 0 );
+	ListCtrl->AppendTextColumn(wxString::Format("Cold (%dd+)", AgeBuckets::limits[coldBucket - 1]),wxDATAVIEW_CELL_INERT, 100, static_cast<wxAlignment>(wxALIGN_RIGHT), 0 );
+	//the control never sorts, rows are inserted in order
+	for (unsigned int i = 0; i < ListCtrl->GetColumnCount(); i++){
+		columnTitles.push_back(ListCtrl->GetColumn(i)->GetTitle());
+	}
+	UpdateColumnTitles();
 
 	//fix color on Windows
 #if defined _WIN32
@@ -45,10 +100,83 @@ FolderDisplay::FolderDisplay(wxWindow* parentWindow, wxWindow* eventWindow, Dire
 
 FolderDisplay::~FolderDisplay()
 {
-	abort = true;
+	//the job writes into data and reports to this display, so it must be done before either goes away
+	Stop();
+	DropReload();
+	frameTimer.Stop();
 	//Log("Resize operation has stopped because the view was closed. This folder will need to be manually resized.");
 }
 
+/**
+ Cancel the current job and wait for it to finish. Folders it had not sized are left incomplete but marked done.
+ */
+void FolderDisplay::Stop(){
+	abort = true;
+	if (job != nullptr){
+		job->cancel();
+		job->join();
+	}
+}
+
+/**
+ Stop a folder from owning subfolders that another tree owns as well, so freeing it leaves them alone
+ @param folder the folder to trim
+ @param shared the subfolders to take out of its list
+ */
+static void disown(DirectoryData* folder, const unordered_set<const DirectoryData*>& shared){
+	const ChildList* old = folder->children();
+	ChildList* trimmed = new ChildList;
+	trimmed->files = old->files;
+	for (DirectoryData* sub : old->subFolders){
+		if (shared.count(sub) == 0){
+			trimmed->subFolders.push_back(sub);
+		}
+	}
+	if (trimmed->subFolders.size() < old->subFolders.size()){
+		folder->publish(trimmed);
+	}
+	else{
+		delete trimmed;
+	}
+}
+
+/**
+ Throw away the tree of a reload that has not been swapped in, and show the tree it was replacing again
+ @pre the job has been stopped, so nothing writes into the new tree
+ */
+void FolderDisplay::DropReload(){
+	if (replacing == nullptr){
+		return;
+	}
+	//subfolders an expansion reused still belong to the old tree, so they are not freed with the new one
+	{
+		epoch::Guard guard;
+		const vector<DirectoryData*>& kept = replacing->children()->subFolders;
+		disown(data, unordered_set<const DirectoryData*>(kept.begin(), kept.end()));
+	}
+	epoch::retire(data);
+	data = replacing;
+	replacing = nullptr;
+	reloadParent = nullptr;
+}
+
+/**
+ Pause or resume the current job, if there is one
+ @param pause true to pause, false to resume
+ */
+void FolderDisplay::Pause(bool pause){
+	if (job == nullptr){
+		return;
+	}
+	if (pause){
+		job->pause();
+	}
+	else{
+		job->resume();
+	}
+	UpdateTitle(!abort);
+}
+
 /**
 Activated when the selection in the view is changed
 @param event the event raised by the dataview
@@ -88,18 +216,36 @@ void FolderDisplay::OnSelectionActivated(wxDataViewEvent& event){
  */
 void FolderDisplay::display(){
 	UpdateTitle();
-	auto addItems = [&](vector<DirectoryData*>& list){
-		for (DirectoryData* folder : list){
-			AddItem(folder);
+	epoch::Guard guard;
+	const ChildList* list = data->children();
+	ListCtrl->Freeze();
+	if (data->isComplete()){
+		//each order is sorted at most once per list, after that listing is linear
+		const ChildOrder by = sortOrder == ChildOrder::Size && DirectoryData::sizeMode == SizeMode::Allocated ? ChildOrder::Allocated : sortOrder;
+		const vector<uint32_t>& order = list->order(by);
+		for (size_t i = 0; i < order.size(); i++){
+			AddItem(list->at(order[sortReversed ? order.size() - 1 - i : i]));
 		}
-	};
-	addItems(data->subFolders);
-	addItems(data->files);
+	}
+	else{
+		//another display's job is still sizing the folder, so its rows are kept current until it is done
+		vector<DirectoryData*> items(list->subFolders);
+		items.insert(items.end(), list->files.begin(), list->files.end());
+		sortBySize(items);
+		for (DirectoryData* item : items){
+			AddItem(item);
+		}
+		if (abort){
+			watching = true;
+			frameTimer.Start(1000 / framesPerSecond);
+		}
+	}
+	ListCtrl->Thaw();
 	
-	//set sort descending
-	ListCtrl->GetColumn(1)->SetSortOrder(false);
 	ListCtrl->GetColumn(0)->SetWidth(wxCOL_WIDTH_AUTOSIZE);
 	ListCtrl->GetColumn(2)->SetWidth(wxCOL_WIDTH_AUTOSIZE);
+	ListCtrl->GetColumn(3)->SetWidth(wxCOL_WIDTH_AUTOSIZE);
+	ListCtrl->GetColumn(4)->SetWidth(wxCOL_WIDTH_AUTOSIZE);
 	
 	//fix size and force redraw
 	SetClientSize(ListCtrl->GetSize());
@@ -109,20 +255,186 @@ void FolderDisplay::display(){
 /**
  Add an item to the display
  @param folder the item to add to the display
+ @param row the row to insert at, or -1 to add it after every other row
  */
-void FolderDisplay::AddItem(DirectoryData* folder){
+void FolderDisplay::AddItem(DirectoryData* folder, int row){
 	//no parent set? use the current associated model as the parent
 	if (folder->parent == nullptr){
 		folder->parent = data;
 	}
-	wxVector<wxVariant> items(3);
+	wxVector<wxVariant> items(5);
 	path p = path(folder->Path);
 	items[0] = iconForExtension(folder) + p.filename().string();
 	items[1] = wxAny((long)(folder->percentOfParent()));
-	items[2] = sizeToString(folder->size);
+	items[2] = sizeText(folder);
+	items[3] = slackToString(folder->slack());
+	items[4] = coldToString(folder);
 	//store the address that the pointer is referencing as the client data for the item
 	//wxUIntPtr clientdata((uintptr_t)(folder));
-	ListCtrl->AppendItem(items,(uintptr_t)(folder));
+	if (row < 0){
+		ListCtrl->AppendItem(items,(uintptr_t)(folder));
+	}
+	else{
+		ListCtrl->InsertItem(row, items, (uintptr_t)(folder));
+	}
+}
+
+/**
+ Update the sizes of rows while folders are being sized, reordering the rows if a folder has overtaken another
+ */
+void FolderDisplay::RefreshRows(){
+	const int count = ListCtrl->GetItemCount();
+	vector<DirectoryData*> items(count);
+	for (int i = 0; i < count; i++){
+		items[i] = (DirectoryData*)ListCtrl->GetItemData(ListCtrl->RowToItem(i));
+	}
+	ListCtrl->Freeze();
+	if (!is_sorted(items.begin(), items.end(), shownBefore)){
+		//sizes only grow, and the top of the tree is read first, so the order settles early
+		DirectoryData* selected = GetSelectedData();
+		sortBySize(items);
+		ListCtrl->DeleteAllItems();
+		for (int i = 0; i < count; i++){
+			AddItem(items[i]);
+			if (items[i] == selected){
+				ListCtrl->SelectRow(i);
+			}
+		}
+	}
+	else{
+		for (int i = 0; i < count; i++){
+			wxVariant percent = wxAny((long)(items[i]->percentOfParent()));
+			ListCtrl->SetValue(percent, i, 1);
+			if (items[i]->isFolder){
+				ListCtrl->SetTextValue(sizeText(items[i]), i, 2);
+				ListCtrl->SetTextValue(slackToString(items[i]->slack()), i, 3);
+				ListCtrl->SetTextValue(coldToString(items[i]), i, 4);
+			}
+		}
+	}
+	ListCtrl->Thaw();
+}
+
+/**
+ Forget the rows of the previous job before starting another
+ */
+void FolderDisplay::ResetRows(){
+	pendingRows.clear();
+	nextRow = 0;
+	rowsListed = false;
+	watching = false;
+	frames = 0;
+	progressRing.reset();
+	ListCtrl->DeleteAllItems();
+}
+
+/**
+ Change the order of the rows
+ @param by the order to list the items in
+ @param reversed true to list them last to first
+ @note the rows of a folder being sized stay largest first until it is complete
+ */
+void FolderDisplay::SortBy(ChildOrder by, bool reversed){
+	sortOrder = by;
+	sortReversed = reversed;
+	UpdateColumnTitles();
+	if (abort && data->isComplete()){
+		DirectoryData* selected = GetSelectedData();
+		Clear();
+		display();
+		if (selected != nullptr){
+			Select(selected);
+		}
+	}
+}
+
+/**
+ Mark the title of the column matching the current order
+ */
+void FolderDisplay::UpdateColumnTitles(){
+	int sorted = -1;
+	switch (sortOrder){
+		case ChildOrder::Name:
+			sorted = 0;
+			break;
+		case ChildOrder::Size:
+			sorted = 2;
+			break;
+		case ChildOrder::Slack:
+			sorted = 3;
+			break;
+		case ChildOrder::Cold:
+			sorted = 4;
+			break;
+		default:
+			break;
+	}
+	//names are listed A to Z, every other order largest first
+	const bool descending = (sortOrder != ChildOrder::Name) != sortReversed;
+	for (int i = 0; i < (int)columnTitles.size(); i++){
+		ListCtrl->GetColumn(i)->SetTitle(columnTitles[i] + (i != sorted ? "" : descending ? descendingMark : ascendingMark));
+	}
+}
+
+/**
+ Sort by the clicked column, or reverse the order if the rows are already sorted by it
+ @param event the event raised by the dataview
+ */
+void FolderDisplay::OnHeaderClick(wxDataViewEvent& event){
+	//indexed by column, the percent column sorts by size too
+	static constexpr array<ChildOrder, 5> columnOrders{ChildOrder::Name, ChildOrder::Size, ChildOrder::Size, ChildOrder::Slack, ChildOrder::Cold};
+	const int column = event.GetColumn();
+	if (column < 0 || column >= (int)columnOrders.size()){
+		return;
+	}
+	const ChildOrder by = columnOrders[column];
+	SortBy(by, by == sortOrder ? !sortReversed : false);
+}
+
+/**
+ Offer every order, including those without a column
+ @param event the event raised by the dataview
+ */
+void FolderDisplay::OnHeaderRightClick(wxDataViewEvent& event){
+	static const array<pair<ChildOrder, const char*>, 7> choices{{
+		{ChildOrder::Size, "Size"},
+		{ChildOrder::Name, "Name"},
+		{ChildOrder::Items, "Item Count"},
+		{ChildOrder::Modified, "Last Modified"},
+		{ChildOrder::Recent, "Modified in the Last 30 Days"},
+		{ChildOrder::Slack, "Slack"},
+		{ChildOrder::Cold, "Cold"},
+	}};
+	//menu ids start at 1, 0 is never returned for a selection
+	wxMenu menu;
+	for (size_t i = 0; i < choices.size(); i++){
+		menu.AppendRadioItem(i + 1, choices[i].second)->Check(choices[i].first == sortOrder);
+	}
+	menu.AppendSeparator();
+	const int reverseId = choices.size() + 1;
+	menu.AppendCheckItem(reverseId, "Reverse")->Check(sortReversed);
+	
+	const int picked = GetPopupMenuSelectionFromUser(menu);
+	if (picked == reverseId){
+		SortBy(sortOrder, !sortReversed);
+	}
+	else if (picked > 0 && picked < reverseId){
+		SortBy(choices[picked - 1].first, false);
+	}
+}
+
+/**
+ Select the row representing an item and scroll it into view
+ @param item the item to select. Nothing is selected if it is not displayed.
+ */
+void FolderDisplay::Select(DirectoryData* item){
+	for (int i = 0; i < ListCtrl->GetItemCount(); i++){
+		if ((DirectoryData*)ListCtrl->GetItemData(ListCtrl->RowToItem(i)) == item){
+			ListCtrl->SelectRow(i);
+			ListCtrl->EnsureVisible(ListCtrl->RowToItem(i));
+			return;
+		}
+	}
 }
 
 /**
@@ -167,276 +479,261 @@ string FolderDisplay::sizeToString(const fileSize& fileSize){
 }
 
 /**
-Calculate the size of a folder, including the size of subfolders. Does not allocate a new root.
-@param fd the DirectoryData to size
-@param progress the std::function to call with progress updates
-*/
-void FolderDisplay::SizeItem(DirectoryData* fd, const progCallback& progress){
-	if (abort || path_too_long(fd->Path)) {
-		return;
-	}
-	
-	//skip symbolic links
-	std::error_code ec;
-	if (is_symlink(fd->Path,ec)){
-		fd->size = 1;
-		fd->isSymlink = true;
-		return;
-	}
-	
-	//calculate the size of the immediate files in the folder
-	try{
-		sizeImmediate(fd);
-	}
-	catch(const filesystem_error& e){
-		//notify user
-		Log("Error sizing directory" + fd->Path + "\n" + e.what());
-		return;
-	}
-	
-	fd->num_items = fd->files.size();
-	
-	//recursively size the folders in the folder
-	bool calledback = false;
-	for (int i = 0; i < fd->subFolders.size(); i++){
-		fd->subFolders[i] = SizeItem(fd->subFolders[i]->Path, nullptr);
-		
-		//update parent
-		if (fd->subFolders[i] != nullptr){
-			fd->subFolders[i]->parent = fd;
-			fd->num_items += fd->subFolders[i]->num_items + 1;
-			fd->size += fd->subFolders[i]->size;
-			//check for zero size
-			if (fd->size == 0){
-				fd->size = 1;
-			}
-		}
-		if (progress != nullptr) {
-			calledback = true;
-			progress((float)(i + 1) / fd->subFolders.size(), fd);
-		}
-	}
-	//ensure callback is called for folders with no sub-items
-	if (progress != nullptr && !calledback){
-		progress(1, fd);
+ Formats the difference between allocated and apparent size
+ @param slack the difference in bytes, negative if the item uses less space than its length
+ @returns unitized string with a sign, or an empty string if there is no difference
+ */
+string FolderDisplay::slackToString(const fileSize& slack){
+	if (slack == 0){
+		return "";
 	}
+	return (slack < 0 ? "-" : "+") + sizeToString(slack < 0 ? -slack : slack);
 }
 
 /**
- Calculate the size of a folder, including the size of subfolders. Allocates a new DirectoryData.
- @param folder the path to the folder to size
- @param progress the std::function to call with progress updates
+ Formats the size of an item for its row
+ @param item the item to describe
+ @returns unitized string, marked as a lower bound if the item is a folder that is still being sized, or a note if its mount timed out
  */
-DirectoryData* FolderDisplay::SizeItem(const string& folder, const progCallback& progress){
-	DirectoryData* fd = new DirectoryData(folder, true);
-	
-	SizeItem(fd, progress);
-	
-	return fd;
+string FolderDisplay::sizeText(DirectoryData* item){
+	if (item->timedOut){
+		return "Timed out";
+	}
+	return (item->isFolder && !item->isComplete() ? atLeast : "") + sizeToString(item->measured());
 }
 
 /**
- Calculate the size of the immediate files in the folder
- @param data the FolderData struct to calculate
+ Formats the bytes of an item that have not been modified recently
+ @param item the item to describe
+ @returns unitized string, or an empty string if nothing in the item is cold or the folder is still being sized
  */
-void FolderDisplay::sizeImmediate(DirectoryData* data, const bool& skipFolders){
-	//clear to prevent dupes
-	data->files.clear();
-	if (!skipFolders){
-		data->subFolders.clear();
-	}
-	// iterate through the items in the folder
-	for(auto& p : directory_iterator(data->Path,directory_options::skip_permission_denied)){
-		//is the item a folder? if so, defer sizing it
-		//check if can read the file
-		try {
-			file_status s = status(p.path());
-			if (can_access(s))
-			{
-				if (is_directory(p)) {
-					if (!skipFolders) {
-						string str = p.path().string();
-						DirectoryData* sub = new DirectoryData(str, true);
-						data->subFolders.push_back(sub);
-					}
-				}
-				else {
-					//size the file, add its details to the structure
-
-					string str = p.path().string();
-					auto stat = stat_file_size(str);
-					DirectoryData* file = new DirectoryData(str, stat);
-					data->size += file->size;
-					file->parent = data;
-					data->files.push_back(file);
-					//cout << file->Path << ": " << file->size << endl;
-				}
-			}
-		}
-		catch (const filesystem_error& e) {
-			Log("Error sizing file " + p.path().string() + "\n" + e.what());
-		}
-		catch (const system_error& e) {
-			Log(string("Error sizing item in directory ") + data->Path + "\n" + e.what());
-		}
-	}
+string FolderDisplay::coldToString(DirectoryData* item){
+	const fileSize cold = item->coldBytes(time(nullptr));
+	return cold > 0 ? sizeToString(cold) : "";
 }
 
 /**
  Size the model representing this display on a background thread
  @param parent the item that owns this item
  @param updateItem the item in the parent that needs to be updated
+ @param report whole-tree statistics to collect during the scan, or nullptr
+ @param expand true to keep every file of this folder as an item, even if it is huge
+ @note if the current data has already been sized, a new tree is built and swapped in when complete
  */
-void FolderDisplay::Size(FolderDisplay* parent, wxDataViewItem updateItem){
-	//reset items
-	displayStartIndex = 0;
-	ListCtrl->DeleteAllItems();
+void FolderDisplay::Size(FolderDisplay* parent, wxDataViewItem updateItem, const shared_ptr<ScanReport>& report, bool expand){
+	Stop();
+	//a reload started again begins from the tree the first one was replacing, which is still in use
+	DropReload();
+	ResetRows();
 	abort = false;
 	
-	//reset / deallocate
-	data->resetStats();
+	//size into a fresh tree so the existing one stays valid for readers until it is replaced
+	if (data->isComplete()){
+		replacing = data;
+		data = new DirectoryData(replacing->Path, true);
+		data->parent = replacing->parent;
+	}
 	
 	if (parent != nullptr){
 		reloadParent = parent;
 		this->updateItem = updateItem;
 	}
 	
-	worker = thread([&](FolderDisplay* parent){
-		auto uicallback = [&](float prog, DirectoryData* updated){
-			wxCommandEvent event(progEvt);
-			event.SetId(PROGEVT);
-			event.SetInt(prog * 100);
-			event.SetClientData(updated);
-			
-			//invoke event to notify needs to update UI
-			wxPostEvent(this, event);
-			
+	scanner.report = report;
+	scanner.expand = expand ? data : nullptr;
+	scanner.reuse = nullptr;
+	//expanding a huge folder only needs its files read again, its sized subfolders are moved into the new tree
+	if (expand && replacing != nullptr){
+		auto kept = make_shared<unordered_map<string, DirectoryData*>>();
+		{
+			epoch::Guard guard;
+			for (DirectoryData* sub : replacing->children()->subFolders){
+				if (sub->isComplete()){
+					kept->emplace(sub->Path, sub);
+				}
+			}
+		}
+		//asked from any worker, by the folders this scan reads
+		auto keptLock = make_shared<mutex>();
+		scanner.reuse = [kept, keptLock](const string& path) -> DirectoryData*{
+			lock_guard<mutex> guard(*keptLock);
+			auto it = kept->find(path);
+			if (it == kept->end()){
+				return nullptr;
+			}
+			DirectoryData* sub = it->second;
+			kept->erase(it);
+			return sub;
 		};
-		//called on progress updates
-		SizeItem(data, uicallback);
-	},parent);
-	worker.detach();
+	}
+	scanner.breadthDepth = progressiveDepth;
+	Start(replacing != nullptr ? JobManager::reloadPriority : JobManager::scanPriority, [this](Job& job, DirectoryData* target, const progCallback& progress){
+		scanner.SizeItem(target, progress, job);
+	});
 }
 
-void FolderDisplay::OnUpdateUI(wxCommandEvent& event){
-	//update pointer
-	UpdateTitle(true);
-	DirectoryData* fd = (DirectoryData*)event.GetClientData();
-	//add the current folder
-	if (fd->subFolders.size() > displayStartIndex){
-		AddItem(fd->subFolders[displayStartIndex]);
+/**
+ Load the tree recorded in an ncdu export into this display, in the background
+ @param reader the opened export. The display's data must have been created with its root path.
+ @param report receives whole-tree statistics for the import
+ */
+void FolderDisplay::Import(const shared_ptr<NcduReader>& reader, const shared_ptr<ScanReport>& report){
+	Stop();
+	ResetRows();
+	abort = false;
+	
+	reader->report = report;
+	//the export is read in order, so it is a single task
+	Start(JobManager::scanPriority, [this,reader](Job& job, DirectoryData* target, const progCallback& progress){
+		job.post(target, [this,reader,target,progress]{
+			try{
+				reader->read(target, abort, progress, [this](const string& msg){ Log(msg); });
+			}
+			catch(const runtime_error& e){
+				Log(e.what());
+			}
+		});
+	});
+}
+
+/**
+ Fill in data as a job on the shared workers, and show its progress
+ @param priority the priority of the job, see JobManager
+ @param start posts the tasks of the job, given the tree to fill and the progress callback to report to
+ */
+void FolderDisplay::Start(int priority, const function<void(Job&, DirectoryData*, const progCallback&)>& start){
+	auto uicallback = [this](float prog, DirectoryData* updated){
+		//hand the record to the UI, waiting for it to drain if the ring is full
+		while (!progressRing.push(ProgressRecord{updated, prog})){
+			if (abort){
+				return;
+			}
+			this_thread::sleep_for(chrono::milliseconds(1));
+		}
+	};
+	job = JobManager::shared().submit(priority);
+	start(*job, data, uicallback);
+	
+	//the UI polls the ring instead of receiving an event per folder
+	frameTimer.Start(1000 / framesPerSecond);
+}
+
+/**
+ Called once per frame while sizing. Applies all the progress the worker has reported since the last frame.
+ @param event (unused) the timer event
+ */
+void FolderDisplay::OnUpdateUI(wxTimerEvent& event){
+	//free lists and trees that readers have finished with
+	epoch::collect();
+	++frames;
+	
+	if (watching){
+		if (data->isComplete()){
+			watching = false;
+			frameTimer.Stop();
+			Clear();
+			display();
+		}
+		else if (frames % refreshFrames == 0){
+			RefreshRows();
+			UpdateTitle(true);
+		}
+		return;
 	}
 	
-	//add files once
-	if (displayStartIndex == 0){
-		for (DirectoryData* file : fd->files){
-			AddItem(file);
+	//coalesce all the records produced since the last frame
+	const size_t drained = progressRing.drain([&](const ProgressRecord& record){
+		lastRecord = record;
+	});
+	//records dropped while the job was stopped still end the scan, once the job has drained
+	if (drained == 0 && lastRecord.progress < 1 && abort && job != nullptr && job->finished() && data->isComplete()){
+		//a stopped reload only read part of the folder, so the tree it was replacing is shown again instead of swapped out
+		if (replacing != nullptr){
+			DropReload();
+			ResetRows();
+		}
+		lastRecord = ProgressRecord{data, 1};
+	}
+	int prog = lastRecord.progress * 100;
+	
+	epoch::Guard guard;
+	const ChildList* list = data->children();
+	//list everything as soon as the folder has been read, largest first at that moment
+	if (!rowsListed && list->size() > 0){
+		pendingRows.assign(list->subFolders.begin(), list->subFolders.end());
+		pendingRows.insert(pendingRows.end(), list->files.begin(), list->files.end());
+		sortBySize(pendingRows);
+		rowsListed = true;
+	}
+	if (nextRow < pendingRows.size()){
+		//spread large folders across frames
+		ListCtrl->Freeze();
+		for (size_t added = 0; added < maxRowsPerFrame && nextRow < pendingRows.size(); added++){
+			AddItem(pendingRows[nextRow++]);
 		}
-		//fit
 		ListCtrl->GetColumn(0)->SetWidth(wxCOL_WIDTH_AUTOSIZE);
+		ListCtrl->Thaw();
+	}
+	else if (prog < 100 && frames % refreshFrames == 0){
+		RefreshRows();
+	}
+	else if (drained == 0 && prog < 100){
+		return;
+	}
+	
+	//do not report completion until every row has been added
+	if (prog == 100 && nextRow < pendingRows.size()){
+		prog = 99;
 	}
 	
-	++displayStartIndex;
-	//update progress
-	int prog = event.GetInt();
+	UpdateTitle(prog != 100);
+	if (prog == 100){
+		frameTimer.Stop();
+		lastRecord = ProgressRecord();
 		
-		auto old_parent = data->parent;
-		//update size in parent
-		if (old_parent != nullptr){
-			old_parent->size -= data->size;
-			//deallocate old data
-			//delete data;
-			data = fd;
-			old_parent->size += data->size;
-			
-			//reconnect item in SubFolders of parent
-			for(int i = 0; i < old_parent->subFolders.size(); i++){
-				DirectoryData* parentItem = old_parent->subFolders[i];
-				if (parentItem->Path == data->Path){
-					old_parent->subFolders[i] = data;
-					break;
-				}
-			}
+		//rows are already close to largest first, so they are only updated unless another order was picked
+		if (sortOrder == ChildOrder::Size && !sortReversed){
+			RefreshRows();
 		}
 		else{
-			data = fd;
+			Clear();
+			display();
 		}
-		data->parent = old_parent;
 		
-		UpdateTitle(false);
-	if (prog == 100){
-		//update percents
-		for (int i = 0; i < ListCtrl->GetItemCount(); i++){
-			DirectoryData* d = (DirectoryData*)(ListCtrl->GetItemData(ListCtrl->RowToItem(i)));
-			wxVariant v = wxAny((long)(d->percentOfParent()));
-			ListCtrl->SetValue(v, i, 1);
+		//swap the new tree into its parent
+		if (replacing != nullptr){
+			if (replacing->parent != nullptr){
+				replacing->parent->replaceChild(replacing, data);
+			}
+			//subfolders an expansion reused move to the new tree now, and must not be freed along with the old one
+			const vector<DirectoryData*>& kept = data->children()->subFolders;
+			for (DirectoryData* sub : kept){
+				sub->parent = data;
+			}
+			disown(replacing, unordered_set<const DirectoryData*>(kept.begin(), kept.end()));
+			//the main frame closes any views of the old tree, then retires it
+			wxCommandEvent* evt = new wxCommandEvent(progEvt, RELOADEVT);
+			evt->SetClientData(replacing);
+			evt->SetEventObject(this);
+			eventManager->GetEventHandler()->QueueEvent(evt);
+			replacing = nullptr;
 		}
 		
 		//reconnect if applicable
 		if (reloadParent != nullptr && updateItem.IsOk()){
-			reloadParent->SetItemData(updateItem, fd);
-			data->recalculateStats();
-			reloadParent->SetItemText(sizeToString(fd->size), reloadParent->ItemToRow(updateItem), 2);
+			reloadParent->SetItemData(updateItem, data);
+			reloadParent->SetItemText(sizeToString(data->measured()), reloadParent->ItemToRow(updateItem), 2);
+			reloadParent->SetItemText(slackToString(data->slack()), reloadParent->ItemToRow(updateItem), 3);
+			reloadParent->SetItemText(coldToString(data), reloadParent->ItemToRow(updateItem), 4);
 			reloadParent = nullptr;
 		}
 		abort = true;
-		
-		//set sort descending
-		ListCtrl->GetColumn(1)->SetSortOrder(false);
 	}
 	
-	//invoke main UI event
-	//notify parent to connect new pointer to display
-	
+	//notify parent once per frame to update the progress bar and title
 	wxCommandEvent* evt = new wxCommandEvent(progEvt, RESEVT);
-	//pass along the address to the DirectoryData to the event
-	uintptr_t* addr = new uintptr_t(prog);
-	evt->SetClientData(addr);
+	evt->SetInt(prog);
+	evt->SetEventObject(this);
 	eventManager->GetEventHandler()->QueueEvent(evt);
 }
 
-#if defined _WIN32
-wxString FolderDisplay::GetFileDescription(const string& path)
-{
-	/*auto pos = path.rfind('.');
-	string extension;
-	if (pos != string::npos) {
-		extension = path.substr(pos,path.size());
-	}
-	else {
-		extension = "";
-	}*/
-
-	SHFILEINFOW fileInfo;
-	UINT sizeFile = sizeof(fileInfo);
-	UINT Flags = SHGFI_TYPENAME | SHGFI_EXETYPE;
-
-	SHGetFileInfoW(LPCWSTR(path.c_str()), 0, &fileInfo, sizeFile, Flags);
-
-	return fileInfo.szTypeName;
-}
-#elif defined __APPLE__ || defined __linux__
-/**
- Gets the description of the file using the File command
- @param path the path to the file
- @returns the string returned by file command
- */
-wxString FolderDisplay::GetFileDescription(const string& path){
-	char buffer[64];
-    string result = "";
-	auto command = string("file -b \"" + path + "\"");
-	//open the pipe
-	FILE* pipe = popen(command.c_str(), "r");
-    if (!pipe) throw std::runtime_error("popen() failed!");
-    try {
-        while (fgets(buffer, sizeof buffer, pipe) != NULL) {
-            result += buffer;
-        }
-    } catch (...) {
-		//if cannot read, return unknown type
-		result = "Unknown";
-    }
-    pclose(pipe);
-    return result;
-}
-#endif
@@ -8,13 +8,24 @@
 #pragma once
 #include "interface.h"
 #include "DirectoryData.hpp"
+#include "Scanner.hpp"
 #include "FileSizeModel.h"
+#include "FileTypes.hpp"
+#include "ProgressRing.hpp"
+#include "NcduFormat.hpp"
+#include "JobManager.hpp"
+#include <wx/timer.h>
 #include <filesystem>
 #include <unordered_map>
 #include <thread>
 
-//callback definitions
-typedef function<void(float progress, DirectoryData* data)> progCallback;
+/**
+ A single progress notification sent from the scan worker to the UI
+ */
+struct ProgressRecord{
+	DirectoryData* folder = nullptr;
+	float progress = 0;
+};
 
 class FolderDisplay : public FolderDisplayBase{
 public:
@@ -23,7 +34,25 @@ public:
 	FolderDisplay(wxWindow*,wxWindow*, DirectoryData*);
 	~FolderDisplay();
 	
-	void Size(FolderDisplay*, wxDataViewItem);
+	void Size(FolderDisplay*, wxDataViewItem, const shared_ptr<ScanReport>& report = nullptr, bool expand = false);
+	void Import(const shared_ptr<NcduReader>&, const shared_ptr<ScanReport>& report = nullptr);
+	void Select(DirectoryData*);
+	void Stop();
+	void DropReload();
+	void Pause(bool);
+	/**
+	 Group the errors of this display's scans in a collector instead of logging each one
+	 @param errors the collector, or nullptr to log errors as messages
+	 */
+	void CollectErrors(const shared_ptr<ErrorCollector>& errors){
+		scanner.errors = errors;
+	}
+	/**
+	 @return the watchdog of this display's scans, which remembers the network mounts found hung
+	 */
+	shared_ptr<MountWatchdog> Watchdog() const{
+		return scanner.watchdog;
+	}
 	
 	/**
 	 Blanks the display. Use display() to show items again.
@@ -34,6 +63,13 @@ public:
 	wxDataViewItem GetCurrentItem(){
 		return ListCtrl->GetSelection();
 	}
+	/**
+	 @return the item in the selected row, or nullptr if no row is selected
+	 */
+	DirectoryData* GetSelectedData(){
+		wxDataViewItem item = ListCtrl->GetSelection();
+		return item.IsOk() ? (DirectoryData*)ListCtrl->GetItemData(item) : nullptr;
+	}
 	void SetItemData(const wxDataViewItem& item, DirectoryData* data){
 		ListCtrl->SetItemData(item, (uintptr_t)data);
 	}
@@ -46,7 +82,12 @@ public:
 	
 	void display();
 	static string sizeToString(const fileSize&);
-	bool abort = true;
+	static string slackToString(const fileSize&);
+	static string coldToString(DirectoryData*);
+	static string sizeText(DirectoryData*);
+	//the first AgeBuckets bucket counted as cold
+	static constexpr size_t coldBucket = AgeBuckets::cold;
+	atomic<bool> abort{true};
 	
 	/**
 	 Sets the label in this display to the size of the item
@@ -54,16 +95,42 @@ public:
 	 @note If the size of the current DirectoryData is 0, the item's size will display as Needs reload because the minimum size FatFileFinder reports is 1 byte.
 	 */
 	void UpdateTitle(bool isSizing = false){
-		ItemName->SetLabel((isSizing? "(Sizing) " : "") + std::filesystem::path(data->Path).filename().string() + " - " + (data->size == 0? "Needs reload" : sizeToString(data->size)));
+		const bool paused = isSizing && job != nullptr && job->paused();
+		ItemName->SetLabel((paused ? "(Paused) " : isSizing ? "(Sizing) " : "") + std::filesystem::path(data->Path).filename().string() + " - " + (data->size == 0? "Needs reload" : sizeToString(data->measured())));
 	}
 	
 private:
 	wxWindow* eventManager = nullptr;
-	std::thread worker;
-	int displayStartIndex = 0;
+	//sizes data, owned by the shared JobManager until it finishes
+	shared_ptr<Job> job;
+	//the contents of the folder being sized, largest first when read, added to the rows a batch per frame
+	vector<DirectoryData*> pendingRows;
+	size_t nextRow = 0;
+	bool rowsListed = false;
+	//true while showing a folder that another display's job is still sizing
+	bool watching = false;
+	unsigned int frames = 0;
+	//rows of complete folders follow the list's cached order, rows of folders being sized are kept by size
+	ChildOrder sortOrder = ChildOrder::Size;
+	bool sortReversed = false;
+	vector<wxString> columnTitles;
+	
+	//progress is pushed by the worker and drained by the UI at a fixed frame rate
+	static constexpr int framesPerSecond = 30;
+	static constexpr size_t maxRowsPerFrame = 256;
+	//sizes of folders still being sized are refreshed, and their rows reordered, every this many frames
+	static constexpr unsigned int refreshFrames = 10;
+	//levels read breadth first, so the folders near the root are given a growing size early
+	static constexpr size_t progressiveDepth = 3;
+	SPSCRing<ProgressRecord, 1024> progressRing;
+	wxTimer frameTimer;
+	ProgressRecord lastRecord;
 	
 	FolderDisplay* reloadParent = nullptr;
 	wxDataViewItem updateItem;
+	//the tree being replaced by a reload, kept browsable until the new one is done
+	DirectoryData* replacing = nullptr;
+	Scanner scanner{abort, [this](const string& msg){ Log(msg); }};
 
 	wxObjectDataPtr<FileSizeModel> model;
 	
@@ -78,22 +145,24 @@ private:
 			eventManager->GetEventHandler()->QueueEvent(evt);
 		}
 	}
-	DirectoryData* SizeItem(const string&, const progCallback&);
-	void SizeItem(DirectoryData*, const progCallback&);
-	void sizeImmediate(DirectoryData*, const bool& skipFolders = false);
-	void AddItem(DirectoryData*);
+	void AddItem(DirectoryData*, int row = -1);
+	void RefreshRows();
+	void ResetRows();
+	void SortBy(ChildOrder, bool reversed);
+	void UpdateColumnTitles();
+	void Start(int, const function<void(Job&, DirectoryData*, const progCallback&)>&);
 	
 	//event handlers
 	void OnSelectionChanged(wxDataViewEvent&);
 	void OnSelectionActivated(wxDataViewEvent&);
-	void OnUpdateUI(wxCommandEvent&);
+	void OnUpdateUI(wxTimerEvent&);
+	void OnHeaderClick(wxDataViewEvent&);
+	void OnHeaderRightClick(wxDataViewEvent&);
 	
 	wxDECLARE_EVENT_TABLE();
 	
 public:
 
-	static wxString GetFileDescription(const string&);
-
 	#if defined __APPLE__ || defined __linux__
 		/**
 		 Return the icon for a file type
@@ -101,34 +170,14 @@ public:
 		 @returns an emoji representing the file type
 		 */
 		static wxString iconForExtension(const DirectoryData* data){
-			//for drawing icons next to items in the list
-			static const std::unordered_map<string,wxString> icons = {
-				{"exe", L"💾" },{"dll", L"💾" },{"bat", L"💾" },{"jar", "💾" },
-				{"iso", L"💿" },{"bin", L"💿"},
-				{"ai",L"🎨" },{"bmp", L"🎨" },{"gif", L"🎨" },{"ico", L"🎨" },{"jpeg", L"🎨" },{"jpg", L"🎨" },{"png",L"🎨" },{"psd",L"🎨" },{"svg",L"🎨" },{"tif",L"🎨" },{"icns",L"🎨"},{"exr",L"🎨"},
-				{"mp3",L"🎵" },{"aif", L"🎵" },{"ogg", L"🎵" },{"wav", L"🎵" },{"wma", L"🎵" },{"m4a", L"🎵" },
-				{ "mp4",L"🎞"},{ "avi", L"🎞"},{ "flv", L"🎞"},{ "h264", L"🎞"},{ "m4v", L"🎞"},{ "mkv", L"🎞"},{ "mov",L"🎞"},{ "mpg",L"🎞"},{ "wmv",L"🎞"},
-				{ "7z",L"📦"},{ "arj", L"📦"},{ "pkg", L"📦"},{ "rar", L"📦"},{ "rpm", L"📦"},{ "tar.gz", L"📦"},{ "z", L"📦"},{ "zip",L"📦"},
-				{ "doc",L"📝"},{ "docx", L"📝"},{ "odt", L"📝"},{ "pdf", L"📝"},{ "rtf", L"📝"},{ "tex", L"📝"}
-			};
+			//for drawing icons next to items in the list, indexed by FileCategory
+			static const wxString icons[] = {L"📄", L"📟", L"💾", L"💿", L"🎨", L"🎵", L"🎞", L"📦", L"📝", L"📜"};
+			static_assert(sizeof(icons) / sizeof(icons[0]) == (size_t)FileCategory::Count, "every category needs an icon");
 			static const wxString FolderIcon = L"📁";
-			//avoid crash checking unordered map for empty string
-			if (!data->isFolder){
-				string extension = std::filesystem::path(data->Path).extension();
-				if (extension.size() == 0){
-					return L"📟";
-				}
-				try{
-					extension = extension.substr(1,extension.size());
-					return icons.at(extension);
-				}
-				catch(const exception& e){
-					return L"📄";
-				}
-			}
-			else{
+			if (data->isFolder){
 				return FolderIcon;
 			}
+			return icons[(size_t)data->category];
 		}
 	#elif defined _WIN32
 		//on Windows, unicode is not supported (for now)
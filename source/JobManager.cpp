@@ -0,0 +1,241 @@
+//
+//  JobManager.cpp
+//
+//  Copyright © 2020 Ravbug. All rights reserved.
+//
+
+#include "JobManager.hpp"
+#include <algorithm>
+
+/**
+ Queue a task
+ @param folder the folder the task works on, so tasks in the focused subtree run first. May be nullptr.
+ @param task the work. It must not throw, and must not join its own job.
+ @param breadthFirst true to run the task before the job's depth first tasks, in the order posted
+ */
+void Job::post(const DirectoryData* folder, function<void()> task, bool breadthFirst){
+	{
+		lock_guard<mutex> guard(manager.lock);
+		if (outstanding++ == 0){
+			manager.active.push_back(shared_from_this());
+		}
+		if (manager.inFocus(folder)){
+			boosted.push_back(Task{folder, std::move(task)});
+		}
+		else if (breadthFirst){
+			wide.push_back(Task{folder, std::move(task)});
+		}
+		else{
+			queued.push_back(Task{folder, std::move(task)});
+		}
+	}
+	manager.wake.notify_one();
+}
+
+/**
+ Stop starting this job's tasks. Tasks already running finish.
+ */
+void Job::pause(){
+	lock_guard<mutex> guard(manager.lock);
+	isPaused = true;
+}
+
+/**
+ Start running this job's tasks again
+ */
+void Job::resume(){
+	{
+		lock_guard<mutex> guard(manager.lock);
+		isPaused = false;
+	}
+	manager.wake.notify_all();
+}
+
+/**
+ Ask the job's tasks to return early. A paused job is resumed, so its remaining tasks can drain.
+ */
+void Job::cancel(){
+	stopped.store(true, memory_order_release);
+	resume();
+}
+
+/**
+ Wait until every task of the job has run
+ @note never call from one of the job's own tasks
+ */
+void Job::join(){
+	unique_lock<mutex> guard(manager.lock);
+	done.wait(guard, [this]{
+		return outstanding == 0;
+	});
+}
+
+/**
+ @return true if the job's tasks are not being started
+ */
+bool Job::paused() const{
+	lock_guard<mutex> guard(manager.lock);
+	return isPaused;
+}
+
+/**
+ @return true if no task of the job is queued or running
+ */
+bool Job::finished() const{
+	lock_guard<mutex> guard(manager.lock);
+	return outstanding == 0;
+}
+
+/**
+ @param threads the number of workers, or 0 for one per core. Workers are started with the first job.
+ */
+JobManager::JobManager(size_t threads) : threadCount(threads != 0 ? threads : max(2u, thread::hardware_concurrency())){}
+
+JobManager::~JobManager(){
+	{
+		lock_guard<mutex> guard(lock);
+		stopping = true;
+	}
+	wake.notify_all();
+	for (thread& t : workers){
+		t.join();
+	}
+}
+
+/**
+ @return the manager shared by every window
+ */
+JobManager& JobManager::shared(){
+	static JobManager manager;
+	return manager;
+}
+
+/**
+ Create a job. Its tasks start running as soon as they are posted.
+ @param priority jobs with higher priorities are run first
+ @return the job
+ */
+shared_ptr<Job> JobManager::submit(int priority){
+	{
+		lock_guard<mutex> guard(lock);
+		while (workers.size() < threadCount){
+			workers.emplace_back(&JobManager::work, this);
+		}
+	}
+	return make_shared<Job>(*this, priority);
+}
+
+/**
+ Run the tasks beneath a folder before any others, such as the folder the user is looking at
+ @param folder the folder to prefer, or nullptr to run tasks by priority only
+ */
+void JobManager::focus(const DirectoryData* folder){
+	lock_guard<mutex> guard(lock);
+	focused = folder;
+	auto outOfFocus = [this](const Job::Task& task){
+		return !inFocus(task.folder);
+	};
+	for (auto& job : active){
+		//previously focused tasks go back to depth first order, then the tasks now in focus are moved, keeping them newest first
+		job->queued.insert(job->queued.end(), make_move_iterator(job->boosted.begin()), make_move_iterator(job->boosted.end()));
+		job->boosted.clear();
+		auto wideFirst = stable_partition(job->wide.begin(), job->wide.end(), outOfFocus);
+		job->boosted.assign(make_move_iterator(wideFirst), make_move_iterator(job->wide.end()));
+		job->wide.erase(wideFirst, job->wide.end());
+		auto first = stable_partition(job->queued.begin(), job->queued.end(), outOfFocus);
+		job->boosted.insert(job->boosted.end(), make_move_iterator(first), make_move_iterator(job->queued.end()));
+		job->queued.erase(first, job->queued.end());
+	}
+}
+
+/**
+ @param folder the folder of a task, or nullptr
+ @return true if the folder is the focused folder or beneath it
+ @pre the lock is held
+ */
+bool JobManager::inFocus(const DirectoryData* folder) const{
+	if (focused == nullptr){
+		return false;
+	}
+	for (const DirectoryData* d = folder; d != nullptr; d = d->parent){
+		if (d == focused){
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ @return the job to take the next task from, or nullptr if no task can run
+ @pre the lock is held
+ */
+shared_ptr<Job> JobManager::next(){
+	shared_ptr<Job> best;
+	for (auto& job : active){
+		if (job->isPaused || (job->boosted.empty() && job->wide.empty() && job->queued.empty())){
+			continue;
+		}
+		if (best == nullptr){
+			best = job;
+			continue;
+		}
+		const bool boosted = !job->boosted.empty();
+		const bool bestBoosted = !best->boosted.empty();
+		if (boosted != bestBoosted){
+			if (boosted){
+				best = job;
+			}
+		}
+		else if (job->priority != best->priority){
+			if (job->priority > best->priority){
+				best = job;
+			}
+		}
+		else if (job->lastServed < best->lastServed){
+			best = job;
+		}
+	}
+	return best;
+}
+
+/**
+ The loop run by each worker
+ */
+void JobManager::work(){
+	unique_lock<mutex> guard(lock);
+	while (true){
+		shared_ptr<Job> job = next();
+		if (job == nullptr){
+			if (stopping){
+				return;
+			}
+			wake.wait(guard);
+			continue;
+		}
+		function<void()> task;
+		if (!job->boosted.empty()){
+			task = std::move(job->boosted.back().run);
+			job->boosted.pop_back();
+		}
+		else if (!job->wide.empty()){
+			task = std::move(job->wide.front().run);
+			job->wide.pop_front();
+		}
+		else{
+			task = std::move(job->queued.back().run);
+			job->queued.pop_back();
+		}
+		job->lastServed = ++served;
+
+		guard.unlock();
+		task();
+		//release anything the task captured before the job can be reported finished
+		task = nullptr;
+		guard.lock();
+
+		if (--job->outstanding == 0){
+			active.erase(find(active.begin(), active.end(), job));
+			job->done.notify_all();
+		}
+	}
+}
@@ -0,0 +1,116 @@
+//
+//  JobManager.hpp
+//
+//  Copyright © 2020 Ravbug. All rights reserved.
+//
+
+#pragma once
+#include "DirectoryData.hpp"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <atomic>
+
+using namespace std;
+
+class JobManager;
+
+/**
+ A piece of background work, such as a scan, split into tasks that run on the JobManager's workers.
+ Tasks may post more tasks to their own job, and the job is finished once every task has run.
+ The job stays alive until then even if its owner lets go of it.
+ */
+class Job : public enable_shared_from_this<Job>{
+public:
+	//higher priorities are run first, see JobManager
+	const int priority;
+
+	Job(JobManager& owner, int priority) : priority(priority), manager(owner){}
+	Job(const Job&) = delete;
+	Job& operator=(const Job&) = delete;
+
+	void post(const DirectoryData* folder, function<void()> task, bool breadthFirst = false);
+	void pause();
+	void resume();
+	void cancel();
+	void join();
+	bool paused() const;
+	bool finished() const;
+
+	/**
+	 @return true once the job has been cancelled. Queued tasks still run, so they should return early.
+	 */
+	bool cancelled() const{
+		return stopped.load(memory_order_acquire);
+	}
+	/**
+	 @return the flag set when the job is cancelled, for waits that poll a flag rather than the job
+	 */
+	const atomic<bool>& cancelFlag() const{
+		return stopped;
+	}
+
+private:
+	friend class JobManager;
+	struct Task{
+		const DirectoryData* folder;
+		function<void()> run;
+	};
+	JobManager& manager;
+	//everything below is guarded by the manager's lock
+	//tasks in the focused subtree, run newest first
+	vector<Task> boosted;
+	//tasks run oldest first, before any in queued, so the top of a tree is read before its depths
+	deque<Task> wide;
+	//all other tasks, run newest first so scans go depth first
+	vector<Task> queued;
+	//tasks queued or running
+	size_t outstanding = 0;
+	bool isPaused = false;
+	//when a worker last took a task from this job, for sharing workers between jobs of equal priority
+	uint64_t lastServed = 0;
+	condition_variable done;
+	atomic<bool> stopped{false};
+};
+
+/**
+ Owns every background job and runs their tasks on one shared pool of workers. Workers take tasks from
+ the focused subtree first, then from the job with the highest priority, sharing workers evenly between
+ jobs of equal priority.
+ */
+class JobManager{
+public:
+	//priorities for jobs started by the UI. Reloads and expansions are smaller than whole scans and were asked for later.
+	static constexpr int scanPriority = 0;
+	static constexpr int reloadPriority = 1;
+
+	JobManager(size_t threads = 0);
+	~JobManager();
+	JobManager(const JobManager&) = delete;
+	JobManager& operator=(const JobManager&) = delete;
+
+	static JobManager& shared();
+	shared_ptr<Job> submit(int priority);
+	void focus(const DirectoryData*);
+
+private:
+	friend class Job;
+	mutex lock;
+	condition_variable wake;
+	//jobs with outstanding tasks
+	vector<shared_ptr<Job>> active;
+	vector<thread> workers;
+	const size_t threadCount;
+	//never dereferenced, only compared with the ancestors of queued folders
+	const DirectoryData* focused = nullptr;
+	uint64_t served = 0;
+	bool stopping = false;
+
+	void work();
+	shared_ptr<Job> next();
+	bool inFocus(const DirectoryData*) const;
+};
@@ -0,0 +1,128 @@
+//
+//  LogView.cpp
+//
+//  Copyright © 2020 Ravbug. All rights reserved.
+//
+
+#include "LogView.hpp"
+
+enum Column{ CountColumn, ProblemColumn, FolderColumn };
+
+/**
+ @param parent the window to place the list in
+ @param errors the collector whose groups are listed
+ */
+LogView::LogView(wxWindow* parent, const std::shared_ptr<ErrorCollector>& errors) : wxListCtrl(parent, wxID_ANY, wxDefaultPosition, wxDefaultSize, wxLC_REPORT | wxLC_VIRTUAL | wxLC_SINGLE_SEL), errors(errors){
+	AppendColumn("Count", wxLIST_FORMAT_RIGHT, 70);
+	AppendColumn("Problem", wxLIST_FORMAT_LEFT, 320);
+	AppendColumn("Folder", wxLIST_FORMAT_LEFT, 500);
+}
+
+/**
+ Log a message that is not a scan error, dropping the oldest message once the queue is full
+ @param msg the message, its lines are shown joined in one row
+ */
+void LogView::Add(const wxString& msg){
+	if (messages.size() == maxMessages){
+		messages.pop_front();
+		dropped++;
+	}
+	messages.push_back(msg);
+	Resize();
+	EnsureVisible(GetItemCount() - 1);
+}
+
+/**
+ Take a new snapshot of the grouped errors if they changed
+ @param force update even if the last update was less than refreshInterval ago
+ @return true if there are any scan errors
+ */
+bool LogView::UpdateErrors(bool force){
+	const uint64_t version = errors->version();
+	const auto now = std::chrono::steady_clock::now();
+	if (version != seenVersion && (force || now - lastUpdate >= refreshInterval)){
+		seenVersion = version;
+		lastUpdate = now;
+		groups = errors->groups(overflow);
+		Resize();
+		if (GetItemCount() > 0){
+			RefreshItems(0, GetItemCount() - 1);
+		}
+	}
+	return !groups.empty();
+}
+
+/**
+ Forget the messages and the errors collected so far
+ */
+void LogView::Reset(){
+	errors->clear();
+	groups.clear();
+	overflow = 0;
+	seenVersion = errors->version();
+	messages.clear();
+	dropped = 0;
+	Resize();
+}
+
+/**
+ @return every row as tab separated text, for copying
+ */
+wxString LogView::Text() const{
+	wxString text;
+	for (long row = 0; row < GetItemCount(); row++){
+		text << OnGetItemText(row, CountColumn) << '\t' << OnGetItemText(row, ProblemColumn) << '\t' << OnGetItemText(row, FolderColumn) << '\n';
+	}
+	return text;
+}
+
+/**
+ @param row a row of the list
+ @return the folder of the errors in the row, or an empty string if it is not a row of errors
+ */
+std::string LogView::FolderAt(long row) const{
+	return row >= 0 && row < (long)groups.size() ? groups[row].folder : "";
+}
+
+/**
+ @return the rows after the groups: the uncounted errors, the dropped messages and the messages
+ */
+long LogView::extraRows() const{
+	return (overflow > 0) + (dropped > 0) + (long)messages.size();
+}
+
+void LogView::Resize(){
+	SetItemCount((long)groups.size() + extraRows());
+}
+
+/**
+ Build the text of a cell when it is drawn
+ @param item the row
+ @param column the column
+ */
+wxString LogView::OnGetItemText(long item, long column) const{
+	if (item < (long)groups.size()){
+		const ErrorGroup& group = groups[item];
+		switch (column){
+			case CountColumn:
+				return std::to_string(group.count);
+			case ProblemColumn:
+				return group.describe() + (group.example.empty() ? "" : ": " + group.example + (group.count > 1 ? " and others" : ""));
+			default:
+				return group.folder;
+		}
+	}
+	item -= groups.size();
+	if (overflow > 0 && item-- == 0){
+		return column == CountColumn ? wxString(std::to_string(overflow)) : column == ProblemColumn ? wxString("More errors, not grouped") : wxString();
+	}
+	if (dropped > 0 && item-- == 0){
+		return column == CountColumn ? wxString(std::to_string(dropped)) : column == ProblemColumn ? wxString("Older messages, dropped") : wxString();
+	}
+	if (item < 0 || item >= (long)messages.size() || column != ProblemColumn){
+		return wxString();
+	}
+	wxString msg = messages[item];
+	msg.Replace("\n", " - ");
+	return msg;
+}
@@ -0,0 +1,49 @@
+//
+//  LogView.hpp
+//
+//  Copyright © 2020 Ravbug. All rights reserved.
+//
+
+#pragma once
+#include "ErrorCollector.hpp"
+#include <wx/listctrl.h>
+#include <deque>
+#include <memory>
+#include <vector>
+#include <chrono>
+
+/**
+ The log panel's list. Rows are produced on demand from the grouped scan errors and a bounded queue of
+ other messages, so the cost of the log stays flat however many errors a scan runs into.
+ */
+class LogView : public wxListCtrl{
+public:
+	//other messages kept, older ones are dropped and counted
+	static constexpr size_t maxMessages = 1000;
+	//the grouped errors are merged at most this often while they keep changing
+	static constexpr std::chrono::milliseconds refreshInterval{250};
+
+	LogView(wxWindow* parent, const std::shared_ptr<ErrorCollector>& errors);
+
+	void Add(const wxString& msg);
+	bool UpdateErrors(bool force = false);
+	void Reset();
+	wxString Text() const;
+	std::string FolderAt(long row) const;
+
+protected:
+	wxString OnGetItemText(long item, long column) const override;
+
+private:
+	std::shared_ptr<ErrorCollector> errors;
+	//the groups as of the last update, most frequent first
+	std::vector<ErrorGroup> groups;
+	uint64_t overflow = 0;
+	uint64_t seenVersion = 0;
+	std::chrono::steady_clock::time_point lastUpdate;
+	std::deque<wxString> messages;
+	uint64_t dropped = 0;
+
+	long extraRows() const;
+	void Resize();
+};
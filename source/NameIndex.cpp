@@ -0,0 +1,266 @@
+//
+//  NameIndex.cpp
+//
+//  Copyright © 2020 Ravbug. All rights reserved.
+//
+
+#include "NameIndex.hpp"
+#include <algorithm>
+
+namespace{
+	inline char fold(char c){
+		return c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c;
+	}
+	
+	inline uint32_t trigramAt(string_view s, size_t i){
+		return ((uint32_t)(uint8_t)fold(s[i]) << 16) | ((uint32_t)(uint8_t)fold(s[i + 1]) << 8) | (uint8_t)fold(s[i + 2]);
+	}
+	
+	/**
+	 Intersect sorted lists of name ids, smallest first
+	 @param lists the posting lists, as begin and end pointers
+	 @return the ids present in every list
+	 */
+	vector<uint32_t> intersect(vector<pair<const uint32_t*, const uint32_t*>>& lists){
+		sort(lists.begin(), lists.end(), [](const auto& a, const auto& b){
+			return a.second - a.first < b.second - b.first;
+		});
+		vector<uint32_t> result(lists[0].first, lists[0].second);
+		for (size_t i = 1; i < lists.size() && !result.empty(); i++){
+			vector<uint32_t> next;
+			const uint32_t* pos = lists[i].first;
+			for (uint32_t id : result){
+				pos = lower_bound(pos, lists[i].second, id);
+				if (pos == lists[i].second){
+					break;
+				}
+				if (*pos == id){
+					next.push_back(id);
+				}
+			}
+			result.swap(next);
+		}
+		return result;
+	}
+}
+
+/**
+ Compile a pattern
+ @param pattern a glob if it contains * or ?, otherwise a substring
+ */
+NamePattern::NamePattern(const string& pattern){
+	const bool isGlob = pattern.find_first_of("*?") != string::npos;
+	glob = isGlob ? pattern : "*" + pattern + "*";
+	for (char& c : glob){
+		c = fold(c);
+	}
+	//every literal run of three or more characters must appear in a match
+	size_t runStart = 0;
+	for (size_t i = 0; i <= glob.size(); i++){
+		if (i == glob.size() || glob[i] == '*' || glob[i] == '?'){
+			for (size_t t = runStart; t + 3 <= i; t++){
+				trigrams.push_back(trigramAt(glob, t));
+			}
+			runStart = i + 1;
+		}
+	}
+	sort(trigrams.begin(), trigrams.end());
+	trigrams.erase(unique(trigrams.begin(), trigrams.end()), trigrams.end());
+}
+
+/**
+ @return true if a name matches the whole glob, ignoring ASCII case
+ @param name the name to test
+ */
+bool NamePattern::matches(string_view name) const{
+	size_t g = 0, n = 0;
+	size_t starG = string::npos, starN = 0;
+	while (n < name.size()){
+		if (g < glob.size() && (glob[g] == '?' || glob[g] == fold(name[n]))){
+			g++;
+			n++;
+		}
+		else if (g < glob.size() && glob[g] == '*'){
+			starG = g++;
+			starN = n;
+		}
+		else if (starG != string::npos){
+			//let the last star absorb one more character
+			g = starG + 1;
+			n = ++starN;
+		}
+		else{
+			return false;
+		}
+	}
+	while (g < glob.size() && glob[g] == '*'){
+		g++;
+	}
+	return g == glob.size();
+}
+
+/**
+ Find the names in this segment that match a pattern
+ @param pattern the query
+ @param found called for each match, returns false to stop the search
+ @param cancel checked periodically, stops the search when set
+ @return false if the search was stopped early
+ */
+bool NameSegment::search(const NamePattern& pattern, const function<bool(const NameMatch&)>& found, const atomic<bool>& cancel) const{
+	const uint32_t nameCount = (uint32_t)nameStart.size() - 1;
+	vector<uint32_t> candidates;
+	if (pattern.trigrams.empty()){
+		candidates.resize(nameCount);
+		for (uint32_t i = 0; i < nameCount; i++){
+			candidates[i] = i;
+		}
+	}
+	else{
+		vector<pair<const uint32_t*, const uint32_t*>> lists;
+		for (uint32_t t : pattern.trigrams){
+			auto key = lower_bound(trigramKeys.begin(), trigramKeys.end(), t);
+			if (key == trigramKeys.end() || *key != t){
+				return true;
+			}
+			const size_t k = key - trigramKeys.begin();
+			lists.emplace_back(postings.data() + postingStart[k], postings.data() + postingStart[k + 1]);
+		}
+		candidates = intersect(lists);
+	}
+	
+	for (uint32_t id : candidates){
+		if (cancel){
+			return false;
+		}
+		const string_view n = name(id);
+		if (!pattern.matches(n)){
+			continue;
+		}
+		for (uint32_t e = entryStart[id]; e < entryStart[id + 1]; e++){
+			const Entry& entry = entries[e];
+			string path = folders[entry.folder];
+			path.append(n);
+			if (!found(NameMatch{move(path), entry.size})){
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+/**
+ Index an item
+ @param path the full path to the item
+ @param size the size of the item, or -1 for folders
+ */
+void NameShard::add(const string& path, fileSize size){
+	const size_t nameStart = path.find_last_of("/\\") + 1;	//npos + 1 == 0
+	const string name = path.substr(nameStart);
+	
+	//the scanner adds a folder's items together, so consecutive items usually share a folder
+	if (building.folders.empty() || path.compare(0, nameStart, lastFolder) != 0){
+		lastFolder = path.substr(0, nameStart);
+		building.folders.push_back(lastFolder);
+	}
+	
+	auto it = nameIds.find(name);
+	uint32_t id;
+	if (it != nameIds.end()){
+		id = it->second;
+	}
+	else{
+		id = (uint32_t)nameIds.size();
+		nameIds.emplace(name, id);
+		building.names.append(name);
+		building.nameStart.push_back((uint32_t)building.names.size());
+		for (size_t t = 0; t + 3 <= name.size(); t++){
+			vector<uint32_t>& list = buildingPostings[trigramAt(name, t)];
+			//a name can contain the same trigram more than once
+			if (list.empty() || list.back() != id){
+				list.push_back(id);
+			}
+		}
+	}
+	building.entries.push_back(NameSegment::Entry{id, (uint32_t)building.folders.size() - 1, size});
+	
+	if (building.entries.size() >= segmentEntries){
+		seal();
+	}
+}
+
+/**
+ Freeze the builder into an immutable segment and start a new one
+ */
+void NameShard::seal(){
+	if (building.entries.empty()){
+		return;
+	}
+	auto segment = make_shared<NameSegment>();
+	segment->names = move(building.names);
+	segment->nameStart = move(building.nameStart);
+	segment->folders = move(building.folders);
+	
+	//group the entries by name with a counting sort
+	const size_t nameCount = segment->nameStart.size() - 1;
+	segment->entryStart.assign(nameCount + 1, 0);
+	for (const auto& e : building.entries){
+		segment->entryStart[e.name + 1]++;
+	}
+	for (size_t i = 0; i < nameCount; i++){
+		segment->entryStart[i + 1] += segment->entryStart[i];
+	}
+	segment->entries.resize(building.entries.size());
+	vector<uint32_t> filled(nameCount, 0);
+	for (const auto& e : building.entries){
+		segment->entries[segment->entryStart[e.name] + filled[e.name]++] = e;
+	}
+	
+	//flatten the postings
+	segment->trigramKeys.reserve(buildingPostings.size());
+	for (const auto& pair : buildingPostings){
+		segment->trigramKeys.push_back(pair.first);
+	}
+	sort(segment->trigramKeys.begin(), segment->trigramKeys.end());
+	segment->postingStart.reserve(segment->trigramKeys.size() + 1);
+	segment->postingStart.push_back(0);
+	for (uint32_t key : segment->trigramKeys){
+		const vector<uint32_t>& list = buildingPostings[key];
+		segment->postings.insert(segment->postings.end(), list.begin(), list.end());
+		segment->postingStart.push_back((uint32_t)segment->postings.size());
+	}
+	sealed.push_back(segment);
+	
+	building = NameSegment();
+	nameIds.clear();
+	buildingPostings.clear();
+	lastFolder.clear();
+}
+
+/**
+ Search the items not yet sealed into a segment
+ @param pattern the query
+ @param found called for each match, returns false to stop the search
+ @param cancel checked periodically, stops the search when set
+ @return false if the search was stopped early
+ @note the builder is small, so this scans its names directly
+ */
+bool NameShard::searchBuilder(const NamePattern& pattern, const function<bool(const NameMatch&)>& found, const atomic<bool>& cancel) const{
+	const uint32_t nameCount = (uint32_t)building.nameStart.size() - 1;
+	vector<bool> matched(nameCount);
+	for (uint32_t i = 0; i < nameCount; i++){
+		matched[i] = pattern.matches(building.name(i));
+	}
+	for (const auto& e : building.entries){
+		if (cancel){
+			return false;
+		}
+		if (matched[e.name]){
+			string path = building.folders[e.folder];
+			path.append(building.name(e.name));
+			if (!found(NameMatch{move(path), e.size})){
+				return false;
+			}
+		}
+	}
+	return true;
+}
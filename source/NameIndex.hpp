@@ -0,0 +1,103 @@
+//
+//  NameIndex.hpp
+//
+//  Copyright © 2020 Ravbug. All rights reserved.
+//
+
+#pragma once
+#include "globals.h"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <functional>
+#include <atomic>
+
+using namespace std;
+
+/**
+ An item found by a name search
+ */
+struct NameMatch{
+	string Path;
+	//-1 for folders, whose size is not known when they are indexed
+	fileSize size = 0;
+};
+
+/**
+ A compiled name query. Patterns containing * or ? are matched as globs against the
+ whole name, anything else matches names containing it. Matching ignores ASCII case.
+ */
+class NamePattern{
+public:
+	NamePattern(const string& pattern);
+	bool matches(string_view name) const;
+	
+	//trigrams every matching name must contain, possibly empty
+	vector<uint32_t> trigrams;
+	
+private:
+	string glob;
+};
+
+/**
+ An immutable block of indexed names. Names are interned within the segment, and each
+ trigram of a name maps to a sorted list of the names containing it.
+ */
+struct NameSegment{
+	struct Entry{
+		uint32_t name;
+		uint32_t folder;
+		fileSize size;
+	};
+	
+	//interned names, back to back
+	string names;
+	vector<uint32_t> nameStart{0};
+	//entries grouped by name: the entries of name i are entryStart[i] to entryStart[i + 1]
+	vector<Entry> entries;
+	vector<uint32_t> entryStart;
+	//folder paths including the trailing separator
+	vector<string> folders;
+	//trigram -> names, as sorted keys and a flattened list of name ids
+	vector<uint32_t> trigramKeys;
+	vector<uint32_t> postingStart;
+	vector<uint32_t> postings;
+	
+	string_view name(uint32_t i) const{
+		return string_view(names).substr(nameStart[i], nameStart[i + 1] - nameStart[i]);
+	}
+	bool search(const NamePattern&, const function<bool(const NameMatch&)>&, const atomic<bool>& cancel) const;
+};
+
+/**
+ One scan worker's part of the name index. Names accumulate in a small mutable builder
+ that is sealed into an immutable NameSegment when full, so memory grows with the number of
+ distinct names per segment and searches only lock while reading the builder.
+ @note the owner serializes add, seal and snapshot with its own lock
+ */
+class NameShard{
+public:
+	static constexpr size_t segmentEntries = 1 << 16;
+	
+	void add(const string& path, fileSize size);
+	void seal();
+	
+	/**
+	 @return the sealed segments. They may be searched without holding the owner's lock.
+	 */
+	vector<shared_ptr<const NameSegment>> sealedSegments() const{
+		return sealed;
+	}
+	bool searchBuilder(const NamePattern&, const function<bool(const NameMatch&)>&, const atomic<bool>& cancel) const;
+	
+private:
+	vector<shared_ptr<const NameSegment>> sealed;
+	
+	//the segment being built
+	NameSegment building;
+	unordered_map<string, uint32_t> nameIds;
+	unordered_map<uint32_t, vector<uint32_t>> buildingPostings;
+	string lastFolder;
+};
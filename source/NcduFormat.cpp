@@ -0,0 +1,801 @@
+//
+//  NcduFormat.cpp
+//
+//  Copyright © 2020 Ravbug. All rights reserved.
+//
+
+#include "NcduFormat.hpp"
+#include "Epoch.hpp"
+#include <algorithm>
+#include <iostream>
+#include <cstring>
+#include <cerrno>
+#include <cctype>
+#include <ctime>
+#include <filesystem>
+#include <unordered_set>
+
+using namespace std;
+
+/**
+ Open an export and read its header and the record of the scanned folder
+ @param file the path to the export
+ @throws runtime_error if the file cannot be opened or is not an ncdu export
+ */
+NcduReader::NcduReader(const string& file) : buffer(bufferSize){
+	in = fopen(file.c_str(), "rb");
+	if (in == nullptr){
+		throw runtime_error("Cannot open " + file + ": " + strerror(errno));
+	}
+	length = get_stat(file).st_size;
+	try{
+		//[major, minor, {metadata}, [{root}, ...]]
+		expect('[');
+		const int64_t major = readNumber();
+		if (major != 1){
+			fail("unsupported export version " + to_string(major));
+		}
+		expect(',');
+		readNumber();
+		expect(',');
+		skipValue();
+		expect(',');
+		expect('[');
+		expect('{');
+		readEntry(rootEntry);
+	}
+	catch(...){
+		fclose(in);
+		in = nullptr;
+		throw;
+	}
+}
+
+NcduReader::~NcduReader(){
+	if (in != nullptr){
+		fclose(in);
+	}
+}
+
+/**
+ Build the tree recorded in the export. Progress is reported for the root only, and its contents are
+ published when the whole file has been read.
+ @param root the folder to fill, created with rootPath()
+ @param abort set to true to stop reading early
+ @param progress called with the fraction of the file read
+ @param log called with read errors recorded in the export
+ @throws runtime_error if the export is malformed. The tree read so far is kept and marked complete.
+ @note root is always marked complete on return
+ */
+void NcduReader::read(DirectoryData* root, const atomic<bool>& abort, const progCallback& progress, const logCallback& log){
+	stats = report != nullptr ? &report->local() : nullptr;
+	applyMeta(root, rootEntry);
+	if (rootEntry.readError && log != nullptr){
+		log("Error reading directory " + root->Path + " (recorded in the export)");
+	}
+
+	depth = 0;
+	if (stack.empty()){
+		stack.emplace_back();
+	}
+	OpenFolder& top = stack[depth++];
+	top = OpenFolder();
+	top.folder = root;
+	top.list = new ChildList;
+
+	//finish every open folder, so a partial tree is consistent and owns all of its items
+	auto closeAll = [&]{
+		while (depth > 0){
+			closeFolder();
+		}
+		if (progress != nullptr){
+			progress(1, root);
+		}
+	};
+
+	const uint64_t step = max<uint64_t>(length / 100, bufferSize);
+	uint64_t nextReport = step;
+	uint64_t entries = 0;
+	try{
+		while (depth > 0){
+			int c = next();
+			if (c == ']'){
+				closeFolder();
+				continue;
+			}
+			if (c != ','){
+				fail("expected ',' or ']'");
+			}
+
+			c = next();
+			if (c == '['){
+				//a folder is an array of its own record followed by its contents
+				expect('{');
+				readEntry(entry);
+				openFolder(entry);
+				if (entry.readError && log != nullptr){
+					log("Error reading directory " + stack[depth - 1].folder->Path + " (recorded in the export)");
+				}
+			}
+			else if (c == '{'){
+				readEntry(entry);
+				//folders on other filesystems and pseudo filesystems are recorded without their contents
+				if (!entry.excluded.empty() && ((entry.meta.mode & S_IFMT) == S_IFDIR || entry.excluded == "otherfs" || entry.excluded == "kernfs")){
+					openFolder(entry);
+					closeFolder();
+				}
+				else{
+					addFile(entry);
+				}
+			}
+			else{
+				fail("expected a file or folder");
+			}
+
+			if ((++entries & 4095) == 0){
+				if (abort){
+					break;
+				}
+				const uint64_t offset = consumed + pos;
+				if (progress != nullptr && offset >= nextReport){
+					nextReport = offset + step;
+					progress(min(0.99f, (float)offset / length), root);
+				}
+			}
+		}
+	}
+	catch(...){
+		closeAll();
+		throw;
+	}
+	closeAll();
+}
+
+/**
+ Refill the read buffer
+ @return false at the end of the file
+ */
+bool NcduReader::fill(){
+	consumed += end;
+	end = fread(buffer.data(), 1, bufferSize, in);
+	pos = 0;
+	return end > 0;
+}
+
+/**
+ @return the next byte that is not whitespace, or EOF
+ */
+int NcduReader::next(){
+	for(;;){
+		const int c = get();
+		if (c != ' ' && c != '\n' && c != '\r' && c != '\t'){
+			return c;
+		}
+	}
+}
+
+/**
+ Consume a structural character
+ @param c the character that must come next, after any whitespace
+ */
+void NcduReader::expect(char c){
+	if (next() != c){
+		fail(string("expected '") + c + "'");
+	}
+}
+
+/**
+ @throws runtime_error describing a problem at the current position
+ */
+void NcduReader::fail(const string& problem){
+	throw runtime_error("Invalid ncdu export at byte " + to_string(consumed + pos) + ": " + problem);
+}
+
+/**
+ Read a string whose opening quote has been consumed, decoding escapes to UTF-8
+ @param out receives the string
+ */
+void NcduReader::readString(string& out){
+	out.clear();
+	auto hex4 = [this]{
+		uint32_t value = 0;
+		for (int i = 0; i < 4; i++){
+			const int c = get();
+			if (!isxdigit(c)){
+				fail("invalid \\u escape");
+			}
+			value = value * 16 + (isdigit(c) ? c - '0' : (tolower(c) - 'a' + 10));
+		}
+		return value;
+	};
+	for(;;){
+		if (pos == end && !fill()){
+			fail("unterminated string");
+		}
+		//copy runs of plain characters straight from the buffer
+		const size_t start = pos;
+		while (pos < end && buffer[pos] != '"' && buffer[pos] != '\\'){
+			pos++;
+		}
+		out.append(&buffer[start], pos - start);
+		if (pos == end){
+			continue;
+		}
+		if (buffer[pos++] == '"'){
+			return;
+		}
+		const int c = get();
+		switch (c){
+			case '"': case '\\': case '/':
+				out += (char)c;
+				break;
+			case 'b': out += '\b'; break;
+			case 'f': out += '\f'; break;
+			case 'n': out += '\n'; break;
+			case 'r': out += '\r'; break;
+			case 't': out += '\t'; break;
+			case 'u':{
+				uint32_t code = hex4();
+				if (code >= 0xD800 && code < 0xDC00){
+					//characters outside the basic plane are written as surrogate pairs
+					if (get() != '\\' || get() != 'u'){
+						fail("unpaired surrogate");
+					}
+					const uint32_t low = hex4();
+					if (low < 0xDC00 || low > 0xDFFF){
+						fail("unpaired surrogate");
+					}
+					code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+				}
+				if (code < 0x80){
+					out += (char)code;
+				}
+				else if (code < 0x800){
+					out += (char)(0xC0 | (code >> 6));
+					out += (char)(0x80 | (code & 0x3F));
+				}
+				else if (code < 0x10000){
+					out += (char)(0xE0 | (code >> 12));
+					out += (char)(0x80 | ((code >> 6) & 0x3F));
+					out += (char)(0x80 | (code & 0x3F));
+				}
+				else{
+					out += (char)(0xF0 | (code >> 18));
+					out += (char)(0x80 | ((code >> 12) & 0x3F));
+					out += (char)(0x80 | ((code >> 6) & 0x3F));
+					out += (char)(0x80 | (code & 0x3F));
+				}
+				break;
+			}
+			default:
+				fail("invalid escape");
+		}
+	}
+}
+
+/**
+ Read a number. Fractions and exponents are accepted and discarded, ncdu only writes integers.
+ @return the integer part
+ */
+int64_t NcduReader::readNumber(){
+	int c = next();
+	const bool negative = c == '-';
+	if (negative){
+		c = get();
+	}
+	if (!isdigit(c)){
+		fail("expected a number");
+	}
+	int64_t value = c - '0';
+	while (isdigit(peek())){
+		value = value * 10 + (get() - '0');
+	}
+	for (c = peek(); isdigit(c) || c == '.' || c == 'e' || c == 'E' || c == '+' || c == '-'; c = peek()){
+		get();
+	}
+	return negative ? -value : value;
+}
+
+/**
+ Skip any value, including nested objects and arrays
+ */
+void NcduReader::skipValue(){
+	int depth = 0;
+	do{
+		const int c = next();
+		switch (c){
+			case '[': case '{':
+				depth++;
+				break;
+			case ']': case '}':
+				depth--;
+				break;
+			case '"':
+				readString(key);
+				break;
+			case ',': case ':':
+				break;
+			case EOF:
+				fail("unexpected end of file");
+			default:
+				//numbers and literals
+				while (isalnum(peek()) || peek() == '.' || peek() == '+' || peek() == '-'){
+					get();
+				}
+		}
+	} while (depth > 0);
+}
+
+/**
+ Read a file or folder record whose opening brace has been consumed
+ @param e receives the record
+ */
+void NcduReader::readEntry(Entry& e){
+	e.name.clear();
+	e.excluded.clear();
+	e.asize = e.dsize = 0;
+	e.meta = FileMeta();
+	e.hasMode = e.readError = e.notRegular = false;
+
+	auto readBool = [this]{
+		const int c = next();
+		while (isalpha(peek())){
+			get();
+		}
+		return c == 't';
+	};
+
+	bool hasAccessed = false;
+	int c = next();
+	while (c != '}'){
+		if (c != '"'){
+			fail("expected a key");
+		}
+		readString(key);
+		expect(':');
+		if (key == "name"){
+			expect('"');
+			readString(e.name);
+		}
+		else if (key == "asize"){
+			e.asize = readNumber();
+		}
+		else if (key == "dsize"){
+			e.dsize = readNumber();
+		}
+		else if (key == "mtime"){
+			e.meta.modified = readNumber();
+		}
+		else if (key == "atime"){
+			e.meta.accessed = readNumber();
+			hasAccessed = true;
+		}
+		else if (key == "ctime"){
+			e.meta.changed = readNumber();
+		}
+		else if (key == "uid"){
+			e.meta.uid = (uint32_t)readNumber();
+		}
+		else if (key == "gid"){
+			e.meta.gid = (uint32_t)readNumber();
+		}
+		else if (key == "mode"){
+			e.meta.mode = (uint32_t)readNumber();
+			e.hasMode = true;
+		}
+		else if (key == "read_error"){
+			e.readError = readBool();
+		}
+		else if (key == "notreg"){
+			e.notRegular = readBool();
+		}
+		else if (key == "excluded"){
+			expect('"');
+			readString(e.excluded);
+		}
+		else{
+			skipValue();
+		}
+
+		c = next();
+		if (c == ','){
+			c = next();
+		}
+		else if (c != '}'){
+			fail("expected ',' or '}'");
+		}
+	}
+	//ncdu does not record access times, so age by modification time instead of treating everything as cold
+	if (!hasAccessed){
+		e.meta.accessed = e.meta.modified;
+	}
+}
+
+/**
+ @param name the name of an item in the innermost open folder
+ @return the full path of the item
+ */
+string NcduReader::childPath(const string& name) const{
+	const string& parent = stack[depth - 1].folder->Path;
+	string path;
+	path.reserve(parent.size() + name.size() + 1);
+	path = parent;
+	if (path.empty() || (path.back() != '/' && path.back() != filesystem::path::preferred_separator)){
+		path += (char)filesystem::path::preferred_separator;
+	}
+	path += name;
+	return path;
+}
+
+/**
+ Copy the metadata of a record into an item
+ @param item the item to update
+ @param e the record, which may lack the extended fields
+ */
+void NcduReader::applyMeta(DirectoryData* item, const Entry& e){
+	item->meta = e.meta;
+	if (!e.hasMode){
+		//exports made without -e carry no mode, so invent one that matches the record
+		item->meta.mode = item->isFolder ? (S_IFDIR | 0755) : (S_IFREG | 0644);
+	}
+	item->meta.blocks = (e.dsize + 511) / 512;
+#if !defined _WIN32
+	item->isSymlink = S_ISLNK(item->meta.mode);
+#endif
+	if (item->isFolder){
+		item->allocated = item->meta.allocated(0);
+		item->stats->newestModified = item->meta.modified;
+	}
+	else{
+		item->size = e.asize;
+		item->allocated = item->meta.allocated(e.asize);
+	}
+}
+
+/**
+ Create a folder in the innermost open folder and make it the innermost
+ @param e the folder's record
+ */
+void NcduReader::openFolder(const Entry& e){
+	DirectoryData* sub = new DirectoryData(childPath(e.name), true);
+	applyMeta(sub, e);
+	OpenFolder& parent = stack[depth - 1];
+	sub->parent = parent.folder;
+	parent.list->subFolders.push_back(sub);
+	if (stats != nullptr){
+		parent.names.push_back(NameMatch{sub->Path, -1});
+	}
+
+	//levels are reused, so their vectors keep their capacity from folder to folder
+	if (depth == stack.size()){
+		stack.emplace_back();
+	}
+	OpenFolder& f = stack[depth++];
+	f.folder = sub;
+	f.list = new ChildList;
+	f.types.clear();
+	f.subTypes.clear();
+	f.total = f.allocated = 0;
+	f.names.clear();
+	f.users.clear();
+	f.groups.clear();
+}
+
+/**
+ Add a file to the innermost open folder
+ @param e the file's record
+ */
+void NcduReader::addFile(const Entry& e){
+	OpenFolder& f = stack[depth - 1];
+	DirectoryData* file = new DirectoryData(childPath(e.name), false);
+	applyMeta(file, e);
+	file->extension = ExtensionTable::intern(extensionView(e.name));
+	file->category = categoryForExtension(extensionView(e.name));
+	file->parent = f.folder;
+	file->markComplete();
+
+	Scanner::addType(f.types, TypeShare{file->extension, 1, file->size});
+	f.total += file->size;
+	f.allocated += file->allocated;
+	FolderStats& folderStats = *f.folder->stats;
+	folderStats.newestModified = max(folderStats.newestModified, file->meta.modified);
+	folderStats.modifiedAge.add(file->size, file->meta.modified, started);
+	folderStats.accessedAge.add(file->size, file->meta.accessed, started);
+	if (stats != nullptr){
+		report->addFile(*stats, file->Path, file->size, file->meta.modified);
+		f.names.push_back(NameMatch{file->Path, file->size});
+		const OwnerTotals owned{file->size, file->allocated, 1};
+		addOwner(f.users, file->meta.uid, owned);
+		addOwner(f.groups, file->meta.gid, owned);
+	}
+	f.list->files.push_back(file);
+}
+
+/**
+ Publish the innermost open folder, mark it complete and add its totals to its parent
+ */
+void NcduReader::closeFolder(){
+	OpenFolder& f = stack[--depth];
+	DirectoryData* folder = f.folder;
+	folder->size += f.total;
+	folder->allocated += f.allocated;
+	folder->num_items += f.list->files.size();
+	//every child is closed, so its order by size is final
+	f.list->order(ChildOrder::Size);
+	folder->publish(f.list);
+	f.list = nullptr;
+	if (stats != nullptr){
+		report->addTypes(*stats, f.types);
+		report->addNames(*stats, f.names);
+		report->addOwners(*stats, f.users, f.groups);
+	}
+
+	//keep the largest extensions of the subtree
+	for (const TypeShare& share : f.subTypes){
+		Scanner::addType(f.types, share);
+	}
+	auto last = f.types.begin() + min(f.types.size(), FolderStats::topTypeCount);
+	partial_sort(f.types.begin(), last, f.types.end(), [](const TypeShare& a, const TypeShare& b){
+		return a.bytes > b.bytes;
+	});
+	copy(f.types.begin(), last, folder->stats->topTypes.begin());
+	folder->markComplete();
+
+	if (depth > 0){
+		OpenFolder& parent = stack[depth - 1];
+		DirectoryData* p = parent.folder;
+		p->size += folder->size;
+		p->allocated += folder->allocated;
+		p->num_items += folder->num_items + 1;
+		for (const TypeShare& share : folder->stats->topTypes){
+			Scanner::addType(parent.subTypes, share);
+		}
+		p->stats->newestModified = max(p->stats->newestModified, folder->stats->newestModified);
+		p->stats->modifiedAge.add(folder->stats->modifiedAge);
+		p->stats->accessedAge.add(folder->stats->accessedAge);
+	}
+}
+
+namespace{
+	/**
+	 Buffered output for the ncdu writer, flushed in large blocks
+	 */
+	class JsonWriter{
+	public:
+		JsonWriter(FILE* out) : out(out){
+			buffer.reserve(flushSize + 4096);
+		}
+		~JsonWriter(){
+			flush();
+		}
+		void flush(){
+			fwrite(buffer.data(), 1, buffer.size(), out);
+			buffer.clear();
+		}
+		void raw(string_view text){
+			buffer.append(text.data(), text.size());
+			if (buffer.size() >= flushSize){
+				flush();
+			}
+		}
+		void number(string_view key, int64_t value){
+			raw(",\"");
+			raw(key);
+			raw("\":");
+			raw(to_string(value));
+		}
+		/**
+		 Write a quoted string. Bytes that are not valid UTF-8 are passed through, as ncdu does.
+		 */
+		void quoted(string_view text){
+			buffer += '"';
+			for (char c : text){
+				if (c == '"' || c == '\\'){
+					buffer += '\\';
+					buffer += c;
+				}
+				else if ((unsigned char)c < 0x20){
+					char escaped[8];
+					snprintf(escaped, sizeof(escaped), "\\u%04x", (unsigned char)c);
+					buffer += escaped;
+				}
+				else{
+					buffer += c;
+				}
+			}
+			buffer += '"';
+		}
+	private:
+		static constexpr size_t flushSize = 1 << 20;
+		FILE* out;
+		string buffer;
+	};
+
+	/**
+	 @return the last component of a path
+	 */
+	string_view leafName(const string& path){
+#if defined _WIN32
+		const size_t slash = path.find_last_of("\\/");
+#else
+		const size_t slash = path.find_last_of('/');
+#endif
+		return slash == string::npos || slash + 1 == path.size() ? string_view(path) : string_view(path).substr(slash + 1);
+	}
+
+	/**
+	 Write the record of one item
+	 @param out the destination
+	 @param item the item to describe
+	 @param name the name to record, the full path for the root
+	 @param asFolder true if the item is written as a folder
+	 */
+	void writeEntry(JsonWriter& out, DirectoryData* item, string_view name, bool asFolder){
+		out.raw("{\"name\":");
+		out.quoted(name);
+		if (asFolder){
+			//a folder's own size, ncdu adds its contents when loading
+			out.number("dsize", item->meta.allocated(0));
+		}
+		else{
+			out.number("asize", item->size);
+			out.number("dsize", item->allocated);
+		}
+		if (item->meta.valid()){
+			out.number("uid", item->meta.uid);
+			out.number("gid", item->meta.gid);
+			out.number("mode", item->meta.mode);
+			out.number("mtime", item->meta.modified);
+			if (!asFolder && (item->meta.mode & S_IFMT) != S_IFREG){
+				out.raw(",\"notreg\":true");
+			}
+		}
+		//folders are only incomplete when sizing was stopped
+		if (asFolder && (!item->isComplete() || item->timedOut)){
+			out.raw(",\"read_error\":true");
+		}
+		out.raw("}");
+	}
+}
+
+namespace{
+	/**
+	 Write the files of a huge folder that the scan only counted in its summary row, reading them from disk again
+	 @param out the destination
+	 @param folder the huge folder
+	 @param list the folder's contents, whose files were written already
+	 @note files that can no longer be read are left out
+	 */
+	void writeSummarized(JsonWriter& out, const DirectoryData* folder, const ChildList* list){
+		unordered_set<string> written;
+		for (const DirectoryData* file : list->files){
+			if (!file->isSummary){
+				written.insert(file->Path);
+			}
+		}
+		error_code ec;
+		for (filesystem::directory_iterator it(folder->Path, ec), end; !ec && it != end; it.increment(ec)){
+			//folders are told apart the way the scanner does, following links, and are written from the tree
+			error_code typeError;
+			const string path = it->path().string();
+			if (written.count(path) > 0 || it->is_directory(typeError)){
+				continue;
+			}
+			const struct stat info = get_stat(path);
+			if (info.st_mode == 0){
+				continue;
+			}
+			DirectoryData file(path, info);
+			out.raw(",\n");
+			writeEntry(out, &file, leafName(file.Path), false);
+		}
+	}
+}
+
+/**
+ Write a scanned tree in ncdu's export format, so it can be browsed with ncdu -f or imported again
+ @param root the folder to write
+ @param file the path to write to, or - for standard output
+ @throws runtime_error if the file cannot be written
+ @note the caller must keep root alive, for example by holding an epoch::Guard from before it could be retired
+ */
+void writeNcdu(DirectoryData* root, const string& file){
+	FILE* stream = file == "-" ? stdout : fopen(file.c_str(), "wb");
+	if (stream == nullptr){
+		throw runtime_error("Cannot create " + file + ": " + strerror(errno));
+	}
+	{
+		//the lists cannot be freed while the guard is held
+		epoch::Guard guard;
+		JsonWriter out(stream);
+		out.raw("[1,2,{\"progname\":");
+		out.quoted(AppName);
+		out.raw(",\"progver\":");
+		out.quoted(AppVersion);
+		out.number("timestamp", time(nullptr));
+		out.raw("},\n[");
+		writeEntry(out, root, root->Path, true);
+
+		//walk depth first with an explicit stack
+		struct Level{
+			const ChildList* list;
+			size_t next;
+		};
+		vector<Level> stack{Level{root->children(), 0}};
+		while (!stack.empty()){
+			Level& top = stack.back();
+			const size_t fileCount = top.list->files.size();
+			if (top.next == fileCount + top.list->subFolders.size()){
+				out.raw("]");
+				stack.pop_back();
+				continue;
+			}
+			DirectoryData* item = top.next < fileCount ? top.list->files[top.next] : top.list->subFolders[top.next - fileCount];
+			top.next++;
+			//ncdu has no summary rows, so the files a summary stands for are listed instead
+			if (item->isSummary){
+				writeSummarized(out, item->parent, top.list);
+				continue;
+			}
+			out.raw(",\n");
+			//symbolic links to folders are written as the links themselves
+			if (item->isFolder && !item->isSymlink){
+				out.raw("[");
+				writeEntry(out, item, leafName(item->Path), true);
+				stack.push_back(Level{item->children(), 0});
+			}
+			else{
+				writeEntry(out, item, leafName(item->Path), false);
+			}
+		}
+		out.raw("]\n");
+	}
+	bool failed = ferror(stream) != 0;
+	if (stream == stdout){
+		failed |= fflush(stream) != 0;
+	}
+	else{
+		failed |= fclose(stream) != 0;
+	}
+	if (failed){
+		throw runtime_error("Error writing " + file);
+	}
+}
+
+/**
+ @return true if the arguments ask for the export command
+ */
+bool isExportCommand(int argc, char** argv){
+	return argc >= 2 && strcmp(argv[1], "--export-ncdu") == 0;
+}
+
+/**
+ Scan a folder and write it in ncdu's export format, for browsing on another machine:
+   FatFileFinder --export-ncdu /srv srv.json
+ Pass - as the output to write to standard output.
+ @return the process exit code
+ */
+int exportCommand(int argc, char** argv){
+	if (argc < 4){
+		cerr << "usage: " << argv[0] << " --export-ncdu <folder> <output.json | ->" << endl;
+		return 2;
+	}
+	atomic<bool> abort{false};
+	DirectoryData* root = new DirectoryData(argv[2], true);
+	Scanner scanner(abort, [](const string& msg){
+		cerr << msg << endl;
+	});
+	scanner.summarizeAbove = Scanner::neverSummarize;
+	scanner.SizeItem(root, nullptr);
+
+	int result = 0;
+	try{
+		writeNcdu(root, argv[3]);
+	}
+	catch(const runtime_error& e){
+		cerr << e.what() << endl;
+		result = 1;
+	}
+	delete root;
+	return result;
+}
@@ -0,0 +1,129 @@
+//
+//  NcduFormat.hpp
+//
+//  Copyright © 2020 Ravbug. All rights reserved.
+//
+
+#pragma once
+#include "DirectoryData.hpp"
+#include "Scanner.hpp"
+#include "ScanReport.hpp"
+#include <cstdio>
+#include <vector>
+#include <string>
+#include <atomic>
+#include <memory>
+
+using namespace std;
+
+/**
+ Reads the JSON export written by ncdu -o. The file is tokenized straight from a fixed read buffer into
+ DirectoryData nodes with an explicit stack of open folders, so memory use beyond the tree itself does not
+ grow with the size of the export. Folders are rolled up, published and marked complete the same way the
+ Scanner does, so every view and report works on an imported tree.
+ */
+class NcduReader{
+public:
+	NcduReader(const string& file);
+	~NcduReader();
+	NcduReader(const NcduReader&) = delete;
+	NcduReader& operator=(const NcduReader&) = delete;
+
+	/**
+	 @return the path of the scanned folder recorded in the export
+	 */
+	const string& rootPath() const{
+		return rootEntry.name;
+	}
+
+	void read(DirectoryData* root, const atomic<bool>& abort, const progCallback& progress, const logCallback& log);
+
+	//whole-tree statistics for the import, or nullptr to skip collecting them
+	shared_ptr<ScanReport> report;
+
+private:
+	/**
+	 One file or folder record, reused for every entry so its strings keep their capacity
+	 */
+	struct Entry{
+		string name;
+		string excluded;
+		fileSize asize = 0;
+		fileSize dsize = 0;
+		FileMeta meta;
+		bool hasMode = false;
+		bool readError = false;
+		bool notRegular = false;
+	};
+
+	/**
+	 A folder whose closing bracket has not been read yet
+	 */
+	struct OpenFolder{
+		DirectoryData* folder = nullptr;
+		ChildList* list = nullptr;
+		//extensions of the folder's own files, and the top extensions of its closed subfolders
+		vector<TypeShare> types;
+		vector<TypeShare> subTypes;
+		fileSize total = 0;
+		fileSize allocated = 0;
+		vector<NameMatch> names;
+		OwnerShares users, groups;
+	};
+
+	static constexpr size_t bufferSize = 1 << 20;
+	FILE* in = nullptr;
+	vector<char> buffer;
+	size_t pos = 0;
+	size_t end = 0;
+	//bytes of the file before the start of the buffer
+	uint64_t consumed = 0;
+	uint64_t length = 0;
+
+	Entry rootEntry;
+	Entry entry;
+	string key;
+	//open folders from the root inward, only the first depth entries are in use
+	vector<OpenFolder> stack;
+	size_t depth = 0;
+	ScanReport::Local* stats = nullptr;
+	//ages are measured from the time of the import, like a scan
+	const time_t started = time(nullptr);
+
+	/**
+	 @return the next byte without consuming it, or EOF
+	 */
+	int peek(){
+		if (pos == end && !fill()){
+			return EOF;
+		}
+		return (unsigned char)buffer[pos];
+	}
+	/**
+	 @return the next byte, or EOF
+	 */
+	int get(){
+		if (pos == end && !fill()){
+			return EOF;
+		}
+		return (unsigned char)buffer[pos++];
+	}
+	bool fill();
+	int next();
+	void expect(char);
+	[[noreturn]] void fail(const string&);
+	void readString(string&);
+	int64_t readNumber();
+	void skipValue();
+	void readEntry(Entry&);
+
+	void openFolder(const Entry&);
+	void addFile(const Entry&);
+	void closeFolder();
+	string childPath(const string&) const;
+	void applyMeta(DirectoryData*, const Entry&);
+};
+
+void writeNcdu(DirectoryData* root, const string& file);
+bool isExportCommand(int argc, char** argv);
+int exportCommand(int argc, char** argv);
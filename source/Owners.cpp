@@ -0,0 +1,150 @@
+//
+//  Owners.cpp
+//
+//  Copyright © 2020 Ravbug. All rights reserved.
+//
+
+#include "Owners.hpp"
+#include "Epoch.hpp"
+#include <mutex>
+#if !defined _WIN32
+#include <pwd.h>
+#include <grp.h>
+#endif
+using namespace std;
+
+namespace{
+	mutex namesLock;
+	unordered_map<uint32_t, string> userNames;
+	unordered_map<uint32_t, string> groupNames;
+	
+	/**
+	 Look up a name in the user or group database
+	 @param id the uid or gid
+	 @param isGroup true to look up a group
+	 @return the name, or the id as a string if it has no entry
+	 */
+	string lookup(uint32_t id, bool isGroup){
+#if defined _WIN32
+		return "";
+#else
+		long bufferSize = sysconf(isGroup ? _SC_GETGR_R_SIZE_MAX : _SC_GETPW_R_SIZE_MAX);
+		vector<char> buffer(bufferSize > 0 ? bufferSize : 16384);
+		for(;;){
+			int error;
+			const char* name = nullptr;
+			if (isGroup){
+				struct group entry, *found = nullptr;
+				error = getgrgid_r(id, &entry, buffer.data(), buffer.size(), &found);
+				if (found != nullptr){
+					name = found->gr_name;
+				}
+			}
+			else{
+				struct passwd entry, *found = nullptr;
+				error = getpwuid_r(id, &entry, buffer.data(), buffer.size(), &found);
+				if (found != nullptr){
+					name = found->pw_name;
+				}
+			}
+			if (error == ERANGE && buffer.size() < (1 << 20)){
+				buffer.resize(buffer.size() * 2);
+				continue;
+			}
+			return name != nullptr ? string(name) : to_string(id);
+		}
+#endif
+	}
+	
+	/**
+	 @return the cached name for an id, looking it up on first use
+	 */
+	string cached(unordered_map<uint32_t, string>& names, uint32_t id, bool isGroup){
+		{
+			lock_guard<mutex> guard(namesLock);
+			auto found = names.find(id);
+			if (found != names.end()){
+				return found->second;
+			}
+		}
+		//look up outside the lock, a slow directory service should not block other threads
+		string name = lookup(id, isGroup);
+		lock_guard<mutex> guard(namesLock);
+		names.emplace(id, name);
+		return name;
+	}
+}
+
+string OwnerNames::user(uint32_t uid){
+	return cached(userNames, uid, false);
+}
+
+string OwnerNames::group(uint32_t gid){
+	return cached(groupNames, gid, true);
+}
+
+/**
+ @param id a uid or gid
+ @param isGroup true if id is a gid
+ @return the name followed by the id, such as "alice (1001)"
+ */
+string OwnerNames::describe(uint32_t id, bool isGroup){
+	const string name = isGroup ? group(id) : user(id);
+	if (name.empty() || name == to_string(id)){
+		return to_string(id);
+	}
+	return name + " (" + to_string(id) + ")";
+}
+
+/**
+ Add a file's totals to its owner's entry
+ @param shares the totals for one folder
+ @param id the file's uid or gid
+ @param totals the file's totals
+ */
+void addOwner(OwnerShares& shares, uint32_t id, const OwnerTotals& totals){
+	//folders rarely have more than a few owners, so a linear search is fastest
+	for (auto& share : shares){
+		if (share.first == id){
+			share.second.add(totals);
+			return;
+		}
+	}
+	shares.emplace_back(id, totals);
+}
+
+/**
+ Total the files beneath a folder by owner, from the metadata captured by the scan
+ @param folder the folder to total
+ @param byGroup true to total by gid, false to total by uid
+ @param cancel set to stop early
+ @param summarized receives the totals of the summary rows of huge folders, whose files' owners were not kept
+ @return the totals for each id
+ */
+unordered_map<uint32_t, OwnerTotals> folderOwnerTotals(DirectoryData* folder, bool byGroup, const atomic<bool>& cancel, OwnerTotals& summarized){
+	unordered_map<uint32_t, OwnerTotals> totals;
+	summarized = OwnerTotals();
+	epoch::Guard guard;
+	vector<DirectoryData*> stack{folder};
+	while (!stack.empty() && !cancel){
+		DirectoryData* current = stack.back();
+		stack.pop_back();
+		const ChildList* list = current->children();
+		for (DirectoryData* file : list->files){
+			if (file->isSummary){
+				summarized.add(OwnerTotals{file->size, file->allocated, file->num_items.load()});
+				continue;
+			}
+			OwnerTotals& t = totals[byGroup ? file->meta.gid : file->meta.uid];
+			t.bytes += file->size;
+			t.allocated += file->allocated;
+			t.count++;
+		}
+		for (DirectoryData* sub : list->subFolders){
+			if (!sub->isSymlink){
+				stack.push_back(sub);
+			}
+		}
+	}
+	return totals;
+}
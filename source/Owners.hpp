@@ -0,0 +1,45 @@
+//
+//  Owners.hpp
+//
+//  Copyright © 2020 Ravbug. All rights reserved.
+//
+
+#pragma once
+#include "DirectoryData.hpp"
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <atomic>
+#include <cstdint>
+
+/**
+ Bytes and file count owned by one user or group
+ */
+struct OwnerTotals{
+	fileSize bytes = 0;
+	fileSize allocated = 0;
+	uint64_t count = 0;
+	
+	void add(const OwnerTotals& other){
+		bytes += other.bytes;
+		allocated += other.allocated;
+		count += other.count;
+	}
+};
+
+//totals per id, as a short list for the few owners found in one folder
+typedef std::vector<std::pair<uint32_t, OwnerTotals>> OwnerShares;
+
+void addOwner(OwnerShares& shares, uint32_t id, const OwnerTotals& totals);
+std::unordered_map<uint32_t, OwnerTotals> folderOwnerTotals(DirectoryData* folder, bool byGroup, const std::atomic<bool>& cancel, OwnerTotals& summarized);
+
+/**
+ Resolves user and group ids to names. Each id is looked up once and cached, since
+ lookups may go to a directory service. Safe to use from any thread.
+ */
+class OwnerNames{
+public:
+	static std::string user(uint32_t uid);
+	static std::string group(uint32_t gid);
+	static std::string describe(uint32_t id, bool isGroup);
+};
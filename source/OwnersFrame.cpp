@@ -0,0 +1,141 @@
+//
+//  OwnersFrame.cpp
+//
+//  Copyright © 2020 Ravbug. All rights reserved.
+//
+
+#include "OwnersFrame.hpp"
+#include "FolderDisplay.hpp"
+#include "Epoch.hpp"
+#include <future>
+#include <algorithm>
+
+/**
+ Construct an owner report and fill it
+ @param parent the main window
+ @param report the statistics of the current scan
+ @param folderProvider returns the folder to break down when the scope is the selected folder. Called on the main thread.
+ */
+OwnersFrame::OwnersFrame(wxWindow* parent, const std::shared_ptr<ScanReport>& report, const std::function<DirectoryData*()>& folderProvider) : ReportFrame(parent, "Owners"), report(report), folderProvider(folderProvider){
+	wxString owners[] = {"By user", "By group"};
+	ownerChoice = new wxChoice(list->GetParent(), wxID_ANY, wxDefaultPosition, wxDefaultSize, 2, owners);
+	ownerChoice->SetSelection(0);
+	controlSizer->Add(ownerChoice, 0, wxALL, 5);
+	wxString scopes[] = {"Whole scan", "Selected folder"};
+	scopeChoice = new wxChoice(list->GetParent(), wxID_ANY, wxDefaultPosition, wxDefaultSize, 2, scopes);
+	scopeChoice->SetSelection(0);
+	controlSizer->Add(scopeChoice, 0, wxALL, 5);
+	status = new wxStaticText(list->GetParent(), wxID_ANY, "", wxDefaultPosition, wxDefaultSize, wxST_ELLIPSIZE_MIDDLE);
+	controlSizer->Add(status, 1, wxALL|wxALIGN_CENTER_VERTICAL, 5);
+	for (wxChoice* choice : {ownerChoice, scopeChoice}){
+		choice->Bind(wxEVT_CHOICE, [this](wxCommandEvent&){
+			Populate();
+		});
+	}
+	
+	list->AppendTextColumn("Owner", wxDATAVIEW_CELL_INERT, 160, wxALIGN_LEFT, wxDATAVIEW_COL_RESIZABLE);
+	list->AppendTextColumn("Files", wxDATAVIEW_CELL_INERT, 80, wxALIGN_RIGHT);
+	list->AppendProgressColumn("Percent", wxDATAVIEW_CELL_INERT, 100);
+	list->AppendTextColumn("Size", wxDATAVIEW_CELL_INERT, 90, wxALIGN_RIGHT);
+	list->AppendTextColumn("On Disk", wxDATAVIEW_CELL_INERT, 90, wxALIGN_RIGHT);
+	
+	Populate();
+}
+
+OwnersFrame::~OwnersFrame(){
+	Stop();
+}
+
+/**
+ Cancel the running job, if any, and wait for it to exit
+ */
+void OwnersFrame::Stop(){
+	cancel = true;
+	if (worker.joinable()){
+		worker.join();
+	}
+	cancel = false;
+}
+
+/**
+ Total the space by owner on a background thread. Whole-scan totals were gathered during the scan;
+ folder totals are summed from the metadata in the tree.
+ */
+void OwnersFrame::Populate(){
+	Stop();
+	Clear();
+	const bool byGroup = ownerChoice->GetSelection() == 1;
+	DirectoryData* folder = nullptr;
+	wxString scope = "the whole scan";
+	if (scopeChoice->GetSelection() == 1){
+		folder = folderProvider();
+		if (folder == nullptr){
+			status->SetLabel("Select a folder in the main window");
+			return;
+		}
+		scope = folder->Path;
+	}
+	else if (report == nullptr){
+		status->SetLabel("Open a folder to see its owners");
+		return;
+	}
+	status->SetLabel("Totalling " + scope);
+	
+	//the tree may be replaced as soon as this function returns, so wait until the worker has pinned it
+	std::promise<void> pinned;
+	std::future<void> ready = pinned.get_future();
+	worker = std::thread([this, folder, byGroup, scope, report = report, pinned = std::move(pinned)]() mutable {
+		std::unordered_map<uint32_t, OwnerTotals> totals;
+		//the scan's totals count every file, the tree's summary rows do not say who owns their files
+		OwnerTotals summarized;
+		{
+			epoch::Guard guard;
+			pinned.set_value();
+			totals = folder != nullptr ? folderOwnerTotals(folder, byGroup, cancel, summarized) : report->ownerTotals(byGroup);
+		}
+		std::vector<Row> rows;
+		for (const auto& pair : totals){
+			if (cancel){
+				return;
+			}
+			rows.push_back(Row{OwnerNames::describe(pair.first, byGroup), pair.second});
+		}
+		std::sort(rows.begin(), rows.end(), [](const Row& a, const Row& b){
+			return a.totals.allocated > b.totals.allocated;
+		});
+		CallAfter([this, rows, scope, summarized]{
+			ShowRows(rows, scope, summarized);
+		});
+	});
+	ready.wait();
+}
+
+/**
+ Display owner totals, largest on disk first
+ @param rows the owners and their totals
+ @param scope the description of what was totalled
+ @param summarized the totals left out because they are in summary rows
+ */
+void OwnersFrame::ShowRows(const std::vector<Row>& rows, const wxString& scope, const OwnerTotals& summarized){
+	Clear();
+	fileSize total = 0;
+	for (const Row& r : rows){
+		total += r.totals.allocated;
+	}
+	list->Freeze();
+	for (const Row& r : rows){
+		wxVector<wxVariant> items;
+		items.push_back(r.name);
+		items.push_back(std::to_string(r.totals.count));
+		items.push_back(wxAny((long)(total > 0 ? r.totals.allocated * 100 / total : 0)));
+		items.push_back(FolderDisplay::sizeToString(r.totals.bytes));
+		items.push_back(FolderDisplay::sizeToString(r.totals.allocated));
+		AppendRow(items, "");
+	}
+	list->Thaw();
+	wxString label = wxString::Format("%zu owners in %s", rows.size(), scope);
+	if (summarized.count > 0){
+		label += wxString::Format(", not counting %llu small files (%s) in summary rows, expand them to count their owners", (unsigned long long)summarized.count, FolderDisplay::sizeToString(summarized.allocated));
+	}
+	status->SetLabel(label);
+}
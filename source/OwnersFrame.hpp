@@ -0,0 +1,43 @@
+//
+//  OwnersFrame.hpp
+//
+//  Copyright © 2020 Ravbug. All rights reserved.
+//
+
+#pragma once
+#include "ReportFrame.hpp"
+#include "ScanReport.hpp"
+#include <memory>
+#include <functional>
+#include <thread>
+#include <atomic>
+
+/**
+ Shows how much space each user or group owns, across the whole scan or beneath one folder
+ */
+class OwnersFrame : public ReportFrame{
+public:
+	OwnersFrame(wxWindow* parent, const std::shared_ptr<ScanReport>& report, const std::function<DirectoryData*()>& folderProvider);
+	~OwnersFrame();
+	void Populate() override;
+	
+private:
+	/**
+	 One owner's totals with its name, resolved on the worker thread
+	 */
+	struct Row{
+		std::string name;
+		OwnerTotals totals;
+	};
+	
+	std::shared_ptr<ScanReport> report;
+	std::function<DirectoryData*()> folderProvider;
+	wxChoice* ownerChoice;
+	wxChoice* scopeChoice;
+	wxStaticText* status;
+	std::thread worker;
+	std::atomic<bool> cancel{false};
+	
+	void Stop();
+	void ShowRows(const std::vector<Row>&, const wxString& scope, const OwnerTotals& summarized);
+};
@@ -0,0 +1,45 @@
+//
+//  Parallel.hpp
+//
+//  Copyright © 2020 Ravbug. All rights reserved.
+//
+
+#pragma once
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <functional>
+#include <algorithm>
+
+/**
+ Run a function for every index in [0, count) across all cores, returning when every call has finished
+ @param count the number of indices
+ @param fn called once per index, from any thread
+ @param threads the number of threads to use, or 0 to use one per core
+ */
+inline void parallelFor(size_t count, const std::function<void(size_t)>& fn, size_t threads = 0){
+	if (threads == 0){
+		threads = std::max(1u, std::thread::hardware_concurrency());
+	}
+	threads = std::min(threads, count);
+	if (threads <= 1){
+		for (size_t i = 0; i < count; i++){
+			fn(i);
+		}
+		return;
+	}
+	std::atomic<size_t> next{0};
+	auto work = [&]{
+		for (size_t i = next++; i < count; i = next++){
+			fn(i);
+		}
+	};
+	std::vector<std::thread> pool;
+	for (size_t t = 1; t < threads; t++){
+		pool.emplace_back(work);
+	}
+	work();
+	for (std::thread& t : pool){
+		t.join();
+	}
+}
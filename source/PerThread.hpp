@@ -0,0 +1,85 @@
+//
+//  PerThread.hpp
+//
+//  Copyright © 2020 Ravbug. All rights reserved.
+//
+
+#pragma once
+#include <thread>
+#include <vector>
+#include <array>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <utility>
+#include <cstdint>
+
+/**
+ One accumulator per thread, so workers can record statistics without contending with each other.
+ Readers merge the accumulators with forEach, at any time. A thread keeps its accumulator for as long
+ as the owner lives, so a thread that alternates between several owners does not leave one behind each time.
+ */
+template<typename Local>
+class PerThread{
+public:
+	PerThread() : id(nextId()){}
+	PerThread(const PerThread&) = delete;
+	PerThread& operator=(const PerThread&) = delete;
+
+	/**
+	 @return the accumulator of the calling thread, created on first use
+	 */
+	Local& local(){
+		//recent lookups are cached per thread, keyed by id so a new owner at a reused address is not confused with an old one.
+		//Pool workers alternate between the scans of several jobs, so more than one owner is kept.
+		static constexpr size_t cacheSize = 4;
+		thread_local std::array<std::pair<uint64_t, Local*>, cacheSize> cached{};
+		thread_local size_t nextSlot = 0;
+		for (const auto& entry : cached){
+			if (entry.first == id){
+				return *entry.second;
+			}
+		}
+		Local* found = nullptr;
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			const std::thread::id self = std::this_thread::get_id();
+			for (const auto& owned : locals){
+				if (owned.first == self){
+					found = owned.second.get();
+					break;
+				}
+			}
+			if (found == nullptr){
+				locals.emplace_back(self, std::make_unique<Local>());
+				found = locals.back().second.get();
+			}
+		}
+		cached[nextSlot] = {id, found};
+		nextSlot = (nextSlot + 1) % cacheSize;
+		return *found;
+	}
+
+	/**
+	 Visit every accumulator, while no new ones can be added
+	 @param fn called with each accumulator. Lock it before reading what its thread writes.
+	 */
+	template<typename Fn>
+	void forEach(Fn&& fn) const{
+		std::lock_guard<std::mutex> guard(lock);
+		for (const auto& owned : locals){
+			fn(*owned.second);
+		}
+	}
+
+private:
+	const uint64_t id;
+	mutable std::mutex lock;
+	//a thread id can be reused once its thread exits, which safely hands the accumulator to the new thread
+	std::vector<std::pair<std::thread::id, std::unique_ptr<Local>>> locals;
+
+	static uint64_t nextId(){
+		static std::atomic<uint64_t> next{1};
+		return next++;
+	}
+};
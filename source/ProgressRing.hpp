@@ -0,0 +1,80 @@
+//
+//  ProgressRing.hpp
+//
+//  Copyright © 2020 Ravbug. All rights reserved.
+//
+
+#pragma once
+#include <atomic>
+#include <array>
+#include <cstddef>
+
+/**
+ A fixed-capacity, lock-free single-producer / single-consumer ring.
+ The scan worker is the only producer and the UI thread is the only consumer,
+ so each side owns one index and publishes it with release semantics.
+ */
+template<typename T, size_t Capacity>
+class SPSCRing{
+	static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+public:
+	/**
+	 Append an item to the ring (producer only)
+	 @param item the item to copy into the ring
+	 @return true if the item was added, false if the ring is full
+	 */
+	bool push(const T& item){
+		const size_t h = head.load(std::memory_order_relaxed);
+		if (h - tail.load(std::memory_order_acquire) == Capacity){
+			return false;
+		}
+		buffer[h & (Capacity - 1)] = item;
+		head.store(h + 1, std::memory_order_release);
+		return true;
+	}
+
+	/**
+	 Remove the oldest item from the ring (consumer only)
+	 @param out receives the item
+	 @return true if an item was removed, false if the ring is empty
+	 */
+	bool pop(T& out){
+		const size_t t = tail.load(std::memory_order_relaxed);
+		if (t == head.load(std::memory_order_acquire)){
+			return false;
+		}
+		out = buffer[t & (Capacity - 1)];
+		tail.store(t + 1, std::memory_order_release);
+		return true;
+	}
+
+	/**
+	 Invoke a function on every item currently in the ring, removing them (consumer only)
+	 @param fn callable taking a const T&
+	 @return the number of items consumed
+	 */
+	template<typename Fn>
+	size_t drain(Fn&& fn){
+		size_t t = tail.load(std::memory_order_relaxed);
+		const size_t h = head.load(std::memory_order_acquire);
+		const size_t count = h - t;
+		for (; t != h; ++t){
+			fn(buffer[t & (Capacity - 1)]);
+		}
+		tail.store(h, std::memory_order_release);
+		return count;
+	}
+
+	/**
+	 Discard all items. Only safe to call while no producer is running.
+	 */
+	void reset(){
+		tail.store(head.load(std::memory_order_acquire), std::memory_order_release);
+	}
+
+private:
+	std::array<T, Capacity> buffer;
+	//keep producer and consumer indices on separate cache lines
+	alignas(64) std::atomic<size_t> head{0};
+	alignas(64) std::atomic<size_t> tail{0};
+};
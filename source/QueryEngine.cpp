@@ -0,0 +1,504 @@
+//
+//  QueryEngine.cpp
+//
+//  Copyright © 2020 Ravbug. All rights reserved.
+//
+
+#include "QueryEngine.hpp"
+#include "NameIndex.hpp"
+#include "Scanner.hpp"
+#include "Parallel.hpp"
+#include "Epoch.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <mutex>
+#include <limits>
+
+using namespace std;
+
+namespace{
+	enum class Op{Equal, NotEqual, Less, LessEqual, Greater, GreaterEqual};
+	
+	/**
+	 Clear the mask of rows that fail a comparison. Written as a plain loop over
+	 contiguous arrays so the compiler can vectorize it for the target.
+	 */
+	template<typename T, typename Compare>
+	void filterColumn(const T* column, size_t count, T value, uint8_t* mask, Compare compare){
+		for (size_t i = 0; i < count; i++){
+			mask[i] &= (uint8_t)compare(column[i], value);
+		}
+	}
+	
+	template<typename T>
+	function<void(const NodeColumns&, size_t, size_t, uint8_t*)> compareKernel(vector<T> NodeColumns::* member, Op op, T value){
+		return [member, op, value](const NodeColumns& c, size_t begin, size_t count, uint8_t* mask){
+			const T* column = (c.*member).data() + begin;
+			switch (op){
+				case Op::Equal: filterColumn(column, count, value, mask, equal_to<T>()); break;
+				case Op::NotEqual: filterColumn(column, count, value, mask, not_equal_to<T>()); break;
+				case Op::Less: filterColumn(column, count, value, mask, less<T>()); break;
+				case Op::LessEqual: filterColumn(column, count, value, mask, less_equal<T>()); break;
+				case Op::Greater: filterColumn(column, count, value, mask, greater<T>()); break;
+				case Op::GreaterEqual: filterColumn(column, count, value, mask, greater_equal<T>()); break;
+			}
+		};
+	}
+	
+	template<typename T>
+	function<void(const NodeColumns&, size_t, size_t, uint8_t*)> memberKernel(vector<T> NodeColumns::* member, const vector<T>& values){
+		return [member, values](const NodeColumns& c, size_t begin, size_t count, uint8_t* mask){
+			const T* column = (c.*member).data() + begin;
+			for (size_t i = 0; i < count; i++){
+				uint8_t found = 0;
+				for (T v : values){
+					found |= column[i] == v;
+				}
+				mask[i] &= found;
+			}
+		};
+	}
+	
+	/**
+	 @return the comparison with its sides swapped, e.g. a > b becomes b < a
+	 */
+	Op mirrored(Op op){
+		switch (op){
+			case Op::Less: return Op::Greater;
+			case Op::LessEqual: return Op::GreaterEqual;
+			case Op::Greater: return Op::Less;
+			case Op::GreaterEqual: return Op::LessEqual;
+			default: return op;
+		}
+	}
+	
+	string lowercase(string s){
+		for (char& c : s){
+			if (c >= 'A' && c <= 'Z'){
+				c += 'a' - 'A';
+			}
+		}
+		return s;
+	}
+	
+	vector<string> splitList(const string& s){
+		vector<string> items;
+		size_t start = 0;
+		while (start <= s.size()){
+			size_t comma = s.find(',', start);
+			if (comma == string::npos){
+				comma = s.size();
+			}
+			if (comma > start){
+				items.push_back(s.substr(start, comma - start));
+			}
+			start = comma + 1;
+		}
+		return items;
+	}
+	
+	/**
+	 Parse a number followed by a unit
+	 @param text the value, such as 1.5G
+	 @param units the suffixes and their multipliers, the empty suffix included if a bare number is allowed
+	 @param limit the largest value allowed, in base units
+	 @return the value in base units, rounded down
+	 @throws invalid_argument if the value is not a number with a known unit, or is negative or above the limit
+	 */
+	int64_t parseQuantity(const string& text, const vector<pair<string, double>>& units, int64_t limit = numeric_limits<int64_t>::max()){
+		size_t end = 0;
+		double number;
+		try{
+			number = stod(text, &end);
+		}
+		catch(const exception&){
+			throw invalid_argument("expected a number in \"" + text + "\"");
+		}
+		const string unit = lowercase(text.substr(end));
+		for (const auto& u : units){
+			if (u.first == unit){
+				//nan fails both comparisons, and converting a double out of range of int64_t is undefined
+				const double scaled = number * u.second;
+				if (!(scaled >= 0 && scaled < (double)limit + 1)){
+					throw invalid_argument("\"" + text + "\" is out of range");
+				}
+				return (int64_t)scaled;
+			}
+		}
+		throw invalid_argument("unknown unit \"" + text.substr(end) + "\"");
+	}
+	
+	bool isSeparator(char c){
+		return c == '/' || c == '\\';
+	}
+	
+	void appendRow(NodeColumns& c, DirectoryData* node, uint32_t folder, uint16_t depth){
+		c.size.push_back(node->size);
+		c.allocated.push_back(node->allocated);
+		c.modified.push_back(node->meta.modified);
+		c.accessed.push_back(node->meta.accessed);
+		c.uid.push_back(node->meta.uid);
+		c.gid.push_back(node->meta.gid);
+		c.extension.push_back(node->extension);
+		c.category.push_back((uint8_t)node->category);
+		c.depth.push_back(depth);
+		c.isFolder.push_back(node->isFolder);
+		c.folder.push_back(folder);
+		size_t nameStart = node->Path.size();
+		while (nameStart > 0 && !isSeparator(node->Path[nameStart - 1])){
+			nameStart--;
+		}
+		c.names.append(node->Path, nameStart, string::npos);
+		c.nameStart.push_back(c.names.size());
+	}
+}
+
+/**
+ Copy the attributes of every sized item beneath a folder into columns
+ @param root the folder to copy. It is not included itself.
+ @param cancel stops the copy early when set
+ @return the columns. Folders still being sized are left out, and so are the files of huge folders that were only counted.
+ */
+shared_ptr<NodeColumns> NodeColumns::build(DirectoryData* root, const atomic<bool>& cancel){
+	auto c = make_shared<NodeColumns>();
+	epoch::Guard guard;
+	vector<pair<DirectoryData*, uint16_t>> stack{{root, 0}};
+	while (!stack.empty() && !cancel){
+		DirectoryData* current = stack.back().first;
+		const uint16_t depth = stack.back().second + 1;
+		stack.pop_back();
+		
+		const uint32_t folderIndex = (uint32_t)c->folders.size();
+		c->folders.push_back(current->Path);
+		if (c->folders.back().empty() || !isSeparator(c->folders.back().back())){
+			c->folders.back() += filesystem::path::preferred_separator;
+		}
+		const ChildList* list = current->children();
+		for (DirectoryData* sub : list->subFolders){
+			if (!sub->isComplete()){
+				continue;
+			}
+			appendRow(*c, sub, folderIndex, depth);
+			if (!sub->isSymlink){
+				stack.emplace_back(sub, depth);
+			}
+		}
+		for (DirectoryData* file : list->files){
+			//a summary row stands for the smaller files of a huge folder, it is not a file that can be matched
+			if (!file->isSummary){
+				appendRow(*c, file, folderIndex, depth);
+			}
+		}
+	}
+	return c;
+}
+
+/**
+ Compile a query
+ @param text the terms of the query, see the class description
+ @throws invalid_argument if the query cannot be parsed
+ */
+Query::Query(const string& text){
+	size_t start = 0;
+	while (start < text.size()){
+		size_t end = text.find_first_of(" \t", start);
+		if (end == string::npos){
+			end = text.size();
+		}
+		if (end > start){
+			parseTerm(text.substr(start, end - start));
+		}
+		start = end + 1;
+	}
+	if (!folders){
+		kernels.insert(kernels.begin(), compareKernel<uint8_t>(&NodeColumns::isFolder, Op::Equal, 0));
+	}
+}
+
+/**
+ Compile one term and add its kernel
+ @param term the term, such as size>1G
+ */
+void Query::parseTerm(const string& term){
+	//key:value terms
+	const size_t colon = term.find(':');
+	const size_t opStart = term.find_first_of("<>=!");
+	if (colon != string::npos && (opStart == string::npos || colon < opStart)){
+		const string key = lowercase(term.substr(0, colon));
+		const string value = term.substr(colon + 1);
+		if (value.empty()){
+			throw invalid_argument("missing value in \"" + term + "\"");
+		}
+		if (key == "ext"){
+			vector<uint32_t> ids;
+			for (string ext : splitList(lowercase(value))){
+				if (ext[0] == '.'){
+					ext.erase(0, 1);
+				}
+				ids.push_back(ExtensionTable::intern(ext));
+			}
+			kernels.push_back(memberKernel<uint32_t>(&NodeColumns::extension, ids));
+		}
+		else if (key == "type"){
+			vector<uint8_t> categories;
+			for (const string& name : splitList(lowercase(value))){
+				int found = -1;
+				for (size_t i = 0; i < (size_t)FileCategory::Count; i++){
+					string candidate = lowercase(categoryName((FileCategory)i));
+					candidate.erase(remove(candidate.begin(), candidate.end(), ' '), candidate.end());
+					if (candidate.find(name) != string::npos){
+						if (found != -1){
+							throw invalid_argument("\"" + name + "\" matches more than one type");
+						}
+						found = (int)i;
+					}
+				}
+				if (found == -1){
+					throw invalid_argument("unknown type \"" + name + "\"");
+				}
+				categories.push_back((uint8_t)found);
+			}
+			kernels.push_back(memberKernel<uint8_t>(&NodeColumns::category, categories));
+		}
+		else if (key == "under"){
+			string prefix = value;
+			while (!prefix.empty() && isSeparator(prefix.back())){
+				prefix.pop_back();
+			}
+			//decided once per folder rather than once per row, the first block to run fills the table
+			struct FolderTable{
+				mutex lock;
+				const NodeColumns* builtFor = nullptr;
+				vector<uint8_t> inside;
+			};
+			auto table = make_shared<FolderTable>();
+			kernels.push_back([prefix, table](const NodeColumns& c, size_t begin, size_t count, uint8_t* mask){
+				{
+					lock_guard<mutex> guard(table->lock);
+					if (table->builtFor != &c){
+						table->inside.assign(c.folders.size(), 0);
+						for (size_t f = 0; f < c.folders.size(); f++){
+							const string& path = c.folders[f];
+							table->inside[f] = path.size() > prefix.size() && path.compare(0, prefix.size(), prefix) == 0 && isSeparator(path[prefix.size()]);
+						}
+						table->builtFor = &c;
+					}
+				}
+				const uint8_t* inside = table->inside.data();
+				const uint32_t* folder = c.folder.data() + begin;
+				for (size_t i = 0; i < count; i++){
+					mask[i] &= inside[folder[i]];
+				}
+			});
+		}
+		else if (key == "name"){
+			auto pattern = make_shared<NamePattern>(value);
+			kernels.push_back([pattern](const NodeColumns& c, size_t begin, size_t count, uint8_t* mask){
+				for (size_t i = 0; i < count; i++){
+					if (mask[i]){
+						mask[i] = pattern->matches(c.name(begin + i));
+					}
+				}
+			});
+		}
+		else if (key == "kind"){
+			const string kind = lowercase(value);
+			folders = true;
+			if (kind == "folder" || kind == "dir"){
+				kernels.push_back(compareKernel<uint8_t>(&NodeColumns::isFolder, Op::Equal, 1));
+			}
+			else if (kind == "file"){
+				kernels.push_back(compareKernel<uint8_t>(&NodeColumns::isFolder, Op::Equal, 0));
+			}
+			else if (kind != "any"){
+				throw invalid_argument("kind must be file, folder or any");
+			}
+		}
+		else{
+			throw invalid_argument("unknown filter \"" + key + "\"");
+		}
+		return;
+	}
+	
+	//comparison terms
+	if (opStart == string::npos || opStart == 0){
+		throw invalid_argument("cannot understand \"" + term + "\"");
+	}
+	size_t opEnd = opStart;
+	while (opEnd < term.size() && strchr("<>=!", term[opEnd]) != nullptr){
+		opEnd++;
+	}
+	const string key = lowercase(term.substr(0, opStart));
+	const string opText = term.substr(opStart, opEnd - opStart);
+	const string value = term.substr(opEnd);
+	Op op;
+	if (opText == "=" || opText == "=="){
+		op = Op::Equal;
+	}
+	else if (opText == "!="){
+		op = Op::NotEqual;
+	}
+	else if (opText == "<"){
+		op = Op::Less;
+	}
+	else if (opText == "<="){
+		op = Op::LessEqual;
+	}
+	else if (opText == ">"){
+		op = Op::Greater;
+	}
+	else if (opText == ">="){
+		op = Op::GreaterEqual;
+	}
+	else{
+		throw invalid_argument("unknown comparison \"" + opText + "\"");
+	}
+	if (value.empty()){
+		throw invalid_argument("missing value in \"" + term + "\"");
+	}
+	
+	static const vector<pair<string, double>> sizeUnits = {
+		{"", 1}, {"b", 1},
+		{"k", 1e3}, {"kb", 1e3}, {"m", 1e6}, {"mb", 1e6}, {"g", 1e9}, {"gb", 1e9}, {"t", 1e12}, {"tb", 1e12},
+		{"kib", 1024.0}, {"mib", 1024.0 * 1024}, {"gib", 1024.0 * 1024 * 1024}, {"tib", 1024.0 * 1024 * 1024 * 1024}
+	};
+	static const vector<pair<string, double>> ageUnits = {
+		{"s", 1}, {"h", 3600}, {"d", 86400}, {"w", 7 * 86400}, {"y", 365.25 * 86400}
+	};
+	
+	if (key == "size"){
+		kernels.push_back(compareKernel<fileSize>(&NodeColumns::size, op, parseQuantity(value, sizeUnits)));
+	}
+	else if (key == "alloc"){
+		kernels.push_back(compareKernel<fileSize>(&NodeColumns::allocated, op, parseQuantity(value, sizeUnits)));
+	}
+	else if (key == "mtime" || key == "atime"){
+		//an age greater than N means a timestamp earlier than now - N
+		const int64_t timestamp = (int64_t)time(nullptr) - parseQuantity(value, ageUnits);
+		kernels.push_back(compareKernel<int64_t>(key == "mtime" ? &NodeColumns::modified : &NodeColumns::accessed, mirrored(op), timestamp));
+	}
+	else if (key == "uid" || key == "gid"){
+		const uint32_t id = (uint32_t)parseQuantity(value, {{"", 1}}, numeric_limits<uint32_t>::max());
+		kernels.push_back(compareKernel<uint32_t>(key == "uid" ? &NodeColumns::uid : &NodeColumns::gid, op, id));
+	}
+	else if (key == "depth"){
+		kernels.push_back(compareKernel<uint16_t>(&NodeColumns::depth, op, (uint16_t)parseQuantity(value, {{"", 1}}, numeric_limits<uint16_t>::max())));
+	}
+	else{
+		throw invalid_argument("unknown attribute \"" + key + "\"");
+	}
+}
+
+/**
+ Run the query over every row, in blocks spread across all cores
+ @param columns the rows to filter
+ @param limit the maximum number of rows to return. Totals always include every match.
+ @param cancel stops the query early when set
+ @return the totals and the largest matching rows
+ */
+QueryResult Query::run(const NodeColumns& columns, size_t limit, const atomic<bool>& cancel) const{
+	const size_t rows = columns.rows();
+	const size_t blocks = (rows + blockRows - 1) / blockRows;
+	vector<QueryResult> partial(blocks);
+	auto largerFirst = [&](uint32_t a, uint32_t b){
+		return columns.size[a] > columns.size[b];
+	};
+	
+	parallelFor(blocks, [&](size_t b){
+		if (cancel){
+			return;
+		}
+		const size_t begin = b * blockRows;
+		const size_t count = min(blockRows, rows - begin);
+		thread_local vector<uint8_t> mask;
+		mask.assign(count, 1);
+		for (const kernel& k : kernels){
+			k(columns, begin, count, mask.data());
+		}
+		
+		QueryResult& r = partial[b];
+		const fileSize* size = columns.size.data() + begin;
+		const fileSize* allocated = columns.allocated.data() + begin;
+		for (size_t i = 0; i < count; i++){
+			//branch-free totals
+			const fileSize keep = -(fileSize)mask[i];
+			r.count += mask[i];
+			r.bytes += size[i] & keep;
+			r.allocated += allocated[i] & keep;
+		}
+		for (size_t i = 0; i < count; i++){
+			if (mask[i]){
+				r.rows.push_back((uint32_t)(begin + i));
+			}
+		}
+		if (r.rows.size() > limit){
+			nth_element(r.rows.begin(), r.rows.begin() + limit, r.rows.end(), largerFirst);
+			r.rows.resize(limit);
+		}
+	});
+	
+	QueryResult result;
+	for (QueryResult& r : partial){
+		result.count += r.count;
+		result.bytes += r.bytes;
+		result.allocated += r.allocated;
+		result.rows.insert(result.rows.end(), r.rows.begin(), r.rows.end());
+	}
+	const size_t kept = min(limit, result.rows.size());
+	partial_sort(result.rows.begin(), result.rows.begin() + kept, result.rows.end(), largerFirst);
+	result.rows.resize(kept);
+	return result;
+}
+
+/**
+ @return true if the command line asks for a query instead of the window
+ */
+bool isQueryCommand(int argc, char** argv){
+	return argc >= 2 && strcmp(argv[1], "--query") == 0;
+}
+
+/**
+ Scan a folder and print the results of a query, for use from scripts:
+   FatFileFinder --query "size>1G mtime>180d" /srv [--limit N]
+ Prints the size in bytes and path of the largest matches, one per line, then a totals line starting with #.
+ @return the process exit code
+ */
+int queryCommand(int argc, char** argv){
+	if (argc < 4){
+		cerr << "usage: " << argv[0] << " --query \"<terms>\" <folder> [--limit N]" << endl;
+		return 2;
+	}
+	size_t limit = 100;
+	if (argc >= 6 && strcmp(argv[4], "--limit") == 0){
+		limit = strtoull(argv[5], nullptr, 10);
+	}
+	
+	unique_ptr<Query> query;
+	try{
+		query = make_unique<Query>(argv[2]);
+	}
+	catch(const invalid_argument& e){
+		cerr << "invalid query: " << e.what() << endl;
+		return 2;
+	}
+	
+	atomic<bool> abort{false};
+	DirectoryData* root = new DirectoryData(argv[3], true);
+	Scanner scanner(abort, [](const string& msg){
+		cerr << msg << endl;
+	});
+	scanner.summarizeAbove = Scanner::neverSummarize;
+	scanner.SizeItem(root, nullptr);
+	auto columns = NodeColumns::build(root, abort);
+	
+	QueryResult result = query->run(*columns, limit, abort);
+	for (uint32_t row : result.rows){
+		cout << columns->size[row] << '\t' << columns->path(row) << '\n';
+	}
+	cout << "# " << result.count << " items, " << result.bytes << " bytes, " << result.allocated << " bytes on disk" << endl;
+	delete root;
+	return 0;
+}
@@ -0,0 +1,89 @@
+//
+//  QueryEngine.hpp
+//
+//  Copyright © 2020 Ravbug. All rights reserved.
+//
+
+#pragma once
+#include "DirectoryData.hpp"
+#include <vector>
+#include <string>
+#include <memory>
+#include <functional>
+#include <atomic>
+
+/**
+ A column-per-attribute copy of a scanned tree, so filters read only the attributes
+ they test from contiguous arrays. Independent of the tree once built.
+ */
+struct NodeColumns{
+	vector<fileSize> size;
+	vector<fileSize> allocated;
+	vector<int64_t> modified;
+	vector<int64_t> accessed;
+	vector<uint32_t> uid;
+	vector<uint32_t> gid;
+	vector<uint32_t> extension;
+	vector<uint8_t> category;
+	vector<uint16_t> depth;
+	vector<uint8_t> isFolder;
+	//index into folders of the folder containing each row
+	vector<uint32_t> folder;
+	//names of the rows, back to back
+	vector<uint64_t> nameStart{0};
+	string names;
+	//paths of the folders, each ending in a separator
+	vector<string> folders;
+	
+	size_t rows() const{
+		return size.size();
+	}
+	string_view name(size_t row) const{
+		return string_view(names).substr(nameStart[row], nameStart[row + 1] - nameStart[row]);
+	}
+	string path(size_t row) const{
+		return folders[folder[row]] + string(name(row));
+	}
+	
+	static shared_ptr<NodeColumns> build(DirectoryData* root, const atomic<bool>& cancel);
+};
+
+/**
+ Totals and the largest matches of a query
+ */
+struct QueryResult{
+	uint64_t count = 0;
+	fileSize bytes = 0;
+	fileSize allocated = 0;
+	//matching rows, largest first, at most the requested limit
+	vector<uint32_t> rows;
+};
+
+/**
+ A filter over NodeColumns, compiled from space-separated terms that must all match:
+   size>1G  alloc<=4K        sizes with optional K, M, G, T (powers of 1000) or KiB, MiB, GiB, TiB
+   mtime>180d  atime<2w      time since modification or access, in s, h, d, w or y
+   uid=1001  gid!=0  depth<=3
+   ext:log,txt  type:video   extension without the dot, or a file category
+   under:/srv  name:core.*   path prefix, or a glob or substring of the name
+   kind:folder               files are matched by default
+ Comparisons are =, !=, <, <=, > and >=.
+ */
+class Query{
+public:
+	static constexpr size_t blockRows = 1 << 16;
+	
+	Query(const string& text);
+	QueryResult run(const NodeColumns&, size_t limit, const atomic<bool>& cancel) const;
+	
+private:
+	//clears mask entries of rows [begin, begin + count) that do not match
+	typedef function<void(const NodeColumns&, size_t begin, size_t count, uint8_t* mask)> kernel;
+	vector<kernel> kernels;
+	bool folders = false;
+	
+	void parseTerm(const string& term);
+};
+
+int queryCommand(int argc, char** argv);
+bool isQueryCommand(int argc, char** argv);
@@ -0,0 +1,144 @@
+//
+//  QueryFrame.cpp
+//
+//  Copyright © 2020 Ravbug. All rights reserved.
+//
+
+#include "QueryFrame.hpp"
+#include "FolderDisplay.hpp"
+#include "Epoch.hpp"
+#include <filesystem>
+#include <future>
+#include <chrono>
+
+/**
+ Construct a query window and copy the current tree
+ @param parent the main window
+ @param rootProvider returns the current root of the scanned tree. Called on the main thread on every refresh.
+ */
+QueryFrame::QueryFrame(wxWindow* parent, const std::function<DirectoryData*()>& rootProvider) : ReportFrame(parent, "Query"), rootProvider(rootProvider){
+	query = new wxTextCtrl(list->GetParent(), wxID_ANY, "", wxDefaultPosition, wxSize(320, -1), wxTE_PROCESS_ENTER);
+	query->SetHint("size>1G mtime>180d under:/srv uid=1001");
+	query->SetToolTip("Terms that must all match:\nsize, alloc: size>1G, alloc<=4K\nmtime, atime: mtime>180d (age in s, h, d, w, y)\nuid, gid, depth: uid=1001\next:log,txt  type:video  under:/srv  name:core.*  kind:folder");
+	controlSizer->Add(query, 0, wxALL, 5);
+	status = new wxStaticText(list->GetParent(), wxID_ANY, "");
+	controlSizer->Add(status, 1, wxALL|wxALIGN_CENTER_VERTICAL, 5);
+	query->Bind(wxEVT_TEXT_ENTER, [this](wxCommandEvent&){
+		RunQuery();
+	});
+	
+	list->AppendTextColumn("Name", wxDATAVIEW_CELL_INERT, 200, wxALIGN_LEFT, wxDATAVIEW_COL_RESIZABLE);
+	list->AppendTextColumn("Size", wxDATAVIEW_CELL_INERT, 90, wxALIGN_RIGHT);
+	list->AppendTextColumn("On Disk", wxDATAVIEW_CELL_INERT, 90, wxALIGN_RIGHT);
+	list->AppendTextColumn("Modified", wxDATAVIEW_CELL_INERT, 140, wxALIGN_LEFT, wxDATAVIEW_COL_RESIZABLE);
+	list->AppendTextColumn("Folder", wxDATAVIEW_CELL_INERT, -1, wxALIGN_LEFT, wxDATAVIEW_COL_RESIZABLE);
+	
+	Populate();
+}
+
+QueryFrame::~QueryFrame(){
+	Stop();
+}
+
+/**
+ Cancel the running job, if any, and wait for it to exit
+ */
+void QueryFrame::Stop(){
+	cancel = true;
+	if (worker.joinable()){
+		worker.join();
+	}
+	cancel = false;
+}
+
+/**
+ Copy the current tree into columns on a background thread, then run the current query
+ */
+void QueryFrame::Populate(){
+	Stop();
+	Clear();
+	columns = nullptr;
+	DirectoryData* root = rootProvider();
+	if (root == nullptr){
+		status->SetLabel("Open a folder to query it");
+		return;
+	}
+	status->SetLabel("Reading the scanned tree");
+	
+	//the tree may be replaced as soon as this function returns, so wait until the worker has pinned it
+	std::promise<void> pinned;
+	std::future<void> ready = pinned.get_future();
+	worker = std::thread([this, root, pinned = std::move(pinned)]() mutable {
+		std::shared_ptr<NodeColumns> copy;
+		{
+			epoch::Guard guard;
+			pinned.set_value();
+			copy = NodeColumns::build(root, cancel);
+		}
+		if (!cancel){
+			CallAfter([this, copy]{
+				columns = copy;
+				status->SetLabel(wxString::Format("%zu items", columns->rows()));
+				RunQuery();
+			});
+		}
+	});
+	ready.wait();
+}
+
+/**
+ Compile the query and run it on a background thread
+ */
+void QueryFrame::RunQuery(){
+	if (columns == nullptr){
+		return;
+	}
+	const std::string text = query->GetValue().ToStdString();
+	if (text.empty()){
+		return;
+	}
+	std::shared_ptr<Query> compiled;
+	try{
+		compiled = std::make_shared<Query>(text);
+	}
+	catch(const std::invalid_argument& e){
+		status->SetLabel(wxString("Invalid query: ") + e.what());
+		return;
+	}
+	Stop();
+	status->SetLabel("Running");
+	worker = std::thread([this, compiled, data = columns]{
+		auto start = std::chrono::steady_clock::now();
+		QueryResult result = compiled->run(*data, maxRows, cancel);
+		double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		if (!cancel){
+			CallAfter([this, data, result, elapsed]{
+				ShowResult(data, result, elapsed);
+			});
+		}
+	});
+}
+
+/**
+ Display the totals and largest matches of a query
+ @param data the columns the query ran over
+ @param result the result of the query
+ @param milliseconds how long the query took
+ */
+void QueryFrame::ShowResult(const std::shared_ptr<NodeColumns>& data, const QueryResult& result, double milliseconds){
+	Clear();
+	list->Freeze();
+	for (uint32_t row : result.rows){
+		const std::string path = data->path(row);
+		std::filesystem::path p(path);
+		wxVector<wxVariant> items;
+		items.push_back(p.filename().string());
+		items.push_back(FolderDisplay::sizeToString(data->size[row]));
+		items.push_back(FolderDisplay::sizeToString(data->allocated[row]));
+		items.push_back(timeToString(data->modified[row]));
+		items.push_back(p.parent_path().string());
+		AppendRow(items, path);
+	}
+	list->Thaw();
+	status->SetLabel(wxString::Format("%llu items, %s (%s on disk), in %.0f ms", (unsigned long long)result.count, FolderDisplay::sizeToString(result.bytes), FolderDisplay::sizeToString(result.allocated), milliseconds));
+}
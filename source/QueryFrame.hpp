@@ -0,0 +1,37 @@
+//
+//  QueryFrame.hpp
+//
+//  Copyright © 2020 Ravbug. All rights reserved.
+//
+
+#pragma once
+#include "ReportFrame.hpp"
+#include "QueryEngine.hpp"
+#include <functional>
+#include <thread>
+#include <atomic>
+
+/**
+ Runs queries such as "size>1G mtime>180d" over a columnar copy of the scanned tree
+ */
+class QueryFrame : public ReportFrame{
+public:
+	static constexpr size_t maxRows = 1000;
+	
+	QueryFrame(wxWindow* parent, const std::function<DirectoryData*()>& rootProvider);
+	~QueryFrame();
+	void Populate() override;
+	
+private:
+	std::function<DirectoryData*()> rootProvider;
+	wxTextCtrl* query;
+	wxStaticText* status;
+	std::thread worker;
+	std::atomic<bool> cancel{false};
+	//the copy of the tree being queried, replaced by Refresh
+	std::shared_ptr<NodeColumns> columns;
+	
+	void Stop();
+	void RunQuery();
+	void ShowResult(const std::shared_ptr<NodeColumns>&, const QueryResult&, double milliseconds);
+};
@@ -0,0 +1,85 @@
+//
+//  ReportFrame.cpp
+//
+//  Copyright © 2020 Ravbug. All rights reserved.
+//
+
+#include "ReportFrame.hpp"
+
+/**
+ Construct a report window
+ @param parent the main window, which receives reveal requests
+ @param title the window title
+ */
+ReportFrame::ReportFrame(wxWindow* parent, const wxString& title) : wxFrame(parent, wxID_ANY, title, wxDefaultPosition, wxSize(640,480)), eventManager(parent){
+	wxPanel* panel = new wxPanel(this);
+	wxBoxSizer* mainSizer = new wxBoxSizer(wxVERTICAL);
+	
+	controlSizer = new wxBoxSizer(wxHORIZONTAL);
+	wxButton* refreshBtn = new wxButton(panel, wxID_REFRESH, "Refresh");
+	controlSizer->Add(refreshBtn, 0, wxALL, 5);
+	mainSizer->Add(controlSizer, 0, wxEXPAND, 0);
+	
+	list = new wxDataViewListCtrl(panel, wxID_ANY, wxDefaultPosition, wxDefaultSize, wxDV_ROW_LINES);
+	mainSizer->Add(list, 1, wxALL|wxEXPAND, 5);
+	
+	panel->SetSizer(mainSizer);
+	
+	list->Bind(wxEVT_DATAVIEW_ITEM_ACTIVATED, &ReportFrame::OnActivated, this);
+	refreshBtn->Bind(wxEVT_BUTTON, &ReportFrame::OnRefresh, this);
+	
+#if defined _WIN32
+	SetBackgroundColour(wxSystemSettings::GetColour(wxSYS_COLOUR_WINDOW));
+#endif
+}
+
+/**
+ Remove all rows
+ */
+void ReportFrame::Clear(){
+	list->DeleteAllItems();
+	rowPaths.clear();
+}
+
+/**
+ Add a row to the list
+ @param items the values for each column
+ @param path the item to reveal when the row is activated, or an empty string if the row is not an item
+ */
+void ReportFrame::AppendRow(const wxVector<wxVariant>& items, const std::string& path){
+	rowPaths.push_back(path);
+	list->AppendItem(items);
+}
+
+/**
+ @return the path of the selected row, or an empty string if no item is selected
+ */
+std::string ReportFrame::SelectedPath() const{
+	int row = list->GetSelectedRow();
+	if (row < 0 || row >= (int)rowPaths.size()){
+		return "";
+	}
+	return rowPaths[row];
+}
+
+/**
+ Notify the main window to reveal an item
+ @param path the item to reveal
+ */
+void ReportFrame::Activate(const std::string& path){
+	wxCommandEvent* evt = new wxCommandEvent(progEvt, REVEALEVT);
+	evt->SetString(path);
+	eventManager->GetEventHandler()->QueueEvent(evt);
+}
+
+/**
+ Called when a row is double clicked or enter is pressed
+ @param event the event raised by the dataview
+ */
+void ReportFrame::OnActivated(wxDataViewEvent& event){
+	int row = list->ItemToRow(event.GetItem());
+	if (row < 0 || row >= (int)rowPaths.size() || rowPaths[row].empty()){
+		return;
+	}
+	Activate(rowPaths[row]);
+}
@@ -0,0 +1,45 @@
+//
+//  ReportFrame.hpp
+//
+//  Copyright © 2020 Ravbug. All rights reserved.
+//
+
+#pragma once
+#include "globals.h"
+#include <wx/dataview.h>
+#include <vector>
+#include <string>
+
+/**
+ A window showing a flat list of items from the scanned tree.
+ By default, activating a row asks the main window to reveal that item in its column.
+ Subclasses add their columns and controls, then fill the list in Populate().
+ */
+class ReportFrame : public wxFrame{
+public:
+	ReportFrame(wxWindow* parent, const wxString& title);
+	
+	/**
+	 Fill or refresh the list
+	 */
+	virtual void Populate() = 0;
+	
+protected:
+	wxBoxSizer* controlSizer;
+	wxDataViewListCtrl* list;
+	
+	void Clear();
+	void AppendRow(const wxVector<wxVariant>& items, const std::string& path);
+	std::string SelectedPath() const;
+	virtual void Activate(const std::string& path);
+	
+	wxWindow* eventManager;
+	
+private:
+	std::vector<std::string> rowPaths;
+	
+	void OnActivated(wxDataViewEvent&);
+	void OnRefresh(wxCommandEvent&){
+		Populate();
+	}
+};
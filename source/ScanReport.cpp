@@ -0,0 +1,306 @@
+//
+//  ScanReport.cpp
+//
+//  Copyright © 2020 Ravbug. All rights reserved.
+//
+
+#include "ScanReport.hpp"
+#include <algorithm>
+
+namespace{
+	//min-heap on size, so the smallest kept file is at the front
+	bool largerFirst(const RankedFile& a, const RankedFile& b){
+		return a.size > b.size;
+	}
+	//min-heap on time, so the fastest kept folder is at the front
+	bool slowerFirst(const FolderTiming& a, const FolderTiming& b){
+		return a.micros > b.micros;
+	}
+}
+
+/**
+ Offer a file to the ranking
+ @param path the full path of the file
+ @param size the size of the file
+ @param modified the modification time of the file
+ */
+void TopFiles::offer(const string& path, fileSize size, time_t modified){
+	if (!accepts(size)){
+		return;
+	}
+	if (heap.size() == capacity){
+		pop_heap(heap.begin(), heap.end(), largerFirst);
+		heap.pop_back();
+	}
+	heap.push_back(RankedFile{path, size, modified});
+	push_heap(heap.begin(), heap.end(), largerFirst);
+}
+
+/**
+ Add the contents of another ranking to this one
+ @param other the ranking to merge
+ */
+void TopFiles::merge(const TopFiles& other){
+	for (const RankedFile& f : other.heap){
+		offer(f.Path, f.size, f.modified);
+	}
+}
+
+/**
+ @return the kept files, largest first
+ */
+vector<RankedFile> TopFiles::sorted() const{
+	vector<RankedFile> result = heap;
+	sort(result.begin(), result.end(), largerFirst);
+	return result;
+}
+
+/**
+ Offer a folder to the ranking
+ @param timing the folder and the time it took to read
+ */
+void SlowFolders::offer(const FolderTiming& timing){
+	if (!accepts(timing.micros)){
+		return;
+	}
+	if (heap.size() == capacity){
+		pop_heap(heap.begin(), heap.end(), slowerFirst);
+		heap.pop_back();
+	}
+	heap.push_back(timing);
+	push_heap(heap.begin(), heap.end(), slowerFirst);
+}
+
+/**
+ Add the contents of another ranking to this one
+ @param other the ranking to merge
+ */
+void SlowFolders::merge(const SlowFolders& other){
+	for (const FolderTiming& f : other.heap){
+		offer(f);
+	}
+}
+
+/**
+ @return the kept folders, slowest first
+ */
+vector<FolderTiming> SlowFolders::sorted() const{
+	vector<FolderTiming> result = heap;
+	sort(result.begin(), result.end(), slowerFirst);
+	return result;
+}
+
+ScanReport::ScanReport() : cutoff(time(nullptr) - recentDays * 24 * 60 * 60){}
+
+/**
+ Record a file found by the scanner
+ @param l the accumulators of the calling worker
+ @param path the full path to the file
+ @param size the size of the file
+ @param modified the modification time of the file
+ */
+void ScanReport::addFile(Local& l, const string& path, fileSize size, time_t modified){
+	const bool isRecent = modified >= cutoff;
+	//reject small files without taking the lock; only this thread writes the heaps
+	if (!l.largest.accepts(size) && !(isRecent && l.recent.accepts(size))){
+		return;
+	}
+	lock_guard<mutex> guard(l.lock);
+	l.largest.offer(path, size, modified);
+	if (isRecent){
+		l.recent.offer(path, size, modified);
+	}
+}
+
+/**
+ @return the largest files found so far, largest first
+ */
+vector<RankedFile> ScanReport::largestFiles() const{
+	TopFiles merged(topCount);
+	forEachLocal([&](const Local& l){
+		merged.merge(l.largest);
+	});
+	return merged.sorted();
+}
+
+/**
+ @return the largest files modified within recentDays found so far, largest first
+ */
+vector<RankedFile> ScanReport::recentLargestFiles() const{
+	TopFiles merged(topCount);
+	forEachLocal([&](const Local& l){
+		merged.merge(l.recent);
+	});
+	return merged.sorted();
+}
+
+/**
+ Record the per-extension totals of one folder's files
+ @param l the accumulators of the calling worker
+ @param types totals for each extension found in the folder
+ */
+void ScanReport::addTypes(Local& l, const vector<TypeShare>& types){
+	if (types.empty()){
+		return;
+	}
+	lock_guard<mutex> guard(l.lock);
+	for (const TypeShare& t : types){
+		TypeTotals& totals = l.extensions[t.extension];
+		totals.bytes += t.bytes;
+		totals.count += t.count;
+	}
+}
+
+/**
+ @return bytes and file counts for each extension id found so far
+ */
+unordered_map<uint32_t, TypeTotals> ScanReport::extensionTotals() const{
+	unordered_map<uint32_t, TypeTotals> merged;
+	forEachLocal([&](const Local& l){
+		for (const auto& pair : l.extensions){
+			TypeTotals& totals = merged[pair.first];
+			totals.bytes += pair.second.bytes;
+			totals.count += pair.second.count;
+		}
+	});
+	return merged;
+}
+
+/**
+ @return bytes and file counts for each FileCategory found so far
+ */
+array<TypeTotals, (size_t)FileCategory::Count> ScanReport::categoryTotals() const{
+	array<TypeTotals, (size_t)FileCategory::Count> result{};
+	for (const auto& pair : extensionTotals()){
+		TypeTotals& totals = result[(size_t)ExtensionTable::category(pair.first)];
+		totals.bytes += pair.second.bytes;
+		totals.count += pair.second.count;
+	}
+	return result;
+}
+
+/**
+ Add the totals for a folder's files to each owner
+ @param l the accumulators of the calling worker
+ @param users the folder's totals by uid
+ @param groups the folder's totals by gid
+ */
+void ScanReport::addOwners(Local& l, const OwnerShares& users, const OwnerShares& groups){
+	if (users.empty() && groups.empty()){
+		return;
+	}
+	lock_guard<mutex> guard(l.lock);
+	for (const auto& share : users){
+		l.users[share.first].add(share.second);
+	}
+	for (const auto& share : groups){
+		l.groups[share.first].add(share.second);
+	}
+}
+
+/**
+ @param byGroup true to total by gid, false to total by uid
+ @return bytes and file counts for each owner found so far
+ */
+unordered_map<uint32_t, OwnerTotals> ScanReport::ownerTotals(bool byGroup) const{
+	unordered_map<uint32_t, OwnerTotals> merged;
+	forEachLocal([&](const Local& l){
+		for (const auto& pair : byGroup ? l.groups : l.users){
+			merged[pair.first].add(pair.second);
+		}
+	});
+	return merged;
+}
+
+/**
+ Record how long a folder took to read
+ @param l the accumulators of the calling worker
+ @param path the full path to the folder
+ @param micros the wall time spent reading the folder's entries
+ @param entries the number of entries in the folder
+ @param calls the directory reads and stat calls made
+ */
+void ScanReport::addTiming(Local& l, const string& path, uint64_t micros, uint64_t entries, uint64_t calls){
+	lock_guard<mutex> guard(l.lock);
+	l.timing.add(TimingTotals{1, micros, entries, calls});
+	//the path is only copied for folders slow enough to be ranked
+	if (l.slowest.accepts(micros)){
+		l.slowest.offer(FolderTiming{path, micros, entries, calls});
+	}
+}
+
+/**
+ @return the slowest folders to read found so far, slowest first
+ */
+vector<FolderTiming> ScanReport::slowestFolders() const{
+	SlowFolders merged(topCount);
+	forEachLocal([&](const Local& l){
+		merged.merge(l.slowest);
+	});
+	return merged.sorted();
+}
+
+/**
+ @return the time spent reading all the folders read so far
+ */
+TimingTotals ScanReport::timingTotals() const{
+	TimingTotals merged;
+	forEachLocal([&](const Local& l){
+		merged.add(l.timing);
+	});
+	return merged;
+}
+
+/**
+ Add a folder's items to the name index
+ @param l the accumulators of the calling worker
+ @param items the full path and size of each item, with a size of -1 for folders
+ */
+void ScanReport::addNames(Local& l, const vector<NameMatch>& items){
+	if (items.empty()){
+		return;
+	}
+	lock_guard<mutex> guard(l.lock);
+	for (const NameMatch& item : items){
+		l.names.add(item.Path, item.size);
+	}
+}
+
+/**
+ Search the names indexed so far. Safe to call while the scan is running.
+ @param pattern a glob if it contains * or ?, otherwise a substring. Case is ignored.
+ @param found called for each match, returns false to stop the search
+ @param cancel stops the search when set
+ */
+void ScanReport::findNames(const string& pattern, const function<bool(const NameMatch&)>& found, const atomic<bool>& cancel) const{
+	const NamePattern compiled(pattern);
+	vector<Local*> shards;
+	locals.forEach([&shards](Local& l){
+		shards.push_back(&l);
+	});
+	for (Local* l : shards){
+		vector<shared_ptr<const NameSegment>> segments;
+		vector<NameMatch> unsealed;
+		{
+			//the unsealed names are read under the worker's lock, so their matches are only copied out here,
+			//and passed on once the worker can add names again
+			lock_guard<mutex> guard(l->lock);
+			l->names.searchBuilder(compiled, [&unsealed](const NameMatch& match){
+				unsealed.push_back(match);
+				return true;
+			}, cancel);
+			segments = l->names.sealedSegments();
+		}
+		for (const NameMatch& match : unsealed){
+			if (cancel || !found(match)){
+				return;
+			}
+		}
+		//sealed segments are immutable, so they are searched without the lock
+		for (const auto& segment : segments){
+			if (!segment->search(compiled, found, cancel)){
+				return;
+			}
+		}
+	}
+}
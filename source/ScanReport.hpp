@@ -0,0 +1,179 @@
+//
+//  ScanReport.hpp
+//
+//  Copyright © 2020 Ravbug. All rights reserved.
+//
+
+#pragma once
+#include "globals.h"
+#include "DirectoryData.hpp"
+#include "FileTypes.hpp"
+#include "NameIndex.hpp"
+#include "Owners.hpp"
+#include "PerThread.hpp"
+#include <vector>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <ctime>
+
+using namespace std;
+
+/**
+ A file recorded in a whole-tree ranking
+ */
+struct RankedFile{
+	string Path;
+	fileSize size = 0;
+	time_t modified = 0;
+};
+
+/**
+ Bytes and file count for a group of files
+ */
+struct TypeTotals{
+	fileSize bytes = 0;
+	uint64_t count = 0;
+};
+
+/**
+ Keeps the largest N files offered to it using a bounded min-heap.
+ Offering a file costs O(1) when it is smaller than everything kept, O(log N) otherwise.
+ */
+class TopFiles{
+public:
+	TopFiles(size_t capacity) : capacity(capacity){}
+	
+	/**
+	 @return true if a file of this size would be kept
+	 */
+	bool accepts(fileSize size) const{
+		return heap.size() < capacity || size > heap.front().size;
+	}
+	void offer(const string& path, fileSize size, time_t modified);
+	void merge(const TopFiles&);
+	vector<RankedFile> sorted() const;
+	
+private:
+	size_t capacity;
+	vector<RankedFile> heap;
+};
+
+/**
+ The time spent reading one folder's own entries
+ */
+struct FolderTiming{
+	string Path;
+	uint64_t micros = 0;
+	uint64_t entries = 0;
+	//directory reads and stat calls made for the folder
+	uint64_t calls = 0;
+};
+
+/**
+ The time spent reading every folder of a scan
+ */
+struct TimingTotals{
+	uint64_t folders = 0;
+	uint64_t micros = 0;
+	uint64_t entries = 0;
+	uint64_t calls = 0;
+	
+	void add(const TimingTotals& other){
+		folders += other.folders;
+		micros += other.micros;
+		entries += other.entries;
+		calls += other.calls;
+	}
+};
+
+/**
+ Keeps the N slowest folders offered to it using a bounded min-heap, like TopFiles
+ */
+class SlowFolders{
+public:
+	SlowFolders(size_t capacity) : capacity(capacity){}
+	
+	/**
+	 @return true if a folder that took this long would be kept
+	 */
+	bool accepts(uint64_t micros) const{
+		return heap.size() < capacity || micros > heap.front().micros;
+	}
+	void offer(const FolderTiming&);
+	void merge(const SlowFolders&);
+	vector<FolderTiming> sorted() const;
+	
+private:
+	size_t capacity;
+	vector<FolderTiming> heap;
+};
+
+/**
+ Whole-tree statistics gathered while a scan runs. Each scan worker accumulates into
+ its own Local without contention; results merge all the Locals and can be read at any
+ time, including mid-scan.
+ */
+class ScanReport{
+public:
+	static constexpr size_t topCount = 100;
+	static constexpr int recentDays = 30;
+	
+	/**
+	 Per-worker accumulators. Only the owning worker writes; the lock is held briefly so readers can merge mid-scan.
+	 */
+	struct Local{
+		mutable mutex lock;
+		TopFiles largest{topCount};
+		TopFiles recent{topCount};
+		unordered_map<uint32_t, TypeTotals> extensions;
+		unordered_map<uint32_t, OwnerTotals> users;
+		unordered_map<uint32_t, OwnerTotals> groups;
+		NameShard names;
+		SlowFolders slowest{topCount};
+		TimingTotals timing;
+	};
+	
+	ScanReport();
+	
+	/**
+	 @return the accumulators for the calling thread, created on first use
+	 */
+	Local& local(){
+		return locals.local();
+	}
+	void addFile(Local&, const string& path, fileSize size, time_t modified);
+	void addTypes(Local&, const vector<TypeShare>&);
+	void addNames(Local&, const vector<NameMatch>&);
+	void addOwners(Local&, const OwnerShares& users, const OwnerShares& groups);
+	void addTiming(Local&, const string& path, uint64_t micros, uint64_t entries, uint64_t calls);
+	
+	vector<RankedFile> largestFiles() const;
+	vector<RankedFile> recentLargestFiles() const;
+	unordered_map<uint32_t, TypeTotals> extensionTotals() const;
+	array<TypeTotals, (size_t)FileCategory::Count> categoryTotals() const;
+	unordered_map<uint32_t, OwnerTotals> ownerTotals(bool byGroup) const;
+	vector<FolderTiming> slowestFolders() const;
+	TimingTotals timingTotals() const;
+	void findNames(const string& pattern, const function<bool(const NameMatch&)>& found, const atomic<bool>& cancel) const;
+	
+	/**
+	 @return the modification time after which a file counts as recent
+	 */
+	time_t recentCutoff() const{
+		return cutoff;
+	}
+	
+private:
+	const time_t cutoff;
+	PerThread<Local> locals;
+	
+	template<typename Fn>
+	void forEachLocal(Fn&& fn) const{
+		locals.forEach([&fn](const Local& l){
+			lock_guard<mutex> guard(l.lock);
+			fn(l);
+		});
+	}
+};
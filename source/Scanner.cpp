@@ -0,0 +1,616 @@
+//
+//  Scanner.cpp
+//
+//  Copyright © 2020 Ravbug. All rights reserved.
+//
+
+#include "Scanner.hpp"
+#include "Epoch.hpp"
+#include <filesystem>
+#include <algorithm>
+#include <chrono>
+
+using namespace std;
+using namespace std::filesystem;
+
+/**
+Calculate the size of a folder, including the size of subfolders. Sizes the folder in place.
+@param fd the DirectoryData to size
+@param progress the std::function to call with progress updates
+@note fd is always marked complete on return, even if sizing stopped early
+*/
+void Scanner::SizeItem(DirectoryData* fd, const progCallback& progress){
+	vector<TypeShare> types;
+	if (!open(fd, types)){
+		return;
+	}
+	
+	//the guard is only held while copying the list, so items retired elsewhere are not pinned for the whole scan.
+	//The subfolders themselves stay valid, since their tree is not retired while this scan writes to it.
+	vector<DirectoryData*> subFolders;
+	{
+		epoch::Guard guard;
+		subFolders = fd->children()->subFolders;
+	}
+	
+	//recursively size the folders in the folder
+	const size_t count = subFolders.size();
+	for (size_t i = 0; i < count; i++){
+		DirectoryData* sub = subFolders[i];
+		//folders kept from an earlier scan are already sized
+		if (!sub->isComplete()){
+			SizeItem(sub, nullptr);
+		}
+		addChild(fd, sub);
+		//the last child's progress is reported once this folder is complete
+		if (progress != nullptr && i + 1 < count) {
+			progress((float)(i + 1) / count, fd);
+		}
+	}
+	close(fd, types, progress);
+}
+
+/**
+ Size a folder as tasks of a job, one per subfolder. Returns once the first task is queued.
+ @param fd the DirectoryData to size
+ @param progress called with progress updates, from one worker at a time
+ @param job the job to post the tasks to. Join it before starting another job with this scanner.
+ @note fd is marked complete once the job has finished, even if it was cancelled
+ */
+void Scanner::SizeItem(DirectoryData* fd, const progCallback& progress, Job& job){
+	jobProgress = progress;
+	post(job, fd, nullptr);
+}
+
+/**
+ Read a folder's own contents, before its subfolders are sized
+ @param fd the folder
+ @param types receives the bytes and count of each extension among the folder's files
+ @return false if the folder was finished without reading it, in which case it is already marked complete
+ */
+bool Scanner::open(DirectoryData* fd, vector<TypeShare>& types){
+	//folders on network mounts are read on a thread the scan can abandon if the mount stops responding.
+	//Even checking the length of the path asks the filesystem, so that is done there too.
+	const VolumeInfo* mount = watchdog != nullptr ? watchdog->mountFor(fd->Path) : nullptr;
+	shared_ptr<FolderEntries> read;
+	if (abort || (mount == nullptr && path_too_long(fd->Path))) {
+		fd->markComplete();
+		return false;
+	}
+	if (mount != nullptr && !fd->isSymlink){
+		read = readGuarded(fd, *mount);
+		if (read == nullptr || read->tooLong){
+			fd->markComplete();
+			return false;
+		}
+	}
+	
+	//folders found by a parent were already stat'ed, roots and reloaded folders were not
+	if (!fd->meta.valid()){
+		if (read != nullptr){
+			applyMeta(fd, read->self);
+		}
+		else{
+			readMeta(fd);
+		}
+	}
+	
+	//skip symbolic links
+	if (fd->isSymlink){
+		fd->size = 1;
+		fd->isSymlink = true;
+		fd->markComplete();
+		return false;
+	}
+	
+	//calculate the size of the immediate files in the folder
+	try{
+		sizeImmediate(fd, types, read.get());
+	}
+	catch(const filesystem_error& e){
+		//notify user
+		fail(fd->Path, ScanStep::List, e.code().value(), "", e.what());
+		fd->markComplete();
+		return false;
+	}
+	return true;
+}
+
+/**
+ Add the totals of a sized subfolder to its parent
+ @param fd the parent, whose totals may be read by other threads meanwhile
+ @param sub the complete subfolder
+ */
+void Scanner::addChild(DirectoryData* fd, const DirectoryData* sub){
+	fd->num_items += sub->num_items + 1;
+	fd->size += sub->size;
+	fd->allocated += sub->allocated;
+}
+
+/**
+ Finish a folder once all of its subfolders are complete
+ @param fd the folder
+ @param types the extensions of the folder's own files
+ @param progress called once the folder is complete, or nullptr
+ */
+void Scanner::close(DirectoryData* fd, vector<TypeShare>& types, const progCallback& progress){
+	epoch::Guard guard;
+	const ChildList* list = fd->children();
+	for (const DirectoryData* sub : list->subFolders){
+		for (const TypeShare& share : sub->stats->topTypes){
+			addType(types, share);
+		}
+		fd->stats->newestModified = max(fd->stats->newestModified, sub->stats->newestModified);
+		fd->stats->modifiedAge.add(sub->stats->modifiedAge);
+		fd->stats->accessedAge.add(sub->stats->accessedAge);
+	}
+	//check for zero size
+	if (fd->size == 0){
+		fd->size = 1;
+	}
+	
+	//keep the largest extensions of the subtree
+	auto end = types.begin() + min(types.size(), FolderStats::topTypeCount);
+	partial_sort(types.begin(), end, types.end(), [](const TypeShare& a, const TypeShare& b){
+		return a.bytes > b.bytes;
+	});
+	copy(types.begin(), end, fd->stats->topTypes.begin());
+	
+	//every size beneath is final, so sort now while the list is still in this worker's cache
+	list->order(ChildOrder::Size);
+	
+	//publish before reporting 100%
+	fd->markComplete();
+	if (progress != nullptr){
+		progress(1, fd);
+	}
+}
+
+/**
+ Queue the task that reads a folder and queues its subfolders
+ @param job the job to add the task to
+ @param fd the folder
+ @param parent the parent's pending record, or nullptr for the root of the job
+ */
+void Scanner::post(Job& job, DirectoryData* fd, Pending* parent){
+	const size_t depth = parent != nullptr ? parent->depth + 1 : 0;
+	job.post(fd, [this, &job, fd, parent, depth]{
+		Pending* pending = new Pending(fd, parent, depth);
+		if (job.cancelled()){
+			fd->markComplete();
+		}
+		else{
+			pending->opened = open(fd, pending->types);
+		}
+		vector<DirectoryData*> unsized;
+		if (pending->opened){
+			epoch::Guard guard;
+			const ChildList* list = fd->children();
+			pending->count = list->subFolders.size();
+			fd->num_items += list->subFolders.size();
+			for (DirectoryData* sub : list->subFolders){
+				//folders kept from an earlier scan are already sized
+				if (sub->isComplete()){
+					fd->num_items += sub->num_items;
+					fd->size += sub->size;
+					fd->allocated += sub->allocated;
+					pending->sized++;
+				}
+				else{
+					unsized.push_back(sub);
+				}
+			}
+		}
+		//what the folder holds itself is final, so every folder above it counts it right away
+		grow(parent, fd->size, fd->allocated, fd->num_items);
+		pending->remaining += unsized.size();
+		for (DirectoryData* sub : unsized){
+			post(job, sub, pending);
+		}
+		release(job, pending);
+	}, depth < breadthDepth);
+}
+
+/**
+ Add to the totals of a pending folder and every folder above it in the job, which are lower bounds until they are complete
+ @param pending the innermost folder to add to, or nullptr
+ @param size bytes to add
+ @param allocated bytes on disk to add
+ @param items items to add
+ */
+void Scanner::grow(Pending* pending, fileSize size, fileSize allocated, unsigned long items){
+	for (Pending* p = pending; p != nullptr; p = p->parent){
+		p->folder->size += size;
+		p->folder->allocated += allocated;
+		p->folder->num_items += items;
+	}
+}
+
+/**
+ Drop one reference to a pending folder, finishing it and then its parent once nothing beneath it is left
+ @param job the job the folder belongs to
+ @param pending the folder
+ */
+void Scanner::release(Job& job, Pending* pending){
+	if (--pending->remaining > 0){
+		return;
+	}
+	DirectoryData* fd = pending->folder;
+	Pending* parent = pending->parent;
+	if (pending->opened){
+		//empty folders are given a size when they close, which the folders above need too
+		const fileSize before = fd->size;
+		close(fd, pending->types, nullptr);
+		grow(parent, fd->size - before, 0, 0);
+	}
+	delete pending;
+	
+	if (parent == nullptr){
+		reportProgress(1, fd);
+		return;
+	}
+	//the root reports progress as each of its subfolders completes, the last one is reported by the root itself
+	const size_t sized = ++parent->sized;
+	if (parent->parent == nullptr && sized < parent->count){
+		reportProgress((float)sized / parent->count, parent->folder);
+	}
+	release(job, parent);
+}
+
+/**
+ Pass progress of a job on, one worker at a time
+ @param progress the fraction done
+ @param fd the root of the job
+ */
+void Scanner::reportProgress(float progress, DirectoryData* fd){
+	lock_guard<mutex> guard(progressLock);
+	if (jobProgress != nullptr){
+		jobProgress(progress, fd);
+	}
+}
+
+/**
+ Record an error reading a folder
+ @param folder the folder being read
+ @param step what was being done
+ @param code the error code
+ @param item the name of the entry that failed, or an empty string if the folder itself failed
+ @param message the description of the error, only used when errors are logged one by one
+ */
+void Scanner::fail(const string& folder, ScanStep step, int code, const string& item, const string& message){
+	if (errors != nullptr){
+		errors->add(errors->local(), folder, step, code, item);
+	}
+	else if (step == ScanStep::List){
+		Log("Error sizing directory " + folder + "\n" + message);
+	}
+	else if (step == ScanStep::Status){
+		Log("Error sizing file " + (path(folder) / item).string() + "\n" + message);
+	}
+	else{
+		Log("Error sizing item in directory " + folder + "\n" + message);
+	}
+}
+
+/**
+ Stat an item and store its metadata
+ @param item the item to update
+ */
+void Scanner::readMeta(DirectoryData* item){
+	applyMeta(item, get_stat(item->Path));
+#if defined _WIN32
+	std::error_code ec;
+	item->isSymlink = is_symlink(item->Path, ec);
+#endif
+}
+
+/**
+ Store metadata that was already read
+ @param item the item to update
+ @param info the item's lstat record
+ */
+void Scanner::applyMeta(DirectoryData* item, const struct stat& info){
+	item->meta = FileMeta(info);
+#if defined _WIN32
+	item->meta.attributes = file_attributes(item->Path);
+#else
+	item->isSymlink = S_ISLNK(info.st_mode);
+#endif
+	if (item->isFolder){
+		item->allocated = item->meta.allocated(0);
+		item->stats->newestModified = item->meta.modified;
+	}
+}
+
+/**
+ Read a folder on a network mount on the watchdog's thread
+ @param fd the folder, marked timed out if the mount does not respond
+ @return the folder's entries, or nullptr if they could not be read in time or the scan was stopped
+ */
+shared_ptr<Scanner::FolderEntries> Scanner::readGuarded(DirectoryData* fd, const VolumeInfo& mount){
+	//once a call on a mount has timed out, the rest of it is skipped rather than abandoning a thread for each folder
+	if (watchdog->hung(mount)){
+		fd->timedOut = true;
+		return nullptr;
+	}
+	const string path = fd->Path;
+	const bool self = !fd->meta.valid();
+	const auto began = chrono::steady_clock::now();
+	uint64_t calls = 0;
+	shared_ptr<FolderEntries> read = watchdog->run<FolderEntries>(mount, [path, self](FolderEntries& out, atomic<uint64_t>& made){
+		readEntries(path, self, out, made);
+	}, abort, calls);
+	if (read != nullptr){
+		read->calls = calls;
+		return read;
+	}
+	if (!abort){
+		fd->timedOut = true;
+		Log("Timed out reading " + path + "\n" + mount.type + " mount " + mount.mountPoint + " did not respond for " + to_string(chrono::duration_cast<chrono::seconds>(watchdog->deadline).count()) + " seconds, the rest of it is skipped");
+		if (report != nullptr){
+			report->addTiming(report->local(), path, chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - began).count(), 0, calls);
+		}
+	}
+	return nullptr;
+}
+
+/**
+ Read a folder's entries and their records, without touching the tree. Runs on the watchdog's thread.
+ @param path the folder
+ @param self true to read the folder's own record too
+ @param out receives the entries
+ @param calls incremented after each call, so the watchdog can tell a slow folder from a hung one
+ */
+void Scanner::readEntries(const string& path, bool self, FolderEntries& out, atomic<uint64_t>& calls){
+	const auto began = chrono::steady_clock::now();
+	out.tooLong = path_too_long(path);
+	calls++;
+	if (out.tooLong){
+		return;
+	}
+	if (self){
+		out.self = get_stat(path);
+		calls++;
+#if !defined _WIN32
+		//symbolic links are not followed
+		if (S_ISLNK(out.self.st_mode)){
+			return;
+		}
+#endif
+	}
+	try{
+		for (auto& p : directory_iterator(path, directory_options::skip_permission_denied)){
+			calls++;
+			try{
+				file_status s = status(p.path());
+				calls++;
+				if (!can_access(s)){
+					continue;
+				}
+				FolderEntries::Item item{p.path().string(), is_directory(p)};
+				item.info = get_stat(item.path);
+				calls++;
+				out.items.push_back(std::move(item));
+			}
+			catch (const filesystem_error& e) {
+				out.failures.push_back(FolderEntries::Failure{ScanStep::Status, e.code().value(), p.path().filename().string(), e.what()});
+			}
+			catch (const system_error& e) {
+				out.failures.push_back(FolderEntries::Failure{ScanStep::Entry, e.code().value(), p.path().filename().string(), e.what()});
+			}
+		}
+	}
+	catch (const filesystem_error& e){
+		out.failure = make_unique<filesystem_error>(e);
+	}
+	out.micros = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - began).count();
+}
+
+/**
+ Merge extension totals into a list
+ @param types the list to add to
+ @param share the totals to add. Entries with a count of 0 are ignored.
+ */
+void Scanner::addType(vector<TypeShare>& types, const TypeShare& share){
+	if (share.count == 0){
+		return;
+	}
+	//folders rarely contain more than a handful of extensions, so a linear search is fastest
+	for (TypeShare& t : types){
+		if (t.extension == share.extension){
+			t.bytes += share.bytes;
+			t.count += share.count;
+			return;
+		}
+	}
+	types.push_back(share);
+}
+
+/**
+ Calculate the size of the immediate files in the folder, and publish its contents
+ @param data the FolderData struct to calculate
+ @param types receives the bytes and count of each extension among the folder's files
+ */
+void Scanner::sizeImmediate(DirectoryData* data, vector<TypeShare>& types, const FolderEntries* read){
+	//timed for the slowest folders report. The clock is read twice per folder, which is cheap next to the stat calls.
+	const auto began = chrono::steady_clock::now();
+	uint64_t entries = 0;
+	//opening the folder
+	uint64_t calls = 1;
+	//entries read on the watchdog's thread were timed there
+	auto elapsed = [&]{
+		const uint64_t micros = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - began).count();
+		return read != nullptr ? read->micros + micros : micros;
+	};
+	ChildList* list = new ChildList;
+	fileSize total = 0;
+	fileSize allocated = 0;
+	time_t newest = 0;
+	ScanReport::Local* stats = report != nullptr ? &report->local() : nullptr;
+	vector<NameMatch> names;
+	OwnerShares users, groups;
+	
+	//once a folder is huge, list->files is a min-heap of the largest files and the rest are only counted
+	bool huge = false;
+	auto smallerFirst = [](const DirectoryData* a, const DirectoryData* b){
+		return a->size > b->size;
+	};
+	DirectoryData* summary = nullptr;
+	auto summarize = [&](fileSize size, fileSize onDisk, time_t modified){
+		if (summary == nullptr){
+			summary = new DirectoryData(data->Path, false);
+			summary->isSummary = true;
+			summary->parent = data;
+			summary->markComplete();
+		}
+		summary->size += size;
+		summary->allocated += onDisk;
+		summary->num_items++;
+		summary->meta.modified = max(summary->meta.modified, modified);
+	};
+	//the summary is named once its count is known, and listed after the files
+	auto finishList = [&]{
+		uint64_t fileCount = list->files.size();
+		if (summary != nullptr){
+			summary->Path += (char)path::preferred_separator + to_string(summary->num_items) + " smaller items";
+			fileCount += summary->num_items;
+			list->files.push_back(summary);
+		}
+		data->num_items = fileCount;
+	};
+	//adds one readable entry of the folder. info is its lstat record, or nullptr to stat it here.
+	auto addItem = [&](const string& str, bool folder, const struct stat* info){
+		//is the item a folder? if so, defer sizing it
+		if (folder) {
+			DirectoryData* sub = reuse != nullptr ? reuse(str) : nullptr;
+			if (sub == nullptr){
+				sub = new DirectoryData(str, true);
+				if (info != nullptr){
+					applyMeta(sub, *info);
+				}
+				else{
+					readMeta(sub);
+					calls++;
+				}
+				sub->parent = data;
+			}
+			if (stats != nullptr){
+				names.push_back(NameMatch{str, -1});
+			}
+			list->subFolders.push_back(sub);
+			return;
+		}
+		//size the file, add its details to the structure
+		struct stat own;
+		if (info == nullptr){
+			own = get_stat(str);
+			calls++;
+			info = &own;
+		}
+		const FileMeta meta(*info);
+		const fileSize size = info->st_size;
+		const fileSize onDisk = meta.allocated(size);
+		const uint32_t extension = ExtensionTable::intern(extensionView(str));
+		addType(types, TypeShare{extension, 1, size});
+		total += size;
+		allocated += onDisk;
+		newest = max(newest, meta.modified);
+		data->stats->modifiedAge.add(size, meta.modified, started);
+		data->stats->accessedAge.add(size, meta.accessed, started);
+		if (stats != nullptr){
+			report->addFile(*stats, str, size, meta.modified);
+			names.push_back(NameMatch{str, size});
+			const OwnerTotals owned{size, onDisk, 1};
+			addOwner(users, meta.uid, owned);
+			addOwner(groups, meta.gid, owned);
+		}
+		
+		//small files of a huge folder are only counted, without allocating an item
+		if (huge && size <= list->files.front()->size){
+			summarize(size, onDisk, meta.modified);
+			return;
+		}
+		DirectoryData* file = new DirectoryData(str, *info);
+#if defined _WIN32
+		file->meta.attributes = file_attributes(str);
+#endif
+		file->extension = extension;
+		file->category = categoryForExtension(extensionView(str));
+		file->parent = data;
+		list->files.push_back(file);
+		
+		if (!huge && list->files.size() > summarizeAbove && data != expand){
+			huge = true;
+			make_heap(list->files.begin(), list->files.end(), smallerFirst);
+		}
+		//keep the largest files, moving the smallest one into the summary
+		while (huge && list->files.size() > keptFiles){
+			pop_heap(list->files.begin(), list->files.end(), smallerFirst);
+			DirectoryData* smallest = list->files.back();
+			list->files.pop_back();
+			summarize(smallest->size, smallest->allocated, smallest->meta.modified);
+			delete smallest;
+		}
+	};
+	try{
+		if (read != nullptr){
+			//the entries were read on the watchdog's thread, only their records are added here
+			entries = read->items.size();
+			calls = read->calls;
+			for (const FolderEntries::Item& item : read->items){
+				addItem(item.path, item.folder, &item.info);
+			}
+			for (const FolderEntries::Failure& failure : read->failures){
+				fail(data->Path, failure.step, failure.code, failure.item, failure.message);
+			}
+			if (read->failure != nullptr){
+				throw *read->failure;
+			}
+		}
+		else{
+			// iterate through the items in the folder
+			for(auto& p : directory_iterator(data->Path,directory_options::skip_permission_denied)){
+				//reading the entry, and the status call below
+				entries++;
+				calls += 2;
+				//check if can read the file
+				try {
+					file_status s = status(p.path());
+					if (can_access(s)){
+						addItem(p.path().string(), is_directory(p), nullptr);
+					}
+				}
+				catch (const filesystem_error& e) {
+					fail(data->Path, ScanStep::Status, e.code().value(), p.path().filename().string(), e.what());
+				}
+				catch (const system_error& e) {
+					fail(data->Path, ScanStep::Entry, e.code().value(), p.path().filename().string(), e.what());
+				}
+			}
+		}
+	}
+	catch(const filesystem_error& e){
+		//publish what was read so the items are owned by the tree
+		finishList();
+		data->size += total;
+		data->allocated += allocated;
+		data->publish(list);
+		//folders that fail slowly, such as unresponsive mounts, are ranked too
+		if (stats != nullptr){
+			report->addTiming(*stats, data->Path, elapsed(), entries, calls);
+		}
+		throw;
+	}
+	finishList();
+	data->size += total;
+	data->allocated += allocated;
+	data->stats->newestModified = max(data->stats->newestModified, newest);
+	//the pointers in the list never change after this point
+	data->publish(list);
+	if (stats != nullptr){
+		report->addTiming(*stats, data->Path, elapsed(), entries, calls);
+		report->addTypes(*stats, types);
+		report->addNames(*stats, names);
+		report->addOwners(*stats, users, groups);
+	}
+}
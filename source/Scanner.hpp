@@ -0,0 +1,137 @@
+//
+//  Scanner.hpp
+//
+//  Copyright © 2020 Ravbug. All rights reserved.
+//
+
+#pragma once
+#include "DirectoryData.hpp"
+#include "ScanReport.hpp"
+#include "JobManager.hpp"
+#include "Watchdog.hpp"
+#include "ErrorCollector.hpp"
+#include <functional>
+#include <atomic>
+#include <mutex>
+
+//callback definitions
+typedef function<void(float progress, DirectoryData* data)> progCallback;
+typedef function<void(const string& msg)> logCallback;
+
+/**
+ Walks the filesystem and fills in DirectoryData trees.
+ Each folder's contents are published as an immutable ChildList as soon as they are read,
+ and the folder is marked complete once its whole subtree is sized, so other threads can
+ browse finished subtrees while the scan continues. A tree is sized either on the calling
+ thread, or as a Job whose tasks each read one folder, so the shared workers size many folders at once.
+ */
+class Scanner{
+public:
+	/**
+	 @param abortFlag set to true to stop the scan early
+	 @param logger called with error messages
+	 */
+	Scanner(const atomic<bool>& abortFlag, const logCallback& logger) : abort(abortFlag), Log(logger){}
+	
+	//a folder with more files than this keeps only its largest files as items, the rest are summed into one summary row
+	static constexpr size_t hugeFolderFiles = 10000;
+	static constexpr size_t keptFiles = 1000;
+	static constexpr size_t neverSummarize = SIZE_MAX;
+	
+	void SizeItem(DirectoryData*, const progCallback&);
+	void SizeItem(DirectoryData*, const progCallback&, Job&);
+	static void addType(vector<TypeShare>&, const TypeShare&);
+	
+	//whole-tree statistics for this scan, or nullptr to skip collecting them
+	shared_ptr<ScanReport> report;
+	//returns an already sized folder to keep in place of the folder at a path, or nullptr to size it.
+	//Used to rescan a folder without rescanning the subfolders that did not change. A reused folder still
+	//belongs to the old tree, and keeps its parent, until the caller swaps the new tree in.
+	function<DirectoryData*(const string& path)> reuse;
+	//a folder that keeps all of its files as items, however many there are
+	DirectoryData* expand = nullptr;
+	//folders with more files than this are summarized. Scans whose trees are written out or queried rather than
+	//browsed pass neverSummarize, since a summary row is not a file.
+	size_t summarizeAbove = hugeFolderFiles;
+	//folders less deep than this below the root of a job are read breadth first, the rest depth first.
+	//Reading the top of the tree first gives every folder near the root a size that only grows from then on.
+	size_t breadthDepth = 0;
+	//reads folders on network mounts with a deadline, or nullptr to read every folder directly
+	shared_ptr<MountWatchdog> watchdog = make_shared<MountWatchdog>();
+	//receives the errors of reading folders, or nullptr to pass each one to the logger as a message
+	shared_ptr<ErrorCollector> errors;
+	
+private:
+	const atomic<bool>& abort;
+	logCallback Log;
+	//ages are measured from the start of the scan, so they do not drift while it runs
+	const time_t started = time(nullptr);
+	
+	//reports progress of the job being sized, from whichever worker finished the folder
+	progCallback jobProgress;
+	mutex progressLock;
+	
+	/**
+	 A folder of a job whose subfolders are still being sized
+	 */
+	struct Pending{
+		DirectoryData* folder;
+		Pending* parent;
+		//levels below the root of the job
+		size_t depth;
+		vector<TypeShare> types;
+		//false if the folder was finished without reading it
+		bool opened = false;
+		//subfolders still being sized, plus one until the folder's own task has posted them all
+		atomic<size_t> remaining{1};
+		//for progress of the root, the subfolders that are done
+		atomic<size_t> sized{0};
+		size_t count = 0;
+		
+		Pending(DirectoryData* folder, Pending* parent, size_t depth) : folder(folder), parent(parent), depth(depth){}
+	};
+	
+	/**
+	 A folder's entries, read on the watchdog's thread
+	 */
+	struct FolderEntries{
+		struct Item{
+			string path;
+			bool folder;
+			//the entry's lstat record
+			struct stat info{};
+		};
+		//the folder's own record, if it was asked for
+		struct stat self{};
+		bool tooLong = false;
+		vector<Item> items;
+		/**
+		 An entry that could not be read
+		 */
+		struct Failure{
+			ScanStep step;
+			int code;
+			string item;
+			string message;
+		};
+		vector<Failure> failures;
+		//set if the folder could not be listed completely
+		unique_ptr<std::filesystem::filesystem_error> failure;
+		uint64_t micros = 0;
+		uint64_t calls = 0;
+	};
+	
+	bool open(DirectoryData*, vector<TypeShare>&);
+	void close(DirectoryData*, vector<TypeShare>&, const progCallback&);
+	static void addChild(DirectoryData*, const DirectoryData*);
+	static void grow(Pending*, fileSize, fileSize, unsigned long);
+	void post(Job&, DirectoryData*, Pending*);
+	void release(Job&, Pending*);
+	void reportProgress(float, DirectoryData*);
+	void fail(const string& folder, ScanStep, int code, const string& item, const string& message);
+	void sizeImmediate(DirectoryData*, vector<TypeShare>&, const FolderEntries*);
+	shared_ptr<FolderEntries> readGuarded(DirectoryData*, const VolumeInfo&);
+	static void readEntries(const string& path, bool self, FolderEntries&, atomic<uint64_t>& calls);
+	static void readMeta(DirectoryData*);
+	static void applyMeta(DirectoryData*, const struct stat&);
+};
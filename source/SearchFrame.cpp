@@ -0,0 +1,110 @@
+//
+//  SearchFrame.cpp
+//
+//  Copyright © 2020 Ravbug. All rights reserved.
+//
+
+#include "SearchFrame.hpp"
+#include "FolderDisplay.hpp"
+#include <filesystem>
+
+/**
+ Construct a name search window
+ @param parent the main window
+ @param report the scan whose names are searched. May still be running.
+ */
+SearchFrame::SearchFrame(wxWindow* parent, const std::shared_ptr<ScanReport>& report) : ReportFrame(parent, "Find by Name"), report(report){
+	query = new wxTextCtrl(list->GetParent(), wxID_ANY, "", wxDefaultPosition, wxSize(240, -1), wxTE_PROCESS_ENTER);
+	query->SetHint("Name, or a pattern like *.hprof");
+	controlSizer->Add(query, 0, wxALL, 5);
+	status = new wxStaticText(list->GetParent(), wxID_ANY, "");
+	controlSizer->Add(status, 1, wxALL|wxALIGN_CENTER_VERTICAL, 5);
+	//searches are fast enough to run on every keystroke
+	query->Bind(wxEVT_TEXT, [this](wxCommandEvent&){
+		Populate();
+	});
+	
+	list->AppendTextColumn("Name", wxDATAVIEW_CELL_INERT, 200, wxALIGN_LEFT, wxDATAVIEW_COL_RESIZABLE);
+	list->AppendTextColumn("Size", wxDATAVIEW_CELL_INERT, 90, wxALIGN_RIGHT);
+	list->AppendTextColumn("Folder", wxDATAVIEW_CELL_INERT, -1, wxALIGN_LEFT, wxDATAVIEW_COL_RESIZABLE);
+}
+
+SearchFrame::~SearchFrame(){
+	Stop();
+}
+
+/**
+ Cancel the running search, if any, and wait for it to exit
+ */
+void SearchFrame::Stop(){
+	cancel = true;
+	if (worker.joinable()){
+		worker.join();
+	}
+	cancel = false;
+}
+
+/**
+ Start a search for the current query, replacing any search in progress
+ */
+void SearchFrame::Populate(){
+	Stop();
+	Clear();
+	shown = 0;
+	const std::string pattern = query->GetValue().ToStdString();
+	if (report == nullptr || pattern.empty()){
+		status->SetLabel("");
+		return;
+	}
+	status->SetLabel("Searching");
+	
+	const unsigned int current = ++generation;
+	worker = std::thread([this, pattern, current]{
+		std::vector<NameMatch> batch;
+		size_t total = 0;
+		report->findNames(pattern, [&](const NameMatch& match){
+			batch.push_back(match);
+			if (batch.size() == batchSize){
+				CallAfter([this, current, batch]{
+					ShowBatch(current, batch, false);
+				});
+				batch.clear();
+			}
+			return ++total < maxResults;
+		}, cancel);
+		if (!cancel){
+			CallAfter([this, current, batch]{
+				ShowBatch(current, batch, true);
+			});
+		}
+	});
+}
+
+/**
+ Append results to the list
+ @param searchGeneration the search the results belong to
+ @param batch the results
+ @param finished true if this is the last batch of the search
+ */
+void SearchFrame::ShowBatch(unsigned int searchGeneration, const std::vector<NameMatch>& batch, bool finished){
+	if (searchGeneration != generation){
+		return;
+	}
+	list->Freeze();
+	for (const NameMatch& m : batch){
+		std::filesystem::path p(m.Path);
+		wxVector<wxVariant> items;
+		items.push_back(p.filename().string());
+		items.push_back(m.size < 0 ? "" : FolderDisplay::sizeToString(m.size));
+		items.push_back(p.parent_path().string());
+		AppendRow(items, m.Path);
+	}
+	list->Thaw();
+	shown += batch.size();
+	if (finished){
+		status->SetLabel(shown >= maxResults ? wxString::Format("Showing the first %zu items", shown) : wxString::Format("%zu items", shown));
+	}
+	else{
+		status->SetLabel(wxString::Format("Searching, %zu items so far", shown));
+	}
+}
@@ -0,0 +1,38 @@
+//
+//  SearchFrame.hpp
+//
+//  Copyright © 2020 Ravbug. All rights reserved.
+//
+
+#pragma once
+#include "ReportFrame.hpp"
+#include "ScanReport.hpp"
+#include <memory>
+#include <thread>
+#include <atomic>
+
+/**
+ Finds items in the scanned tree by name using the scan's name index, while the scan runs
+ */
+class SearchFrame : public ReportFrame{
+public:
+	static constexpr size_t maxResults = 10000;
+	static constexpr size_t batchSize = 256;
+	
+	SearchFrame(wxWindow* parent, const std::shared_ptr<ScanReport>& report);
+	~SearchFrame();
+	void Populate() override;
+	
+private:
+	std::shared_ptr<ScanReport> report;
+	wxTextCtrl* query;
+	wxStaticText* status;
+	std::thread worker;
+	std::atomic<bool> cancel{false};
+	//incremented for every search, so batches from a cancelled search are dropped
+	unsigned int generation = 0;
+	size_t shown = 0;
+	
+	void Stop();
+	void ShowBatch(unsigned int generation, const std::vector<NameMatch>& batch, bool finished);
+};
@@ -0,0 +1,381 @@
+//
+//  SizeEstimator.cpp
+//
+//  Copyright © 2020 Ravbug. All rights reserved.
+//
+
+#include "SizeEstimator.hpp"
+#include "Scanner.hpp"
+#include "Epoch.hpp"
+#include <algorithm>
+#include <unordered_map>
+#include <iostream>
+#include <cstring>
+#include <cmath>
+
+using namespace std;
+using namespace std::filesystem;
+
+/**
+ Tighten an estimate with what a full scan of the same folder has found so far
+ @param scanned the folder in the scanned tree, or nullptr if the scan has not reached it
+ */
+void SizeEstimate::bound(const DirectoryData* scanned){
+	if (scanned == nullptr){
+		return;
+	}
+	const fileSize counted = scanned->measured();
+	if (scanned->isComplete()){
+		low = expected = high = counted;
+		unbounded = false;
+		exact = true;
+		return;
+	}
+	//folders being scanned only grow, so what was found so far is a lower bound
+	low = max(low, counted);
+	expected = max(expected, low);
+	high = max(high, low);
+}
+
+/**
+ Start estimating. The levels near the root are read by one task, then walks run until the time is up.
+ @param job the job to run on. Cancel it to stop early.
+ @param budget how long to keep walking, counted from now
+ @param walkers the number of walks to run at once
+ */
+void SizeEstimator::run(Job& job, chrono::steady_clock::duration budget, size_t walkers){
+	const auto deadline = chrono::steady_clock::now() + budget;
+	job.post(nullptr, [this, &job, deadline, walkers]{
+		mt19937_64 random(random_device{}());
+		root = enumerate(rootPath, 0, random, job.cancelFlag());
+		enumerated.store(true, memory_order_release);
+		if (frontier.empty()){
+			return;
+		}
+		for (size_t i = 0; i < walkers; i++){
+			job.post(nullptr, [this, &job, deadline, i]{
+				mt19937_64 random(random_device{}() + i);
+				//each walker takes the next folder in turn, so every folder gets a similar number of walks
+				while (!job.cancelled() && chrono::steady_clock::now() < deadline){
+					walk(frontier[nextFrontier++ % frontier.size()], random, job.cancelFlag());
+				}
+			});
+		}
+	});
+}
+
+/**
+ Read the completely read levels of the tree
+ @param path the folder to read
+ @param level the depth of the folder, 0 for the root
+ @param random picks walks into subfolders, unused while reading completely
+ @param abort stops waiting on an unresponsive mount when set
+ @return the folder's node
+ */
+unique_ptr<SizeEstimator::Node> SizeEstimator::enumerate(const string& path, size_t level, mt19937_64& random, const atomic<bool>& abort){
+	auto node = make_unique<Node>();
+	node->path = path;
+	Listing listing = list(path, true, random, abort);
+	node->size = listing.size;
+	node->allocated = listing.allocated;
+	if (level + 1 < enumeratedLevels){
+		for (const string& sub : listing.subFolders){
+			node->subFolders.push_back(enumerate(sub, level + 1, random, abort));
+		}
+	}
+	else if (!listing.subFolders.empty()){
+		node->below = std::move(listing);
+		frontier.push_back(node.get());
+	}
+	return node;
+}
+
+/**
+ Take one random walk from a folder of the last completely read level down to a leaf
+ @param node the folder, whose subfolders the walk starts from
+ @param random picks the folder entered at each level
+ @param abort stops waiting on an unresponsive mount when set
+ */
+void SizeEstimator::walk(Node* node, mt19937_64& random, const atomic<bool>& abort){
+	//each folder found stands for all the folders that could have been picked instead of it
+	double scale = 1;
+	double size = 0;
+	double allocated = 0;
+	string path = pick(node->below, random, scale);
+	for (size_t depth = 0; depth < maxProbeDepth && !path.empty(); depth++){
+		Listing listing = list(path, false, random, abort);
+		size += scale * listing.size;
+		allocated += scale * listing.allocated;
+		path = pick(listing, random, scale);
+	}
+	{
+		lock_guard<mutex> guard(node->lock);
+		node->sizeWalks.add(size);
+		node->allocatedWalks.add(allocated);
+	}
+	probeCount.fetch_add(1, memory_order_relaxed);
+}
+
+/**
+ Choose the subfolder a walk enters
+ @param listing the folder the walk is in
+ @param random the source of the choice
+ @param scale multiplied by the inverse of the chance of the subfolder picked
+ @return the subfolder, or an empty string if the folder has none
+ */
+string SizeEstimator::pick(const Listing& listing, mt19937_64& random, double& scale){
+	if (listing.subFolders.empty()){
+		return "";
+	}
+	discrete_distribution<size_t> choose(listing.chances.begin(), listing.chances.end());
+	const size_t i = choose(random);
+	scale /= listing.chances[i];
+	return listing.subFolders[i];
+}
+
+/**
+ Read a folder's entries. Folders on network mounts are read on the watchdog's thread, so an unresponsive
+ mount cannot hold a pool worker, and the job waiting on it, forever.
+ @param path the folder
+ @param everyFile true to stat every file, false to stat a random sample and scale it by the number of files
+ @param random picks the sample
+ @param abort stops waiting on an unresponsive mount when set
+ @return the size of the folder's own files and the chances of walking into each subfolder. A folder on a
+ hung mount, or one whose read was abandoned, counts as empty.
+ */
+SizeEstimator::Listing SizeEstimator::list(const string& path, bool everyFile, mt19937_64& random, const atomic<bool>& abort) const{
+	const VolumeInfo* mount = watchdog != nullptr ? watchdog->mountFor(path) : nullptr;
+	if (mount == nullptr){
+		atomic<uint64_t> calls{0};
+		return read(path, everyFile, random, calls);
+	}
+	//once a mount has timed out, the walks skip it rather than abandoning a thread for each folder
+	if (watchdog->hung(*mount)){
+		return Listing();
+	}
+	//the generator stays with the caller, the read samples with one seeded from it
+	const uint64_t seed = random();
+	uint64_t calls = 0;
+	shared_ptr<Listing> listing = watchdog->run<Listing>(*mount, [path, everyFile, seed](Listing& out, atomic<uint64_t>& made){
+		mt19937_64 sample(seed);
+		out = read(path, everyFile, sample, made);
+	}, abort, calls);
+	return listing != nullptr ? std::move(*listing) : Listing();
+}
+
+/**
+ Read a folder's entries on the calling thread
+ @param path the folder
+ @param everyFile true to stat every file, false to stat a random sample and scale it by the number of files
+ @param random picks the sample
+ @param calls incremented after each call, so the watchdog can tell a slow folder from a hung one
+ @return the size of the folder's own files and the chances of walking into each subfolder
+ */
+SizeEstimator::Listing SizeEstimator::read(const string& path, bool everyFile, mt19937_64& random, atomic<uint64_t>& calls){
+	Listing listing;
+	//folders are counted by the blocks they use, like the scanner does
+	listing.allocated = FileMeta(get_stat(path)).allocated(0);
+	calls++;
+	vector<string> files;
+	size_t fileCount = 0;
+	error_code ec;
+	for (directory_iterator it(path, directory_options::skip_permission_denied, ec), end; !ec && it != end; it.increment(ec)){
+		calls++;
+		//the type is read from the folder itself on most systems, so this does not stat
+		error_code typeError;
+		if (it->is_directory(typeError) && !it->is_symlink(typeError)){
+			listing.subFolders.push_back(it->path().string());
+			continue;
+		}
+		fileCount++;
+		if (everyFile || files.size() < sampledFiles){
+			files.push_back(it->path().string());
+		}
+		else{
+			//keep a uniform sample of the files seen so far
+			const size_t slot = uniform_int_distribution<size_t>(0, fileCount - 1)(random);
+			if (slot < sampledFiles){
+				files[slot] = it->path().string();
+			}
+		}
+	}
+	fileSize size = 0;
+	fileSize allocated = 0;
+	for (const string& file : files){
+		const struct stat info = get_stat(file);
+		calls++;
+		size += info.st_size;
+		allocated += FileMeta(info).allocated(info.st_size);
+	}
+	if (!files.empty()){
+		const double scale = (double)fileCount / files.size();
+		listing.size = size * scale;
+		listing.allocated += allocated * scale;
+	}
+
+	const size_t count = listing.subFolders.size();
+	listing.chances.assign(count, 1.0 / max<size_t>(count, 1));
+	if (count < 2 || count > weightedSubfolders){
+		return listing;
+	}
+	//a folder's link count is 2 plus its subfolders on most Unix filesystems, so bushier folders are entered more often.
+	//Filesystems that do not count links that way, and Windows, report 1 and keep equal chances.
+	vector<double> weights(count);
+	double sum = 0;
+	for (size_t i = 0; i < count; i++){
+		const struct stat info = get_stat(listing.subFolders[i]);
+		calls++;
+		if (info.st_nlink < 2){
+			return listing;
+		}
+		weights[i] = info.st_nlink - 1;
+		sum += weights[i];
+	}
+	for (size_t i = 0; i < count; i++){
+		listing.chances[i] = weights[i] / sum;
+	}
+	return listing;
+}
+
+/**
+ Combine what was counted and walked beneath a node
+ @param node the folder
+ @return the estimate of its size, in the current size mode
+ */
+SizeEstimate SizeEstimator::estimate(const Node* node) const{
+	const bool onDisk = DirectoryData::sizeMode == SizeMode::Allocated;
+	double expected = 0;
+	double counted = 0;
+	double variance = 0;
+	SizeEstimate result;
+	result.exact = true;
+	//walks of different folders are independent, so their variances add
+	auto add = [&](const Node* n, auto& addChildren) -> void{
+		const fileSize own = onDisk ? n->allocated : n->size;
+		expected += own;
+		counted += own;
+		if (!n->below.subFolders.empty()){
+			lock_guard<mutex> guard(n->lock);
+			const Moments& walks = onDisk ? n->allocatedWalks : n->sizeWalks;
+			result.exact = false;
+			result.probes += walks.count;
+			expected += walks.mean;
+			if (walks.count > 1){
+				variance += walks.varianceOfMean();
+			}
+			else{
+				result.unbounded = true;
+			}
+		}
+		for (const auto& sub : n->subFolders){
+			addChildren(sub.get(), addChildren);
+		}
+	};
+	add(node, add);
+
+	const double margin = 1.96 * sqrt(variance);
+	result.expected = expected;
+	result.low = max(counted, expected - margin);
+	result.high = result.unbounded ? result.expected : expected + margin;
+	return result;
+}
+
+/**
+ @return the estimated sizes of the root's subfolders, or nothing until the top levels have been read
+ */
+vector<pair<string, SizeEstimate>> SizeEstimator::folders() const{
+	vector<pair<string, SizeEstimate>> rows;
+	if (!ready()){
+		return rows;
+	}
+	for (const auto& sub : root->subFolders){
+		rows.emplace_back(sub->path, estimate(sub.get()));
+	}
+	return rows;
+}
+
+/**
+ @return the estimated size of the whole tree, 0 until the top levels have been read
+ */
+SizeEstimate SizeEstimator::total() const{
+	return ready() ? estimate(root.get()) : SizeEstimate();
+}
+
+/**
+ @return true if the arguments ask for the estimate command
+ */
+bool isEstimateCommand(int argc, char** argv){
+	return argc >= 2 && strcmp(argv[1], "--estimate") == 0;
+}
+
+/**
+ Estimate the sizes of the folders in a folder within a time limit, while a full scan runs alongside:
+   FatFileFinder --estimate /srv [--seconds N]
+ Prints the estimate, the 95% interval and the path of each subfolder, largest first, then a totals line
+ starting with #. Folders the full scan finished in time are printed exactly.
+ @return the process exit code
+ */
+int estimateCommand(int argc, char** argv){
+	if (argc < 3){
+		cerr << "usage: " << argv[0] << " --estimate <folder> [--seconds N]" << endl;
+		return 2;
+	}
+	double seconds = 10;
+	if (argc >= 5 && strcmp(argv[3], "--seconds") == 0){
+		seconds = strtod(argv[4], nullptr);
+	}
+	const auto budget = chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(seconds));
+
+	atomic<bool> abort{false};
+	DirectoryData* root = new DirectoryData(argv[2], true);
+	Scanner scanner(abort, [](const string& msg){
+		cerr << msg << endl;
+	});
+	scanner.breadthDepth = SizeEstimator::enumeratedLevels;
+	shared_ptr<Job> scan = JobManager::shared().submit(JobManager::scanPriority);
+	scanner.SizeItem(root, nullptr, *scan);
+
+	SizeEstimator estimator(root->Path);
+	estimator.watchdog = scanner.watchdog;
+	shared_ptr<Job> sampling = JobManager::shared().submit(JobManager::reloadPriority);
+	estimator.run(*sampling, budget, max(1u, thread::hardware_concurrency() / 2));
+	sampling->join();
+
+	vector<pair<string, SizeEstimate>> rows = estimator.folders();
+	SizeEstimate total = estimator.total();
+	{
+		epoch::Guard guard;
+		unordered_map<string, const DirectoryData*> scanned;
+		for (const DirectoryData* sub : root->children()->subFolders){
+			scanned[sub->Path] = sub;
+		}
+		for (auto& row : rows){
+			auto found = scanned.find(row.first);
+			row.second.bound(found != scanned.end() ? found->second : nullptr);
+		}
+		total.bound(root);
+	}
+	sort(rows.begin(), rows.end(), [](const pair<string, SizeEstimate>& a, const pair<string, SizeEstimate>& b){
+		return a.second.expected > b.second.expected;
+	});
+	auto print = [](const SizeEstimate& e, const string& path){
+		cout << e.expected << '\t' << e.low << '\t';
+		if (e.unbounded){
+			cout << '?';
+		}
+		else{
+			cout << e.high;
+		}
+		cout << '\t' << (e.exact ? "exact" : to_string(e.probes) + " walks") << '\t' << path << '\n';
+	};
+	for (const auto& row : rows){
+		print(row.second, row.first);
+	}
+	cout << "# ";
+	print(total, root->Path);
+
+	scan->cancel();
+	scan->join();
+	delete root;
+	return 0;
+}
@@ -0,0 +1,151 @@
+//
+//  SizeEstimator.hpp
+//
+//  Copyright © 2020 Ravbug. All rights reserved.
+//
+
+#pragma once
+#include "DirectoryData.hpp"
+#include "JobManager.hpp"
+#include "Watchdog.hpp"
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <random>
+
+using namespace std;
+
+/**
+ The size of a folder with a 95% confidence interval
+ */
+struct SizeEstimate{
+	fileSize low = 0;
+	fileSize expected = 0;
+	fileSize high = 0;
+	//true while too few samples were taken to bound the size from above
+	bool unbounded = false;
+	//true if the size was counted rather than estimated
+	bool exact = false;
+	//random walks the estimate is based on
+	size_t probes = 0;
+
+	void bound(const DirectoryData*);
+};
+
+/**
+ Estimates the sizes of the folders in a tree within a time limit, for finding the folder that is filling a
+ disk without waiting for a full scan. The top levels are read completely. Below them, random walks from
+ each folder to a leaf (Knuth's estimator) read one folder per level, multiply what they find by how many
+ folders could have been picked at each level, and stat only a sample of the files of large folders,
+ scaling by the number of entries. Folders with more subfolders, according to their link counts, are
+ walked into more often, which keeps the estimates of deep trees steadier.
+
+ Estimates are unbiased but spread widely when a few folders hold most of the space, so each is reported
+ with an interval from the spread of its walks, assuming it is roughly normal.
+ */
+class SizeEstimator{
+public:
+	//levels read completely, counting the root
+	static constexpr size_t enumeratedLevels = 2;
+	//files stat'ed in each folder a walk passes through
+	static constexpr size_t sampledFiles = 64;
+	//folders with more subfolders than this are walked into with equal chances, instead of stat'ing every one
+	static constexpr size_t weightedSubfolders = 1000;
+	static constexpr size_t maxProbeDepth = 64;
+
+	SizeEstimator(const string& rootPath) : rootPath(rootPath){}
+	SizeEstimator(const SizeEstimator&) = delete;
+	SizeEstimator& operator=(const SizeEstimator&) = delete;
+
+	void run(Job&, chrono::steady_clock::duration budget, size_t walkers);
+	vector<pair<string, SizeEstimate>> folders() const;
+	SizeEstimate total() const;
+
+	/**
+	 @return the number of random walks taken so far
+	 */
+	size_t probes() const{
+		return probeCount.load(memory_order_relaxed);
+	}
+	/**
+	 @return true once the root and the levels below it have been read, so estimates are available
+	 */
+	bool ready() const{
+		return enumerated.load(memory_order_acquire);
+	}
+
+	const string rootPath;
+	//skips unresponsive network mounts. Share the scanner's, so a mount either finds hung is skipped by both.
+	shared_ptr<MountWatchdog> watchdog = make_shared<MountWatchdog>();
+
+private:
+	/**
+	 Mean and variance of a stream of samples, updated one sample at a time (Welford's method)
+	 */
+	struct Moments{
+		size_t count = 0;
+		double mean = 0;
+		double squares = 0;
+
+		void add(double sample){
+			count++;
+			const double delta = sample - mean;
+			mean += delta / count;
+			squares += delta * (sample - mean);
+		}
+		/**
+		 @return the variance of the mean of the samples
+		 @pre count > 1
+		 */
+		double varianceOfMean() const{
+			return squares / (count - 1) / count;
+		}
+	};
+
+	/**
+	 The contents of one folder, read completely or from a sample of its files
+	 */
+	struct Listing{
+		fileSize size = 0;
+		fileSize allocated = 0;
+		vector<string> subFolders;
+		//chances of walking into each subfolder, summing to 1
+		vector<double> chances;
+	};
+
+	/**
+	 A folder in the completely read levels
+	 */
+	struct Node{
+		string path;
+		//the folder's own files, counted exactly
+		fileSize size = 0;
+		fileSize allocated = 0;
+		vector<unique_ptr<Node>> subFolders;
+		//in the last completely read level, the subfolders walks start from
+		Listing below;
+		mutable mutex lock;
+		Moments sizeWalks;
+		Moments allocatedWalks;
+	};
+
+	unique_ptr<Node> root;
+	//the nodes of the last completely read level, whose subfolders are walked
+	vector<Node*> frontier;
+	atomic<bool> enumerated{false};
+	atomic<size_t> probeCount{0};
+	atomic<size_t> nextFrontier{0};
+
+	unique_ptr<Node> enumerate(const string& path, size_t level, mt19937_64&, const atomic<bool>& abort);
+	void walk(Node*, mt19937_64&, const atomic<bool>& abort);
+	SizeEstimate estimate(const Node*) const;
+	Listing list(const string& path, bool everyFile, mt19937_64&, const atomic<bool>& abort) const;
+	static Listing read(const string& path, bool everyFile, mt19937_64&, atomic<uint64_t>& calls);
+	static string pick(const Listing&, mt19937_64&, double& scale);
+};
+
+bool isEstimateCommand(int argc, char** argv);
+int estimateCommand(int argc, char** argv);
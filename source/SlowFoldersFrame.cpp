@@ -0,0 +1,68 @@
+//
+//  SlowFoldersFrame.cpp
+//
+//  Copyright © 2020 Ravbug. All rights reserved.
+//
+
+#include "SlowFoldersFrame.hpp"
+
+/**
+ Construct a ranked list of the slowest folders
+ @param parent the main window
+ @param report the scan to read the timings from. May still be running.
+ */
+SlowFoldersFrame::SlowFoldersFrame(wxWindow* parent, const std::shared_ptr<ScanReport>& report) : ReportFrame(parent, "Slowest Folders"), report(report){
+	status = new wxStaticText(list->GetParent(), wxID_ANY, "", wxDefaultPosition, wxDefaultSize, wxST_ELLIPSIZE_END);
+	controlSizer->Add(status, 1, wxALL|wxALIGN_CENTER_VERTICAL, 5);
+	
+	list->AppendTextColumn("#", wxDATAVIEW_CELL_INERT, 40, wxALIGN_RIGHT);
+	list->AppendTextColumn("Time", wxDATAVIEW_CELL_INERT, 80, wxALIGN_RIGHT);
+	list->AppendTextColumn("Entries", wxDATAVIEW_CELL_INERT, 80, wxALIGN_RIGHT);
+	list->AppendTextColumn("Calls", wxDATAVIEW_CELL_INERT, 80, wxALIGN_RIGHT);
+	list->AppendTextColumn("Per Entry", wxDATAVIEW_CELL_INERT, 80, wxALIGN_RIGHT);
+	list->AppendTextColumn("Folder", wxDATAVIEW_CELL_INERT, -1, wxALIGN_LEFT, wxDATAVIEW_COL_RESIZABLE);
+	
+	Populate();
+}
+
+/**
+ Read the current ranking from the scan and display it
+ */
+void SlowFoldersFrame::Populate(){
+	Clear();
+	if (report == nullptr){
+		status->SetLabel("Open a folder to time its folders");
+		return;
+	}
+	const TimingTotals totals = report->timingTotals();
+	status->SetLabel(wxString::Format("%llu folders read in %s, %llu entries, %llu calls", (unsigned long long)totals.folders, timeToString(totals.micros), (unsigned long long)totals.entries, (unsigned long long)totals.calls));
+	
+	list->Freeze();
+	int rank = 1;
+	for (const FolderTiming& f : report->slowestFolders()){
+		wxVector<wxVariant> items;
+		items.push_back(std::to_string(rank++));
+		items.push_back(timeToString(f.micros));
+		items.push_back(std::to_string(f.entries));
+		items.push_back(std::to_string(f.calls));
+		items.push_back(f.entries > 0 ? timeToString(f.micros / f.entries) : wxString());
+		items.push_back(f.Path);
+		AppendRow(items, f.Path);
+	}
+	list->Thaw();
+}
+
+/**
+ Formats a duration
+ @param micros the duration in microseconds
+ @return the duration in the largest unit that keeps it above 1
+ */
+wxString SlowFoldersFrame::timeToString(uint64_t micros){
+	if (micros >= 1000000){
+		return wxString::Format("%.2f s", micros / 1e6);
+	}
+	if (micros >= 1000){
+		return wxString::Format("%.1f ms", micros / 1e3);
+	}
+	return wxString::Format("%llu µs", (unsigned long long)micros);
+}
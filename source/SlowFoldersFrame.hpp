@@ -0,0 +1,25 @@
+//
+//  SlowFoldersFrame.hpp
+//
+//  Copyright © 2020 Ravbug. All rights reserved.
+//
+
+#pragma once
+#include "ReportFrame.hpp"
+#include "ScanReport.hpp"
+#include <memory>
+
+/**
+ Shows the folders that took longest to read as a ranked list, to find slow mounts and pathological folders
+ */
+class SlowFoldersFrame : public ReportFrame{
+public:
+	SlowFoldersFrame(wxWindow* parent, const std::shared_ptr<ScanReport>& report);
+	void Populate() override;
+	
+	static wxString timeToString(uint64_t micros);
+	
+private:
+	std::shared_ptr<ScanReport> report;
+	wxStaticText* status;
+};
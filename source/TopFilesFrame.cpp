@@ -0,0 +1,56 @@
+//
+//  TopFilesFrame.cpp
+//
+//  Copyright © 2020 Ravbug. All rights reserved.
+//
+
+#include "TopFilesFrame.hpp"
+#include "FolderDisplay.hpp"
+#include <filesystem>
+
+/**
+ Construct a ranked list of the largest files
+ @param parent the main window
+ @param report the scan to read the rankings from. May still be running.
+ */
+TopFilesFrame::TopFilesFrame(wxWindow* parent, const std::shared_ptr<ScanReport>& report) : ReportFrame(parent, "Largest Files"), report(report){
+	wxString modes[] = {"All files", wxString::Format("Modified in the last %d days", ScanReport::recentDays)};
+	modeChoice = new wxChoice(list->GetParent(), wxID_ANY, wxDefaultPosition, wxDefaultSize, 2, modes);
+	modeChoice->SetSelection(0);
+	controlSizer->Add(modeChoice, 0, wxALL, 5);
+	modeChoice->Bind(wxEVT_CHOICE, [this](wxCommandEvent&){
+		Populate();
+	});
+	
+	list->AppendTextColumn("#", wxDATAVIEW_CELL_INERT, 40, wxALIGN_RIGHT);
+	list->AppendTextColumn("File Name", wxDATAVIEW_CELL_INERT, 200, wxALIGN_LEFT, wxDATAVIEW_COL_RESIZABLE);
+	list->AppendTextColumn("File Size", wxDATAVIEW_CELL_INERT, 90, wxALIGN_RIGHT);
+	list->AppendTextColumn("Modified", wxDATAVIEW_CELL_INERT, 140, wxALIGN_LEFT, wxDATAVIEW_COL_RESIZABLE);
+	list->AppendTextColumn("Folder", wxDATAVIEW_CELL_INERT, -1, wxALIGN_LEFT, wxDATAVIEW_COL_RESIZABLE);
+	
+	Populate();
+}
+
+/**
+ Read the current ranking from the scan and display it
+ */
+void TopFilesFrame::Populate(){
+	Clear();
+	if (report == nullptr){
+		return;
+	}
+	auto files = modeChoice->GetSelection() == 0 ? report->largestFiles() : report->recentLargestFiles();
+	list->Freeze();
+	int rank = 1;
+	for (const RankedFile& f : files){
+		std::filesystem::path p(f.Path);
+		wxVector<wxVariant> items;
+		items.push_back(std::to_string(rank++));
+		items.push_back(p.filename().string());
+		items.push_back(FolderDisplay::sizeToString(f.size));
+		items.push_back(timeToString(f.modified));
+		items.push_back(p.parent_path().string());
+		AppendRow(items, f.Path);
+	}
+	list->Thaw();
+}
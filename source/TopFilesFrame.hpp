@@ -0,0 +1,23 @@
+//
+//  TopFilesFrame.hpp
+//
+//  Copyright © 2020 Ravbug. All rights reserved.
+//
+
+#pragma once
+#include "ReportFrame.hpp"
+#include "ScanReport.hpp"
+#include <memory>
+
+/**
+ Shows the largest files of the whole scanned tree as a ranked list
+ */
+class TopFilesFrame : public ReportFrame{
+public:
+	TopFilesFrame(wxWindow* parent, const std::shared_ptr<ScanReport>& report);
+	void Populate() override;
+	
+private:
+	std::shared_ptr<ScanReport> report;
+	wxChoice* modeChoice;
+};
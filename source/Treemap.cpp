@@ -0,0 +1,397 @@
+//
+//  Treemap.cpp
+//
+//  Copyright © 2020 Ravbug. All rights reserved.
+//
+
+#include "Treemap.hpp"
+#include "Epoch.hpp"
+#include <queue>
+#include <cmath>
+#include <limits>
+#include <filesystem>
+using namespace std;
+
+namespace{
+#if defined _WIN32
+	const char* separators = "\\/";
+#else
+	const char* separators = "/";
+#endif
+	
+	/**
+	 @param path a full path
+	 @return the last component of the path
+	 */
+	string_view leafName(const string& path){
+		const size_t slash = path.find_last_of(separators);
+		return slash == string::npos ? string_view(path) : string_view(path).substr(slash + 1);
+	}
+	
+	struct Colour{
+		uint8_t r, g, b;
+	};
+	
+	//indexed by FileCategory
+	const Colour palette[] = {
+		{120, 140, 160},	//Other
+		{150, 150, 150},	//NoExtension
+		{210, 80, 70},		//Program
+		{150, 90, 200},		//DiskImage
+		{90, 180, 90},		//Image
+		{220, 200, 70},		//Audio
+		{235, 140, 50},		//Video
+		{160, 110, 70},		//Archive
+		{80, 130, 220},		//Document
+		{60, 180, 180},		//Code
+	};
+	static_assert(sizeof(palette) / sizeof(palette[0]) == (size_t)FileCategory::Count, "every category needs a colour");
+	const Colour background{40, 40, 40};
+	const Colour folderBase{70, 70, 70};
+	
+	/**
+	 @return a coordinate in tile pixels, clamped so it fits in an int
+	 */
+	int toPixel(double position, int size){
+		return (int)max(-1.0, min((double)size + 1, floor(position + 0.5)));
+	}
+	
+	/**
+	 Fill a rectangle of a tile
+	 @param rgb the tile's pixels
+	 @param size the width and height of the tile
+	 @param x0 @param y0 @param x1 @param y1 the rectangle in tile pixels, may extend past the tile
+	 @param c the colour
+	 @param cushion true to shade the rectangle from light at the top left to dark at the bottom right, with a dark edge
+	 */
+	void fill(uint8_t* rgb, int size, double x0, double y0, double x1, double y1, Colour c, bool cushion){
+		const int px0 = toPixel(x0, size), px1 = toPixel(x1, size), py0 = toPixel(y0, size), py1 = toPixel(y1, size);
+		const int left = max(px0, 0), right = min(px1, size), top = max(py0, 0), bottom = min(py1, size);
+		//shading uses the unclipped rectangle so that it lines up across tiles
+		const double width = x1 - x0, height = y1 - y0;
+		const bool edges = cushion && width >= 4 && height >= 4;
+		for (int y = top; y < bottom; y++){
+			uint8_t* px = rgb + ((size_t)y * size + left) * 3;
+			const double v = cushion ? (y + 0.5 - y0) / height : 0;
+			for (int x = left; x < right; x++, px += 3){
+				double f = 1;
+				if (cushion){
+					f = 1.15 - 0.35 * ((x + 0.5 - x0) / width + v);
+					if (edges && (x == px1 - 1 || y == py1 - 1)){
+						f = 0.5;
+					}
+				}
+				px[0] = (uint8_t)min(255.0, c.r * f);
+				px[1] = (uint8_t)min(255.0, c.g * f);
+				px[2] = (uint8_t)min(255.0, c.b * f);
+			}
+		}
+	}
+}
+
+/**
+ Lay out items as rectangles with aspect ratios close to 1 (Bruls, Huizing and van Wijk).
+ The items fill the bounds exactly, in rows along the shorter side.
+ @param sizes the item sizes, largest first
+ @param count the number of items
+ @param bounds the area to fill
+ @param out receives count rectangles, in the same order as sizes. Empty items get empty rectangles.
+ */
+void squarify(const fileSize* sizes, size_t count, const TreemapRect& bounds, TreemapRect* out){
+	long double total = 0;
+	size_t nonEmpty = 0;
+	for (size_t i = 0; i < count; i++){
+		if (sizes[i] > 0){
+			total += sizes[i];
+			nonEmpty = i + 1;
+		}
+	}
+	for (size_t i = nonEmpty; i < count; i++){
+		out[i] = TreemapRect{bounds.x, bounds.y, 0, 0};
+	}
+	if (nonEmpty == 0 || bounds.w <= 0 || bounds.h <= 0){
+		for (size_t i = 0; i < nonEmpty; i++){
+			out[i] = TreemapRect{bounds.x, bounds.y, 0, 0};
+		}
+		return;
+	}
+	const double perByte = (double)(bounds.w * bounds.h / total);
+	TreemapRect free = bounds;
+	size_t start = 0;
+	while (start < nonEmpty){
+		const double side = min(free.w, free.h);
+		if (side <= 0){
+			for (size_t i = start; i < nonEmpty; i++){
+				out[i] = TreemapRect{free.x, free.y, 0, 0};
+			}
+			return;
+		}
+		//grow the row while that makes its worst aspect ratio better
+		const double largest = sizes[start] * perByte;
+		double rowArea = 0, worst = numeric_limits<double>::infinity();
+		size_t end = start;
+		while (end < nonEmpty){
+			const double area = sizes[end] * perByte;
+			const double sum = rowArea + area;
+			const double ratio = max(side * side * largest / (sum * sum), sum * sum / (side * side * area));
+			if (end > start && ratio > worst){
+				break;
+			}
+			rowArea = sum;
+			worst = ratio;
+			end++;
+		}
+		
+		//the row spans the short side, the last row takes whatever is left to absorb rounding
+		const bool column = free.w >= free.h;
+		const double thickness = end == nonEmpty ? (column ? free.w : free.h) : rowArea / side;
+		double offset = 0;
+		for (size_t i = start; i < end; i++){
+			const double length = i + 1 == end ? side - offset : side * (sizes[i] * perByte) / rowArea;
+			if (column){
+				out[i] = TreemapRect{free.x, free.y + offset, thickness, length};
+			}
+			else{
+				out[i] = TreemapRect{free.x + offset, free.y, length, thickness};
+			}
+			offset += length;
+		}
+		if (column){
+			free.x += thickness;
+			free.w = max(0.0, free.w - thickness);
+		}
+		else{
+			free.y += thickness;
+			free.h = max(0.0, free.h - thickness);
+		}
+		start = end;
+	}
+}
+
+/**
+ @param item an item in the tree
+ @return the full path to the item
+ */
+string TreemapTree::path(uint32_t item) const{
+	vector<uint32_t> chain;
+	for (; item != 0; item = parent[item]){
+		chain.push_back(item);
+	}
+	string result(name(0));
+	for (auto it = chain.rbegin(); it != chain.rend(); ++it){
+		if (result.empty() || result.back() != filesystem::path::preferred_separator){
+			result += filesystem::path::preferred_separator;
+		}
+		result += name(*it);
+	}
+	return result;
+}
+
+/**
+ Add an item
+ @param d the item to copy
+ @param itemSize the size to record, read once so that it matches the sort order
+ @param parentItem the index of the item's folder
+ @param itemName the item's name
+ @return the index of the new item
+ */
+uint32_t TreemapTree::append(DirectoryData* d, fileSize itemSize, uint32_t parentItem, string_view itemName){
+	const uint32_t item = (uint32_t)size.size();
+	size.push_back(itemSize);
+	parent.push_back(parentItem);
+	firstChild.push_back(0);
+	childCount.push_back(0);
+	FileCategory c = d->category;
+	if (d->isFolder){
+		//folder statistics are only complete once the folder is
+		const TypeShare& top = d->stats->topTypes[0];
+		c = d->isComplete() && top.count > 0 ? ExtensionTable::category(top.extension) : FileCategory::Other;
+	}
+	category.push_back(c);
+	isFolder.push_back(d->isFolder);
+	nameStart.push_back((uint32_t)names.size());
+	names.append(itemName);
+	return item;
+}
+
+/**
+ Copy a tree breadth first, so that each folder's children are contiguous. Folders still being sized are left out.
+ @param root the folder to copy
+ @param cancel set to stop early, returning a partial copy
+ @return the copy
+ @note pins the current epoch while reading the tree
+ */
+shared_ptr<TreemapTree> TreemapTree::build(DirectoryData* root, const atomic<bool>& cancel){
+	auto t = make_shared<TreemapTree>();
+	epoch::Guard guard;
+	vector<DirectoryData*> folders{root};
+	vector<uint32_t> folderItems{t->append(root, root->measured(), 0, root->Path)};
+	vector<pair<fileSize, DirectoryData*>> children;
+	for (size_t next = 0; next < folders.size() && !cancel; next++){
+		const ChildList* list = folders[next]->children();
+		const uint32_t item = folderItems[next];
+		children.clear();
+		for (DirectoryData* sub : list->subFolders){
+			if (sub->isComplete()){
+				children.emplace_back(sub->measured(), sub);
+			}
+		}
+		//the summary row of a huge folder is drawn as one block of its smaller files, so the folder's area is still
+		//filled, and clicking it selects the summary row, which rereads the folder with every file listed
+		for (DirectoryData* file : list->files){
+			children.emplace_back(file->measured(), file);
+		}
+		stable_sort(children.begin(), children.end(), [](const auto& a, const auto& b){
+			return a.first > b.first;
+		});
+		
+		t->firstChild[item] = (uint32_t)t->items();
+		t->childCount[item] = (uint32_t)children.size();
+		for (const auto& child : children){
+			const uint32_t added = t->append(child.second, child.first, item, leafName(child.second->Path));
+			if (child.second->isFolder && !child.second->isSymlink){
+				folders.push_back(child.second);
+				folderItems.push_back(added);
+			}
+		}
+	}
+	return t;
+}
+
+/**
+ Create a layout with only the root placed
+ @param tree the tree to lay out
+ @param width @param height the size of the whole map
+ */
+TreemapLayout::TreemapLayout(const shared_ptr<const TreemapTree>& tree, double width, double height) : data(tree), rects(tree->items()), expanded(new atomic<bool>[tree->items()]){
+	for (size_t i = 0; i < tree->items(); i++){
+		expanded[i].store(false, memory_order_relaxed);
+	}
+	rects[0] = TreemapRect{0, 0, width, height};
+}
+
+/**
+ @return true if a folder is visible and large enough on screen to show its contents, but has not been laid out
+ */
+bool TreemapLayout::wantsExpansion(uint32_t item, const TreemapRect& viewport, double scale) const{
+	const TreemapRect& r = rects[item];
+	return data->childCount[item] > 0 && !isExpanded(item) && r.w * scale >= minFolderPixels && r.h * scale >= minFolderPixels && r.intersects(viewport);
+}
+
+/**
+ Lay out the visible folders that are large enough to show their contents, largest first. Call from one thread only.
+ @param viewport the visible part of the map
+ @param scale screen pixels per map unit
+ @param budget stop after placing about this many items
+ @param changed receives the area that was laid out
+ @param cancel set to stop early
+ @return true if the viewport needs no further layout
+ */
+bool TreemapLayout::refine(const TreemapRect& viewport, double scale, size_t budget, TreemapRect& changed, const atomic<bool>& cancel){
+	const TreemapTree& t = *data;
+	priority_queue<pair<double, uint32_t>> pending;
+	//collect the work left from the part of the tree that is already placed
+	vector<uint32_t> stack{0};
+	while (!stack.empty()){
+		const uint32_t item = stack.back();
+		stack.pop_back();
+		if (!isExpanded(item)){
+			if (wantsExpansion(item, viewport, scale)){
+				pending.emplace(rects[item].w * rects[item].h, item);
+			}
+			continue;
+		}
+		const TreemapRect& r = rects[item];
+		if (!r.intersects(viewport) || r.w * scale < minFolderPixels || r.h * scale < minFolderPixels){
+			continue;
+		}
+		for (uint32_t c = t.firstChild[item]; c < t.firstChild[item] + t.childCount[item]; c++){
+			if (t.childCount[c] > 0){
+				stack.push_back(c);
+			}
+		}
+	}
+	
+	changed = TreemapRect();
+	size_t placed = 0;
+	while (!pending.empty() && placed < budget && !cancel){
+		const uint32_t item = pending.top().second;
+		pending.pop();
+		const uint32_t first = t.firstChild[item], count = t.childCount[item];
+		squarify(&t.size[first], count, rects[item], &rects[first]);
+		//publish the children to the rendering threads
+		expanded[item].store(true, memory_order_release);
+		placed += count;
+		changed = changed.unite(rects[item]);
+		for (uint32_t c = first; c < first + count; c++){
+			if (wantsExpansion(c, viewport, scale)){
+				pending.emplace(rects[c].w * rects[c].h, c);
+			}
+		}
+	}
+	return pending.empty();
+}
+
+/**
+ Find the smallest placed item at a point
+ @param x @param y the point in map units
+ @return the item, or none if the point is outside the map
+ */
+uint32_t TreemapLayout::hitTest(double x, double y) const{
+	if (!rects[0].contains(x, y)){
+		return none;
+	}
+	const TreemapTree& t = *data;
+	uint32_t item = 0;
+	while (isExpanded(item)){
+		uint32_t found = none;
+		for (uint32_t c = t.firstChild[item]; c < t.firstChild[item] + t.childCount[item]; c++){
+			if (rects[c].contains(x, y)){
+				found = c;
+				break;
+			}
+		}
+		if (found == none){
+			break;
+		}
+		item = found;
+	}
+	return item;
+}
+
+/**
+ Draw one square tile of the map. Safe to call while another thread refines the layout.
+ @param layout the layout to draw
+ @param scale screen pixels per map unit
+ @param tileX @param tileY the position of the tile, in tiles
+ @param tileSize the width and height of the tile in pixels
+ @param rgb receives tileSize * tileSize pixels, 3 bytes each
+ */
+void renderTile(const TreemapLayout& layout, double scale, int tileX, int tileY, int tileSize, uint8_t* rgb){
+	fill(rgb, tileSize, 0, 0, tileSize, tileSize, background, false);
+	const TreemapTree& t = layout.tree();
+	const double originX = (double)tileX * tileSize, originY = (double)tileY * tileSize;
+	vector<uint32_t> stack{0};
+	while (!stack.empty()){
+		const uint32_t item = stack.back();
+		stack.pop_back();
+		const TreemapRect& r = layout.rect(item);
+		const double x0 = r.x * scale - originX, x1 = (r.x + r.w) * scale - originX;
+		const double y0 = r.y * scale - originY, y1 = (r.y + r.h) * scale - originY;
+		//pixel sizes are rounded the same way in every tile, so decisions agree across tile edges
+		const double width = floor(x1 + 0.5) - floor(x0 + 0.5), height = floor(y1 + 0.5) - floor(y0 + 0.5);
+		//items smaller than a pixel are left to the folder's background
+		if (x1 <= 0 || y1 <= 0 || x0 >= tileSize || y0 >= tileSize || width <= 0 || height <= 0){
+			continue;
+		}
+		if (layout.isExpanded(item) && width >= 2 && height >= 2){
+			fill(rgb, tileSize, x0, y0, x1, y1, folderBase, false);
+			for (uint32_t c = t.firstChild[item]; c < t.firstChild[item] + t.childCount[item]; c++){
+				stack.push_back(c);
+			}
+		}
+		else{
+			fill(rgb, tileSize, x0, y0, x1, y1, palette[(size_t)t.category[item]], true);
+		}
+	}
+}
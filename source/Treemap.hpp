@@ -0,0 +1,127 @@
+//
+//  Treemap.hpp
+//
+//  Copyright © 2020 Ravbug. All rights reserved.
+//
+
+#pragma once
+#include "DirectoryData.hpp"
+#include <memory>
+#include <atomic>
+#include <vector>
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include <algorithm>
+
+/**
+ A rectangle in treemap coordinates
+ */
+struct TreemapRect{
+	double x = 0, y = 0, w = 0, h = 0;
+	
+	bool intersects(const TreemapRect& other) const{
+		return x < other.x + other.w && other.x < x + w && y < other.y + other.h && other.y < y + h;
+	}
+	bool contains(double px, double py) const{
+		return px >= x && px < x + w && py >= y && py < y + h;
+	}
+	/**
+	 @return the smallest rectangle containing both rectangles. Empty rectangles are ignored.
+	 */
+	TreemapRect unite(const TreemapRect& other) const{
+		if (w <= 0 || h <= 0){
+			return other;
+		}
+		if (other.w <= 0 || other.h <= 0){
+			return *this;
+		}
+		TreemapRect r;
+		r.x = std::min(x, other.x);
+		r.y = std::min(y, other.y);
+		r.w = std::max(x + w, other.x + other.w) - r.x;
+		r.h = std::max(y + h, other.y + other.h) - r.y;
+		return r;
+	}
+};
+
+void squarify(const fileSize* sizes, size_t count, const TreemapRect& bounds, TreemapRect* out);
+
+/**
+ A compact copy of the scanned tree for the treemap, so that the layout and rendering threads never touch
+ the live tree. Item 0 is the root. The children of a folder are stored contiguously, largest first.
+ */
+class TreemapTree{
+public:
+	std::vector<fileSize> size;
+	std::vector<uint32_t> parent;
+	std::vector<uint32_t> firstChild;
+	std::vector<uint32_t> childCount;
+	//for folders, the category using the most space beneath them
+	std::vector<FileCategory> category;
+	std::vector<uint8_t> isFolder;
+	//names are stored back to back, item i's name ends where item i+1's begins. The root's name is its full path.
+	std::vector<uint32_t> nameStart;
+	std::string names;
+	
+	size_t items() const{
+		return size.size();
+	}
+	std::string_view name(uint32_t item) const{
+		const uint32_t end = item + 1 < nameStart.size() ? nameStart[item + 1] : (uint32_t)names.size();
+		return std::string_view(names).substr(nameStart[item], end - nameStart[item]);
+	}
+	std::string path(uint32_t item) const;
+	
+	static std::shared_ptr<TreemapTree> build(DirectoryData* root, const std::atomic<bool>& cancel);
+	
+private:
+	uint32_t append(DirectoryData*, fileSize, uint32_t parent, std::string_view name);
+};
+
+/**
+ Squarified layout of a TreemapTree. The layout starts with only the root placed and is refined
+ on demand: folders are laid out when they are visible and large enough on screen, biggest first.
+ Refinement runs on one thread while any number of threads read the layout; a folder's children
+ are written before the folder is marked expanded, and are never changed afterwards.
+ */
+class TreemapLayout{
+public:
+	//folders smaller than this many pixels on either side are drawn as a single block
+	static constexpr double minFolderPixels = 4;
+	//returned by hitTest when no item is under the point
+	static constexpr uint32_t none = UINT32_MAX;
+	
+	TreemapLayout(const std::shared_ptr<const TreemapTree>& tree, double width, double height);
+	
+	const TreemapTree& tree() const{
+		return *data;
+	}
+	const std::shared_ptr<const TreemapTree>& treePtr() const{
+		return data;
+	}
+	const TreemapRect& bounds() const{
+		return rects[0];
+	}
+	const TreemapRect& rect(uint32_t item) const{
+		return rects[item];
+	}
+	/**
+	 @return true if the item's children have been placed
+	 */
+	bool isExpanded(uint32_t item) const{
+		return expanded[item].load(std::memory_order_acquire);
+	}
+	
+	bool refine(const TreemapRect& viewport, double scale, size_t budget, TreemapRect& changed, const std::atomic<bool>& cancel);
+	uint32_t hitTest(double x, double y) const;
+	
+private:
+	std::shared_ptr<const TreemapTree> data;
+	std::vector<TreemapRect> rects;
+	std::unique_ptr<std::atomic<bool>[]> expanded;
+	
+	bool wantsExpansion(uint32_t item, const TreemapRect& viewport, double scale) const;
+};
+
+void renderTile(const TreemapLayout& layout, double scale, int tileX, int tileY, int tileSize, uint8_t* rgb);
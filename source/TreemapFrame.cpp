@@ -0,0 +1,99 @@
+//
+//  TreemapFrame.cpp
+//
+//  Copyright © 2020 Ravbug. All rights reserved.
+//
+
+#include "TreemapFrame.hpp"
+#include "FolderDisplay.hpp"
+#include "Epoch.hpp"
+#include <future>
+
+/**
+ Construct a treemap window and copy the current tree
+ @param parent the main window, which receives reveal requests
+ @param rootProvider returns the current root of the scanned tree. Called on the main thread on every refresh.
+ */
+TreemapFrame::TreemapFrame(wxWindow* parent, const std::function<DirectoryData*()>& rootProvider) : wxFrame(parent, wxID_ANY, "Treemap", wxDefaultPosition, wxSize(800,600)), rootProvider(rootProvider){
+	wxPanel* panel = new wxPanel(this);
+	wxBoxSizer* mainSizer = new wxBoxSizer(wxVERTICAL);
+	
+	wxBoxSizer* controlSizer = new wxBoxSizer(wxHORIZONTAL);
+	wxButton* refreshBtn = new wxButton(panel, wxID_REFRESH, "Refresh");
+	controlSizer->Add(refreshBtn, 0, wxALL, 5);
+	status = new wxStaticText(panel, wxID_ANY, "", wxDefaultPosition, wxDefaultSize, wxST_ELLIPSIZE_MIDDLE);
+	controlSizer->Add(status, 1, wxALL|wxALIGN_CENTER_VERTICAL, 5);
+	mainSizer->Add(controlSizer, 0, wxEXPAND, 0);
+	
+	map = new TreemapPanel(panel, parent, [this](const std::string& path, fileSize size){
+		OnHover(path, size);
+	});
+	map->SetToolTip("Drag to move, scroll to zoom, double click to zoom to a folder, right click to zoom out.\nClick an item to show it in the main window.");
+	mainSizer->Add(map, 1, wxALL|wxEXPAND, 5);
+	panel->SetSizer(mainSizer);
+	
+	refreshBtn->Bind(wxEVT_BUTTON, &TreemapFrame::OnRefresh, this);
+	
+#if defined _WIN32
+	SetBackgroundColour(wxSystemSettings::GetColour(wxSYS_COLOUR_WINDOW));
+#endif
+	Populate();
+}
+
+TreemapFrame::~TreemapFrame(){
+	Stop();
+}
+
+/**
+ Cancel the running copy, if any, and wait for it to exit
+ */
+void TreemapFrame::Stop(){
+	cancel = true;
+	if (worker.joinable()){
+		worker.join();
+	}
+	cancel = false;
+}
+
+/**
+ Copy the current tree on a background thread and show it
+ */
+void TreemapFrame::Populate(){
+	Stop();
+	DirectoryData* root = rootProvider();
+	if (root == nullptr){
+		status->SetLabel("Open a folder to draw it");
+		return;
+	}
+	summary = "Reading the scanned tree";
+	status->SetLabel(summary);
+	
+	//the tree may be replaced as soon as this function returns, so wait until the worker has pinned it
+	std::promise<void> pinned;
+	std::future<void> ready = pinned.get_future();
+	worker = std::thread([this, root, pinned = std::move(pinned)]() mutable {
+		std::shared_ptr<TreemapTree> copy;
+		{
+			epoch::Guard guard;
+			pinned.set_value();
+			copy = TreemapTree::build(root, cancel);
+		}
+		if (!cancel){
+			CallAfter([this, copy]{
+				summary = wxString::Format("%s, %zu items", FolderDisplay::sizeToString(copy->size[0]), copy->items());
+				status->SetLabel(summary);
+				map->SetTree(copy);
+			});
+		}
+	});
+	ready.wait();
+}
+
+/**
+ Show the item under the mouse
+ @param path the item, or an empty string to show the totals
+ @param size the size of the item
+ */
+void TreemapFrame::OnHover(const std::string& path, fileSize size){
+	status->SetLabel(path.empty() ? summary : wxString::Format("%s (%s)", path, FolderDisplay::sizeToString(size)));
+}
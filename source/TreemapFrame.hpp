@@ -0,0 +1,35 @@
+//
+//  TreemapFrame.hpp
+//
+//  Copyright © 2020 Ravbug. All rights reserved.
+//
+
+#pragma once
+#include "TreemapPanel.hpp"
+#include <functional>
+#include <thread>
+#include <atomic>
+
+/**
+ A window showing the scanned tree as a treemap
+ */
+class TreemapFrame : public wxFrame{
+public:
+	TreemapFrame(wxWindow* parent, const std::function<DirectoryData*()>& rootProvider);
+	~TreemapFrame();
+	void Populate();
+	
+private:
+	std::function<DirectoryData*()> rootProvider;
+	TreemapPanel* map;
+	wxStaticText* status;
+	wxString summary;
+	std::thread worker;
+	std::atomic<bool> cancel{false};
+	
+	void Stop();
+	void OnHover(const std::string& path, fileSize size);
+	void OnRefresh(wxCommandEvent&){
+		Populate();
+	}
+};
@@ -0,0 +1,386 @@
+//
+//  TreemapPanel.cpp
+//
+//  Copyright © 2020 Ravbug. All rights reserved.
+//
+
+#include "TreemapPanel.hpp"
+#include <wx/dcbuffer.h>
+#include <cmath>
+using namespace std;
+
+/**
+ Construct an empty treemap
+ @param parent the window to place the map in
+ @param eventManager the main window, which receives reveal requests
+ @param onHover called when the item under the mouse changes
+ */
+TreemapPanel::TreemapPanel(wxWindow* parent, wxWindow* eventManager, const hoverCallback& onHover) : wxPanel(parent, wxID_ANY), eventManager(eventManager), onHover(onHover){
+	SetBackgroundStyle(wxBG_STYLE_PAINT);
+	Bind(wxEVT_PAINT, &TreemapPanel::OnPaint, this);
+	Bind(wxEVT_SIZE, &TreemapPanel::OnSize, this);
+	Bind(wxEVT_MOUSEWHEEL, &TreemapPanel::OnMouseWheel, this);
+	Bind(wxEVT_LEFT_DOWN, &TreemapPanel::OnLeftDown, this);
+	Bind(wxEVT_LEFT_UP, &TreemapPanel::OnLeftUp, this);
+	Bind(wxEVT_LEFT_DCLICK, &TreemapPanel::OnLeftDClick, this);
+	Bind(wxEVT_RIGHT_DOWN, &TreemapPanel::OnRightDown, this);
+	Bind(wxEVT_MOTION, &TreemapPanel::OnMotion, this);
+	Bind(wxEVT_LEAVE_WINDOW, &TreemapPanel::OnLeave, this);
+	Bind(wxEVT_MOUSE_CAPTURE_LOST, &TreemapPanel::OnCaptureLost, this);
+	worker = thread(&TreemapPanel::run, this);
+}
+
+TreemapPanel::~TreemapPanel(){
+	{
+		lock_guard<mutex> guard(lock);
+		stopping = true;
+		cancel = true;
+	}
+	wake.notify_one();
+	worker.join();
+}
+
+/**
+ Show a new tree, resetting the view
+ @param newTree the tree to draw
+ */
+void TreemapPanel::SetTree(const shared_ptr<const TreemapTree>& newTree){
+	tree = newTree;
+	ResetLayout();
+}
+
+/**
+ Start a new layout at the current size and zoom out completely
+ */
+void TreemapPanel::ResetLayout(){
+	const wxSize size = GetClientSize();
+	layout = nullptr;
+	if (tree != nullptr && size.x > 0 && size.y > 0){
+		layout = make_shared<TreemapLayout>(tree, size.x, size.y);
+	}
+	level = 0;
+	offsetX = offsetY = 0;
+	version++;
+	recent.clear();
+	tiles.clear();
+	SetHovered(TreemapLayout::none);
+	Refresh();
+}
+
+/**
+ @return screen pixels per map unit at the current zoom level
+ */
+double TreemapPanel::Scale() const{
+	return pow(2.0, level / 4.0);
+}
+
+/**
+ @return the visible part of the map, in map units
+ */
+TreemapRect TreemapPanel::Viewport() const{
+	const wxSize size = GetClientSize();
+	const double scale = Scale();
+	return TreemapRect{offsetX / scale, offsetY / scale, size.x / scale, size.y / scale};
+}
+
+/**
+ Keep the map covering the window
+ */
+void TreemapPanel::ClampOffset(){
+	if (layout == nullptr){
+		return;
+	}
+	const wxSize size = GetClientSize();
+	const double scale = Scale();
+	offsetX = max(0L, min(offsetX, (long)(layout->bounds().w * scale) - size.x));
+	offsetY = max(0L, min(offsetY, (long)(layout->bounds().h * scale) - size.y));
+}
+
+/**
+ Change the zoom level, keeping the point under the anchor in place
+ @param newLevel the new zoom level, clamped to the valid range
+ @param anchor the fixed point in window coordinates
+ */
+void TreemapPanel::ZoomAt(int newLevel, const wxPoint& anchor){
+	newLevel = max(0, min(newLevel, maxZoomLevel));
+	if (newLevel == level){
+		return;
+	}
+	const double ratio = pow(2.0, (newLevel - level) / 4.0);
+	offsetX = lround((offsetX + anchor.x) * ratio) - anchor.x;
+	offsetY = lround((offsetY + anchor.y) * ratio) - anchor.y;
+	level = newLevel;
+	ClampOffset();
+	SetHovered(ItemAt(anchor));
+	Refresh();
+}
+
+/**
+ @param point a point in window coordinates
+ @return the smallest laid out item at the point, or TreemapLayout::none
+ */
+uint32_t TreemapPanel::ItemAt(const wxPoint& point) const{
+	if (layout == nullptr){
+		return TreemapLayout::none;
+	}
+	const double scale = Scale();
+	return layout->hitTest((offsetX + point.x) / scale, (offsetY + point.y) / scale);
+}
+
+/**
+ Change the highlighted item
+ @param item the item under the mouse, or TreemapLayout::none
+ */
+void TreemapPanel::SetHovered(uint32_t item){
+	if (item == hovered){
+		return;
+	}
+	hovered = item;
+	Refresh();
+	if (item == TreemapLayout::none || layout == nullptr){
+		onHover("", 0);
+	}
+	else{
+		onHover(layout->tree().path(item), layout->tree().size[item]);
+	}
+}
+
+/**
+ Hand the current view to the background thread, unless it already has it
+ @param missing the visible tiles that are not cached
+ */
+void TreemapPanel::Schedule(const vector<TileKey>& missing){
+	const TreemapRect viewport = Viewport();
+	if (lastJob.layout == layout && lastJob.version == version && lastJob.level == level && lastJob.tiles == missing && lastJob.viewport.x == viewport.x && lastJob.viewport.y == viewport.y && lastJob.viewport.w == viewport.w && lastJob.viewport.h == viewport.h){
+		return;
+	}
+	lastJob = Job{layout, version, level, viewport, missing};
+	{
+		lock_guard<mutex> guard(lock);
+		pending = lastJob;
+		hasPending = true;
+		//stop a layout pass for the old view
+		cancel = true;
+	}
+	wake.notify_one();
+}
+
+/**
+ Background thread: render the requested tiles, then refine the layout of the view one pass at a time.
+ After each pass it waits for the window to repaint, so the map fills in from the top level down.
+ */
+void TreemapPanel::run(){
+	Job job;
+	size_t next = 0;
+	bool laidOut = true;
+	bool awaitingPaint = false;
+	vector<uint8_t> pixels((size_t)tileSize * tileSize * 3);
+	unique_lock<mutex> guard(lock);
+	for(;;){
+		wake.wait(guard, [&]{
+			return stopping || hasPending || (job.layout != nullptr && (next < job.tiles.size() || (!laidOut && !awaitingPaint)));
+		});
+		if (stopping){
+			return;
+		}
+		if (hasPending){
+			job = std::move(pending);
+			hasPending = false;
+			cancel = false;
+			next = 0;
+			laidOut = false;
+			awaitingPaint = false;
+		}
+		guard.unlock();
+		
+		const double scale = pow(2.0, job.level / 4.0);
+		if (next < job.tiles.size()){
+			const TileKey key = job.tiles[next++];
+			renderTile(*job.layout, scale, key.x, key.y, tileSize, pixels.data());
+			CallAfter([this, layout = job.layout, key, version = job.version, pixels]{
+				OnTileRendered(layout, key, version, pixels);
+			});
+		}
+		else{
+			TreemapRect changed;
+			laidOut = job.layout->refine(job.viewport, scale, layoutBudget, changed, cancel);
+			if (changed.w > 0){
+				awaitingPaint = true;
+				CallAfter([this, layout = job.layout, changed]{
+					OnLayoutChanged(layout, changed);
+				});
+			}
+		}
+		guard.lock();
+	}
+}
+
+/**
+ Cache a tile from the background thread and draw it
+ */
+void TreemapPanel::OnTileRendered(const shared_ptr<TreemapLayout>& from, const TileKey& key, uint64_t tileVersion, const vector<uint8_t>& pixels){
+	if (from != layout || tileVersion != version){
+		return;
+	}
+	wxImage image(tileSize, tileSize, false);
+	memcpy(image.GetData(), pixels.data(), pixels.size());
+	auto existing = tiles.find(key);
+	if (existing != tiles.end()){
+		recent.erase(existing->second);
+	}
+	recent.emplace_front(key, wxBitmap(image));
+	tiles[key] = recent.begin();
+	while (recent.size() > tileCacheCapacity){
+		tiles.erase(recent.back().first);
+		recent.pop_back();
+	}
+	if (key.level == level){
+		RefreshRect(wxRect(key.x * tileSize - offsetX, key.y * tileSize - offsetY, tileSize, tileSize), false);
+	}
+}
+
+/**
+ Drop the cached tiles covering an area that was laid out in more detail
+ */
+void TreemapPanel::OnLayoutChanged(const shared_ptr<TreemapLayout>& from, const TreemapRect& changed){
+	if (from != layout){
+		return;
+	}
+	version++;
+	for (auto it = recent.begin(); it != recent.end();){
+		const TileKey& key = it->first;
+		const double span = tileSize / pow(2.0, key.level / 4.0);
+		if (TreemapRect{key.x * span, key.y * span, span, span}.intersects(changed)){
+			tiles.erase(key);
+			it = recent.erase(it);
+		}
+		else{
+			++it;
+		}
+	}
+	Refresh();
+}
+
+/**
+ Draw the cached tiles and ask the background thread for the missing ones
+ */
+void TreemapPanel::OnPaint(wxPaintEvent&){
+	wxAutoBufferedPaintDC dc(this);
+	dc.SetBackground(wxBrush(wxColour(40, 40, 40)));
+	dc.Clear();
+	if (layout == nullptr){
+		return;
+	}
+	const wxSize size = GetClientSize();
+	const double scale = Scale();
+	const int lastX = (int)min<double>((offsetX + size.x - 1) / tileSize, ceil(layout->bounds().w * scale / tileSize) - 1);
+	const int lastY = (int)min<double>((offsetY + size.y - 1) / tileSize, ceil(layout->bounds().h * scale / tileSize) - 1);
+	vector<TileKey> missing;
+	for (int y = (int)(offsetY / tileSize); y <= lastY; y++){
+		for (int x = (int)(offsetX / tileSize); x <= lastX; x++){
+			const TileKey key{level, x, y};
+			auto found = tiles.find(key);
+			if (found == tiles.end()){
+				missing.push_back(key);
+				continue;
+			}
+			recent.splice(recent.begin(), recent, found->second);
+			dc.DrawBitmap(found->second->second, x * tileSize - offsetX, y * tileSize - offsetY);
+		}
+	}
+	
+	if (hovered != TreemapLayout::none){
+		const TreemapRect& r = layout->rect(hovered);
+		dc.SetPen(wxPen(*wxWHITE, 2));
+		dc.SetBrush(*wxTRANSPARENT_BRUSH);
+		dc.DrawRectangle(lround(r.x * scale) - offsetX, lround(r.y * scale) - offsetY, max(2L, lround(r.w * scale)), max(2L, lround(r.h * scale)));
+	}
+	Schedule(missing);
+}
+
+void TreemapPanel::OnSize(wxSizeEvent& event){
+	ResetLayout();
+	event.Skip();
+}
+
+void TreemapPanel::OnMouseWheel(wxMouseEvent& event){
+	ZoomAt(level + (event.GetWheelRotation() > 0 ? 1 : -1), event.GetPosition());
+}
+
+void TreemapPanel::OnLeftDown(wxMouseEvent& event){
+	dragStart = event.GetPosition();
+	dragOffsetX = offsetX;
+	dragOffsetY = offsetY;
+	dragging = true;
+	CaptureMouse();
+}
+
+/**
+ Finish a drag, or reveal the clicked item if the mouse did not move
+ */
+void TreemapPanel::OnLeftUp(wxMouseEvent& event){
+	if (!dragging){
+		return;
+	}
+	dragging = false;
+	if (HasCapture()){
+		ReleaseMouse();
+	}
+	const wxPoint moved = event.GetPosition() - dragStart;
+	const uint32_t item = ItemAt(event.GetPosition());
+	if (abs(moved.x) + abs(moved.y) < 4 && item != TreemapLayout::none){
+		wxCommandEvent* evt = new wxCommandEvent(progEvt, REVEALEVT);
+		evt->SetString(layout->tree().path(item));
+		eventManager->GetEventHandler()->QueueEvent(evt);
+	}
+}
+
+/**
+ Zoom so that the folder under the mouse fills the window
+ */
+void TreemapPanel::OnLeftDClick(wxMouseEvent& event){
+	uint32_t item = ItemAt(event.GetPosition());
+	if (item == TreemapLayout::none){
+		return;
+	}
+	if (!layout->tree().isFolder[item]){
+		item = layout->tree().parent[item];
+	}
+	const TreemapRect& r = layout->rect(item);
+	const wxSize size = GetClientSize();
+	if (r.w <= 0 || r.h <= 0){
+		return;
+	}
+	level = max(0, min(maxZoomLevel, (int)floor(4 * log2(min(size.x / r.w, size.y / r.h)))));
+	const double scale = Scale();
+	offsetX = lround((r.x + r.w / 2) * scale - size.x / 2.0);
+	offsetY = lround((r.y + r.h / 2) * scale - size.y / 2.0);
+	ClampOffset();
+	SetHovered(ItemAt(event.GetPosition()));
+	Refresh();
+}
+
+void TreemapPanel::OnRightDown(wxMouseEvent& event){
+	ZoomAt(level - 4, event.GetPosition());
+}
+
+void TreemapPanel::OnMotion(wxMouseEvent& event){
+	if (dragging){
+		const wxPoint moved = event.GetPosition() - dragStart;
+		offsetX = dragOffsetX - moved.x;
+		offsetY = dragOffsetY - moved.y;
+		ClampOffset();
+		Refresh();
+	}
+	SetHovered(ItemAt(event.GetPosition()));
+}
+
+void TreemapPanel::OnLeave(wxMouseEvent&){
+	if (!dragging){
+		SetHovered(TreemapLayout::none);
+	}
+}
+
+void TreemapPanel::OnCaptureLost(wxMouseCaptureLostEvent&){
+	dragging = false;
+}
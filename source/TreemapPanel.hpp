@@ -0,0 +1,113 @@
+//
+//  TreemapPanel.hpp
+//
+//  Copyright © 2020 Ravbug. All rights reserved.
+//
+
+#pragma once
+#include "globals.h"
+#include "Treemap.hpp"
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <list>
+#include <unordered_map>
+
+/**
+ Draws a squarified treemap. The layout is refined and tiles are rendered on a background thread;
+ the paint handler only copies finished tiles, so panning and zooming never wait for the map.
+ Drag to pan, scroll to zoom, double click to zoom to a folder, right click to zoom out, click to reveal an item.
+ */
+class TreemapPanel : public wxPanel{
+public:
+	static constexpr int tileSize = 256;
+	static constexpr size_t tileCacheCapacity = 192;
+	//each level zooms in by a quarter of a power of two
+	static constexpr int maxZoomLevel = 56;
+	//items placed per layout pass, before the tiles are redrawn
+	static constexpr size_t layoutBudget = 50000;
+	
+	//called on the main thread with the item under the mouse, or an empty path when there is none
+	typedef std::function<void(const std::string& path, fileSize size)> hoverCallback;
+	
+	TreemapPanel(wxWindow* parent, wxWindow* eventManager, const hoverCallback& onHover);
+	~TreemapPanel();
+	void SetTree(const std::shared_ptr<const TreemapTree>& tree);
+	
+private:
+	struct TileKey{
+		int level, x, y;
+		bool operator==(const TileKey& other) const{
+			return level == other.level && x == other.x && y == other.y;
+		}
+	};
+	struct TileKeyHash{
+		size_t operator()(const TileKey& k) const{
+			return std::hash<uint64_t>()(((uint64_t)(uint32_t)k.x << 32 | (uint32_t)k.y) ^ ((uint64_t)k.level << 58));
+		}
+	};
+	
+	/**
+	 Work for the background thread, replaced as a whole each time the view changes
+	 */
+	struct Job{
+		std::shared_ptr<TreemapLayout> layout;
+		uint64_t version = 0;
+		int level = 0;
+		TreemapRect viewport;
+		std::vector<TileKey> tiles;
+	};
+	
+	wxWindow* eventManager;
+	hoverCallback onHover;
+	
+	//main thread state
+	std::shared_ptr<const TreemapTree> tree;
+	std::shared_ptr<TreemapLayout> layout;
+	int level = 0;
+	long offsetX = 0, offsetY = 0;
+	//incremented whenever the layout changes, tiles rendered for an older version are dropped
+	uint64_t version = 0;
+	uint32_t hovered = TreemapLayout::none;
+	wxPoint dragStart;
+	long dragOffsetX = 0, dragOffsetY = 0;
+	bool dragging = false;
+	Job lastJob;
+	//most recently drawn first
+	typedef std::pair<TileKey, wxBitmap> tileEntry;
+	std::list<tileEntry> recent;
+	std::unordered_map<TileKey, std::list<tileEntry>::iterator, TileKeyHash> tiles;
+	
+	//shared with the background thread
+	std::mutex lock;
+	std::condition_variable wake;
+	Job pending;
+	bool hasPending = false;
+	bool stopping = false;
+	std::atomic<bool> cancel{false};
+	std::thread worker;
+	
+	void run();
+	void Schedule(const std::vector<TileKey>& missing);
+	double Scale() const;
+	TreemapRect Viewport() const;
+	void ResetLayout();
+	void ClampOffset();
+	void ZoomAt(int newLevel, const wxPoint& anchor);
+	uint32_t ItemAt(const wxPoint&) const;
+	void SetHovered(uint32_t);
+	void OnTileRendered(const std::shared_ptr<TreemapLayout>&, const TileKey&, uint64_t, const std::vector<uint8_t>&);
+	void OnLayoutChanged(const std::shared_ptr<TreemapLayout>&, const TreemapRect&);
+	
+	void OnPaint(wxPaintEvent&);
+	void OnSize(wxSizeEvent&);
+	void OnMouseWheel(wxMouseEvent&);
+	void OnLeftDown(wxMouseEvent&);
+	void OnLeftUp(wxMouseEvent&);
+	void OnLeftDClick(wxMouseEvent&);
+	void OnRightDown(wxMouseEvent&);
+	void OnMotion(wxMouseEvent&);
+	void OnLeave(wxMouseEvent&);
+	void OnCaptureLost(wxMouseCaptureLostEvent&);
+};
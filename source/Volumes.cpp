@@ -0,0 +1,272 @@
+//
+//  Volumes.cpp
+//
+//  Copyright © 2020 Ravbug. All rights reserved.
+//
+
+#include "Volumes.hpp"
+#include "Epoch.hpp"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <unordered_set>
+#include <cctype>
+#if defined __APPLE__
+#include <sys/mount.h>
+#endif
+using namespace std;
+using namespace std::filesystem;
+
+namespace{
+	/**
+	 @return true if a path is strictly inside a folder
+	 */
+	bool isInside(const string& item, const string& folder){
+		const path rel = path(item).lexically_relative(folder);
+		return !rel.empty() && rel != "." && *rel.begin() != "..";
+	}
+	
+	/**
+	 Find a folder in the scanned tree
+	 @param root the root of the tree
+	 @param target the full path to the folder
+	 @return the folder, or nullptr if it is not in the tree
+	 @note hold an epoch::Guard while using the result
+	 */
+	DirectoryData* findFolder(DirectoryData* root, const string& target){
+		const path rel = path(target).lexically_relative(root->Path);
+		if (rel.empty() || *rel.begin() == ".."){
+			return nullptr;
+		}
+		DirectoryData* node = root;
+		for (const path& part : rel){
+			if (part == "."){
+				continue;
+			}
+			const string childPath = (path(node->Path) / part).string();
+			DirectoryData* next = nullptr;
+			for (DirectoryData* d : node->children()->subFolders){
+				if (d->Path == childPath){
+					next = d;
+					break;
+				}
+			}
+			if (next == nullptr){
+				return nullptr;
+			}
+			node = next;
+		}
+		return node;
+	}
+	
+#if defined __linux__
+	/**
+	 Decode the octal escapes mountinfo uses for spaces and other special characters in paths
+	 */
+	string unescape(const string& field){
+		string result;
+		for (size_t i = 0; i < field.size(); i++){
+			if (field[i] == '\\' && i + 3 < field.size() && isdigit(field[i+1]) && isdigit(field[i+2]) && isdigit(field[i+3])){
+				result += (char)stoi(field.substr(i + 1, 3), nullptr, 8);
+				i += 3;
+			}
+			else{
+				result += field[i];
+			}
+		}
+		return result;
+	}
+#endif
+}
+
+/**
+ List the mounted filesystems from the mount table, without asking the filesystems for anything, so unresponsive
+ network mounts do not block. Usage is left at 0. Not available on Windows, where the list is empty.
+ @return the mounts, in the order they were mounted
+ */
+vector<VolumeInfo> listMounts(){
+	vector<VolumeInfo> mounts;
+#if defined __linux__
+	//fields: id parent major:minor root mountpoint options [optional...] - type source superoptions
+	ifstream mountinfo("/proc/self/mountinfo");
+	unordered_set<string> seen;
+	string line;
+	while (getline(mountinfo, line)){
+		istringstream fields(line);
+		string id, parent, deviceNumber, root, mountPoint, options, field;
+		fields >> id >> parent >> deviceNumber >> root >> mountPoint >> options;
+		while (fields >> field && field != "-"){}
+		VolumeInfo v;
+		fields >> v.type >> v.device;
+		v.mountPoint = unescape(mountPoint);
+		v.device = unescape(v.device);
+		//the same filesystem mounted again, or bind mounted, is only listed once
+		if (!seen.insert(deviceNumber + " " + root).second){
+			continue;
+		}
+		//a later mount on the same point hides the earlier one
+		auto hidden = find_if(mounts.begin(), mounts.end(), [&](const VolumeInfo& other){
+			return other.mountPoint == v.mountPoint;
+		});
+		if (hidden != mounts.end()){
+			*hidden = v;
+		}
+		else{
+			mounts.push_back(v);
+		}
+	}
+#elif defined __APPLE__
+	struct statfs* table = nullptr;
+	//MNT_NOWAIT uses cached totals, so unresponsive network volumes do not block
+	const int count = getmntinfo(&table, MNT_NOWAIT);
+	for (int i = 0; i < count; i++){
+		VolumeInfo v;
+		v.mountPoint = table[i].f_mntonname;
+		v.device = table[i].f_mntfromname;
+		v.type = table[i].f_fstypename;
+		mounts.push_back(v);
+	}
+#endif
+	return mounts;
+}
+
+/**
+ @param type the filesystem type from the mount table
+ @return true if filesystems of the type may be served over a network, and so may stop responding
+ */
+bool isNetworkFilesystem(const string& type){
+	static const unordered_set<string> network = {
+		"nfs", "nfs4", "cifs", "smb3", "smbfs", "ncpfs", "afs", "9p", "ceph", "glusterfs", "lustre", "gpfs",
+		"davfs", "webdav", "afpfs", "osxfuse", "macfuse"
+	};
+	//FUSE filesystems (sshfs, rclone, s3fs ...) are often remote. fuseblk is a local disk.
+	return network.count(type) > 0 || type.rfind("fuse.", 0) == 0;
+}
+
+/**
+ Ask a filesystem for its usage. Blocks until an unresponsive network mount answers.
+ @param volume a volume from listMounts, whose usage is filled in
+ @return false if the usage could not be read, or the filesystem has no blocks, such as proc
+ */
+bool readUsage(VolumeInfo& volume){
+#if defined __linux__
+	struct statvfs info;
+	if (statvfs(volume.mountPoint.c_str(), &info) != 0 || info.f_blocks == 0){
+		return false;
+	}
+	volume.total = (fileSize)info.f_blocks * info.f_frsize;
+	volume.used = (fileSize)(info.f_blocks - info.f_bfree) * info.f_frsize;
+	volume.available = (fileSize)info.f_bavail * info.f_frsize;
+	volume.inodes = info.f_files;
+	volume.freeInodes = info.f_ffree;
+	return true;
+#else
+	//elsewhere the usage is read along with the list
+	return volume.total > 0;
+#endif
+}
+
+/**
+ List the mounted filesystems with their usage. Pseudo filesystems with no blocks, such as proc, are left out.
+ Only reads the mount table and asks each filesystem for its totals, so no scan is needed.
+ @param network if given, receives the suspected network mounts without asking them for their usage, so the
+ caller can read it with readUsage where an unresponsive mount cannot block it. Only used on Linux, where
+ asking a filesystem for its usage always waits for it.
+ @return the volumes, sorted by mount point
+ */
+vector<VolumeInfo> listVolumes(vector<VolumeInfo>* network){
+	vector<VolumeInfo> volumes;
+#if defined __linux__
+	for (VolumeInfo& v : listMounts()){
+		if (network != nullptr && isNetworkFilesystem(v.type)){
+			network->push_back(v);
+		}
+		else if (readUsage(v)){
+			volumes.push_back(v);
+		}
+	}
+#elif defined __APPLE__
+	struct statfs* mounts = nullptr;
+	//MNT_NOWAIT uses cached totals, so unresponsive network volumes do not block
+	const int count = getmntinfo(&mounts, MNT_NOWAIT);
+	for (int i = 0; i < count; i++){
+		const struct statfs& info = mounts[i];
+		if (info.f_blocks == 0){
+			continue;
+		}
+		VolumeInfo v;
+		v.mountPoint = info.f_mntonname;
+		v.device = info.f_mntfromname;
+		v.type = info.f_fstypename;
+		v.total = (fileSize)info.f_blocks * info.f_bsize;
+		v.used = (fileSize)(info.f_blocks - info.f_bfree) * info.f_bsize;
+		v.available = (fileSize)info.f_bavail * info.f_bsize;
+		v.inodes = info.f_files;
+		v.freeInodes = info.f_ffree;
+		volumes.push_back(v);
+	}
+#elif defined _WIN32
+	wchar_t drives[512];
+	const DWORD length = GetLogicalDriveStringsW(sizeof(drives) / sizeof(drives[0]), drives);
+	for (const wchar_t* drive = drives; drive < drives + length && *drive != 0; drive += wcslen(drive) + 1){
+		ULARGE_INTEGER available, total, free;
+		if (!GetDiskFreeSpaceExW(drive, &available, &total, &free) || total.QuadPart == 0){
+			continue;
+		}
+		VolumeInfo v;
+		v.mountPoint = path(drive).string();
+		wchar_t label[MAX_PATH + 1] = {0}, type[MAX_PATH + 1] = {0};
+		if (GetVolumeInformationW(drive, label, MAX_PATH + 1, nullptr, nullptr, nullptr, type, MAX_PATH + 1)){
+			v.device = path(label).string();
+			v.type = path(type).string();
+		}
+		v.total = total.QuadPart;
+		v.used = total.QuadPart - free.QuadPart;
+		v.available = available.QuadPart;
+		volumes.push_back(v);
+	}
+#endif
+	sort(volumes.begin(), volumes.end(), [](const VolumeInfo& a, const VolumeInfo& b){
+		return a.mountPoint < b.mountPoint;
+	});
+	return volumes;
+}
+
+/**
+ Measure how much of a volume's used space the scan found. Volumes mounted inside the volume are not counted.
+ Used space the scan did not find belongs to files that were deleted while still open, items that could not
+ be read, or filesystem metadata.
+ @param root the root of the scanned tree, or nullptr
+ @param volume the volume to measure
+ @param volumes every listed volume, to exclude nested mounts
+ @return the bytes on disk found by the scan, or -1 if the scan does not cover the whole volume
+ */
+fileSize scannedOnVolume(DirectoryData* root, const VolumeInfo& volume, const vector<VolumeInfo>& volumes){
+	if (root == nullptr){
+		return -1;
+	}
+	epoch::Guard guard;
+	DirectoryData* top = findFolder(root, volume.mountPoint);
+	if (top == nullptr || !top->isComplete()){
+		return -1;
+	}
+	fileSize bytes = top->allocated;
+	for (const VolumeInfo& inner : volumes){
+		if (!isInside(inner.mountPoint, volume.mountPoint)){
+			continue;
+		}
+		//only subtract mounts directly on this volume, deeper ones are already inside them
+		bool direct = true;
+		for (const VolumeInfo& between : volumes){
+			if (isInside(between.mountPoint, volume.mountPoint) && isInside(inner.mountPoint, between.mountPoint)){
+				direct = false;
+				break;
+			}
+		}
+		DirectoryData* nested = direct ? findFolder(root, inner.mountPoint) : nullptr;
+		if (nested != nullptr){
+			bytes -= nested->allocated;
+		}
+	}
+	return bytes;
+}
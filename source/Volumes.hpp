@@ -0,0 +1,33 @@
+//
+//  Volumes.hpp
+//
+//  Copyright © 2020 Ravbug. All rights reserved.
+//
+
+#pragma once
+#include "DirectoryData.hpp"
+#include <string>
+#include <vector>
+#include <cstdint>
+
+/**
+ A mounted filesystem and its usage, as reported by the filesystem itself
+ */
+struct VolumeInfo{
+	std::string mountPoint;
+	std::string device;
+	std::string type;
+	fileSize total = 0;
+	fileSize used = 0;
+	//free space usable by the current user, excludes blocks reserved for root
+	fileSize available = 0;
+	//0 on filesystems without a fixed inode table, and on Windows
+	uint64_t inodes = 0;
+	uint64_t freeInodes = 0;
+};
+
+std::vector<VolumeInfo> listMounts();
+std::vector<VolumeInfo> listVolumes(std::vector<VolumeInfo>* network = nullptr);
+bool readUsage(VolumeInfo& volume);
+bool isNetworkFilesystem(const std::string& type);
+fileSize scannedOnVolume(DirectoryData* root, const VolumeInfo& volume, const std::vector<VolumeInfo>& volumes);
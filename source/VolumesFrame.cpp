@@ -0,0 +1,211 @@
+//
+//  VolumesFrame.cpp
+//
+//  Copyright © 2020 Ravbug. All rights reserved.
+//
+
+#include "VolumesFrame.hpp"
+#include "FolderDisplay.hpp"
+#include "Watchdog.hpp"
+#include <algorithm>
+#include <thread>
+
+/**
+ Construct a volume list and fill it
+ @param parent the main window, which receives scan requests
+ @param rootProvider returns the current root of the scanned tree, or nullptr. Called on the main thread on every refresh.
+ */
+VolumesFrame::VolumesFrame(wxWindow* parent, const std::function<DirectoryData*()>& rootProvider) : ReportFrame(parent, "Volumes"), rootProvider(rootProvider), answerTimer(this){
+	wxButton* scanBtn = new wxButton(list->GetParent(), wxID_ANY, "Scan Volume");
+	controlSizer->Add(scanBtn, 0, wxALL, 5);
+	status = new wxStaticText(list->GetParent(), wxID_ANY, "");
+	controlSizer->Add(status, 1, wxALL|wxALIGN_CENTER_VERTICAL, 5);
+	scanBtn->Bind(wxEVT_BUTTON, &VolumesFrame::OnScan, this);
+	
+	list->AppendTextColumn("Mount Point", wxDATAVIEW_CELL_INERT, 160, wxALIGN_LEFT, wxDATAVIEW_COL_RESIZABLE);
+	list->AppendTextColumn("Type", wxDATAVIEW_CELL_INERT, 60, wxALIGN_LEFT, wxDATAVIEW_COL_RESIZABLE);
+	list->AppendTextColumn("Size", wxDATAVIEW_CELL_INERT, 80, wxALIGN_RIGHT);
+	list->AppendTextColumn("Used", wxDATAVIEW_CELL_INERT, 80, wxALIGN_RIGHT);
+	list->AppendTextColumn("Free", wxDATAVIEW_CELL_INERT, 80, wxALIGN_RIGHT);
+	list->AppendProgressColumn("Full", wxDATAVIEW_CELL_INERT, 80);
+	list->AppendTextColumn("Inodes Used", wxDATAVIEW_CELL_INERT, 90, wxALIGN_RIGHT);
+	list->AppendTextColumn("Unaccounted", wxDATAVIEW_CELL_INERT, 90, wxALIGN_RIGHT);
+	list->AppendTextColumn("Device", wxDATAVIEW_CELL_INERT, -1, wxALIGN_LEFT, wxDATAVIEW_COL_RESIZABLE);
+	list->SetToolTip("Unaccounted is the used space that the last scan did not find: files deleted while still open, items that could not be read, and filesystem overhead.");
+	
+	Bind(wxEVT_TIMER, [this](wxTimerEvent&){
+		ShowAnswers();
+	});
+	
+	Populate();
+}
+
+VolumesFrame::~VolumesFrame(){
+	answerTimer.Stop();
+}
+
+/**
+ Read the mounted volumes and their usage. Network volumes are listed right away and filled in once they answer.
+ */
+void VolumesFrame::Populate(){
+	Clear();
+	answerTimer.Stop();
+	waiting.clear();
+	auto start = std::chrono::steady_clock::now();
+	std::vector<VolumeInfo> network;
+	volumes = listVolumes(&network);
+	localMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	
+	for (const VolumeInfo& v : network){
+		volumes.push_back(v);
+	}
+	std::sort(volumes.begin(), volumes.end(), [](const VolumeInfo& a, const VolumeInfo& b){
+		return a.mountPoint < b.mountPoint;
+	});
+	std::unordered_set<std::string> remote;
+	for (const VolumeInfo& v : network){
+		remote.insert(v.mountPoint);
+	}
+	
+	DirectoryData* root = rootProvider();
+	list->Freeze();
+	for (const VolumeInfo& v : volumes){
+		if (remote.count(v.mountPoint) == 0){
+			AppendRow(RowFor(v, root), v.mountPoint);
+			continue;
+		}
+		wxVector<wxVariant> items;
+		items.push_back(v.mountPoint);
+		items.push_back(v.type);
+		items.push_back("Reading...");
+		items.push_back("");
+		items.push_back("");
+		items.push_back(0L);
+		items.push_back("");
+		items.push_back("");
+		items.push_back(v.device);
+		waiting.emplace(v.mountPoint, (unsigned int)list->GetItemCount());
+		AppendRow(items, v.mountPoint);
+	}
+	list->Thaw();
+	
+	//each network volume is read on a thread of its own, which is abandoned if the mount never answers
+	for (const VolumeInfo& v : network){
+		{
+			std::lock_guard<std::mutex> guard(reads->lock);
+			if (!reads->reading.insert(v.mountPoint).second){
+				continue;
+			}
+		}
+		std::thread([reads = reads, volume = v]() mutable {
+			const bool read = readUsage(volume);
+			std::lock_guard<std::mutex> guard(reads->lock);
+			reads->reading.erase(volume.mountPoint);
+			reads->answered.emplace_back(volume, read);
+		}).detach();
+	}
+	asked = std::chrono::steady_clock::now();
+	if (!waiting.empty()){
+		answerTimer.Start(answerMilliseconds);
+	}
+	UpdateStatus(false);
+}
+
+/**
+ Build the row of a volume whose usage is known
+ @param v the volume
+ @param root the root of the scanned tree, or nullptr
+ */
+wxVector<wxVariant> VolumesFrame::RowFor(const VolumeInfo& v, DirectoryData* root) const{
+	wxVector<wxVariant> items;
+	items.push_back(v.mountPoint);
+	items.push_back(v.type);
+	items.push_back(FolderDisplay::sizeToString(v.total));
+	items.push_back(FolderDisplay::sizeToString(v.used));
+	items.push_back(FolderDisplay::sizeToString(v.available));
+	//used and available do not add up to the total when blocks are reserved, so compare against what the user can fill
+	const fileSize usable = v.used + v.available;
+	items.push_back((long)(usable > 0 ? v.used * 100 / usable : 0));
+	items.push_back(v.inodes > 0 ? wxString::Format("%.0f%%", (v.inodes - v.freeInodes) * 100.0 / v.inodes) : wxString(""));
+	
+	const fileSize scanned = scannedOnVolume(root, v, volumes);
+	wxString unaccounted;
+	if (scanned >= 0){
+		const fileSize missing = v.used - scanned;
+		unaccounted = missing >= 0 ? FolderDisplay::sizeToString(missing) : "-" + FolderDisplay::sizeToString(-missing);
+	}
+	items.push_back(unaccounted);
+	items.push_back(v.device);
+	return items;
+}
+
+/**
+ Fill in the rows of the network volumes that answered since the last check
+ */
+void VolumesFrame::ShowAnswers(){
+	std::vector<std::pair<VolumeInfo, bool>> answered;
+	{
+		std::lock_guard<std::mutex> guard(reads->lock);
+		answered.swap(reads->answered);
+	}
+	DirectoryData* root = rootProvider();
+	for (const auto& answer : answered){
+		auto row = waiting.find(answer.first.mountPoint);
+		if (row == waiting.end()){
+			continue;
+		}
+		if (answer.second){
+			const wxVector<wxVariant> items = RowFor(answer.first, root);
+			for (unsigned int column = 0; column < items.size(); column++){
+				list->SetValue(items[column], row->second, column);
+			}
+		}
+		else{
+			list->SetTextValue("Unavailable", row->second, 2);
+		}
+		waiting.erase(row);
+	}
+	
+	//mounts that have not answered by the deadline are left to answer by the next refresh
+	const bool late = std::chrono::steady_clock::now() - asked >= MountWatchdog::defaultDeadline;
+	if (late){
+		for (const auto& row : waiting){
+			list->SetTextValue("Not responding", row.second, 2);
+		}
+	}
+	if (waiting.empty() || late){
+		answerTimer.Stop();
+	}
+	UpdateStatus(late);
+}
+
+/**
+ Show how many volumes were read, and how many network volumes are still being waited for
+ @param late true once the network volumes have had until the deadline to answer
+ */
+void VolumesFrame::UpdateStatus(bool late){
+	wxString label = wxString::Format("%zu volumes, read in %.0f ms", volumes.size() - waiting.size(), localMilliseconds);
+	if (!waiting.empty()){
+		label += wxString::Format(late ? ", %zu network volumes not responding" : ", waiting for %zu network volumes", waiting.size());
+	}
+	status->SetLabel(label);
+}
+
+/**
+ Ask the main window to scan a volume
+ @param path the mount point of the volume
+ */
+void VolumesFrame::Activate(const std::string& path){
+	wxCommandEvent* evt = new wxCommandEvent(progEvt, SCANEVT);
+	evt->SetString(path);
+	eventManager->GetEventHandler()->QueueEvent(evt);
+}
+
+void VolumesFrame::OnScan(wxCommandEvent&){
+	const std::string path = SelectedPath();
+	if (path.empty()){
+		status->SetLabel("Select a volume to scan");
+		return;
+	}
+	Activate(path);
+}
@@ -0,0 +1,61 @@
+//
+//  VolumesFrame.hpp
+//
+//  Copyright © 2020 Ravbug. All rights reserved.
+//
+
+#pragma once
+#include "ReportFrame.hpp"
+#include "Volumes.hpp"
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <chrono>
+#include <unordered_map>
+#include <unordered_set>
+
+/**
+ Lists the mounted volumes and how full they are, without scanning. Activating a volume scans it.
+ Once a volume has been scanned, shows the used space the scan did not find.
+ The usage of network volumes is read in the background, and filled in as each one answers.
+ */
+class VolumesFrame : public ReportFrame{
+public:
+	VolumesFrame(wxWindow* parent, const std::function<DirectoryData*()>& rootProvider);
+	~VolumesFrame();
+	void Populate() override;
+	
+protected:
+	void Activate(const std::string& path) override;
+	
+private:
+	//how often answers from network volumes are checked for
+	static constexpr int answerMilliseconds = 250;
+	
+	/**
+	 Usage read from network volumes, shared with the reading threads, which outlive the window if a mount hangs
+	 */
+	struct UsageReads{
+		std::mutex lock;
+		//mount points being read, which are not asked again until they answer
+		std::unordered_set<std::string> reading;
+		//volumes that answered since the last check, with whether their usage could be read
+		std::vector<std::pair<VolumeInfo, bool>> answered;
+	};
+	
+	std::function<DirectoryData*()> rootProvider;
+	wxStaticText* status;
+	std::shared_ptr<UsageReads> reads = std::make_shared<UsageReads>();
+	//every listed volume, in row order
+	std::vector<VolumeInfo> volumes;
+	//rows of network volumes that have not answered, by mount point
+	std::unordered_map<std::string, unsigned int> waiting;
+	std::chrono::steady_clock::time_point asked;
+	double localMilliseconds = 0;
+	wxTimer answerTimer;
+	
+	wxVector<wxVariant> RowFor(const VolumeInfo&, DirectoryData* root) const;
+	void ShowAnswers();
+	void UpdateStatus(bool late);
+	void OnScan(wxCommandEvent&);
+};
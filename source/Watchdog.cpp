@@ -0,0 +1,93 @@
+//
+//  Watchdog.cpp
+//
+//  Copyright © 2020 Ravbug. All rights reserved.
+//
+
+#include "Watchdog.hpp"
+#include <algorithm>
+
+//how often a waiting caller checks for progress and for being stopped
+static constexpr chrono::milliseconds pollInterval{100};
+
+/**
+ Read the mount table for suspected network mounts
+ @param deadline how long a call may go without progress
+ */
+MountWatchdog::MountWatchdog(chrono::milliseconds deadline) : deadline(deadline){
+	for (const VolumeInfo& v : listMounts()){
+		if (isNetworkFilesystem(v.type)){
+			mounts.push_back(v);
+		}
+	}
+	sort(mounts.begin(), mounts.end(), [](const VolumeInfo& a, const VolumeInfo& b){
+		return a.mountPoint.size() > b.mountPoint.size();
+	});
+}
+
+/**
+ @param path a full path
+ @return the suspected network mount the path is on, or nullptr if it is on a local filesystem
+ */
+const VolumeInfo* MountWatchdog::mountFor(const string& path) const{
+	for (const VolumeInfo& v : mounts){
+		const string& point = v.mountPoint;
+		if (path.compare(0, point.size(), point) == 0 && (path.size() == point.size() || point.back() == '/' || path[point.size()] == '/')){
+			return &v;
+		}
+	}
+	return nullptr;
+}
+
+/**
+ @return true if a call on the mount has timed out
+ */
+bool MountWatchdog::hung(const VolumeInfo& mount) const{
+	lock_guard<mutex> guard(hungLock);
+	return hungPoints.count(mount.mountPoint) > 0;
+}
+
+/**
+ @return the mount points that have timed out
+ */
+vector<string> MountWatchdog::hungMounts() const{
+	lock_guard<mutex> guard(hungLock);
+	vector<string> points(hungPoints.begin(), hungPoints.end());
+	sort(points.begin(), points.end());
+	return points;
+}
+
+/**
+ Wait for a run to finish, or to stop making progress
+ @param call the run
+ @param mount the mount it reads, marked hung if the deadline passes
+ @param abort stops waiting when set, without marking the mount
+ @param calls receives the number of calls the run made
+ @return true if the run finished
+ */
+bool MountWatchdog::wait(Call& call, const VolumeInfo& mount, const atomic<bool>& abort, uint64_t& calls){
+	unique_lock<mutex> guard(call.lock);
+	uint64_t seen = 0;
+	auto progressed = chrono::steady_clock::now();
+	while (!call.done){
+		if (abort){
+			calls = call.calls;
+			return false;
+		}
+		call.finished.wait_for(guard, pollInterval);
+		const uint64_t made = call.calls;
+		const auto now = chrono::steady_clock::now();
+		if (made != seen){
+			seen = made;
+			progressed = now;
+		}
+		else if (!call.done && now - progressed >= deadline){
+			calls = made;
+			lock_guard<mutex> hungGuard(hungLock);
+			hungPoints.insert(mount.mountPoint);
+			return false;
+		}
+	}
+	calls = call.calls;
+	return true;
+}
@@ -0,0 +1,86 @@
+//
+//  Watchdog.hpp
+//
+//  Copyright © 2020 Ravbug. All rights reserved.
+//
+
+#pragma once
+#include "Volumes.hpp"
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <functional>
+#include <unordered_set>
+
+using namespace std;
+
+/**
+ Keeps an unresponsive network mount from stalling a scan. Calls on suspected network mounts run on a thread
+ of their own while the caller waits with a deadline. A call that stops making progress is abandoned, with its
+ thread, which stays blocked in the kernel until the mount recovers or the program exits. The mount is then
+ marked hung, so the rest of it is skipped instead of abandoning a thread for every folder.
+ */
+class MountWatchdog{
+public:
+	//how long a call may go without progress before its mount counts as hung
+	static constexpr chrono::seconds defaultDeadline{10};
+
+	MountWatchdog(chrono::milliseconds deadline = defaultDeadline);
+	MountWatchdog(const MountWatchdog&) = delete;
+	MountWatchdog& operator=(const MountWatchdog&) = delete;
+
+	const VolumeInfo* mountFor(const string& path) const;
+	bool hung(const VolumeInfo&) const;
+	vector<string> hungMounts() const;
+
+	/**
+	 Run calls on a mount on a thread that can be abandoned
+	 @param mount the mount the calls read from
+	 @param work the calls. Captures must be by value, since the work may outlive the caller. Increment the
+	 counter after each call, each increment restarts the deadline.
+	 @param abort stops waiting when set
+	 @param calls receives the number of calls made, including those made before a timeout
+	 @return the result of the work, or nullptr if the deadline passed or the wait was aborted
+	 */
+	template<typename Result>
+	shared_ptr<Result> run(const VolumeInfo& mount, const function<void(Result&, atomic<uint64_t>&)>& work, const atomic<bool>& abort, uint64_t& calls){
+		auto call = make_shared<Call>();
+		auto result = make_shared<Result>();
+		thread([call, result, work]{
+			work(*result, call->calls);
+			call->finish();
+		}).detach();
+		return wait(*call, mount, abort, calls) ? result : nullptr;
+	}
+
+	const chrono::milliseconds deadline;
+
+private:
+	/**
+	 The state shared with the thread of one run, which outlives the caller if it is abandoned
+	 */
+	struct Call{
+		mutex lock;
+		condition_variable finished;
+		bool done = false;
+		atomic<uint64_t> calls{0};
+
+		void finish(){
+			lock_guard<mutex> guard(lock);
+			done = true;
+			finished.notify_all();
+		}
+	};
+
+	//suspected network mounts, deepest first so the innermost mount of a path is found first
+	vector<VolumeInfo> mounts;
+	mutable mutex hungLock;
+	unordered_set<string> hungPoints;
+
+	bool wait(Call&, const VolumeInfo&, const atomic<bool>& abort, uint64_t& calls);
+};
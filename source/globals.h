@@ -19,6 +19,25 @@ static inline const std::string AppVersion = "2.3";
 #define SELEVT 2004
 #define ACTEVT 2005
 #define RESEVT 2006
+#define FRAMETIMER 2007
+#define REVEALEVT 2008
+#define TOPFILESMENU 2009
+#define FILETYPESMENU 2010
+#define DUPLICATESMENU 2011
+#define METAREFRESH 2012
+#define SIZEMODEMENU 2013
+#define SEARCHMENU 2014
+#define QUERYMENU 2015
+#define TREEMAPMENU 2016
+#define SCANEVT 2017
+#define VOLUMESMENU 2018
+#define OWNERSMENU 2019
+#define IMPORTNCDUMENU 2020
+#define EXPORTNCDUMENU 2021
+#define DAEMONMENU 2022
+#define PAUSEMENU 2023
+#define ESTIMATEMENU 2024
+#define SLOWFOLDERSMENU 2025
 typedef int64_t fileSize;
 wxDEFINE_EVENT(progEvt, wxCommandEvent);
 
@@ -43,7 +62,8 @@ inline void fitWindowMinSize(wxWindow* window) {
  @note On Windows this function invokes stat, on other platforms it uses lstat
  */
 inline struct stat get_stat(const std::string& path){
-	struct stat buf;
+	//zeroed so a failed call reads as an empty record
+	struct stat buf{};
 #if defined _WIN32
 	stat(path.c_str(), &buf);
 #else
@@ -173,31 +193,37 @@ static inline bool path_too_long(const std::string& inPath){
 }
 
 /**
- Determines if with current permissions the target path can be written to (Windows only)
- @param inPath the path to the file
- @return true if the path is writable
+ Determines if with current permissions an item can be written to (Windows only)
+ @param mode the st_mode of the item
+ @return true if the item is writable
  */
-static inline bool is_writable(const std::string& inPath) {
-	mode_t mode = get_stat(inPath).st_mode;
+static inline bool is_writable(mode_t mode) {
 	return mode & _S_IWRITE;
 }
 
 /**
-Determines if with current permissions the target path can be executed (Windows only)
-@param inPath the path to the file
-@return true if the path is executable
+Determines if with current permissions an item can be executed (Windows only)
+@param mode the st_mode of the item
+@return true if the item is executable
 */
-static inline bool is_executable(const std::string& inPath) {
-	mode_t mode = get_stat(inPath).st_mode;
+static inline bool is_executable(mode_t mode) {
 	return mode & _S_IEXEC && mode & _S_IFDIR;
 }
 
 /**
-@param inPath the path to the file
-@return true if the file is hidden (according to GetFileAttributesA)
+@param path the path to the file
+@return the file's attribute bits (according to GetFileAttributesA), or 0 if they could not be read
+ */
+static inline uint32_t file_attributes(const std::string& path) {
+	DWORD attributes = GetFileAttributesA(path.c_str());
+	return attributes == INVALID_FILE_ATTRIBUTES ? 0 : attributes;
+}
+
+/**
+@param attributes the file's attribute bits, see file_attributes
+@return true if the file is hidden
  */
-static inline bool is_hidden(const std::string& inPath) {
-	DWORD attributes = GetFileAttributesA(inPath.c_str());
+static inline bool is_hidden(uint32_t attributes) {
 	return attributes & FILE_ATTRIBUTE_HIDDEN;
 }
 
@@ -219,12 +245,11 @@ static inline void reveal(const std::filesystem::path& fspath) {
 }
 
 /**
-Get the attributes for a file (Windows)
-@param path the path to the file
+Split the attributes of a file into flags (Windows)
+@param attributes the file's attribute bits, see file_attributes
 @return a boolean array representing the different file properties
 */
-static inline std::array<bool, 13> file_attributes_for(const std::string& path) {
-	DWORD attributes = GetFileAttributesA(path.c_str());
+static inline std::array<bool, 13> file_attributes_for(uint32_t attributes) {
 	int attr_const[] = {FILE_ATTRIBUTE_ARCHIVE, FILE_ATTRIBUTE_COMPRESSED, FILE_ATTRIBUTE_ENCRYPTED, FILE_ATTRIBUTE_INTEGRITY_STREAM, FILE_ATTRIBUTE_NOT_CONTENT_INDEXED, FILE_ATTRIBUTE_NO_SCRUB_DATA, FILE_ATTRIBUTE_OFFLINE, FILE_ATTRIBUTE_RECALL_ON_DATA_ACCESS, FILE_ATTRIBUTE_RECALL_ON_OPEN, FILE_ATTRIBUTE_REPARSE_POINT, FILE_ATTRIBUTE_SPARSE_FILE, FILE_ATTRIBUTE_SYSTEM, FILE_ATTRIBUTE_TEMPORARY, FILE_ATTRIBUTE_VIRTUAL};
 
 	std::array<bool, 13> attr;
@@ -352,34 +377,31 @@ static inline bool is_hidden(const std::string& strpath){
 
 
 /**
- Determines if an item is write-able using stat
- @param path the path to the file
+ Determines if an item is write-able from its mode
+ @param mode the st_mode of the item
  @return true if the file can be written to, false otherwise
  */
-static inline bool is_writable(const std::string& path){
-	mode_t mode = get_stat(path).st_mode;
+static inline bool is_writable(mode_t mode){
 	//owner or others can write
 	return mode & S_IWUSR || mode & S_IWOTH;
 }
 
 /**
- Determines if an item is executable using stat
- @param path the path to the file
+ Determines if an item is executable from its mode
+ @param mode the st_mode of the item
  @return true if file is executable, false otherwise
  */
-static inline bool is_executable(const std::string& path){
-	mode_t mode = get_stat(path).st_mode;
+static inline bool is_executable(mode_t mode){
 	//owner can exeucte or others can execute if the item is not a folder
 	return (mode & S_IXUSR || mode & S_IXOTH) && !(mode & S_IFDIR);
 }
 
 /**
- Gets a permissions string based on stat
- @param path the path to the item
+ Gets a permissions string from a mode
+ @param perm the st_mode of the item
  @return string representing the permissions
  */
-static inline std::string permstr_for(const std::string& path){
-	mode_t perm = get_stat(path).st_mode;
+static inline std::string permstr_for(mode_t perm){
 	char perms[10];
 	perms[0] = (perm & S_IRUSR) ? 'r' : '-';
     perms[1] = (perm & S_IWUSR) ? 'w' : '-';
@@ -396,12 +418,11 @@ static inline std::string permstr_for(const std::string& path){
 }
 
 /**
- Determines the st_mode type(s) of a path
- @param path the path to the file
+ Determines the st_mode type(s) of an item
+ @param perm the st_mode of the item
  @return a string for the type
  */
-static inline std::string modet_type_for(const std::string& path){
-	mode_t perm = get_stat(path).st_mode;
+static inline std::string modet_type_for(mode_t perm){
 	std::string types[] = {"regular file", "block device", "directory", "character device", "FIFO"};
 	int perms[] = {S_IFLNK, S_IFREG, S_IFBLK, S_IFDIR, S_IFCHR, S_IFIFO};
 	
@@ -416,12 +437,12 @@ static inline std::string modet_type_for(const std::string& path){
 }
 
 /**
- Returns the size of the file on disk, based on the number of blocks it consumes
- @param path the path to the file
+ Returns the size of an item on disk, based on the number of blocks it consumes
+ @param blocks the st_blocks of the item
  @return number of bytes representing the file	on disk
  */
-static inline fileSize size_on_disk(const std::string& path){
-	return get_stat(path).st_blocks * DEV_BSIZE;
+static inline fileSize size_on_disk(int64_t blocks){
+	return blocks * DEV_BSIZE;
 }
 
 #endif
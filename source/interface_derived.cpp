@@ -7,6 +7,19 @@
 // Place constructors and function definitons here.
 
 #include "interface_derived.h"
+#include "Epoch.hpp"
+#include "TopFilesFrame.hpp"
+#include "FileTypesFrame.hpp"
+#include "DuplicatesFrame.hpp"
+#include "SearchFrame.hpp"
+#include "QueryFrame.hpp"
+#include "TreemapFrame.hpp"
+#include "OwnersFrame.hpp"
+#include "EstimateFrame.hpp"
+#include "SlowFoldersFrame.hpp"
+#include "NcduFormat.hpp"
+#include "DaemonFrame.hpp"
+#include <future>
 #include <wx/generic/aboutdlgg.h>
 #include <wx/aboutdlg.h>
 #include <wx/gdicmn.h>
@@ -29,9 +42,29 @@ EVT_MENU(wxID_UP, MainFrame::OnUpdates)
 EVT_MENU(wxID_PROPERTIES, MainFrame::OnToggleSidebar)
 EVT_MENU(wxID_JUSTIFY_FILL, MainFrame::OnToggleLog)
 EVT_COMMAND(LOGEVT, progEvt, MainFrame::OnLog)
+EVT_COMMAND(RELOADEVT, progEvt, MainFrame::OnReloaded)
+EVT_COMMAND(REVEALEVT, progEvt, MainFrame::OnRevealPath)
+EVT_MENU(TOPFILESMENU, MainFrame::OnShowTopFiles)
+EVT_MENU(FILETYPESMENU, MainFrame::OnShowFileTypes)
+EVT_MENU(OWNERSMENU, MainFrame::OnShowOwners)
+EVT_MENU(ESTIMATEMENU, MainFrame::OnShowEstimates)
+EVT_MENU(SLOWFOLDERSMENU, MainFrame::OnShowSlowFolders)
+EVT_MENU(DUPLICATESMENU, MainFrame::OnShowDuplicates)
+EVT_MENU(SEARCHMENU, MainFrame::OnShowSearch)
+EVT_MENU(QUERYMENU, MainFrame::OnShowQuery)
+EVT_MENU(TREEMAPMENU, MainFrame::OnShowTreemap)
+EVT_MENU(VOLUMESMENU, MainFrame::OnShowVolumes)
+EVT_MENU(IMPORTNCDUMENU, MainFrame::OnImportNcdu)
+EVT_MENU(EXPORTNCDUMENU, MainFrame::OnExportNcdu)
+EVT_MENU(DAEMONMENU, MainFrame::OnShowDaemon)
+EVT_MENU(PAUSEMENU, MainFrame::OnPause)
+EVT_COMMAND(SCANEVT, progEvt, MainFrame::OnScanPath)
+EVT_MENU(SIZEMODEMENU, MainFrame::OnToggleSizeMode)
 EVT_BUTTON(wxID_OPEN, MainFrame::OnOpenFolder)
 EVT_BUTTON(COPYPATH, MainFrame::OnCopy)
 EVT_BUTTON(wxID_FIND, MainFrame::OnReveal)
+EVT_BUTTON(METAREFRESH, MainFrame::OnRefreshMeta)
+EVT_UPDATE_UI(METAREFRESH, MainFrame::OnUpdateRefreshMeta)
 EVT_BUTTON(wxID_STOP, MainFrame::OnAbort)
 EVT_BUTTON(wxID_CLEAR, MainFrame::OnClearLog)
 EVT_BUTTON(wxID_COPY, MainFrame::OnCopyLog)
@@ -73,26 +106,88 @@ MainFrame::MainFrame(wxWindow* parent) : MainFrameBase( parent )
 	
 	//set up the default values for the left side table
 #if defined __APPLE__ || defined __linux__
-	string properties[] = {"Name","Size","Type","Items","Modified","Created","Accessed","Is Hidden", "Is Read Only","Is Executable","Is Symbolic Link", "mode_t types","Permissions","Size on Disk"};
+	string properties[] = {"Name","Size","Type","Items","Modified","Created","Accessed","Is Hidden", "Is Read Only","Is Executable","Is Symbolic Link", "mode_t types","Permissions","Size on Disk","Owner"};
 #elif defined _WIN32
 	string properties[] = {"Name","Size","Type","Items","Modified","Created","Accessed","Is Hidden", "Is Read Only","Is Executable", "Is Symbolic Link", "Is Archive", "Is Compressed", "Is Encrypted", "Integrity Stream", "No Indexing", "No Scrubbing", "Is Offline", "Recall on Access", "Is Reparse Point", "Is Sparse File", "Is System", "Is Temporary", "Is Virtual"};
 #endif
-	for (const string& p : properties){
+	//rows computed from the scan, the same on every platform
+	string extraProperties[] = {"Largest Types", "Newest Item"};
+	extraPropertyRow = sizeof(properties) / sizeof(properties[0]);
+	auto addProperty = [&](const string& p){
 		//pairs, because 2 columns
 		wxVector<wxVariant> items;
 		items.push_back(p);
 		items.push_back("");
 		//add to the view
 		propertyList->AppendItem(items);
+	};
+	for (const string& p : properties){
+		addProperty(p);
+	}
+	for (const string& p : extraProperties){
+		addProperty(p);
 	}
 	
 	PLPropertyCol->SetWidth(wxCOL_WIDTH_AUTOSIZE);
+	
+	//the sidebar shows metadata captured during the scan, this re-reads it for the selected item
+	wxGridBagSizer* propertySizer = (wxGridBagSizer*)propertyPanel->GetSizer();
+	wxButton* refreshMetaBtn = new wxButton(propertyPanel, METAREFRESH, "Refresh from Disk");
+	propertySizer->Add(refreshMetaBtn, wxGBPosition(3, 0), wxGBSpan(1, 1), wxALL|wxEXPAND, 5);
+	ageChart = new AgeChart(propertyPanel);
+	propertySizer->Add(ageChart, wxGBPosition(4, 0), wxGBSpan(1, 1), wxALL|wxEXPAND, 5);
 	//create the sorting object
 	//fileBrowser->SetItemComparator(new sizeComparator());
 	
+	//reports over the whole scanned tree
+	wxMenu* menuReports = new wxMenu();
+	menuReports->Append(TOPFILESMENU, "Largest Files\tCtrl-T", "Show the largest files in the scanned folder");
+	menuReports->Append(FILETYPESMENU, "File Types", "Show how much space each type of file uses");
+	menuReports->Append(OWNERSMENU, "Owners", "Show how much space each user and group owns");
+	menuReports->Append(SLOWFOLDERSMENU, "Slowest Folders", "Show the folders that took longest to read, such as slow mounts");
+	menuReports->Append(ESTIMATEMENU, "Estimate Sizes", "Estimate the size of each folder in a few seconds by sampling, while the full scan runs");
+	menuReports->Append(DUPLICATESMENU, "Duplicate Files", "Find files with identical contents in the scanned folder");
+	menuReports->Append(SEARCHMENU, "Find by Name\tCtrl-F", "Search the scanned folder for items by name");
+	menuReports->Append(QUERYMENU, "Query\tCtrl-Shift-F", "Filter the scanned folder by size, age, owner and type");
+	menuReports->Append(TREEMAPMENU, "Treemap\tCtrl-Shift-T", "Draw the scanned folder as nested rectangles sized by their contents");
+	GetMenuBar()->Insert(1, menuReports, "Reports");
+	
+	//mounted volumes can be checked and scanned without choosing a folder
+	wxMenu* menuFile = GetMenuBar()->GetMenu(GetMenuBar()->FindMenu("File"));
+	menuFile->Insert(1, VOLUMESMENU, "Volumes\tCtrl-Shift-O", "Show how full each mounted volume is, and scan one");
+	//trees scanned by ncdu can be browsed here, and scans can be browsed with ncdu
+	menuFile->Insert(2, IMPORTNCDUMENU, "Import ncdu Export...", "Browse a tree saved with ncdu -o");
+	menuFile->Insert(3, EXPORTNCDUMENU, "Export as ncdu...", "Save the scanned folder in ncdu's export format");
+	//trees kept by a running daemon can be browsed without scanning them again
+	menuFile->Insert(4, DAEMONMENU, "Browse Daemon", "Browse the folders kept scanned by FatFileFinder --daemon");
+	//sizing can be held while the disk is needed for something else
+	menuFile->InsertCheckItem(5, PAUSEMENU, "Pause Sizing", "Hold every size operation until this is unchecked");
+	
+	//switches every view between apparent size and size on disk
+	wxMenu* menuHelp = GetMenuBar()->GetMenu(GetMenuBar()->FindMenu("Help"));
+	menuHelp->AppendCheckItem(SIZEMODEMENU, "Show Size on Disk\tCtrl-D", "Sort and total items by the space they use on disk instead of their length");
+	
+	//the log lists grouped scan errors and recent messages, built a row at a time as they are drawn
+	logView = new LogView(logPanel, errors);
+	logPanel->GetSizer()->Replace(logCtrl, logView);
+	logCtrl->Destroy();
+	logCtrl = nullptr;
+	logView->Bind(wxEVT_LIST_ITEM_ACTIVATED, [this](wxListEvent& e){
+		const string folder = logView->FolderAt(e.GetIndex());
+		if (!folder.empty()){
+			RevealPath(folder);
+		}
+	});
+	
 	// default unsplit
 	browserSplitter->Unsplit();
 	AddDisplay(nullptr);
+	
+	//start with the volume list, so full volumes can be found before choosing what to scan
+	CallAfter([this]{
+		wxCommandEvent e;
+		OnShowVolumes(e);
+	});
 }
 
 /**
@@ -100,10 +195,26 @@ MainFrame::MainFrame(wxWindow* parent) : MainFrameBase( parent )
  @param folder the path to the folder to size
  */
 void MainFrame::SizeRootFolder(const string& folder){
-	//deallocate existing data
-	delete currentDisplay[0]->data;
+	ResetRoot(folder);
+	wxDataViewItem i;
+	currentDisplay[0]->Size(nullptr,i,report);
+	SizingStarted(currentDisplay[0]);
+}
+
+/**
+ Replace the current tree with an empty root, closing every view of the old one
+ @param folder the path of the new root
+ */
+void MainFrame::ResetRoot(const string& folder){
+	//deallocate existing data once nothing is reading it, or still writing it.
+	//Every display may have a job writing into the old tree, so all of them are joined first.
+	for (FolderDisplay* disp : currentDisplay){
+		disp->Stop();
+		disp->DropReload();
+	}
+	epoch::retire(currentDisplay[0]->data);
 	//clear the log
-	logCtrl->SetValue("");
+	logView->Reset();
 	//hide the log
 	if (browserSplitter->IsSplit()) {
 		wxCommandEvent e;
@@ -113,22 +224,12 @@ void MainFrame::SizeRootFolder(const string& folder){
 	userClosedLog = false;
 	selected = nullptr;
 	
-	progCallback callback = [&](float progress, DirectoryData* data){
-		wxCommandEvent event(progEvt);
-		event.SetId(PROGEVT);
-		event.SetInt(progress * 100);
-		event.SetClientData(data);
-		
-		//invoke event to notify needs to update UI
-		wxPostEvent(this, event);
-	};
 	currentDisplay[0]->Clear();
 	currentDisplay[0]->data = new DirectoryData(folder, true);
-	wxDataViewItem i;
 	
 	//reset viewing area
+	//the other displays show items owned by the old root
 	for (int i = 1; i < currentDisplay.size(); i++){
-		delete currentDisplay[i]->data;
 		currentDisplay[i]->Destroy();
 	}
 	currentDisplay.erase(currentDisplay.begin()+1,currentDisplay.end());
@@ -138,8 +239,7 @@ void MainFrame::SizeRootFolder(const string& folder){
 	wxSize size = scrollView->GetBestVirtualSize();
 	scrollView->SetVirtualSize( size );
 	
-	//start size
-	currentDisplay[0]->Size(nullptr,i);
+	report = make_shared<ScanReport>();
 }
 
 /**
@@ -149,58 +249,118 @@ void MainFrame::SizeRootFolder(const string& folder){
 void MainFrame::PopulateSidebar(DirectoryData* ptr){
 	path p = ptr->Path;
 	propertyList->SetTextValue(p.filename().string(), 0, 1);
-	//make sure it exists
-	if (!exists(ptr->Path)){
+	//the summary row of a huge folder stands for many small files, which keep no metadata of their own
+	if (ptr->isSummary){
+		for (int i = 1; i < propertyList->GetItemCount(); i++){
+			propertyList->SetTextValue("", i, 1);
+		}
+		propertyList->SetTextValue(FolderDisplay::sizeToString(ptr->size), 1, 1);
+		propertyList->SetTextValue("Small files, open the row to list them", 2, 1);
+		propertyList->SetTextValue(to_string(ptr->num_items), 3, 1);
+		//the newest of the files
+		propertyList->SetTextValue(timeToString(ptr->meta.modified), 4, 1);
+		ageChart->Clear();
+		return;
+	}
+	//items that could not be read when scanned, or that were found missing on refresh
+	if (!ptr->meta.valid()){
 		for (int i = 1; i < propertyList->GetItemCount(); i++){
 			propertyList->SetTextValue("[Deleted]", i, 1);
 		}
+		ageChart->Clear();
 		return;
 	}
 	
+	//everything except the type comes from the metadata captured by the scan
+	const FileMeta& meta = ptr->meta;
 	propertyList->SetTextValue(ptr->isFolder? to_string(ptr->num_items) : "", 3, 1);
 	propertyList->SetTextValue(FolderDisplay::sizeToString(ptr->size), 1, 1);
 
-	string ext = p.extension().string();
-	//special case for files with no extension
-	propertyList->SetTextValue(FolderDisplay::GetFileDescription(ptr->Path), 2, 1);
+	//the type is read from the file's contents in the background, see OnFileDescribed
+	propertyList->SetTextValue("", 2, 1);
+	sniffer.request(ptr->Path);
 	
 	//modified date
-	propertyList->SetTextValue(timeToString(file_modify_time(ptr->Path)),4,1);
-	propertyList->SetTextValue(timeToString(file_create_time(ptr->Path)), 5, 1);
-	propertyList->SetTextValue(timeToString(file_access_time(ptr->Path)), 6, 1);
+	propertyList->SetTextValue(timeToString(meta.modified),4,1);
+	propertyList->SetTextValue(timeToString(meta.changed), 5, 1);
+	propertyList->SetTextValue(timeToString(meta.accessed), 6, 1);
 	
 	//Is read only
-	propertyList->SetTextValue(is_writable(ptr->Path)? "No" : "Yes", 8, 1);
+	propertyList->SetTextValue(is_writable(meta.mode)? "No" : "Yes", 8, 1);
 	
 	//Is executable
-	propertyList->SetTextValue(is_executable(ptr->Path)? "Yes" : "No", 9, 1);
+	propertyList->SetTextValue(is_executable(meta.mode)? "Yes" : "No", 9, 1);
 	
 	//is symbolic link
 	propertyList->SetTextValue(ptr->isSymlink? "Yes" : "No", 10, 1);
 	
 	//Is Hidden
+#if defined _WIN32
+	propertyList->SetTextValue(is_hidden(meta.attributes)? "Yes" : "No", 7, 1);
+#else
 	propertyList->SetTextValue(is_hidden(ptr->Path)? "Yes" : "No", 7, 1);
+#endif
 	
 #if defined __APPLE__ || defined __linux__
 	//mode_t
-	propertyList->SetTextValue(modet_type_for(ptr->Path), 11, 1);
+	propertyList->SetTextValue(modet_type_for(meta.mode), 11, 1);
 
 	//perms string
-	propertyList->SetTextValue(permstr_for(ptr->Path), 12, 1);
+	propertyList->SetTextValue(permstr_for(meta.mode), 12, 1);
+	
+	//Size on disk, folders include everything beneath them
+	string onDisk = "-";
+	if (!ptr->isFolder){
+		onDisk = FolderDisplay::sizeToString(size_on_disk(meta.blocks));
+	}
+	else if (ptr->isComplete()){
+		onDisk = FolderDisplay::sizeToString(ptr->allocated);
+	}
+	propertyList->SetTextValue(onDisk, 13, 1);
 	
-	//Size on disk
-	propertyList->SetTextValue(!ptr->isFolder? FolderDisplay::sizeToString(size_on_disk(ptr->Path)) : "-", 13, 1);
+	//owner
+	propertyList->SetTextValue(OwnerNames::describe(meta.uid, false) + " : " + OwnerNames::describe(meta.gid, true), 14, 1);
 	
 # elif defined _WIN32
 
 	//file args windows
-	auto args = file_attributes_for(ptr->Path);
+	auto args = file_attributes_for(meta.attributes);
 
 	for (int i = 0; i < args.size(); i++) {
 		propertyList->SetTextValue(args[i] ? "Yes" : "No", 11+i, 1);
 	}
 
 #endif
+	//largest extensions in the folder
+	string types;
+	if (ptr->isFolder && ptr->isComplete()){
+		for (const TypeShare& share : ptr->stats->topTypes){
+			if (share.count == 0 || share.bytes == 0){
+				continue;
+			}
+			types += (types.empty() ? "" : ", ") + (share.extension == 0 ? string("(none)") : "." + ExtensionTable::name(share.extension)) + " " + FolderDisplay::sizeToString(share.bytes);
+		}
+	}
+	propertyList->SetTextValue(types, extraPropertyRow, 1);
+	
+	//most recent change anywhere in the folder
+	propertyList->SetTextValue(ptr->isFolder && ptr->isComplete() ? timeToString(ptr->stats->newestModified) : "", extraPropertyRow + 1, 1);
+	
+	//how much of the item has gone unused
+	if (ptr->isFolder && ptr->isComplete()){
+		ageChart->SetBuckets(ptr->stats->modifiedAge, ptr->stats->accessedAge);
+	}
+	else if (!ptr->isFolder){
+		AgeBuckets modifiedAge, accessedAge;
+		const time_t now = time(nullptr);
+		modifiedAge.add(ptr->size, meta.modified, now);
+		accessedAge.add(ptr->size, meta.accessed, now);
+		ageChart->SetBuckets(modifiedAge, accessedAge);
+	}
+	else{
+		ageChart->Clear();
+	}
+	
 	//fix width
 	PLValueCol->SetWidth(wxCOL_WIDTH_AUTOSIZE);
 	
@@ -208,6 +368,54 @@ void MainFrame::PopulateSidebar(DirectoryData* ptr){
 	statusBar->SetStatusText(p.string());
 }
 
+/**
+ Show the type of a file in the sidebar, if it is still selected
+ @param path the file that was described
+ @param description its type
+ */
+void MainFrame::OnFileDescribed(const string& path, const string& description){
+	if (selected == nullptr || selected->Path != path){
+		return;
+	}
+	propertyList->SetTextValue(description, 2, 1);
+	PLValueCol->SetWidth(wxCOL_WIDTH_AUTOSIZE);
+}
+
+/**
+ Re-read the selected item's metadata from disk and show it
+ @param event (unused) the button event
+ */
+void MainFrame::OnRefreshMeta(wxCommandEvent& event){
+	if (!CanRefreshMeta()){
+		return;
+	}
+	if (!selected->refreshMeta()){
+		selected->meta = FileMeta();
+	}
+	PopulateSidebar(selected);
+}
+
+/**
+ The metadata is overwritten in place, so it may only be refreshed while nothing else can read or write it
+ @return true if the selected item is complete, no display is sizing, and no report or export is reading the tree
+ */
+bool MainFrame::CanRefreshMeta() const{
+	if (selected == nullptr || !selected->isComplete()){
+		return false;
+	}
+	for (const FolderDisplay* disp : currentDisplay){
+		if (!disp->abort){
+			return false;
+		}
+	}
+	//background readers hold a guard for as long as they copy from the tree
+	return !epoch::pinnedElsewhere();
+}
+
+void MainFrame::OnUpdateRefreshMeta(wxUpdateUIEvent& event){
+	event.Enable(CanRefreshMeta());
+}
+
 void MainFrame::OnCopy(wxCommandEvent& event){
 	if (selected == nullptr){
 		//if no pointer, don't try to copy
@@ -238,7 +446,8 @@ void MainFrame::OnReveal(wxCommandEvent& event){
 void MainFrame::OnReloadFolder(wxCommandEvent& event){
 	//get the folder data that was last selected
 	
-	if (selected == nullptr || !(selected->isFolder)){return;}
+	//folders still being sized will be finished by the running scan
+	if (selected == nullptr || !(selected->isFolder) || !selected->isComplete()){return;}
 	
 	FolderDisplay* toReload = nullptr;
 	int index = 0;
@@ -265,8 +474,129 @@ void MainFrame::OnReloadFolder(wxCommandEvent& event){
 	
 	//signal it to size again
 	toReload->Size(fdisp, item);
+	SizingStarted(toReload);
+}
+/**
+ Called after a display starts sizing. The folder it shows is sized first, and it waits if sizing is paused.
+ @param disp the display
+ */
+void MainFrame::SizingStarted(FolderDisplay* disp){
+	JobManager::shared().focus(disp->data);
+	disp->Pause(GetMenuBar()->IsChecked(PAUSEMENU));
+}
+
+/**
+ Pause or resume every size operation
+ @param event the menu event, checked to pause
+ */
+void MainFrame::OnPause(wxCommandEvent& event){
+	for (FolderDisplay* disp : currentDisplay){
+		disp->Pause(event.IsChecked());
+	}
+}
+
+/**
+ Reread a huge folder keeping all of its files as items, replacing its summary row. Its sized subfolders are kept.
+ @param summary the summary row that was activated
+ */
+void MainFrame::ExpandSummary(DirectoryData* summary){
+	for (size_t i = 0; i < currentDisplay.size(); i++){
+		if (currentDisplay[i]->data == summary->parent && summary->parent->isComplete()){
+			FolderDisplay* parent = i > 0 ? currentDisplay[i - 1] : nullptr;
+			currentDisplay[i]->Size(parent, parent != nullptr ? parent->GetCurrentItem() : wxDataViewItem(), nullptr, true);
+			SizingStarted(currentDisplay[i]);
+			return;
+		}
+	}
+}
+
+/**
+ Called when a reloaded folder has been swapped into the tree
+ @param event carries the replaced DirectoryData as client data, and the reloaded FolderDisplay as the event object
+ */
+void MainFrame::OnReloaded(wxCommandEvent& event){
+	DirectoryData* old = (DirectoryData*)event.GetClientData();
+	FolderDisplay* source = (FolderDisplay*)event.GetEventObject();
+	
+	//close the displays to the right of the reloaded folder, they show the old tree
+	auto it = find(currentDisplay.begin(), currentDisplay.end(), source);
+	if (it != currentDisplay.end()){
+		size_t idx = it - currentDisplay.begin();
+		for (size_t i = idx + 1; i < currentDisplay.size(); i++){
+			//destruction is deferred, so a job writing into the old tree is joined now, before it is retired
+			currentDisplay[i]->Stop();
+			currentDisplay[i]->DropReload();
+			currentDisplay[i]->Destroy();
+		}
+		currentDisplay.erase(currentDisplay.begin() + idx + 1, currentDisplay.end());
+		scrollSizer->SetCols(idx + 1);
+	}
 	
+	//the selection may point into the old tree
+	for (DirectoryData* d = selected; d != nullptr; d = d->parent){
+		if (d == old){
+			selected = nullptr;
+			break;
+		}
+	}
+	epoch::retire(old);
 }
+
+/**
+ Open the columns leading to an item and select it
+ @param target the full path to the item, which must be inside the current root
+ */
+void MainFrame::RevealPath(const string& target){
+	DirectoryData* root = currentDisplay[0]->data;
+	if (root == nullptr){
+		return;
+	}
+	path rel = path(target).lexically_relative(root->Path);
+	if (rel.empty() || *rel.begin() == ".."){
+		Log(target + " is not in the current folder");
+		return;
+	}
+	
+	//walk down from the root one path component at a time
+	epoch::Guard guard;
+	vector<DirectoryData*> chain;
+	DirectoryData* node = root;
+	for (const path& part : rel){
+		const string childPath = (path(node->Path) / part).string();
+		const ChildList* list = node->children();
+		DirectoryData* next = nullptr;
+		for (const vector<DirectoryData*>* items : {&list->subFolders, &list->files}){
+			for (DirectoryData* d : *items){
+				if (d->Path == childPath){
+					next = d;
+					break;
+				}
+			}
+			if (next != nullptr){
+				break;
+			}
+		}
+		if (next == nullptr || !next->isComplete()){
+			Log(target + " is not available in the scanned tree");
+			return;
+		}
+		chain.push_back(next);
+		node = next;
+	}
+	
+	//open a column for each folder on the way, then select the item in its parent's column
+	for (size_t i = 0; i + 1 < chain.size(); i++){
+		ChangeSelection(chain[i]);
+	}
+	for (FolderDisplay* disp : currentDisplay){
+		if (disp->data == node->parent){
+			disp->Select(node);
+		}
+	}
+	selected = node;
+	PopulateSidebar(node);
+}
+
 /** Brings up a folder selection dialog with a prompt
  * @param message the prompt for the user
  * @return path selected, or an empty string if nothing chosen
@@ -296,13 +626,24 @@ void MainFrame::OnOpenFolder(wxCommandEvent& event){
 		SizeRootFolder(path);
 	}
 }
+/**
+ Frees the tree once no job writes into it and no reader holds it. The displays are still alive here, and no more events reach them.
+ */
+MainFrame::~MainFrame(){
+	for (FolderDisplay* disp : currentDisplay){
+		disp->Stop();
+		disp->DropReload();
+	}
+	epoch::retire(currentDisplay[0]->data);
+	epoch::collect();
+}
+
 /**
  Closes the app
  */
 void MainFrame::OnExit(wxCommandEvent& event)
 {
-	//deallocate structure
-	delete currentDisplay[0]->data;
+	//the tree is freed when the window is destroyed
 	Close( true );
 }
 /**
@@ -323,6 +664,241 @@ void MainFrame::OnAbout(wxCommandEvent& event)
 	wxAboutBox(aboutInfo);
 }
 
+/**
+ Show the ranked list of the largest files
+ @param event (unused) the menu event
+ */
+void MainFrame::OnShowTopFiles(wxCommandEvent& event){
+	TopFilesFrame* frame = new TopFilesFrame(this, report);
+	frame->Show();
+}
+
+/**
+ Show the space owned by each user and group
+ @param event (unused) the menu event
+ */
+void MainFrame::OnShowOwners(wxCommandEvent& event){
+	OwnersFrame* frame = new OwnersFrame(this, report, [this]{
+		//break down the selected folder, or the folder containing the selected file
+		DirectoryData* folder = selected != nullptr ? selected : currentDisplay[0]->data;
+		if (folder != nullptr && !folder->isFolder){
+			folder = folder->parent;
+		}
+		return folder;
+	});
+	frame->Show();
+}
+
+/**
+ Point out the folder that held up the scan the most, once the scan has finished
+ */
+void MainFrame::LogSlowestFolder(){
+	if (report == nullptr || report.get() == loggedTimings){
+		return;
+	}
+	loggedTimings = report.get();
+	vector<FolderTiming> slowest = report->slowestFolders();
+	if (!slowest.empty() && slowest.front().micros >= slowFolderMicros){
+		const FolderTiming& f = slowest.front();
+		Log("Slowest folder: " + f.Path + " took " + SlowFoldersFrame::timeToString(f.micros) + " for " + to_string(f.entries) + " entries. See Reports > Slowest Folders.");
+	}
+}
+
+/**
+ Show the folders that took longest to read
+ @param event (unused) the menu event
+ */
+void MainFrame::OnShowSlowFolders(wxCommandEvent& event){
+	SlowFoldersFrame* frame = new SlowFoldersFrame(this, report);
+	frame->Show();
+}
+
+/**
+ Show quick estimates of the size of each folder in the scanned folder
+ @param event (unused) the menu event
+ */
+void MainFrame::OnShowEstimates(wxCommandEvent& event){
+	EstimateFrame* frame = new EstimateFrame(this, [this]{
+		return currentDisplay[0]->data;
+	}, currentDisplay[0]->Watchdog());
+	frame->Show();
+}
+
+/**
+ Show the space used by each file type
+ @param event (unused) the menu event
+ */
+void MainFrame::OnShowFileTypes(wxCommandEvent& event){
+	FileTypesFrame* frame = new FileTypesFrame(this, report);
+	frame->Show();
+}
+
+/**
+ Switch between apparent size and size on disk, and redraw the views that are not sizing
+ @param event the menu event, checked to use size on disk
+ */
+void MainFrame::OnToggleSizeMode(wxCommandEvent& event){
+	DirectoryData::sizeMode = event.IsChecked() ? SizeMode::Allocated : SizeMode::Apparent;
+	for (FolderDisplay* disp : currentDisplay){
+		if (disp->data == nullptr){
+			continue;
+		}
+		//views still sizing add their rows as they go and fix up percents when finished
+		if (disp->abort){
+			DirectoryData* current = disp->GetSelectedData();
+			disp->Clear();
+			disp->display();
+			if (current != nullptr){
+				disp->Select(current);
+			}
+		}
+		else{
+			disp->UpdateTitle(true);
+		}
+	}
+	if (currentDisplay[0]->data != nullptr){
+		UpdateTitlebar(progressBar->GetValue(), FolderDisplay::sizeToString(currentDisplay[0]->data->measured()));
+	}
+}
+
+/**
+ Show the name search window
+ @param event (unused) the menu event
+ */
+void MainFrame::OnShowSearch(wxCommandEvent& event){
+	SearchFrame* frame = new SearchFrame(this, report);
+	frame->Show();
+}
+
+/**
+ Show the volume list, creating it if it is not open
+ @param event (unused) the menu event
+ */
+void MainFrame::OnShowVolumes(wxCommandEvent& event){
+	if (volumes == nullptr){
+		volumes = new VolumesFrame(this, [this]{
+			return currentDisplay[0]->data;
+		});
+	}
+	volumes->Show();
+	volumes->Raise();
+}
+
+/**
+ Open a window browsing the trees of a running daemon
+ @param event (unused) the menu event
+ */
+void MainFrame::OnShowDaemon(wxCommandEvent& event){
+	DaemonFrame* frame = new DaemonFrame(this);
+	frame->Show();
+}
+
+/**
+ Browse a tree saved by ncdu, replacing the current one
+ @param event (unused) the menu event
+ */
+void MainFrame::OnImportNcdu(wxCommandEvent& event){
+	wxFileDialog dlg(this, "Import ncdu Export", "", "", "JSON files (*.json)|*.json|All files|*", wxFD_OPEN | wxFD_FILE_MUST_EXIST);
+	if (dlg.ShowModal() == wxID_CANCEL){
+		return;
+	}
+	//the header is read here, so files that are not exports are rejected before the current tree is closed
+	shared_ptr<NcduReader> reader;
+	try{
+		reader = make_shared<NcduReader>(dlg.GetPath().ToStdString());
+	}
+	catch(const runtime_error& e){
+		wxMessageBox(e.what(), "Import Failed", wxICON_ERROR);
+		return;
+	}
+	ResetRoot(reader->rootPath());
+	currentDisplay[0]->Import(reader, report);
+	SizingStarted(currentDisplay[0]);
+}
+
+/**
+ Save the scanned tree in ncdu's export format on a background thread
+ @param event (unused) the menu event
+ */
+void MainFrame::OnExportNcdu(wxCommandEvent& event){
+	DirectoryData* root = currentDisplay[0]->data;
+	if (root == nullptr || !root->isComplete()){
+		wxMessageBox("Wait for sizing to finish, then export again.", "Export as ncdu");
+		return;
+	}
+	wxFileDialog dlg(this, "Export as ncdu", "", "export.json", "JSON files (*.json)|*.json", wxFD_SAVE | wxFD_OVERWRITE_PROMPT);
+	if (dlg.ShowModal() == wxID_CANCEL){
+		return;
+	}
+	const string file = dlg.GetPath().ToStdString();
+	
+	//do not return until the worker has pinned the tree, so a new scan cannot free it mid-export
+	promise<void> pinned;
+	future<void> ready = pinned.get_future();
+	thread([this, root, file, pinned = std::move(pinned)]() mutable{
+		epoch::Guard guard;
+		pinned.set_value();
+		string error;
+		try{
+			writeNcdu(root, file);
+		}
+		catch(const runtime_error& e){
+			error = e.what();
+		}
+		CallAfter([this, file, error]{
+			if (error.empty()){
+				Log("Exported to " + file);
+			}
+			else{
+				wxMessageBox(error, "Export Failed", wxICON_ERROR);
+			}
+		});
+	}).detach();
+	ready.wait();
+}
+
+/**
+ Scan a folder chosen in another window
+ @param event the event, with the folder's path as its string
+ */
+void MainFrame::OnScanPath(wxCommandEvent& event){
+	SizeRootFolder(event.GetString().ToStdString());
+	Raise();
+}
+
+/**
+ Show the treemap window
+ @param event (unused) the menu event
+ */
+void MainFrame::OnShowTreemap(wxCommandEvent& event){
+	TreemapFrame* frame = new TreemapFrame(this, [this]{
+		return currentDisplay[0]->data;
+	});
+	frame->Show();
+}
+
+/**
+ Show the query window
+ @param event (unused) the menu event
+ */
+void MainFrame::OnShowQuery(wxCommandEvent& event){
+	QueryFrame* frame = new QueryFrame(this, [this]{
+		return currentDisplay[0]->data;
+	});
+	frame->Show();
+}
+
+/**
+ Search the scanned folder for identical files
+ @param event (unused) the menu event
+ */
+void MainFrame::OnShowDuplicates(wxCommandEvent& event){
+	DuplicatesFrame* frame = new DuplicatesFrame(this, [this]{
+		return currentDisplay[0]->data;
+	});
+	frame->Show();
+}
+
 /**
 Toggle the info sidebar
 Called when the menu is activated
@@ -376,8 +952,10 @@ FolderDisplay* MainFrame::ChangeSelection(DirectoryData* sender){
 	}
 	//at end? only need to add another display
 	if (idx < currentDisplay.size()-1){
-		//remove from current display by deallocating
+		//remove from current display by deallocating. Destruction is deferred, so a reload still running in one is stopped now.
 		for (int i = idx+1; i < currentDisplay.size(); i++){
+			currentDisplay[i]->Stop();
+			currentDisplay[i]->DropReload();
 			currentDisplay[i]->Destroy();
 		}
 		//update vector size
@@ -387,5 +965,7 @@ FolderDisplay* MainFrame::ChangeSelection(DirectoryData* sender){
 	}
 	FolderDisplay* f = AddDisplay(sender);
 	f->display();
+	//a folder opened while the scan continues is sized before the rest of the tree
+	JobManager::shared().focus(sender);
 	return f;
 }
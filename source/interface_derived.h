@@ -11,10 +11,15 @@
 #include "globals.h"
 #include "interface.h"
 #include "FolderDisplay.hpp"
+#include "FileSniffer.hpp"
+#include "VolumesFrame.hpp"
+#include "AgeChart.hpp"
+#include "LogView.hpp"
 #include <thread>
 #include <unordered_set>
 #include <wx/treebase.h>
 #include <wx/clipbrd.h>
+#include <wx/weakref.h>
 
 /**
  Defines the main window and all of its behaviors and members.
@@ -23,37 +28,60 @@ class MainFrame : public MainFrameBase
 {
 public:
 	MainFrame(wxWindow* parent = nullptr);
+	~MainFrame();
 	/**
 	Log a message to the console
 	@param msg the string to log
 	*/
 	void Log(const wxString& msg) {
-		logCtrl->AppendText(msg + "\n");
-		if (!userClosedLog && !browserSplitter->IsSplit()) {
-			auto e = wxCommandEvent();
-			OnToggleLog(e);
-		}
+		logView->Add(msg);
+		ShowLog();
 	}
 	void OnLog(wxCommandEvent& evt) {
 		Log(evt.GetString());
 	}
+	void OnReloaded(wxCommandEvent&);
+	void OnRevealPath(wxCommandEvent& evt){
+		RevealPath(evt.GetString().ToStdString());
+	}
+	void RevealPath(const string&);
 	void PopulateSidebar(DirectoryData*);
+	void OnFileDescribed(const string&, const string&);
 	
 	FolderDisplay* ChangeSelection(DirectoryData*);
+	void ExpandSummary(DirectoryData*);
 	
-	void ProgressUpdate(int progress){
+	/**
+	 Show the progress of a display's job
+	 @param progress the percentage done
+	 @param source the display reporting it
+	 */
+	void ProgressUpdate(int progress, FolderDisplay* source){
 		progressBar->SetValue(progress);
 		if (progress == 100){
-			currentDisplay[0]->data->recalculateStats();
+			//only the root's scan writes into the root's tree. A reload on the right is swapped in with its totals,
+			//and finishing it says nothing about whether the root's scan is still running.
+			if (source == currentDisplay[0]){
+				currentDisplay[0]->data->recalculateStats();
+			}
 			for (FolderDisplay* disp : currentDisplay){
 				disp->UpdateTitle();
 			}
+			//the scanned total is now known, so the volume list can show unaccounted space
+			if (volumes != nullptr){
+				volumes->Populate();
+			}
+			LogSlowestFolder();
 		}
-		UpdateTitlebar(progress, FolderDisplay::sizeToString(currentDisplay[0]->data->size));
+		if (logView->UpdateErrors(progress == 100)){
+			ShowLog();
+		}
+		UpdateTitlebar(progress, FolderDisplay::sizeToString(currentDisplay[0]->data->measured()));
 	}
 	
 	FolderDisplay* AddDisplay(DirectoryData* model){
 		FolderDisplay* f = new FolderDisplay(scrollView,this,model);
+		f->CollectErrors(errors);
 		int count = (int)scrollSizer->GetItemCount();
 		scrollSizer->SetCols(++count);
 		scrollSizer->Add(f, wxGBPosition( 0, count-1), wxGBSpan( 1, 1 ), wxALL|wxEXPAND, 0);
@@ -78,11 +106,45 @@ public:
 	
 private:
 	bool userClosedLog = false;
+	AgeChart* ageChart;
+	//errors of every display's scans, grouped instead of logged one by one
+	shared_ptr<ErrorCollector> errors = make_shared<ErrorCollector>();
+	//replaces the generated text log, which grew with every message
+	LogView* logView;
+	//index of the first sidebar row shared by all platforms
+	int extraPropertyRow = 0;
 
 	string GetPathFromDialog(const string&);
 	void SizeRootFolder(const string&);
+	void ResetRoot(const string&);
+	void SizingStarted(FolderDisplay*);
+	void LogSlowestFolder();
+	bool CanRefreshMeta() const;
+	/**
+	 Show the log panel, unless the user closed it
+	 */
+	void ShowLog(){
+		if (!userClosedLog && !browserSplitter->IsSplit()) {
+			auto e = wxCommandEvent();
+			OnToggleLog(e);
+		}
+	}
 	
 	vector<FolderDisplay*> currentDisplay;
+	//the volume list, cleared automatically when its window closes
+	wxWeakRef<VolumesFrame> volumes;
+	//whole-tree statistics for the current root
+	shared_ptr<ScanReport> report;
+	//the report whose slowest folder was logged, so it is logged once per scan
+	const ScanReport* loggedTimings = nullptr;
+	//folders that take longer than this to read are pointed out when the scan finishes
+	static constexpr uint64_t slowFolderMicros = 1000000;
+	//reads file types for the sidebar without blocking the UI
+	FileSniffer sniffer{[this](const string& path, const string& description){
+		CallAfter([this, path, description]{
+			OnFileDescribed(path, description);
+		});
+	}};
 	
 	void OnExit(wxCommandEvent&);
 	void OnAbout(wxCommandEvent&);
@@ -92,6 +154,24 @@ private:
 	void OnToggleSidebar(wxCommandEvent&);
 	void OnToggleLog(wxCommandEvent&);
 	void OnReveal(wxCommandEvent&);
+	void OnRefreshMeta(wxCommandEvent&);
+	void OnUpdateRefreshMeta(wxUpdateUIEvent&);
+	void OnShowTopFiles(wxCommandEvent&);
+	void OnShowFileTypes(wxCommandEvent&);
+	void OnShowOwners(wxCommandEvent&);
+	void OnShowEstimates(wxCommandEvent&);
+	void OnShowSlowFolders(wxCommandEvent&);
+	void OnShowDuplicates(wxCommandEvent&);
+	void OnShowSearch(wxCommandEvent&);
+	void OnShowQuery(wxCommandEvent&);
+	void OnShowTreemap(wxCommandEvent&);
+	void OnShowVolumes(wxCommandEvent&);
+	void OnImportNcdu(wxCommandEvent&);
+	void OnExportNcdu(wxCommandEvent&);
+	void OnShowDaemon(wxCommandEvent&);
+	void OnPause(wxCommandEvent&);
+	void OnScanPath(wxCommandEvent&);
+	void OnToggleSizeMode(wxCommandEvent&);
 
 
 	void OnSourceCode(wxCommandEvent&){
@@ -105,7 +185,7 @@ private:
 		for (FolderDisplay* disp : currentDisplay){
 			if (!disp->abort){
 				stopped = true;
-				disp->abort = true;
+				disp->Stop();
 			}
 		}
 		if (stopped){
@@ -113,12 +193,12 @@ private:
 		}
 	}
 	void OnClearLog(wxCommandEvent& event) {
-		logCtrl->SetValue("");
+		logView->Reset();
 	}
 	void OnCopyLog(wxCommandEvent& event) {
 		//copy values to the clipboard
 		if (wxTheClipboard->Open()) {
-			wxTheClipboard->SetData(new wxTextDataObject(logCtrl->GetValue()));
+			wxTheClipboard->SetData(new wxTextDataObject(logView->Text()));
 			wxTheClipboard->Flush();
 			wxTheClipboard->Close();
 		}
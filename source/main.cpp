@@ -15,23 +15,106 @@
 #endif
 
 #include "interface_derived.h"
+#include "QueryEngine.hpp"
+#include "NcduFormat.hpp"
+#include "Daemon.hpp"
+#include "SizeEstimator.hpp"
+#if defined _WIN32
+#include <wx/msw/wrapwin.h>
+#include <cstdio>
+#endif
 
 class FatFileFinder: public wxApp
 {
 public:
     virtual bool OnInit();
+    virtual int OnRun();
     virtual int FilterEvent(wxEvent&);
-    MainFrame* frame;
+    MainFrame* frame = nullptr;
+    //exit code of a command line command, or -1 to show the window
+    int commandResult = -1;
 };
 
+#if defined _WIN32
 wxIMPLEMENT_APP(FatFileFinder);
+#else
+wxIMPLEMENT_APP_NO_MAIN(FatFileFinder);
+#endif
+
+/**
+ Run a command line command instead of showing the window
+ @return the exit code, or -1 if the arguments are not a command
+ */
+static int runCommand(int argc, char** argv){
+	if (isQueryCommand(argc, argv)){
+		return queryCommand(argc, argv);
+	}
+	if (isExportCommand(argc, argv)){
+		return exportCommand(argc, argv);
+	}
+	if (isDaemonCommand(argc, argv)){
+		return daemonCommand(argc, argv);
+	}
+	if (isAskCommand(argc, argv)){
+		return askCommand(argc, argv);
+	}
+	if (isEstimateCommand(argc, argv)){
+		return estimateCommand(argc, argv);
+	}
+	return -1;
+}
+
+#if !defined _WIN32
+//commands do not need a display, so they run before wxWidgets starts
+int main(int argc, char** argv){
+	const int result = runCommand(argc, argv);
+	return result >= 0 ? result : wxEntry(argc, argv);
+}
+#endif
+
 bool FatFileFinder::OnInit()
 {
+#if defined _WIN32
+	//Windows starts in WinMain, so commands are handled here instead
+	vector<string> args;
+	vector<char*> pointers;
+	for (int i = 0; i < argc; i++){
+		args.push_back(argv[i].ToStdString());
+	}
+	for (string& a : args){
+		pointers.push_back(&a[0]);
+	}
+	//the app is built for the GUI subsystem, so it starts without a console. Commands print to the one
+	//they were run from, if there is one. The shell does not wait for a GUI app, so the prompt may come first.
+	if (argc > 1 && AttachConsole(ATTACH_PARENT_PROCESS)){
+		freopen("CONOUT$", "w", stdout);
+		freopen("CONOUT$", "w", stderr);
+		freopen("CONIN$", "r", stdin);
+		//cout and cerr write through the C streams, which now point at the console
+		ios::sync_with_stdio(true);
+	}
+	commandResult = runCommand(argc, pointers.data());
+	if (commandResult >= 0){
+		return true;
+	}
+#endif
     frame = new MainFrame( );
     frame->Show( true );
     return true;
 }
 
+/**
+ Run the event loop, unless a command was run from OnInit
+ @return the exit code
+ */
+int FatFileFinder::OnRun()
+{
+	if (commandResult >= 0){
+		return commandResult;
+	}
+	return wxApp::OnRun();
+}
+
 //for catching global events
 int FatFileFinder::FilterEvent(wxEvent& event) {
 	//logging
@@ -61,20 +144,16 @@ int FatFileFinder::FilterEvent(wxEvent& event) {
 		if (data->isFolder){
 			frame->ChangeSelection(data);
 		}
+		else if (data->isSummary){
+			frame->ExpandSummary(data);
+		}
 		delete ptr;
 		delete ce;
 		return true;
 	}
 	else if (event.GetId() == RESEVT && event.IsCommandEvent()){
-		wxCommandEvent* ce = (wxCommandEvent*)(event.Clone());
-		//extract the pointer from the client data
-		uintptr_t* ptr = (uintptr_t*)(ce->GetClientData());
-		
 		//update progress bar and header
-		frame->ProgressUpdate((int)*ptr);
-		
-		delete ptr;
-		delete ce;
+		frame->ProgressUpdate(((wxCommandEvent&)event).GetInt(), (FolderDisplay*)event.GetEventObject());
 		return true;
 	}
     return -1;